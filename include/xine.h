@@ -344,6 +344,23 @@ int  xine_get_param (xine_stream_t *stream, int param) XINE_PROTECTED;
 #define XINE_PARAM_EARLY_FINISHED_EVENT   31 /* send event when demux finish*/
 #define XINE_PARAM_GAPLESS_SWITCH         32 /* next stream only gapless swi*/
 #define XINE_PARAM_DELAY_FINISHED_EVENT   33 /* 1/10sec,0=>disable,-1=>forev*/
+#define XINE_PARAM_TRICK_PLAY             34 /* keyframes only, see below   */
+#define XINE_PARAM_EXACT_SEEK             35 /* bool, see below             */
+
+/*
+ * XINE_PARAM_TRICK_PLAY:
+ * fast forward/rewind by showing keyframes only. value is the playback
+ * rate in XINE_FINE_SPEED_NORMAL units, negative values play backwards,
+ * 0 resumes normal playback from the last keyframe shown. audio is muted
+ * meanwhile. only works when the demuxer reports DEMUX_CAP_TRICKPLAY.
+ *
+ * XINE_PARAM_EXACT_SEEK:
+ * make xine_play () with a start_time show exactly the frame at that time.
+ * the demuxer seeks to the keyframe before, and frames up to the target
+ * are decoded but neither post processed nor displayed. see
+ * XINE_STREAM_INFO_SEEK_DROPPED_FRAMES and XINE_STREAM_INFO_SEEK_TIME
+ * for what it did cost.
+ */
 
 /*
  * speed values for XINE_PARAM_SPEED parameter.
@@ -1029,6 +1046,21 @@ const char *xine_get_meta_info   (xine_stream_t *stream, int info) XINE_PROTECTE
 #define XINE_STREAM_INFO_DVD_CHAPTER_COUNT  33
 #define XINE_STREAM_INFO_DVD_ANGLE_NUMBER   34
 #define XINE_STREAM_INFO_DVD_ANGLE_COUNT    35
+#define XINE_STREAM_INFO_SEEK_DROPPED_FRAMES 36 /* last exact seek: frames decoded but not shown */
+#define XINE_STREAM_INFO_SEEK_TIME          37 /* last exact seek: msecs until target frame */
+#define XINE_STREAM_INFO_NET_LOST_PACKETS      38 /* network inputs: packets never received */
+#define XINE_STREAM_INFO_NET_REORDERED_PACKETS 39 /* network inputs: packets put back in order */
+#define XINE_STREAM_INFO_NET_LATE_PACKETS      40 /* network inputs: duplicate or too late packets */
+#define XINE_STREAM_INFO_NET_VARIANT           41 /* adaptive streams: index of the current variant */
+#define XINE_STREAM_INFO_NET_THROUGHPUT        42 /* adaptive streams: measured download rate, bit/s, at most INT_MAX */
+#define XINE_STREAM_INFO_NET_VARIANT_SWITCHES  43 /* adaptive streams: variant changes so far */
+#define XINE_STREAM_INFO_NET_BUFFER_LENGTH     44 /* adaptive streams: msecs buffered ahead */
+#define XINE_STREAM_INFO_NET_RESOLVE_TIME      45 /* network inputs: msecs spent resolving the last host name */
+#define XINE_STREAM_INFO_NET_CONNECT_TIME      46 /* network inputs: msecs until the last tcp connection was up */
+#define XINE_STREAM_INFO_NET_TLS_HANDSHAKES    47 /* network inputs: full TLS handshakes so far */
+#define XINE_STREAM_INFO_NET_TLS_RESUMED       48 /* network inputs: TLS sessions resumed so far */
+#define XINE_STREAM_INFO_NET_REBUFFERS         49 /* network inputs: buffer underruns after start */
+#define XINE_STREAM_INFO_NET_REBUFFER_TIME     50 /* network inputs: msecs spent rebuffering after start */
 
 /* possible values for XINE_STREAM_INFO_VIDEO_AFD */
 #define XINE_VIDEO_AFD_NOT_PRESENT         -1
@@ -1981,6 +2013,9 @@ typedef struct {
   int                 buffering;    /* currently filling buffer */
   int                 enabled;      /* buffer disabled by engine */
   int                 type;         /* 0=buffer put, 1=buffer get */
+  int64_t             in_bitrate;   /* measured input rate, 0 while unknown */
+  int                 start_mark;   /* msecs buffered before playback (re)starts */
+  int                 rebuffers;    /* underruns after start */
 } xine_nbc_stats_data_t;
 
 /*
@@ -212,6 +212,16 @@ struct demux_plugin_s {
 
 #define DEMUX_CAP_CHAPTERS             0x00000080
 
+/*
+ * DEMUX_CAP_TRICKPLAY:
+ *   seek (start_time) is cheap and resumes at or shortly before the
+ *   requested time, so the engine may step through the stream showing
+ *   one keyframe per step (XINE_PARAM_TRICK_PLAY).
+ *   Not shared with INPUT capabilities.
+ */
+
+#define DEMUX_CAP_TRICKPLAY            0x00010000
+
 
 #define DEMUX_OPTIONAL_UNSUPPORTED    0
 #define DEMUX_OPTIONAL_SUCCESS        1
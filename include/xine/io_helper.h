@@ -50,7 +50,8 @@
  *   timeout_sec   timeout in seconds
  *
  * An other thread can abort this function if stream != NULL by setting
- * stream->demux_action_pending.
+ * stream->demux_action_pending (see _x_action_raise ()). This wakes up
+ * the waiting thread immediately.
  *
  * return value :
  *   XIO_READY     the file descriptor is ready for cmd
@@ -65,11 +66,18 @@ int _x_io_select (xine_stream_t *stream, int fd, int state, int timeout_msec) XI
  * open a tcp connection
  *
  * params :
- *   stream        needed for reporting errors but may be NULL
+ *   stream        needed for aborting and reporting errors but may be NULL
  *   host          address of target
  *   port          port on target
  *
- * returns a socket descriptor or -1 if an error occured
+ * Host names are resolved in the background and cached for
+ * media.network.dns_cache_ttl seconds. When a host has several addresses,
+ * connection attempts are started 250 msecs apart and the first one that
+ * succeeds is used (RFC 8305). Resolve and connect times are stored in
+ * XINE_STREAM_INFO_NET_RESOLVE_TIME and XINE_STREAM_INFO_NET_CONNECT_TIME.
+ *
+ * returns a connected, non-blocking socket descriptor or -1 if an error
+ * occured or the attempt was aborted (see _x_io_select ())
  */
 int _x_io_tcp_connect(xine_stream_t *stream, const char *host, int port) XINE_PROTECTED XINE_USED;
 
@@ -143,4 +151,45 @@ int _x_io_tcp_read_line(xine_stream_t *stream, int sock, char *str, int size) XI
  */
 int _x_io_tcp_close(xine_stream_t *stream, int fd) XINE_PROTECTED;
 
+/*
+ * I/O reactor
+ *
+ * Instead of running an own thread per stream that waits for its socket,
+ * network input plugins can register the socket with the engine. A few
+ * shared threads per xine instance wait for all registered sockets and
+ * call back when one is ready, or when the watch timeout expires.
+ *
+ * The callback gets XIO_READ_READY and/or XIO_WRITE_READY, or 0 on
+ * timeout. It must not block. It returns the next timeout in
+ * milliseconds, XIO_WATCH_NO_TIMEOUT, or XIO_WATCH_STOP to stop calling
+ * back until the watch is removed. Callbacks of one watch never run
+ * concurrently.
+ */
+
+#define XIO_WATCH_NO_TIMEOUT  -1
+#define XIO_WATCH_STOP        -2
+
+typedef struct xine_io_watch_s xine_io_watch_t;
+typedef int (*xine_io_watch_cb_t) (void *data, int fd, int state);
+
+/*
+ * register a socket
+ *
+ * params :
+ *   xine          xine instance
+ *   fd            socket descriptor, or -1 for a timer only
+ *   state         XIO_READ_READY, XIO_WRITE_READY
+ *   timeout_msec  first timeout, or XIO_WATCH_NO_TIMEOUT
+ *
+ * returns the watch or NULL if an error occured
+ */
+xine_io_watch_t *_x_io_watch_add (xine_t *xine, int fd, int state, int timeout_msec,
+                                  xine_io_watch_cb_t cb, void *data) XINE_PROTECTED;
+
+/*
+ * unregister a socket. Waits for a running callback to finish, and may be
+ * called from within the callback itself. Remove before closing the socket.
+ */
+void _x_io_watch_remove (xine_io_watch_t **watch) XINE_PROTECTED;
+
 #endif
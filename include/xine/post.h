@@ -170,6 +170,7 @@ struct post_out_s {
 
 /* helper structure for intercepting video port calls */
 typedef struct post_video_port_s post_video_port_t;
+typedef struct post_band_op_s post_band_op_t;
 struct post_video_port_s {
 
   /* the new public port with replaced function pointers */
@@ -227,6 +228,16 @@ struct post_video_port_s {
   /* you can fill this to your liking */
   void                     *user_data;
 
+  /* fill this in if your filter works on single rows of YV12 frames and
+   * calls _x_post_band_draw() from its draw(); fill in op and return 1 to
+   * filter the given frame, or return 0 to pass it unchanged */
+  int (*band_op)(post_video_port_t *self, vo_frame_t *frame, post_band_op_t *op);
+
+  /* set this if your draw() keeps earlier frames for later use (eg. for
+   * deinterlacing); otherwise, frames dropped after an exact seek will
+   * not reach it */
+  int                       need_all_frames;
+
 #ifdef POST_INTERNAL
   /* some of the above members are to be directly included here, but
    * adding the structures would mean that post_video_port_t becomes
@@ -390,6 +401,42 @@ static inline void _x_post_unlock(post_plugin_t *post) {
 int _x_post_dispose(post_plugin_t *post) XINE_PROTECTED;
 
 
+/* slice parallel processing for video filters.
+ * Splits rows (or columns) 0..n-1 into up to POST_SLICES_MAX bands with borders
+ * at multiples of align, and runs func on each of them. The calling thread
+ * works on bands itself, worker threads shared by all post plugins of this
+ * engine take the others; calls from several streams may run side by side.
+ * Returns when all bands are done.
+ * func may read outside of [start, end), eg. the rows a neighbourhood filter
+ * needs, but must only write inside. band < POST_SLICES_MAX numbers the band
+ * for per band scratch memory; the split stays the same as long as n does. */
+#define POST_SLICES_MAX 16
+typedef void (*post_slice_func_t) (void *data, int band, int start, int end);
+void _x_post_slices (post_plugin_t *post, int n, int align, post_slice_func_t func, void *data) XINE_PROTECTED;
+
+
+/* fused band filters.
+ * Per pixel filters on YV12 frames (see band_op above) dont need a frame of
+ * their own. When the next port is a band filter too, _x_post_band_draw()
+ * hands the op over to it; the last one of such a chain runs all ops in one
+ * pass over row tiles small enough to stay in cache, and in place when the
+ * frame was filled by a post plugin rather than by a decoder.
+ * func filters luma rows [y0, y1) and chroma rows [y0 / 2, (y1 + 1) / 2)
+ * with even y0 from src to dst; src may be the same as dst. Several threads
+ * may run it at once, and not before the next plugin's draw(), so let it
+ * read a copy of the parameters taken by band_op rather than live ones. */
+#define POST_BAND_OPS_MAX 8
+struct post_band_op_s {
+  void (*func) (void *data, vo_frame_t *src, vo_frame_t *dst, int y0, int y1);
+  void  *data;
+};
+int _x_post_band_draw (vo_frame_t *frame, xine_stream_t *stream) XINE_PROTECTED;
+
+/* tell the post layer that nobody else reads from frame, eg. because it came
+ * from get_frame() and was just filled by your plugin. Call before draw(). */
+void _x_post_frame_writable (vo_frame_t *frame) XINE_PROTECTED;
+
+
 /* macros to handle usage counter */
 
 /* WARNING!
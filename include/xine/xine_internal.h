@@ -108,6 +108,14 @@ struct xine_s {
 
   int                        flags;
 
+  /* shared network i/o threads, see io_helper.c */
+  struct xine_io_reactor_s  *io_reactor;
+  pthread_mutex_t            io_reactor_lock;
+
+  /* worker threads for slice parallel post plugins, see post.c */
+  struct xine_post_slices_s *post_slices;
+  pthread_mutex_t            post_slices_lock;
+
   /* set when pauseing with port ticket granted, for XINE_PARAM_VO_SINGLE_STEP. */
   int                        live_pause;
   pthread_mutex_t            pause_mutex;
@@ -280,6 +288,7 @@ struct xine_stream_s {
   pthread_t                  demux_thread;
   pthread_mutex_t            demux_lock;
   pthread_mutex_t            demux_action_lock;
+  int                        demux_action_fd[2]; /* readable while demux_action_pending */
   pthread_cond_t             demux_resume;
   pthread_mutex_t            demux_mutex; /* used in _x_demux_... functions to synchronize order of pairwise A/V buffer operations */
 
@@ -289,6 +298,19 @@ struct xine_stream_s {
 
   int                        delay_finish_event; /* delay event in 1/10 sec units. 0=>no delay, -1=>forever */
 
+  int                        trick_speed; /* XINE_PARAM_TRICK_PLAY rate, 0 => off */
+
+  /* frame accurate seek (XINE_PARAM_EXACT_SEEK). the exact_seek_*
+   * fields below are protected by first_frame_lock. the per frame paths
+   * peek at exact_seek_state without it, and lock only when it is set. */
+  int                        exact_seek;
+  int                        exact_seek_state;   /* 0 => off, 1 => waiting for target pts, 2 => dropping */
+  int                        exact_seek_time;    /* target, msecs */
+  int                        exact_seek_dropped;
+  int64_t                    exact_seek_pts;     /* target, valid in state 2 */
+  int64_t                    exact_seek_last_pts; /* of the last frame with one, for frames without */
+  struct timespec            exact_seek_start;
+
   int                        slave_affection;   /* what operations need to be propagated down to the slave? */
 
   int                        err;
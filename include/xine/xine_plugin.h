@@ -97,7 +97,7 @@ typedef struct {
 
 /* special info for generic loadable module
  * examples:
- *   { .type = "tls_v1" },
+ *   { .type = "tls_v2" },
  *   { .type = "gl_v1", .sub_type = XINE_VISUAL_TYPE_X11 },
  */
 typedef struct {
@@ -170,6 +170,7 @@ typedef struct {
 #define MM_ACCEL_X86_SSE4       0x01000000
 #define MM_ACCEL_X86_SSE42      0x00800000
 #define MM_ACCEL_X86_AVX        0x00400000
+#define MM_ACCEL_X86_AVX2       0x00200000
 
 /* powerpc accelerations and features */
 #define MM_ACCEL_PPC_ALTIVEC    0x04000000
@@ -474,6 +475,23 @@ extern void yuy2_to_yuy2
    unsigned char *dst, int dst_pitch,
    int width, int height) XINE_PROTECTED;
 
+/*
+ * separable scaler for 8 bit image planes.
+ * xine_scaler_rows () scales output rows y0 .. y1 - 1 of one plane and may
+ * run for different rows of the same scaler in parallel. step is the
+ * distance of 2 samples in bytes, eg. 1 for YV12 planes, 2 for YUY2 luma and
+ * 4 for YUY2 chroma. Returns NULL for unsupported geometry.
+ */
+#define XINE_SCALER_BILINEAR 0
+#define XINE_SCALER_BICUBIC  1
+#define XINE_SCALER_LANCZOS  2
+typedef struct xine_scaler_s xine_scaler_t;
+xine_scaler_t *xine_scaler_new (int method, int src_width, int src_height,
+  int dst_width, int dst_height) XINE_PROTECTED;
+void xine_scaler_delete (xine_scaler_t *scaler) XINE_PROTECTED;
+void xine_scaler_rows (xine_scaler_t *scaler, const uint8_t *src, int src_pitch, int src_step,
+  uint8_t *dst, int dst_pitch, int dst_step, int y0, int y1) XINE_PROTECTED;
+
 /* print a hexdump of the given data */
 void xine_hexdump (const void *buf, int length) XINE_PROTECTED;
 
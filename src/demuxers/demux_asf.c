@@ -91,6 +91,9 @@ typedef struct {
 
   int                 payload_size;
 
+  /* frame spanning several packets, read into a single buffer */
+  buf_element_t      *pending;
+
   /* palette handling */
   int                  palette_count;
   palette_entry_t      palette[256];
@@ -701,6 +704,68 @@ static void check_newpts (demux_asf_t *this, int64_t pts, int video, int frame_e
 }
 
 
+static void asf_put_pending (asf_demux_stream_t *stream) {
+  if (stream->pending) {
+    stream->fifo->put (stream->fifo, stream->pending);
+    stream->pending = NULL;
+  }
+}
+
+static void asf_drop_pending (asf_demux_stream_t *stream) {
+  if (stream->pending) {
+    stream->pending->free_buffer (stream->pending);
+    stream->pending = NULL;
+  }
+}
+
+/* Read a fragment of a frame that spans several packets straight into
+ * one buffer large enough for the whole frame. Returns 0 when the frame
+ * has to be sent in pieces instead. */
+static int asf_read_fragment_pending (demux_asf_t *this, asf_demux_stream_t *stream,
+                                      int64_t timestamp, int frag_len) {
+  buf_element_t *buf = stream->pending;
+
+  if (!buf) {
+    buf = stream->fifo->buffer_pool_size_alloc (stream->fifo, stream->payload_size);
+    if (buf->max_size < stream->payload_size) {
+      buf->free_buffer (buf);
+      return 0;
+    }
+    buf->pts           = timestamp * 90;
+    buf->type          = stream->buf_type;
+    buf->decoder_flags = BUF_FLAG_FRAME_START;
+    buf->extra_info->input_time = timestamp;
+    if ((buf->type & BUF_MAJOR_MASK) == BUF_VIDEO_BASE)
+      check_newpts (this, buf->pts, PTS_VIDEO, 0);
+    else
+      check_newpts (this, buf->pts, PTS_AUDIO, 0);
+    stream->pending = buf;
+  } else if (buf->size + frag_len > buf->max_size) {
+    asf_put_pending (stream);
+    return 0;
+  }
+
+  if (this->input->read (this->input, buf->content + buf->size, frag_len) != frag_len) {
+    asf_drop_pending (stream);
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "demux_asf: input buffer starved\n");
+    return 1;
+  }
+  buf->size += frag_len;
+  stream->frag_offset += frag_len;
+
+  if (this->input->get_length (this->input) > 0)
+    buf->extra_info->input_normpos = (int)((double)this->input->get_current_pos (this->input) *
+      65535 / this->input->get_length (this->input));
+
+  if (stream->frag_offset >= stream->payload_size) {
+    buf->decoder_flags |= BUF_FLAG_FRAME_END;
+    lprintf ("buffer type %08x %8d bytes, %8" PRId64 " pts\n",
+             buf->type, buf->size, buf->pts);
+    asf_put_pending (stream);
+  }
+  return 1;
+}
+
 static void asf_send_buffer_nodefrag (demux_asf_t *this, asf_demux_stream_t *stream,
 				      int frag_offset, int64_t timestamp,
 				      int frag_len) {
@@ -712,6 +777,7 @@ static void asf_send_buffer_nodefrag (demux_asf_t *this, asf_demux_stream_t *str
 
   if (frag_offset == 0) {
     /* new packet */
+    asf_put_pending (stream);
     stream->frag_offset = 0;
     lprintf("new packet\n");
   } else {
@@ -721,11 +787,16 @@ static void asf_send_buffer_nodefrag (demux_asf_t *this, asf_demux_stream_t *str
     } else {
       /* cannot continue current packet: free it */
       xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "demux_asf: asf_send_buffer_nodefrag: stream offset: %d, invalid offset: %d\n", stream->frag_offset, frag_offset);
+      asf_put_pending (stream);
       this->input->seek (this->input, frag_len, SEEK_CUR);
       return ;
     }
   }
 
+  if ((stream->pending || ((frag_offset == 0) && (frag_len < stream->payload_size))) &&
+      asf_read_fragment_pending (this, stream, timestamp, frag_len))
+    return;
+
   while (frag_len) {
     buf_element_t *buf;
     int bsize;
@@ -1736,6 +1807,7 @@ static void demux_asf_dispose (demux_plugin_t *this_gen) {
       asf_demux_stream_t *asf_stream;
 
       asf_stream = &this->streams[i];
+      asf_drop_pending (asf_stream);
       if (asf_stream->buffer) {
         free (asf_stream->buffer);
         asf_stream->buffer = NULL;
@@ -1809,6 +1881,7 @@ static int demux_asf_seek (demux_plugin_t *this_gen,
    * seek to start position
    */
   for(i = 0; i < this->asf_header->stream_count; i++) {
+    asf_drop_pending (&this->streams[i]);
     this->streams[i].frag_offset =  0;
     this->streams[i].first_seq   =  1;
     this->streams[i].seq         =  0;
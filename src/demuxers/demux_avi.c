@@ -1596,7 +1596,8 @@ static int demux_avi_next (demux_avi_t *this, int decoder_flags) {
 
     if (!this->no_audio && (audio_pts < video_pts)) {
 
-      buf = this->audio_fifo->buffer_pool_alloc (this->audio_fifo);
+      /* get the rest of the chunk in one go if possible */
+      buf = this->audio_fifo->buffer_pool_size_alloc (this->audio_fifo, aie->len - audio->audio_posb);
 
       /* read audio */
 
@@ -1630,8 +1631,12 @@ static int demux_avi_next (demux_avi_t *this, int decoder_flags) {
   }
 
   if (do_read_video) {
+    video_index_entry_t *vie = video_cur_index_entry (this);
 
-    buf = this->video_fifo->buffer_pool_alloc (this->video_fifo);
+    /* large frames (MJPEG, HuffYUV, DV) are read into a single buffer
+     * if possible, saving the decoder from reassembling them */
+    buf = this->video_fifo->buffer_pool_size_alloc (this->video_fifo,
+      vie ? vie->len - this->avi->video_posb : 0);
 
     /* read video */
 
@@ -1765,14 +1770,14 @@ static int demux_avi_next_streaming (demux_avi_t *this, int decoder_flags) {
           get_audio_pts (this, audio_stream, audio->block_no,
                          audio->audio_tot - chunk_len, chunk_len - left);
 
-        buf = this->audio_fifo->buffer_pool_alloc (this->audio_fifo);
+        buf = this->audio_fifo->buffer_pool_size_alloc (this->audio_fifo, left);
 
         /* read audio */
         buf->pts = audio_pts;
         lprintf("audio pts: %" PRId64 "\n", audio_pts);
 
-        if (left > this->audio_fifo->buffer_pool_buf_size) {
-          buf->size = this->audio_fifo->buffer_pool_buf_size;
+        if (left > buf->max_size) {
+          buf->size = buf->max_size;
           buf->decoder_flags = 0;
         } else {
           buf->size = left;
@@ -1811,14 +1816,14 @@ static int demux_avi_next_streaming (demux_avi_t *this, int decoder_flags) {
       while (left > 0) {
         video_pts = get_video_pts (this, this->avi->video_posf);
 
-        buf = this->video_fifo->buffer_pool_alloc (this->video_fifo);
+        buf = this->video_fifo->buffer_pool_size_alloc (this->video_fifo, left);
 
         /* read video */
         buf->pts = video_pts;
         lprintf("video pts: %" PRId64 "\n", video_pts);
 
-        if (left > this->video_fifo->buffer_pool_buf_size) {
-          buf->size = this->video_fifo->buffer_pool_buf_size;
+        if (left > buf->max_size) {
+          buf->size = buf->max_size;
           buf->decoder_flags = 0;
         } else {
           buf->size = left;
@@ -2287,7 +2292,11 @@ static int demux_avi_get_stream_length (demux_plugin_t *this_gen) {
 }
 
 static uint32_t demux_avi_get_capabilities(demux_plugin_t *this_gen) {
-  (void)this_gen;
+  demux_avi_t *this = (demux_avi_t *)this_gen;
+
+  /* seeks go to the nearest indexed keyframe */
+  if (this->avi && this->avi->video_idx.video_frames > 0)
+    return DEMUX_CAP_TRICKPLAY;
   return DEMUX_CAP_NOCAP;
 }
 
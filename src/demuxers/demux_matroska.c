@@ -36,6 +36,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <zlib.h>
+#include <errno.h>
 
 #define LOG_MODULE "demux_matroska"
 #define LOG_VERBOSE
@@ -1968,6 +1969,48 @@ static int parse_cue_trackposition(demux_matroska_t *this, int *track_num,
 }
 
 
+/* Append an entry to the index of a track, creating the index if needed. */
+static matroska_index_t *add_index_entry(demux_matroska_t *this, int track_num,
+                                         off_t pos, uint64_t timecode) {
+  matroska_index_t *index;
+  int i;
+
+  index = NULL;
+  for (i = 0; i < this->num_indexes; i++)
+    if (this->indexes[i].track_num == track_num) {
+      index = &this->indexes[i];
+      break;
+    }
+  if (index == NULL) {
+    index = realloc(this->indexes, (this->num_indexes + 1) * sizeof(matroska_index_t));
+    if (!index)
+      return NULL;
+    this->indexes = index;
+    index = &this->indexes[this->num_indexes];
+    memset(index, 0, sizeof(matroska_index_t));
+    index->track_num = track_num;
+    this->num_indexes++;
+  }
+  if ((index->num_entries % 1024) == 0) {
+    off_t *new_pos;
+    uint64_t *new_timecode;
+
+    new_pos = realloc(index->pos, sizeof(off_t) * (index->num_entries + 1024));
+    if (!new_pos)
+      return NULL;
+    index->pos = new_pos;
+    new_timecode = realloc(index->timecode, sizeof(uint64_t) * (index->num_entries + 1024));
+    if (!new_timecode)
+      return NULL;
+    index->timecode = new_timecode;
+  }
+  index->pos[index->num_entries] = pos;
+  index->timecode[index->num_entries] = timecode;
+  index->num_entries++;
+
+  return index;
+}
+
 static int parse_cue_point(demux_matroska_t *this) {
   ebml_parser_t *ebml = this->ebml;
   int next_level = 3;
@@ -2004,35 +2047,8 @@ static int parse_cue_point(demux_matroska_t *this) {
     next_level = ebml_get_next_level(ebml, &elem);
   }
 
-  if ((timecode != -1) && (track_num != -1) && (pos != -1)) {
-    matroska_index_t *index;
-    int i;
-
-    index = NULL;
-    for (i = 0; i < this->num_indexes; i++)
-      if (this->indexes[i].track_num == track_num) {
-        index = &this->indexes[i];
-        break;
-      }
-    if (index == NULL) {
-      this->indexes = (matroska_index_t *)realloc(this->indexes,
-                                                  (this->num_indexes + 1) *
-                                                  sizeof(matroska_index_t));
-      memset(&this->indexes[this->num_indexes], 0, sizeof(matroska_index_t));
-      index = &this->indexes[this->num_indexes];
-      index->track_num = track_num;
-      this->num_indexes++;
-    }
-    if ((index->num_entries % 1024) == 0) {
-      index->pos = realloc(index->pos, sizeof(off_t) *
-			   (index->num_entries + 1024));
-      index->timecode = realloc(index->timecode, sizeof(uint64_t) *
-				(index->num_entries + 1024));
-    }
-    index->pos[index->num_entries] = pos;
-    index->timecode[index->num_entries] = timecode;
-    index->num_entries++;
-  }
+  if ((timecode != -1) && (track_num != -1) && (pos != -1))
+    add_index_entry(this, track_num, pos, timecode);
 
   return 1;
 }
@@ -2572,6 +2588,22 @@ static void handle_events(demux_matroska_t *this) {
   }
 }
 
+static void scale_cues(demux_matroska_t *this) {
+  int idx, entry;
+
+  if (this->first_cluster_found)
+    return;
+
+  /* Scale the cues to ms precision. */
+  for (idx = 0; idx < this->num_indexes; idx++) {
+    matroska_index_t *index = &this->indexes[idx];
+    for (entry = 0; entry < index->num_entries; entry++)
+      index->timecode[entry] = index->timecode[entry] *
+        this->timecode_scale / 1000000;
+  }
+  this->first_cluster_found = 1;
+}
+
 static int parse_cluster(demux_matroska_t *this) {
   ebml_parser_t *ebml = this->ebml;
   int this_level = ebml->level;
@@ -2579,18 +2611,7 @@ static int parse_cluster(demux_matroska_t *this) {
   uint64_t timecode = 0;
   uint64_t duration = 0;
 
-  if (!this->first_cluster_found) {
-    int idx, entry;
-
-    /* Scale the cues to ms precision. */
-    for (idx = 0; idx < this->num_indexes; idx++) {
-      matroska_index_t *index = &this->indexes[idx];
-      for (entry = 0; entry < index->num_entries; entry++)
-        index->timecode[entry] = index->timecode[entry] *
-          this->timecode_scale / 1000000;
-    }
-    this->first_cluster_found = 1;
-  }
+  scale_cues(this);
 
   handle_events(this);
 
@@ -2856,6 +2877,8 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
         break;
       case MATROSKA_ID_CLUSTER:
         lprintf("Slipping Cluster\n");
+        if (!this->first_cluster_pos || (current_pos < this->first_cluster_pos))
+          this->first_cluster_pos = current_pos;
         if (!ebml_skip(ebml, &elem))
           return 0;
         ret_value = 2;
@@ -2898,6 +2921,285 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
   return ret_value;
 }
 
+/*
+ * Generated seek index.
+ * Live recorded files often come without cues. Build an index of
+ * cluster positions instead: regular playback extends it for free,
+ * and a seek beyond the indexed range hops over the cluster headers
+ * up to the target. The result may be kept in a cache directory,
+ * keyed by mrl and file size.
+ */
+
+#define INDEX_CACHE_MAGIC   "xinemkvi"
+#define INDEX_CACHE_VERSION 1
+
+static int is_level1_id(uint32_t id) {
+  switch (id) {
+    case MATROSKA_ID_SEEKHEAD:
+    case MATROSKA_ID_INFO:
+    case MATROSKA_ID_CLUSTER:
+    case MATROSKA_ID_TRACKS:
+    case MATROSKA_ID_CUES:
+    case MATROSKA_ID_ATTACHMENTS:
+    case MATROSKA_ID_CHAPTERS:
+    case MATROSKA_ID_TAGS:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static void add_generated_entry(demux_matroska_t *this, off_t pos, uint64_t timecode) {
+  matroska_index_t *index = &this->indexes[0];
+
+  if ((index->num_entries > 0) && (pos <= index->pos[index->num_entries - 1]))
+    return;
+  add_index_entry(this, index->track_num, pos, timecode * this->timecode_scale / 1000000);
+}
+
+/* Get the timecode of the cluster whose header has just been read,
+ * and the position of the level 1 element following it. */
+static int scan_cluster(demux_matroska_t *this, ebml_elem_t *cluster,
+                        uint64_t *timecode, off_t *next_pos) {
+  ebml_parser_t *ebml = this->ebml;
+  int have_timecode = 0;
+  off_t pos = cluster->start;
+
+  while (cluster->len == (uint64_t)-1 || pos < (off_t)(cluster->start + cluster->len)) {
+    ebml_elem_t elem;
+
+    if (!ebml_read_elem_head(ebml, &elem))
+      break;
+    if (is_level1_id(elem.id)) {
+      /* end of a cluster with unknown size */
+      *next_pos = pos;
+      return have_timecode;
+    }
+    if (elem.id == MATROSKA_ID_CL_TIMECODE) {
+      if (!ebml_read_uint(ebml, &elem, timecode))
+        return 0;
+      have_timecode = 1;
+      if (cluster->len != (uint64_t)-1)
+        break;
+    }
+    if (elem.len == (uint64_t)-1)
+      return 0;
+    pos = elem.start + elem.len;
+    if (this->input->seek(this->input, pos, SEEK_SET) != pos)
+      break;
+  }
+
+  if (cluster->len == (uint64_t)-1)
+    return 0;
+  *next_pos = cluster->start + cluster->len;
+  return have_timecode;
+}
+
+/* Extend the generated index until it covers the requested position or time.
+ * The input position is left undefined. */
+static void scan_index(demux_matroska_t *this, off_t stop_pos, int stop_time) {
+  ebml_parser_t *ebml = this->ebml;
+  matroska_index_t *index = &this->indexes[0];
+  uint32_t stime = stop_time < 0 ? 0 : stop_time;
+  int num_scanned = 0;
+
+  while (!this->index_scan_done) {
+    ebml_elem_t elem;
+    uint64_t timecode;
+    off_t next_pos;
+
+    if (index->num_entries > 0) {
+      if (stop_pos) {
+        if (index->pos[index->num_entries - 1] >= stop_pos)
+          break;
+      } else if (index->timecode[index->num_entries - 1] > stime) {
+        break;
+      }
+    }
+
+    if ((this->input->seek(this->input, this->index_scan_pos, SEEK_SET) != this->index_scan_pos) ||
+        !ebml_read_elem_head(ebml, &elem)) {
+      this->index_scan_done = 1;
+      break;
+    }
+
+    if (elem.id == MATROSKA_ID_CLUSTER) {
+      if (!scan_cluster(this, &elem, &timecode, &next_pos)) {
+        this->index_scan_done = 1;
+        break;
+      }
+      add_generated_entry(this, this->index_scan_pos, timecode);
+      /* index may have moved */
+      index = &this->indexes[0];
+      num_scanned++;
+    } else if (is_level1_id(elem.id) && (elem.len != (uint64_t)-1)) {
+      next_pos = elem.start + elem.len;
+    } else {
+      this->index_scan_done = 1;
+      break;
+    }
+
+    if (next_pos <= this->index_scan_pos) {
+      this->index_scan_done = 1;
+      break;
+    }
+    this->index_scan_pos = next_pos;
+  }
+
+  xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+          LOG_MODULE ": scanned %d clusters, index has %d entries%s\n",
+          num_scanned, index->num_entries, this->index_scan_done ? " (complete)" : "");
+}
+
+static char *index_cache_name(demux_matroska_t *this) {
+  demux_matroska_class_t *class = (demux_matroska_class_t *)this->demux_plugin.demux_class;
+  const char *mrl = this->input->get_mrl(this->input);
+  uint32_t hash = 2166136261u;
+  const char *p;
+
+  if (!class->index_cache_dir || !class->index_cache_dir[0] || !mrl)
+    return NULL;
+
+  /* FNV-1a */
+  for (p = mrl; *p; p++)
+    hash = (hash ^ (uint8_t)*p) * 16777619u;
+
+  return _x_asprintf("%s/%08x-%" PRIx64 ".mkvidx", class->index_cache_dir,
+                     (unsigned int)hash, (uint64_t)this->input->get_length(this->input));
+}
+
+static void load_index_cache(demux_matroska_t *this) {
+  matroska_index_t *index = &this->indexes[0];
+  const char *mrl = this->input->get_mrl(this->input);
+  char *name, *cached_mrl = NULL;
+  char magic[8];
+  uint32_t version, num_entries, mrl_len;
+  int32_t scan_done;
+  int64_t scan_pos, entry[2];
+  uint32_t i;
+  FILE *f;
+
+  name = index_cache_name(this);
+  if (!name)
+    return;
+  f = fopen(name, "rb");
+  free(name);
+  if (!f)
+    return;
+
+  if ((fread(magic, sizeof(magic), 1, f) != 1) || memcmp(magic, INDEX_CACHE_MAGIC, sizeof(magic)) ||
+      (fread(&version, sizeof(version), 1, f) != 1) || (version != INDEX_CACHE_VERSION) ||
+      (fread(&num_entries, sizeof(num_entries), 1, f) != 1) ||
+      (fread(&scan_pos, sizeof(scan_pos), 1, f) != 1) ||
+      (fread(&scan_done, sizeof(scan_done), 1, f) != 1) ||
+      (fread(&mrl_len, sizeof(mrl_len), 1, f) != 1) || (mrl_len != strlen(mrl)))
+    goto out;
+
+  /* hash collisions are possible, verify the mrl */
+  cached_mrl = malloc(mrl_len + 1);
+  if (!cached_mrl || (fread(cached_mrl, 1, mrl_len, f) != mrl_len) || memcmp(cached_mrl, mrl, mrl_len))
+    goto out;
+
+  for (i = 0; i < num_entries; i++) {
+    if (fread(entry, sizeof(entry), 1, f) != 1)
+      break;
+    if ((index->num_entries > 0) && (entry[0] <= index->pos[index->num_entries - 1]))
+      continue;
+    index = add_index_entry(this, index->track_num, entry[0], entry[1]);
+    if (!index)
+      goto out;
+  }
+  if ((i == num_entries) && (scan_pos > this->index_scan_pos)) {
+    this->index_scan_pos = scan_pos;
+    this->index_scan_done = scan_done;
+  }
+  this->index_cached_entries = this->indexes[0].num_entries;
+
+  xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+          LOG_MODULE ": loaded %d cached index entries\n", this->index_cached_entries);
+
+out:
+  free(cached_mrl);
+  fclose(f);
+}
+
+static void save_index_cache(demux_matroska_t *this) {
+  matroska_index_t *index = &this->indexes[0];
+  const char *mrl = this->input->get_mrl(this->input);
+  char *name;
+  uint32_t version = INDEX_CACHE_VERSION, num_entries = index->num_entries, mrl_len;
+  int32_t scan_done = this->index_scan_done;
+  int64_t scan_pos = this->index_scan_pos, entry[2];
+  int i, ok;
+  FILE *f;
+
+  if (index->num_entries <= this->index_cached_entries)
+    return;
+  name = index_cache_name(this);
+  if (!name)
+    return;
+  f = fopen(name, "wb");
+  if (!f) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
+            LOG_MODULE ": cannot write index cache %s: %s\n", name, strerror(errno));
+    free(name);
+    return;
+  }
+
+  mrl_len = strlen(mrl);
+  ok = (fwrite(INDEX_CACHE_MAGIC, 8, 1, f) == 1) &&
+       (fwrite(&version, sizeof(version), 1, f) == 1) &&
+       (fwrite(&num_entries, sizeof(num_entries), 1, f) == 1) &&
+       (fwrite(&scan_pos, sizeof(scan_pos), 1, f) == 1) &&
+       (fwrite(&scan_done, sizeof(scan_done), 1, f) == 1) &&
+       (fwrite(&mrl_len, sizeof(mrl_len), 1, f) == 1) &&
+       (fwrite(mrl, 1, mrl_len, f) == mrl_len);
+  for (i = 0; ok && (i < index->num_entries); i++) {
+    entry[0] = index->pos[i];
+    entry[1] = index->timecode[i];
+    ok = (fwrite(entry, sizeof(entry), 1, f) == 1);
+  }
+  if (fclose(f) || !ok)
+    unlink(name);
+  free(name);
+}
+
+/* Called after the headers were parsed: set up an index of our own
+ * when the file has no cues. */
+static void init_generated_index(demux_matroska_t *this) {
+  int track_num = -1;
+  int i;
+
+  if (this->num_indexes || !this->first_cluster_pos || !this->num_tracks)
+    return;
+
+  for (i = 0; i < this->num_tracks; i++) {
+    if (this->tracks[i]->track_type == MATROSKA_TRACK_VIDEO) {
+      track_num = this->tracks[i]->track_num;
+      break;
+    }
+  }
+  if (track_num < 0)
+    track_num = this->tracks[0]->track_num;
+
+  this->indexes = calloc(1, sizeof(matroska_index_t));
+  if (!this->indexes)
+    return;
+  this->indexes[0].track_num = track_num;
+  this->num_indexes = 1;
+
+  /* generated entries are in ms precision already */
+  scale_cues(this);
+
+  this->index_generated = 1;
+  this->index_scan_pos = this->first_cluster_pos;
+
+  if (this->input->get_capabilities(this->input) & INPUT_CAP_SEEKABLE)
+    load_index_cache(this);
+  else
+    this->index_scan_done = 1;
+}
+
 /*
  * Function used to parse a top level element during the playback.
  * It skips all elements except clusters.
@@ -2906,11 +3208,21 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
 static int parse_top_level(demux_matroska_t *this, int *next_level) {
   ebml_parser_t *ebml = this->ebml;
   ebml_elem_t elem;
-  off_t cluster_pos, cluster_len;
+  off_t elem_pos, cluster_pos, cluster_len;
+  int extend_index;
+
+  elem_pos = this->input->get_current_pos(this->input);
 
   if (!ebml_read_elem_head(ebml, &elem))
     return 0;
 
+  /* Without cues, let regular playback extend the generated index
+   * as long as it continues where the last scan stopped. */
+  extend_index = this->index_generated && !this->index_scan_done &&
+                 (elem_pos == this->index_scan_pos) && (elem.len != (uint64_t)-1);
+  if (extend_index && (elem.id != MATROSKA_ID_CLUSTER))
+    this->index_scan_pos = elem.start + elem.len;
+
   switch (elem.id) {
     case MATROSKA_ID_SEEKHEAD:
       lprintf("Skipping SeekHead\n");
@@ -2948,6 +3260,9 @@ static int parse_top_level(demux_matroska_t *this, int *next_level) {
           xprintf(ebml->xine, XINE_VERBOSITY_LOG,
                   "seek error (skipping %" PRId64 " bytes)\n", (int64_t)skip);
         }
+      } else if (extend_index) {
+        add_generated_entry(this, elem_pos, this->last_timecode);
+        this->index_scan_pos = cluster_pos + cluster_len;
       }
       break;
     case MATROSKA_ID_CUES:
@@ -3045,6 +3360,8 @@ static void demux_matroska_send_headers (demux_plugin_t *this_gen) {
   else
     this->status = DEMUX_OK;
 
+  init_generated_index(this);
+
   _x_stream_info_set(this->stream, XINE_STREAM_INFO_HAS_VIDEO, (this->num_video_tracks != 0));
   _x_stream_info_set(this->stream, XINE_STREAM_INFO_HAS_AUDIO, (this->num_audio_tracks != 0));
 
@@ -3176,6 +3493,17 @@ static int demux_matroska_seek (demux_plugin_t *this_gen,
   if (!this->num_indexes)
     return this->status;
 
+  if (this->index_generated && !this->index_scan_done) {
+    off_t cur_pos = this->input->get_current_pos(this->input);
+
+    scan_index(this, start_pos, start_time);
+    if (!this->indexes[0].num_entries) {
+      if (this->input->seek(this->input, cur_pos, SEEK_SET) < 0)
+        this->status = DEMUX_FINISHED;
+      return this->status;
+    }
+  }
+
   /* Find an index for a video track and use the first available index
      otherwise. */
   index = NULL;
@@ -3251,6 +3579,9 @@ static void demux_matroska_dispose (demux_plugin_t *this_gen) {
 
     _x_freep (&this->tracks[i]);
   }
+  if (this->index_generated)
+    save_index_cache(this);
+
   /* Free the cues. */
   for (i = 0; i < this->num_indexes; i++) {
     _x_freep(&this->indexes[i].pos);
@@ -3286,6 +3617,9 @@ static uint32_t demux_matroska_get_capabilities (demux_plugin_t *this_gen) {
   if(this->num_editions > 0 && this->editions[0]->num_chapters > 0)
     caps |= DEMUX_CAP_CHAPTERS;
 
+  if (this->num_indexes > 0)
+    caps |= DEMUX_CAP_TRICKPLAY;
+
   return caps;
 }
 
@@ -3433,23 +3767,50 @@ error:
 /*
  * demux matroska class
  */
+static void index_cache_dir_cb(void *data, xine_cfg_entry_t *cfg) {
+  demux_matroska_class_t *class = (demux_matroska_class_t *)data;
+
+  class->index_cache_dir = cfg->str_value;
+}
+
+static void demux_matroska_class_dispose(demux_class_t *this_gen) {
+  demux_matroska_class_t *this = (demux_matroska_class_t *)this_gen;
+
+  this->xine->config->unregister_callback(this->xine->config, "media.matroska.index_cache_dir");
+
+  free(this);
+}
+
 void *demux_matroska_init_class (xine_t *xine, const void *data) {
 
-  (void)xine;
+  demux_matroska_class_t *this;
+
   (void)data;
 
-  static const demux_class_t demux_matroska_class = {
-    .open_plugin     = open_plugin,
-    .description     = N_("matroska & webm demux plugin"),
-    .identifier      = "matroska",
-    .mimetypes       =
-      "video/mkv: mkv: matroska;"
-      "video/x-matroska: mkv: matroska;"
-      "video/webm: wbm,webm: WebM;",
-    .extensions      = "mkv wbm webm",
-    .dispose         = NULL,
-  };
+  this = calloc(1, sizeof(demux_matroska_class_t));
+  if (!this)
+    return NULL;
 
-  return (void *)&demux_matroska_class;
+  this->demux_class.open_plugin     = open_plugin;
+  this->demux_class.description     = N_("matroska & webm demux plugin");
+  this->demux_class.identifier      = "matroska";
+  this->demux_class.mimetypes       =
+    "video/mkv: mkv: matroska;"
+    "video/x-matroska: mkv: matroska;"
+    "video/webm: wbm,webm: WebM;";
+  this->demux_class.extensions      = "mkv wbm webm";
+  this->demux_class.dispose         = demux_matroska_class_dispose;
+
+  this->xine = xine;
+
+  this->index_cache_dir = xine->config->register_filename(xine->config,
+      "media.matroska.index_cache_dir", "", XINE_CONFIG_STRING_IS_DIRECTORY_NAME,
+      _("directory for generated matroska seek indexes"),
+      _("Matroska files without cues get a seek index generated by scanning their "
+        "clusters. If a directory is given here, these indexes are saved to it "
+        "and reused next time the same file is played.\n"
+        "Leave empty to disable the cache."),
+      20, index_cache_dir_cb, this);
+
+  return this;
 }
-
@@ -54,6 +54,15 @@ typedef struct {
 
 } matroska_index_t;
 
+typedef struct {
+
+  demux_class_t        demux_class;
+
+  xine_t              *xine;
+  const char          *index_cache_dir;
+
+} demux_matroska_class_t;
+
 typedef struct {
 
   demux_plugin_t       demux_plugin;
@@ -85,6 +94,13 @@ typedef struct {
   int                  skip_to_timecode;
   int                  skip_for_track;
 
+  /* generated seek index for files without cues */
+  off_t                first_cluster_pos;
+  int                  index_generated;
+  int                  index_scan_done;
+  off_t                index_scan_pos;      /* next level 1 element to scan */
+  int                  index_cached_entries;
+
   /* tracks */
   int                  num_tracks;
   int                  num_video_tracks;
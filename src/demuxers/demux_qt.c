@@ -3710,7 +3710,11 @@ static int demux_qt_get_stream_length (demux_plugin_t *this_gen) {
 }
 
 static uint32_t demux_qt_get_capabilities(demux_plugin_t *this_gen) {
-  (void)this_gen;
+  demux_qt_t *this = (demux_qt_t *)this_gen;
+
+  /* video keyframes are known from the stss atom */
+  if (this->qt.video_trak >= 0)
+    return DEMUX_CAP_AUDIOLANG | DEMUX_CAP_TRICKPLAY;
   return DEMUX_CAP_AUDIOLANG;
 }
 
@@ -3007,8 +3007,14 @@ static int demux_ts_get_stream_length (demux_plugin_t *this_gen) {
 
 static uint32_t demux_ts_get_capabilities(demux_plugin_t *this_gen)
 {
-  (void)this_gen;
-  return DEMUX_CAP_AUDIOLANG | DEMUX_CAP_SPULANG;
+  demux_ts_t *this = (demux_ts_t *)this_gen;
+  uint32_t caps = DEMUX_CAP_AUDIOLANG | DEMUX_CAP_SPULANG;
+
+  /* time seeks are estimated from bitrate, the engine drops the
+   * broken pictures until the next keyframe. */
+  if (INPUT_IS_SEEKABLE (this->input))
+    caps |= DEMUX_CAP_TRICKPLAY;
+  return caps;
 }
 
 static int demux_ts_get_optional_data(demux_plugin_t *this_gen,
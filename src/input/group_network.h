@@ -25,6 +25,7 @@
 void *input_net_init_class  (xine_t *xine, const void *data);
 void *input_tls_init_class  (xine_t *xine, const void *data);
 void *input_http_init_class (xine_t *xine, const void *data);
+void *input_hls_init_class  (xine_t *xine, const void *data);
 void *input_rtsp_init_class (xine_t *xine, const void *data);
 void *input_pnm_init_class  (xine_t *xine, const void *data);
 void *input_ftp_init_class  (xine_t *xine, const void *data);
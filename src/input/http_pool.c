@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2000-2018 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * keep-alive HTTP connection pool, shared by the http and hls inputs
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define LOG_MODULE "http_pool"
+/*
+#define LOG
+*/
+
+#include <xine/xine_internal.h>
+#include <xine/xineutils.h>
+#include "http_pool.h"
+
+#define HTTP_POOL_SIZE             8     /* idle keep-alive connections per xine instance */
+#define HTTP_POOL_IDLE            15     /* seconds before an idle connection is dropped */
+
+typedef struct {
+  xine_tls_t       *tls;
+  char             *host;
+  int               port;
+  int               use_tls;
+  time_t            since;
+} http_pool_conn_t;
+
+struct http_pool_s {
+  http_pool_t      *next;
+  xine_t           *xine;
+  int               refs;
+
+  pthread_mutex_t   lock;
+  http_pool_conn_t  conn[HTTP_POOL_SIZE];
+};
+
+/* all pools of this process, one per xine instance */
+static pthread_mutex_t  http_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+static http_pool_t     *http_pools = NULL;
+
+http_pool_t *http_pool_acquire (xine_t *xine) {
+  http_pool_t *pool;
+
+  pthread_mutex_lock (&http_pools_lock);
+  for (pool = http_pools; pool; pool = pool->next) {
+    if (pool->xine == xine)
+      break;
+  }
+  if (!pool) {
+    pool = calloc (1, sizeof (*pool));
+    if (pool) {
+      pool->xine = xine;
+      pthread_mutex_init (&pool->lock, NULL);
+      pool->next = http_pools;
+      http_pools = pool;
+    }
+  }
+  if (pool)
+    pool->refs++;
+  pthread_mutex_unlock (&http_pools_lock);
+
+  return pool;
+}
+
+void http_pool_release (http_pool_t **pool_p) {
+  http_pool_t  *pool = *pool_p;
+  http_pool_t **p;
+  int           i;
+
+  if (!pool)
+    return;
+  *pool_p = NULL;
+
+  pthread_mutex_lock (&http_pools_lock);
+  if (--pool->refs > 0) {
+    pthread_mutex_unlock (&http_pools_lock);
+    return;
+  }
+  for (p = &http_pools; *p; p = &(*p)->next) {
+    if (*p == pool) {
+      *p = pool->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&http_pools_lock);
+
+  for (i = 0; i < HTTP_POOL_SIZE; i++) {
+    _x_tls_close (&pool->conn[i].tls);
+    _x_freep (&pool->conn[i].host);
+  }
+  pthread_mutex_destroy (&pool->lock);
+  free (pool);
+}
+
+xine_tls_t *http_pool_get (http_pool_t *pool, xine_stream_t *stream,
+                           const char *host, int port, int use_tls) {
+  xine_tls_t *tls = NULL;
+  time_t      now = time (NULL);
+  int         i;
+
+  pthread_mutex_lock (&pool->lock);
+  for (i = 0; i < HTTP_POOL_SIZE; i++) {
+    http_pool_conn_t *c = &pool->conn[i];
+    if (!c->tls)
+      continue;
+    if (now - c->since > HTTP_POOL_IDLE) {
+      _x_tls_close (&c->tls);
+      _x_freep (&c->host);
+    } else if (!tls && (c->port == port) && (c->use_tls == use_tls) && !strcasecmp (c->host, host)) {
+      tls = c->tls;
+      c->tls = NULL;
+      _x_freep (&c->host);
+    }
+  }
+  pthread_mutex_unlock (&pool->lock);
+
+  if (tls) {
+    lprintf ("reusing connection to %s:%d\n", host, port);
+    _x_tls_set_stream (tls, stream);
+  }
+  return tls;
+}
+
+void http_pool_put (http_pool_t *pool, xine_tls_t **tls,
+                    const char *host, int port, int use_tls) {
+  http_pool_conn_t *slot = NULL;
+  int               i;
+
+  lprintf ("connection to %s:%d back to pool\n", host, port);
+  _x_tls_set_stream (*tls, NULL);
+
+  pthread_mutex_lock (&pool->lock);
+  /* first free entry, or the one idle for the longest time */
+  for (i = 0; i < HTTP_POOL_SIZE; i++) {
+    http_pool_conn_t *c = &pool->conn[i];
+    if (!slot || (slot->tls && (!c->tls || c->since < slot->since)))
+      slot = c;
+  }
+  if (slot->tls) {
+    _x_tls_close (&slot->tls);
+    _x_freep (&slot->host);
+  }
+  slot->host    = strdup (host);
+  if (slot->host) {
+    slot->tls     = *tls;
+    slot->port    = port;
+    slot->use_tls = use_tls;
+    slot->since   = time (NULL);
+    *tls = NULL;
+  }
+  pthread_mutex_unlock (&pool->lock);
+  _x_tls_close (tls);
+}
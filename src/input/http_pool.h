@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2000-2018 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * keep-alive HTTP connection pool, shared by the http and hls inputs
+ */
+
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <xine/xine_internal.h>
+#include "tls/xine_tls.h"
+
+typedef struct http_pool_s http_pool_t;
+
+/*
+ * one pool per xine instance. every input class holds a reference.
+ *
+ * return:
+ *   NULL if out of memory
+ */
+http_pool_t *http_pool_acquire (xine_t *xine);
+void         http_pool_release (http_pool_t **pool);
+
+/*
+ * take an idle connection to host:port, and hand it over to stream (may be NULL).
+ *
+ * return:
+ *   NULL if there is none
+ */
+xine_tls_t *http_pool_get (http_pool_t *pool, xine_stream_t *stream,
+                           const char *host, int port, int use_tls);
+
+/*
+ * park a connection that has no response pending. *tls is NULL afterwards.
+ */
+void        http_pool_put (http_pool_t *pool, xine_tls_t **tls,
+                           const char *host, int port, int use_tls);
+
+#endif /* HTTP_POOL_H */
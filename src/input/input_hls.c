@@ -0,0 +1,1805 @@
+/*
+ * Copyright (C) 2000-2018 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * input plugin for HTTP Live Streaming (m3u8 playlists)
+ *
+ * The playlist is resolved at open time (master playlists select one
+ * variant).  A small pool of worker threads then downloads the upcoming
+ * segments over persistent HTTP/1.1 connections into a bounded set of
+ * prefetch slots.  The demuxer sees one continuous byte stream: the
+ * EXT-X-MAP init section (fMP4) if any, followed by the segments.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/time.h>
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
+#ifndef SHUT_RDWR
+#define SHUT_RDWR 2 /* SD_BOTH */
+#endif
+
+#define LOG_MODULE "input_hls"
+#define LOG_VERBOSE
+/*
+#define LOG
+*/
+
+#include <xine/xine_internal.h>
+#include <xine/xineutils.h>
+#include <xine/input_plugin.h>
+#include "tls/xine_tls.h"
+#include "net_buf_ctrl.h"
+#include "group_network.h"
+#include "http_helper.h"
+#include "http_pool.h"
+#include "input_helper.h"
+
+#define DEFAULT_HTTP_PORT         80
+#define DEFAULT_HTTPS_PORT       443
+
+#define HLS_MAX_WORKERS            4
+#define HLS_MAX_SLOTS             16
+#define HLS_MAX_REDIRECTS          5
+#define HLS_RETRIES                2
+#define HLS_CHUNK_SIZE         32768
+#define HLS_PLAYLIST_MAX   (4 << 20)
+#define HLS_INIT_MAX      (16 << 20)
+/* live playback starts this many segments before the end of the list */
+#define HLS_LIVE_START             3
+/* segments smaller than this say more about latency than throughput */
+#define HLS_ABR_MIN_SAMPLE     16384
+
+typedef struct {
+  char      *uri;          /* absolute */
+  int64_t    seq;          /* media sequence number */
+  int64_t    start;        /* ms since the first listed segment */
+  int        duration;     /* ms */
+  off_t      range_offs;
+  off_t      range_len;    /* 0: whole resource */
+  off_t      size;         /* bytes, 0 until downloaded */
+} hls_segment_t;
+
+typedef struct {
+  hls_segment_t *segs;
+  int            num_segs, max_segs;
+  int64_t        next_seq;        /* after the last segment ever listed */
+  int64_t        next_start;      /* ms, start of a segment with next_seq */
+  int            target_duration; /* ms */
+  int            live;
+  int            encrypted;
+  char          *init_uri;
+  off_t          init_offs, init_len;
+} hls_playlist_t;
+
+typedef struct {
+  char      *uri;
+  uint32_t   bandwidth;    /* bit/s */
+  int        width, height;
+  int        failed;
+} hls_variant_t;
+
+/* one persistent HTTP/1.1 connection */
+typedef struct {
+  xine_tls_t *tls;
+  int         fd;       /* socket of tls, -1 if none or shut down. set under hls lock */
+  int         busy;     /* a request is running. set under hls lock */
+  char        host[256];
+  int         port;
+  int         use_tls;
+} hls_conn_t;
+
+typedef enum {
+  HLS_SLOT_FREE = 0,
+  HLS_SLOT_LOADING,
+  HLS_SLOT_DONE,
+  HLS_SLOT_FAILED
+} hls_slot_state_t;
+
+typedef struct {
+  int               seg;
+  hls_slot_state_t  state;
+  int               cancel;
+  uint8_t          *data;
+  size_t            fill, alloc;
+} hls_slot_t;
+
+typedef struct hls_input_plugin_s hls_input_plugin_t;
+
+typedef struct {
+  hls_input_plugin_t *hls;
+  pthread_t           thread;
+  int                 running;
+  hls_conn_t          conn;
+  hls_slot_t         *slot;
+} hls_worker_t;
+
+/* growable memory sink for playlists and init sections */
+typedef struct {
+  uint8_t  *data;
+  size_t    size, alloc, max;
+} hls_membuf_t;
+
+typedef int (*hls_sink_t) (void *data, const uint8_t *buf, size_t len);
+
+typedef struct {
+  input_class_t     input_class;
+
+  xine_t           *xine;
+
+  /* kept-alive connections, shared with http */
+  http_pool_t      *pool;
+
+  int               connections;
+  int               prefetch;
+  int               max_bitrate;   /* kbit/s, 0: unlimited */
+  int               adaptive;
+} hls_input_class_t;
+
+struct hls_input_plugin_s {
+  input_plugin_t    input_plugin;
+
+  xine_stream_t    *stream;
+  xine_t           *xine;
+  nbc_t            *nbc;
+
+  char             *mrl;
+  char             *list_url;     /* media playlist */
+
+  hls_variant_t    *variants;
+  int               num_variants;
+  int               cur_variant;
+
+  /* adaptive bit rate */
+  int               adaptive;
+  uint32_t          max_bitrate;  /* bit/s */
+  int               switching;
+  int               switches;
+  int64_t           last_switch;  /* ms, monotonic */
+  int               loading;      /* segment downloads in progress */
+  int               tp_samples, tp_used;
+  double            tp_fast, tp_slow; /* bit/s */
+
+  /* media playlist, protected by lock once the workers run */
+  hls_playlist_t    pl;
+
+  uint8_t          *init_data;
+  size_t            init_size;
+
+  pthread_mutex_t   lock;
+  pthread_cond_t    data_cond;    /* reader waits for segment data */
+  pthread_cond_t    work_cond;    /* workers wait for free slots */
+  int               quit;
+  int               reloading;
+  int64_t           next_reload;  /* ms, monotonic */
+
+  hls_worker_t      workers[HLS_MAX_WORKERS];
+  int               num_workers;
+  hls_slot_t        slots[HLS_MAX_SLOTS];
+  int               num_slots;
+
+  int               fetch_seg;    /* next segment to hand to a worker */
+  int               read_seg;
+  int               trimmed;      /* live: segments dropped from the front of pl.segs */
+  size_t            read_offs;    /* position inside read_seg */
+  size_t            init_pos;     /* position inside init_data */
+  off_t             curpos;
+
+  off_t             preview_size;
+  char              preview[MAX_PREVIEW_SIZE];
+};
+
+static int64_t hls_now (void) {
+  struct timeval tv;
+
+  xine_monotonic_clock (&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static void hls_timed_wait (pthread_cond_t *cond, pthread_mutex_t *lock, int msecs) {
+  struct timeval  tv;
+  struct timespec ts;
+
+  gettimeofday (&tv, NULL);
+  ts.tv_sec  = tv.tv_sec + msecs / 1000;
+  ts.tv_nsec = (tv.tv_usec + (msecs % 1000) * 1000) * 1000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_nsec -= 1000000000;
+    ts.tv_sec++;
+  }
+  pthread_cond_timedwait (cond, lock, &ts);
+}
+
+/*
+ * HTTP/1.1 client
+ */
+
+static void hls_conn_close (hls_input_plugin_t *this, hls_conn_t *conn) {
+  /* dispose must not shut down a socket number that got reused */
+  pthread_mutex_lock (&this->lock);
+  conn->fd = -1;
+  pthread_mutex_unlock (&this->lock);
+  _x_tls_close (&conn->tls);
+  conn->host[0] = 0;
+}
+
+/* park an idle connection in the shared pool, unless dispose shut it down */
+static void hls_conn_release (hls_input_plugin_t *this, hls_conn_t *conn) {
+  hls_input_class_t *cls = (hls_input_class_t *) this->input_plugin.input_class;
+  int                idle;
+
+  pthread_mutex_lock (&this->lock);
+  idle = conn->tls && (conn->fd != -1);
+  conn->fd = -1;
+  pthread_mutex_unlock (&this->lock);
+  if (idle)
+    http_pool_put (cls->pool, &conn->tls, conn->host, conn->port, conn->use_tls);
+  _x_tls_close (&conn->tls);
+  conn->host[0] = 0;
+}
+
+/* return 2 for a kept-alive connection, 1 for a new one */
+static int hls_conn_open (hls_input_plugin_t *this, hls_conn_t *conn, const xine_url_t *url, int use_tls) {
+  hls_input_class_t *cls = (hls_input_class_t *) this->input_plugin.input_class;
+  int fd, reused;
+
+  if (conn->tls && conn->port == url->port && conn->use_tls == use_tls &&
+      !strcasecmp (conn->host, url->host))
+    return 2;
+
+  hls_conn_release (this, conn);
+
+  /* workers must not be aborted by engine actions, so no stream here.
+   * dispose instead shuts down the socket to end a blocking read. */
+  conn->tls = http_pool_get (cls->pool, NULL, url->host, url->port, use_tls);
+  reused = conn->tls != NULL;
+  if (!reused) {
+    fd = _x_io_tcp_connect (NULL, url->host, url->port);
+    conn->tls = (fd != -1) ? _x_tls_init (this->xine, NULL, fd) : NULL;
+    if (!conn->tls) {
+      if (fd != -1)
+        _x_io_tcp_close (NULL, fd);
+      xprintf (this->xine, XINE_VERBOSITY_LOG,
+               LOG_MODULE ": connecting %s:%d failed\n", url->host, url->port);
+      return 0;
+    }
+  }
+  pthread_mutex_lock (&this->lock);
+  if (!this->quit)
+    conn->fd = _x_tls_get_fd (conn->tls);
+  pthread_mutex_unlock (&this->lock);
+  if (conn->fd == -1) {
+    _x_tls_close (&conn->tls);
+    return 0;
+  }
+  snprintf (conn->host, sizeof (conn->host), "%s", url->host);
+  conn->port    = url->port;
+  conn->use_tls = use_tls;
+  if (reused)
+    return 2;
+
+  if (use_tls && _x_tls_handshake (conn->tls, url->host, -1) < 0) {
+    xprintf (this->xine, XINE_VERBOSITY_LOG,
+             LOG_MODULE ": TLS handshake with %s failed\n", url->host);
+    hls_conn_close (this, conn);
+    return 0;
+  }
+  return 1;
+}
+
+static ssize_t hls_conn_read (hls_conn_t *conn, uint8_t *buf, size_t len) {
+  size_t  done = 0;
+
+  while (done < len) {
+    ssize_t r = _x_tls_read (conn->tls, buf + done, len - done);
+    if (r <= 0)
+      return done ? (ssize_t)done : r;
+    done += r;
+  }
+  return done;
+}
+
+static int hls_body_chunk (hls_input_plugin_t *this, hls_conn_t *conn, off_t len,
+                           hls_sink_t sink, void *sink_data) {
+  uint8_t buf[HLS_CHUNK_SIZE];
+
+  while (len != 0) {
+    size_t  n = (len < 0 || len > (off_t)sizeof (buf)) ? sizeof (buf) : (size_t)len;
+    ssize_t r = hls_conn_read (conn, buf, n);
+
+    if (r <= 0)
+      return len < 0 ? 1 : 0; /* read until close */
+    if (!sink (sink_data, buf, r))
+      return -1;
+    if (len > 0)
+      len -= r;
+    if (len < 0 && (size_t)r < n)
+      return 1;
+    if (this->quit)
+      return -1;
+  }
+  return 1;
+}
+
+/* passes on the requested part of a whole resource sent instead of a range */
+typedef struct {
+  hls_sink_t  sink;
+  void       *data;
+  off_t       skip, left;
+  int         aborted;
+} hls_range_sink_t;
+
+static int hls_range_sink (void *data, const uint8_t *buf, size_t len) {
+  hls_range_sink_t *r = (hls_range_sink_t *)data;
+
+  if (r->skip >= (off_t)len) {
+    r->skip -= len;
+    return 1;
+  }
+  buf += r->skip;
+  len -= r->skip;
+  r->skip = 0;
+  if ((off_t)len > r->left)
+    len = r->left;
+  if (!r->sink (r->data, buf, len)) {
+    r->aborted = 1;
+    return 0;
+  }
+  r->left -= len;
+  /* stop reading here, the caller drops the connection */
+  return r->left > 0;
+}
+
+/*
+ * GET url (optionally a byte range) and feed the body to sink.
+ * return: 1 success, 0 failure, -1 aborted by sink.
+ */
+static int hls_http_get_int (hls_input_plugin_t *this, hls_conn_t *conn, char **url_p,
+                             off_t offs, off_t len, hls_sink_t sink, void *sink_data) {
+  int redirects = 0;
+
+  while (redirects <= HLS_MAX_REDIRECTS) {
+    xine_url_t  url;
+    char        buf[2048];
+    size_t      buflen;
+    int         use_tls, retry, httpcode = 0, chunked = 0, keep_alive = 1;
+    off_t       contentlength = -1;
+    int64_t     range_first = -1, range_last = -1;
+    char       *location = NULL;
+    hls_range_sink_t range;
+    int         res;
+
+    if (!_x_url_parse2 (*url_p, &url)) {
+      xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": malformed url %s\n", *url_p);
+      return 0;
+    }
+    use_tls = !strcasecmp (url.proto, "https");
+    if (url.port == 0)
+      url.port = use_tls ? DEFAULT_HTTPS_PORT : DEFAULT_HTTP_PORT;
+
+    buflen = snprintf (buf, sizeof (buf),
+                       "GET %s HTTP/1.1\015\012"
+                       "Host: %s:%d\015\012"
+                       "User-Agent: xine/%s\015\012"
+                       "Accept: */*\015\012"
+                       "Connection: keep-alive\015\012",
+                       url.uri, url.host, url.port, VERSION);
+    if (len > 0 && buflen < sizeof (buf))
+      buflen += snprintf (buf + buflen, sizeof (buf) - buflen,
+                          "Range: bytes=%" PRId64 "-%" PRId64 "\015\012",
+                          (int64_t)offs, (int64_t)(offs + len - 1));
+    if (buflen < sizeof (buf))
+      buflen += snprintf (buf + buflen, sizeof (buf) - buflen, "\015\012");
+    if (buflen >= sizeof (buf)) {
+      _x_url_cleanup (&url);
+      return 0;
+    }
+
+    /* a reused connection may have been closed by the server meanwhile */
+    for (retry = 0; retry < 2; retry++) {
+      int reused = hls_conn_open (this, conn, &url, use_tls);
+
+      httpcode = 0;
+      if (!reused)
+        break;
+      if ((size_t)_x_tls_write (conn->tls, buf, buflen) == buflen &&
+          _x_tls_read_line (conn->tls, buf, sizeof (buf)) > 0 &&
+          sscanf (buf, "HTTP/%*d.%*d %d", &httpcode) == 1)
+        break;
+      hls_conn_close (this, conn);
+      httpcode = 0;
+      if (reused != 2)
+        break;
+    }
+    if (!httpcode) {
+      _x_url_cleanup (&url);
+      return 0;
+    }
+    lprintf ("%s -> %d\n", *url_p, httpcode);
+
+    /* headers */
+    while (1) {
+      ssize_t r = _x_tls_read_line (conn->tls, buf, sizeof (buf));
+      if (r < 0) {
+        hls_conn_close (this, conn);
+        free (location);
+        _x_url_cleanup (&url);
+        return 0;
+      }
+      if (r == 0)
+        break;
+      if (!strncasecmp (buf, "Content-Length:", 15))
+        contentlength = strtoll (buf + 15, NULL, 10);
+      else if (!strncasecmp (buf, "Content-Range:", 14))
+        sscanf (buf + 14, " bytes %" SCNd64 "-%" SCNd64, &range_first, &range_last);
+      else if (!strncasecmp (buf, "Transfer-Encoding:", 18) && strstr (buf + 18, "chunked"))
+        chunked = 1;
+      else if (!strncasecmp (buf, "Connection:", 11) && strstr (buf + 11, "close"))
+        keep_alive = 0;
+      else if (!strncasecmp (buf, "Location:", 9) && !location) {
+        const char *p = buf + 9;
+        while (*p == ' ')
+          p++;
+        location = strdup (p);
+      }
+    }
+    _x_url_cleanup (&url);
+
+    if (httpcode >= 300 && httpcode < 400 && location) {
+      char *href = _x_canonicalise_url (*url_p, location);
+      free (location);
+      /* body of a redirection is not interesting */
+      hls_conn_close (this, conn);
+      if (!href)
+        return 0;
+      free (*url_p);
+      *url_p = href;
+      redirects++;
+      continue;
+    }
+    free (location);
+
+    if (httpcode < 200 || httpcode >= 300) {
+      xprintf (this->xine, XINE_VERBOSITY_LOG,
+               LOG_MODULE ": http status %d for %s\n", httpcode, *url_p);
+      hls_conn_close (this, conn);
+      return 0;
+    }
+
+    range.aborted = 0;
+    range.left    = 0;
+    if (len > 0 && httpcode == 206) {
+      if (range_first != offs || range_last != offs + len - 1) {
+        xprintf (this->xine, XINE_VERBOSITY_LOG,
+                 LOG_MODULE ": %s: got bytes %" PRId64 "-%" PRId64 " instead of %" PRId64 "-%" PRId64 "\n",
+                 *url_p, range_first, range_last, (int64_t)offs, (int64_t)(offs + len - 1));
+        hls_conn_close (this, conn);
+        return 0;
+      }
+    } else if (len > 0) {
+      /* server ignored the range and sends the whole resource */
+      lprintf ("%s: no range support, skipping %" PRId64 " bytes\n", *url_p, (int64_t)offs);
+      range.sink = sink;
+      range.data = sink_data;
+      range.skip = offs;
+      range.left = len;
+      sink       = hls_range_sink;
+      sink_data  = &range;
+      keep_alive = 0;
+    }
+
+    if (chunked) {
+      res = 1;
+      while (res > 0) {
+        off_t size;
+        if (_x_tls_read_line (conn->tls, buf, sizeof (buf)) <= 0) {
+          res = 0;
+          break;
+        }
+        size = strtoll (buf, NULL, 16);
+        if (size <= 0) {
+          /* trailer */
+          while (_x_tls_read_line (conn->tls, buf, sizeof (buf)) > 0) ;
+          break;
+        }
+        res = hls_body_chunk (this, conn, size, sink, sink_data);
+        if (res > 0 && _x_tls_read_line (conn->tls, buf, sizeof (buf)) < 0)
+          res = 0;
+      }
+    } else if (contentlength >= 0) {
+      res = hls_body_chunk (this, conn, contentlength, sink, sink_data);
+    } else {
+      res = hls_body_chunk (this, conn, -1, sink, sink_data);
+      keep_alive = 0;
+    }
+
+    if (sink == hls_range_sink) {
+      if (range.aborted)
+        res = -1;
+      else
+        res = range.left ? 0 : 1;
+    }
+
+    if (res <= 0 || !keep_alive)
+      hls_conn_close (this, conn);
+    return res;
+  }
+
+  xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": too many redirections\n");
+  return 0;
+}
+
+/* tell dispose which sockets to shut down, and start nothing after it came */
+static int hls_http_get (hls_input_plugin_t *this, hls_conn_t *conn, char **url_p,
+                         off_t offs, off_t len, hls_sink_t sink, void *sink_data) {
+  int res;
+
+  pthread_mutex_lock (&this->lock);
+  if (this->quit) {
+    pthread_mutex_unlock (&this->lock);
+    return 0;
+  }
+  conn->busy = 1;
+  pthread_mutex_unlock (&this->lock);
+
+  res = hls_http_get_int (this, conn, url_p, offs, len, sink, sink_data);
+
+  pthread_mutex_lock (&this->lock);
+  conn->busy = 0;
+  pthread_mutex_unlock (&this->lock);
+  return res;
+}
+
+static int hls_membuf_sink (void *data, const uint8_t *buf, size_t len) {
+  hls_membuf_t *mb = (hls_membuf_t *)data;
+
+  if (mb->size + len + 1 > mb->alloc) {
+    size_t   alloc = mb->alloc ? mb->alloc : 16384;
+    uint8_t *tmp;
+    while (alloc < mb->size + len + 1)
+      alloc *= 2;
+    if (alloc > mb->max + 1)
+      return 0;
+    tmp = realloc (mb->data, alloc);
+    if (!tmp)
+      return 0;
+    mb->data  = tmp;
+    mb->alloc = alloc;
+  }
+  memcpy (mb->data + mb->size, buf, len);
+  mb->size += len;
+  mb->data[mb->size] = 0;
+  return 1;
+}
+
+/* fetch a whole resource into memory, *url_p is updated on redirection */
+static uint8_t *hls_fetch (hls_input_plugin_t *this, hls_conn_t *conn, char **url_p,
+                           off_t offs, off_t len, size_t max, size_t *size) {
+  hls_membuf_t mb = { NULL, 0, 0, max };
+
+  if (hls_http_get (this, conn, url_p, offs, len, hls_membuf_sink, &mb) != 1 || !mb.data) {
+    free (mb.data);
+    return NULL;
+  }
+  if (size)
+    *size = mb.size;
+  return mb.data;
+}
+
+/*
+ * playlist parser
+ */
+
+/* find attribute value in an "#EXT-X-FOO:NAME=VALUE,NAME="VALUE"" line */
+static const char *hls_attr (const char *line, const char *name, size_t *len) {
+  const char *p = strchr (line, ':');
+  size_t      nl = strlen (name);
+
+  while (p) {
+    const char *v;
+
+    p++;
+    while (*p == ' ')
+      p++;
+    v = strchr (p, '=');
+    if (!v)
+      return NULL;
+    if ((size_t)(v - p) == nl && !strncmp (p, name, nl)) {
+      v++;
+      if (*v == '"') {
+        const char *e = strchr (++v, '"');
+        *len = e ? (size_t)(e - v) : strlen (v);
+      } else {
+        *len = strcspn (v, ",");
+      }
+      return v;
+    }
+    v++;
+    if (*v == '"') {
+      v = strchr (v + 1, '"');
+      if (!v)
+        return NULL;
+    }
+    p = strchr (v, ',');
+  }
+  return NULL;
+}
+
+static void hls_parse_range (const char *s, off_t *offs, off_t *len, off_t next) {
+  char *e;
+
+  *len  = strtoll (s, &e, 10);
+  *offs = (*e == '@') ? strtoll (e + 1, NULL, 10) : next;
+}
+
+static char *hls_next_line (char **text) {
+  char *line = *text, *e;
+
+  if (!line || !*line)
+    return NULL;
+  e = strchr (line, '\n');
+  if (e) {
+    *e = 0;
+    *text = e + 1;
+  } else {
+    *text = line + strlen (line);
+  }
+  while (isspace ((unsigned char)*line))
+    line++;
+  e = line + strlen (line);
+  while (e > line && isspace ((unsigned char)e[-1]))
+    *--e = 0;
+  return line;
+}
+
+static int hls_parse_master (hls_input_plugin_t *this, char *text, const char *base) {
+  char     *line;
+  uint32_t  bandwidth = 0;
+  int       width = 0, height = 0, pending = 0;
+
+  while ((line = hls_next_line (&text))) {
+    if (!*line)
+      continue;
+    if (!strncmp (line, "#EXT-X-STREAM-INF:", 18)) {
+      const char *v;
+      size_t      l;
+      bandwidth = 0;
+      width = height = 0;
+      if ((v = hls_attr (line, "BANDWIDTH", &l)))
+        bandwidth = strtoul (v, NULL, 10);
+      if ((v = hls_attr (line, "RESOLUTION", &l)))
+        sscanf (v, "%dx%d", &width, &height);
+      pending = 1;
+    } else if (line[0] != '#' && pending) {
+      hls_variant_t *tmp = realloc (this->variants, (this->num_variants + 1) * sizeof (*tmp));
+      if (!tmp)
+        return 0;
+      this->variants = tmp;
+      tmp += this->num_variants;
+      tmp->uri       = _x_canonicalise_url (base, line);
+      tmp->bandwidth = bandwidth;
+      tmp->width     = width;
+      tmp->height    = height;
+      if (tmp->uri)
+        this->num_variants++;
+      pending = 0;
+    }
+  }
+  return this->num_variants;
+}
+
+/*
+ * parse a media playlist. On reload, only segments newer than the known
+ * ones are appended. return number of new segments, -1 on error.
+ */
+static int hls_parse_media (hls_playlist_t *pl, char *text, const char *base) {
+  char     *line;
+  int64_t   seq = 0;
+  int       duration = 0, added = 0, endlist = 0;
+  off_t     range_offs = 0, range_len = 0, next_offs = 0;
+
+  while ((line = hls_next_line (&text))) {
+    if (!*line)
+      continue;
+    if (line[0] == '#') {
+      if (!strncmp (line, "#EXT-X-TARGETDURATION:", 22)) {
+        pl->target_duration = atoi (line + 22) * 1000;
+      } else if (!strncmp (line, "#EXT-X-MEDIA-SEQUENCE:", 22)) {
+        seq = strtoll (line + 22, NULL, 10);
+      } else if (!strncmp (line, "#EXTINF:", 8)) {
+        duration = (int)(strtod (line + 8, NULL) * 1000.0 + 0.5);
+      } else if (!strncmp (line, "#EXT-X-BYTERANGE:", 17)) {
+        hls_parse_range (line + 17, &range_offs, &range_len, next_offs);
+      } else if (!strncmp (line, "#EXT-X-MAP:", 11)) {
+        const char *v;
+        size_t      l;
+        if (!pl->init_uri && (v = hls_attr (line, "URI", &l))) {
+          char *uri = strndup (v, l);
+          if (uri) {
+            pl->init_uri = _x_canonicalise_url (base, uri);
+            free (uri);
+          }
+          if ((v = hls_attr (line, "BYTERANGE", &l)))
+            hls_parse_range (v, &pl->init_offs, &pl->init_len, 0);
+        }
+      } else if (!strncmp (line, "#EXT-X-KEY:", 11)) {
+        const char *v;
+        size_t      l;
+        v = hls_attr (line, "METHOD", &l);
+        pl->encrypted = v && strncmp (v, "NONE", l);
+      } else if (!strcmp (line, "#EXT-X-ENDLIST")) {
+        endlist = 1;
+      }
+      continue;
+    }
+
+    if (pl->encrypted)
+      return -1;
+
+    if (seq >= pl->next_seq) {
+      hls_segment_t *s;
+      if (pl->num_segs >= pl->max_segs) {
+        int max = pl->max_segs ? pl->max_segs * 2 : 256;
+        s = realloc (pl->segs, max * sizeof (*s));
+        if (!s)
+          return -1;
+        pl->segs     = s;
+        pl->max_segs = max;
+      }
+      s = &pl->segs[pl->num_segs];
+      s->uri = _x_canonicalise_url (base, line);
+      if (!s->uri)
+        return -1;
+      s->seq        = seq;
+      s->duration   = duration;
+      s->start      = pl->next_start;
+      s->range_offs = range_len ? range_offs : 0;
+      s->range_len  = range_len;
+      s->size       = 0;
+      pl->num_segs++;
+      pl->next_seq   = seq + 1;
+      pl->next_start = s->start + duration;
+      added++;
+    }
+    next_offs = range_offs + range_len;
+    range_len = 0;
+    duration  = 0;
+    seq++;
+  }
+
+  pl->live = !endlist;
+  if (pl->target_duration <= 0)
+    pl->target_duration = 10000;
+  return added;
+}
+
+static void hls_playlist_clear (hls_playlist_t *pl) {
+  int i;
+
+  for (i = 0; i < pl->num_segs; i++)
+    free (pl->segs[i].uri);
+  _x_freep (&pl->segs);
+  _x_freep (&pl->init_uri);
+  pl->num_segs = pl->max_segs = 0;
+  pl->next_seq = pl->next_start = 0;
+}
+
+/*
+ * prefetch
+ */
+
+static hls_slot_t *hls_find_slot (hls_input_plugin_t *this, int seg) {
+  int i;
+
+  for (i = 0; i < this->num_slots; i++) {
+    if (this->slots[i].state != HLS_SLOT_FREE && this->slots[i].seg == seg && !this->slots[i].cancel)
+      return &this->slots[i];
+  }
+  return NULL;
+}
+
+static void hls_free_slot (hls_input_plugin_t *this, hls_slot_t *slot) {
+  slot->state  = HLS_SLOT_FREE;
+  slot->seg    = -1;
+  slot->fill   = 0;
+  slot->cancel = 0;
+  pthread_cond_broadcast (&this->work_cond);
+}
+
+/* next segment not yet in a slot inside the prefetch window, or -1 */
+static int hls_next_job (hls_input_plugin_t *this) {
+
+  if (this->fetch_seg < this->read_seg)
+    this->fetch_seg = this->read_seg;
+
+  while (this->fetch_seg < this->pl.num_segs && this->fetch_seg < this->read_seg + this->num_slots) {
+    int seg = this->fetch_seg++;
+    if (!hls_find_slot (this, seg))
+      return seg;
+  }
+  return -1;
+}
+
+static int hls_slot_sink (void *data, const uint8_t *buf, size_t len) {
+  hls_worker_t       *w    = (hls_worker_t *)data;
+  hls_input_plugin_t *this = w->hls;
+  hls_slot_t         *slot = w->slot;
+
+  pthread_mutex_lock (&this->lock);
+  if (this->quit || slot->cancel) {
+    pthread_mutex_unlock (&this->lock);
+    return 0;
+  }
+  if (slot->fill + len > slot->alloc) {
+    size_t   alloc = slot->alloc ? slot->alloc : (1 << 20);
+    uint8_t *tmp;
+    while (alloc < slot->fill + len)
+      alloc *= 2;
+    tmp = realloc (slot->data, alloc);
+    if (!tmp) {
+      pthread_mutex_unlock (&this->lock);
+      return 0;
+    }
+    slot->data  = tmp;
+    slot->alloc = alloc;
+  }
+  memcpy (slot->data + slot->fill, buf, len);
+  slot->fill += len;
+  pthread_cond_broadcast (&this->data_cond);
+  pthread_mutex_unlock (&this->lock);
+  return 1;
+}
+
+/*
+ * live: forget the segments the reader has passed, live streams cannot
+ * seek back anyway. All segment numbers move down by the count dropped,
+ * a waiting hls_read_int () catches up through this->trimmed.
+ */
+static void hls_trim (hls_input_plugin_t *this) {
+  int drop = this->read_seg, i;
+
+  if (drop <= 0)
+    return;
+
+  for (i = 0; i < drop; i++)
+    free (this->pl.segs[i].uri);
+  memmove (this->pl.segs, this->pl.segs + drop, (this->pl.num_segs - drop) * sizeof (*this->pl.segs));
+  this->pl.num_segs -= drop;
+
+  for (i = 0; i < this->num_slots; i++) {
+    hls_slot_t *slot = &this->slots[i];
+    if (slot->state == HLS_SLOT_FREE)
+      continue;
+    if (slot->seg >= drop) {
+      slot->seg -= drop;
+    } else if (slot->state == HLS_SLOT_LOADING) {
+      slot->cancel = 1;
+      slot->seg    = -1;
+    } else {
+      hls_free_slot (this, slot);
+    }
+  }
+
+  this->read_seg  -= drop;
+  this->fetch_seg  = this->fetch_seg > drop ? this->fetch_seg - drop : 0;
+  this->trimmed   += drop;
+}
+
+static void hls_reload (hls_input_plugin_t *this, hls_worker_t *w) {
+  char    *url = strdup (this->list_url);
+  uint8_t *text;
+  int      added = 0;
+
+  this->reloading = 1;
+  pthread_mutex_unlock (&this->lock);
+
+  text = url ? hls_fetch (this, &w->conn, &url, 0, 0, HLS_PLAYLIST_MAX, NULL) : NULL;
+
+  pthread_mutex_lock (&this->lock);
+  if (text) {
+    added = hls_parse_media (&this->pl, (char *)text, url);
+    if (this->pl.live)
+      hls_trim (this);
+    if (added > 0) {
+      lprintf ("playlist reload: %d new segments\n", added);
+      pthread_cond_broadcast (&this->data_cond);
+    }
+    free (text);
+  }
+  free (url);
+  this->next_reload = hls_now () + (added > 0 ? this->pl.target_duration : this->pl.target_duration / 2);
+  this->reloading = 0;
+}
+
+/*
+ * adaptive bit rate
+ */
+
+/* highest working variant not above limit bit/s, else the lowest one */
+static int hls_select_variant (hls_input_plugin_t *this, uint32_t limit) {
+  int i, best = -1, lowest = -1;
+
+  for (i = 0; i < this->num_variants; i++) {
+    uint32_t b = this->variants[i].bandwidth;
+    if (this->variants[i].failed)
+      continue;
+    if (lowest < 0 || b < this->variants[lowest].bandwidth)
+      lowest = i;
+    if (b <= limit && (best < 0 || b > this->variants[best].bandwidth))
+      best = i;
+  }
+  if (best >= 0)
+    return best;
+  return lowest >= 0 ? lowest : this->cur_variant;
+}
+
+/* feed one finished download into the fast and slow throughput averages */
+static void hls_abr_sample (hls_input_plugin_t *this, size_t bytes, int msecs, int parallel) {
+  double rate;
+
+  if (bytes < HLS_ABR_MIN_SAMPLE || msecs <= 0)
+    return;
+  /* parallel downloads share the link */
+  rate = (double)bytes * 8000.0 / msecs * (parallel > 0 ? parallel : 1);
+  if (!this->tp_samples) {
+    this->tp_fast = this->tp_slow = rate;
+  } else {
+    this->tp_fast += (rate - this->tp_fast) * 0.5;
+    this->tp_slow += (rate - this->tp_slow) * 0.15;
+  }
+  this->tp_samples++;
+}
+
+static double hls_abr_throughput (hls_input_plugin_t *this) {
+  return this->tp_fast < this->tp_slow ? this->tp_fast : this->tp_slow;
+}
+
+/* play time ready for the decoders: fifo contents plus downloaded segments */
+static int hls_abr_buffered (hls_input_plugin_t *this) {
+  int buffered = this->nbc ? nbc_get_fifo_length (this->nbc) : 0;
+  int i;
+
+  for (i = 0; i < this->num_slots; i++) {
+    const hls_slot_t *slot = &this->slots[i];
+    if (slot->state == HLS_SLOT_DONE && slot->seg >= this->read_seg)
+      buffered += this->pl.segs[slot->seg].duration;
+  }
+  return buffered;
+}
+
+/*
+ * The throughput estimate is the smaller one of a fast and a slow moving
+ * average, so drops are followed at once while short peaks are not.
+ * Switch down as soon as the current variant does not fit, more
+ * aggressively when the buffer runs low. Switch up only with two target
+ * durations buffered, and not twice within one.
+ */
+static int hls_abr_decide (hls_input_plugin_t *this, int buffered) {
+  const hls_variant_t *cur = &this->variants[this->cur_variant];
+  double               budget;
+  int                  want;
+
+  budget = hls_abr_throughput (this) * (buffered < this->pl.target_duration ? 0.5 : 0.8);
+  if (this->max_bitrate && budget > this->max_bitrate)
+    budget = this->max_bitrate;
+  want = hls_select_variant (this, budget < 4294967295.0 ? (uint32_t)budget : 0xffffffff);
+
+  if (this->variants[want].bandwidth > cur->bandwidth &&
+      (buffered < 2 * this->pl.target_duration ||
+       hls_now () - this->last_switch < this->pl.target_duration))
+    return this->cur_variant;
+  return want;
+}
+
+static void hls_abr_update_info (hls_input_plugin_t *this, int buffered) {
+  double tp;
+
+  if (!this->stream)
+    return;
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_VARIANT, this->cur_variant);
+  tp = hls_abr_throughput (this);
+  /* beyond 2 Gbit/s, int would overflow */
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_THROUGHPUT, tp < (double)INT_MAX ? (int)tp : INT_MAX);
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_VARIANT_SWITCHES, this->switches);
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_BUFFER_LENGTH, buffered);
+}
+
+/*
+ * Load the media playlist of variant v and let it provide the segments
+ * that have not been handed to a worker yet, matched by media sequence
+ * number. Segments already downloaded or in flight are played as they
+ * are, so the switch becomes visible at a segment boundary.
+ */
+static void hls_abr_switch (hls_input_plugin_t *this, hls_worker_t *w, int v, int buffered) {
+  hls_playlist_t  pl;
+  char           *url = strdup (this->variants[v].uri);
+  uint8_t        *text;
+  int             i, j, n = 0;
+
+  memset (&pl, 0, sizeof (pl));
+  this->switching = 1;
+  pthread_mutex_unlock (&this->lock);
+
+  text = url ? hls_fetch (this, &w->conn, &url, 0, 0, HLS_PLAYLIST_MAX, NULL) : NULL;
+
+  pthread_mutex_lock (&this->lock);
+  this->switching = 0;
+
+  if (text && !strncmp ((char *)text, "#EXTM3U", 7) &&
+      hls_parse_media (&pl, (char *)text, url) > 0 && !pl.encrypted && !pl.init_uri) {
+    j = 0;
+    for (i = this->fetch_seg; i < this->pl.num_segs; i++) {
+      hls_segment_t *s = &this->pl.segs[i];
+      while (j < pl.num_segs && pl.segs[j].seq < s->seq)
+        j++;
+      if (j >= pl.num_segs)
+        break;
+      if (pl.segs[j].seq != s->seq || hls_find_slot (this, i))
+        continue;
+      free (s->uri);
+      s->uri        = pl.segs[j].uri;
+      s->range_offs = pl.segs[j].range_offs;
+      s->range_len  = pl.segs[j].range_len;
+      s->size       = 0;
+      pl.segs[j].uri = NULL;
+      n++;
+    }
+  }
+  free (text);
+  hls_playlist_clear (&pl);
+
+  if (!n && this->fetch_seg < this->pl.num_segs) {
+    xprintf (this->xine, XINE_VERBOSITY_LOG,
+             LOG_MODULE ": variant %d (%u bit/s) unusable, not switching\n", v, this->variants[v].bandwidth);
+    this->variants[v].failed = 1;
+    free (url);
+    return;
+  }
+
+  xprintf (this->xine, XINE_VERBOSITY_LOG,
+           LOG_MODULE ": switch %d: variant %d -> %d (%u -> %u bit/s), throughput %.0f bit/s, buffer %d ms\n",
+           this->switches + 1, this->cur_variant, v, this->variants[this->cur_variant].bandwidth,
+           this->variants[v].bandwidth, hls_abr_throughput (this), buffered);
+
+  free (this->list_url);
+  this->list_url    = url;
+  this->cur_variant = v;
+  this->switches++;
+  this->last_switch = hls_now ();
+  if (this->stream)
+    _x_stream_info_set (this->stream, XINE_STREAM_INFO_BITRATE, this->variants[v].bandwidth);
+  hls_abr_update_info (this, buffered);
+}
+
+static void *hls_worker (void *data) {
+  hls_worker_t       *w    = (hls_worker_t *)data;
+  hls_input_plugin_t *this = w->hls;
+
+  pthread_mutex_lock (&this->lock);
+
+  while (!this->quit) {
+    hls_slot_t *slot = NULL;
+    char       *uri;
+    off_t       offs, len;
+    int64_t     start;
+    int         i, seg, res, tries;
+
+    if (this->pl.live && !this->reloading && hls_now () >= this->next_reload) {
+      hls_reload (this, w);
+      continue;
+    }
+
+    /* decide once per new throughput sample */
+    if (this->adaptive && !this->switching && this->tp_samples > this->tp_used) {
+      int buffered = hls_abr_buffered (this), v;
+      this->tp_used = this->tp_samples;
+      v = hls_abr_decide (this, buffered);
+      if (v != this->cur_variant) {
+        hls_abr_switch (this, w, v, buffered);
+        continue;
+      }
+      hls_abr_update_info (this, buffered);
+    }
+
+    for (i = 0; i < this->num_slots; i++) {
+      if (this->slots[i].state == HLS_SLOT_FREE) {
+        slot = &this->slots[i];
+        break;
+      }
+    }
+    seg = slot ? hls_next_job (this) : -1;
+    if (seg < 0) {
+      hls_timed_wait (&this->work_cond, &this->lock, 100);
+      continue;
+    }
+
+    slot->seg    = seg;
+    slot->state  = HLS_SLOT_LOADING;
+    slot->cancel = 0;
+    slot->fill   = 0;
+    w->slot      = slot;
+    uri  = strdup (this->pl.segs[seg].uri);
+    offs = this->pl.segs[seg].range_offs;
+    len  = this->pl.segs[seg].range_len;
+    this->loading++;
+    pthread_mutex_unlock (&this->lock);
+
+    lprintf ("fetching segment %d: %s\n", seg, uri);
+    start = hls_now ();
+    res = 0;
+    for (tries = 0; uri && tries <= HLS_RETRIES && res == 0; tries++) {
+      res = hls_http_get (this, &w->conn, &uri, offs, len, hls_slot_sink, w);
+      if (res == 0 && slot->fill)
+        break; /* partial data already visible to the reader */
+    }
+    free (uri);
+
+    pthread_mutex_lock (&this->lock);
+    if (res > 0)
+      hls_abr_sample (this, slot->fill, hls_now () - start, this->loading);
+    this->loading--;
+    if (slot->cancel || this->quit) {
+      hls_free_slot (this, slot);
+    } else if (res > 0 || slot->fill) {
+      /* a live reload may have renumbered the segment meanwhile */
+      seg = slot->seg;
+      if (res <= 0)
+        xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": segment %d truncated\n", seg);
+      slot->state = HLS_SLOT_DONE;
+      this->pl.segs[seg].size = slot->fill;
+    } else {
+      xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": segment %d failed\n", seg);
+      slot->state = HLS_SLOT_FAILED;
+    }
+    w->slot = NULL;
+    pthread_cond_broadcast (&this->data_cond);
+  }
+
+  pthread_mutex_unlock (&this->lock);
+  return NULL;
+}
+
+/*
+ * byte stream
+ */
+
+/* copy stream data from the current position, optionally consuming it */
+static off_t hls_read_int (hls_input_plugin_t *this, uint8_t *buf, off_t len, int consume) {
+  size_t init_pos = this->init_pos, offs = this->read_offs;
+  int    seg, trimmed;
+  int    waits = 0;
+  off_t  done = 0;
+
+  if (init_pos < this->init_size) {
+    size_t n = this->init_size - init_pos;
+    if ((off_t)n > len)
+      n = len;
+    memcpy (buf, this->init_data + init_pos, n);
+    init_pos += n;
+    done += n;
+  }
+
+  pthread_mutex_lock (&this->lock);
+  seg     = this->read_seg;
+  trimmed = this->trimmed;
+
+  while (done < len && !this->quit) {
+    hls_slot_t *slot;
+
+    /* segments were dropped while waiting */
+    seg    -= this->trimmed - trimmed;
+    trimmed = this->trimmed;
+
+    if (consume ? (this->stream && _x_action_pending (this->stream)) : (waits > 300))
+      break; /* peeking gives up after 30 s */
+
+    if (seg >= this->pl.num_segs) {
+      if (!this->pl.live)
+        break;
+      hls_timed_wait (&this->data_cond, &this->lock, 100);
+      waits++;
+      continue;
+    }
+
+    slot = hls_find_slot (this, seg);
+    if (!slot) {
+      hls_timed_wait (&this->data_cond, &this->lock, 100);
+      waits++;
+      continue;
+    }
+
+    if (offs < slot->fill) {
+      size_t n = slot->fill - offs;
+      if ((off_t)n > len - done)
+        n = len - done;
+      memcpy (buf + done, slot->data + offs, n);
+      offs += n;
+      done += n;
+      continue;
+    }
+
+    if (slot->state == HLS_SLOT_DONE || slot->state == HLS_SLOT_FAILED) {
+      if (consume)
+        hls_free_slot (this, slot);
+      seg++;
+      offs = 0;
+      continue;
+    }
+
+    hls_timed_wait (&this->data_cond, &this->lock, 100);
+    waits++;
+  }
+
+  if (consume) {
+    this->init_pos  = init_pos;
+    this->read_seg  = seg;
+    this->read_offs = offs;
+    this->curpos   += done;
+  }
+
+  pthread_mutex_unlock (&this->lock);
+  return done;
+}
+
+/* average stream bytes per ms, from the segments seen so far */
+static double hls_byterate (hls_input_plugin_t *this) {
+  int64_t bytes = 0, msecs = 0;
+  int     i;
+
+  for (i = 0; i < this->pl.num_segs; i++) {
+    if (this->pl.segs[i].size > 0) {
+      bytes += this->pl.segs[i].size;
+      msecs += this->pl.segs[i].duration;
+    }
+  }
+  if (msecs > 0)
+    return (double)bytes / msecs;
+  if (this->num_variants)
+    return this->variants[this->cur_variant].bandwidth / 8000.0;
+  return 0.0;
+}
+
+/* (estimated) byte offset of segment seg in the stream */
+static off_t hls_seg_offset (hls_input_plugin_t *this, int seg, double rate) {
+  off_t offs = this->init_size;
+  int   i;
+
+  for (i = 0; i < seg && i < this->pl.num_segs; i++)
+    offs += this->pl.segs[i].size > 0 ? this->pl.segs[i].size : (off_t)(rate * this->pl.segs[i].duration);
+  return offs;
+}
+
+static void hls_reposition (hls_input_plugin_t *this, int seg, size_t offs) {
+  int i;
+
+  for (i = 0; i < this->num_slots; i++) {
+    hls_slot_t *slot = &this->slots[i];
+    if (slot->state == HLS_SLOT_FREE || (slot->seg >= seg && slot->seg < seg + this->num_slots))
+      continue;
+    if (slot->state == HLS_SLOT_LOADING)
+      slot->cancel = 1;
+    else
+      hls_free_slot (this, slot);
+  }
+  this->read_seg  = seg;
+  this->read_offs = offs;
+  this->fetch_seg = seg;
+  pthread_cond_broadcast (&this->work_cond);
+}
+
+static off_t hls_plugin_read (input_plugin_t *this_gen, void *buf_gen, off_t len) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+
+  if (len <= 0)
+    return 0;
+  return hls_read_int (this, (uint8_t *)buf_gen, len, 1);
+}
+
+static off_t hls_plugin_seek (input_plugin_t *this_gen, off_t offset, int origin) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+  double              rate;
+  off_t               length, pos;
+  int                 seg;
+
+  pthread_mutex_lock (&this->lock);
+
+  rate   = hls_byterate (this);
+  length = this->pl.live ? 0 : hls_seg_offset (this, this->pl.num_segs, rate);
+  offset = _x_input_translate_seek (offset, origin, this->curpos, length);
+  if (offset < 0 || (this->pl.live && offset != this->curpos)) {
+    pthread_mutex_unlock (&this->lock);
+    return -1;
+  }
+  /* live segments before read_seg are gone, and offsets count from them */
+  if (this->pl.live) {
+    pthread_mutex_unlock (&this->lock);
+    return offset;
+  }
+
+  if ((size_t)offset < this->init_size) {
+    this->init_pos = offset;
+    hls_reposition (this, 0, 0);
+  } else {
+    this->init_pos = this->init_size;
+    pos = this->init_size;
+    for (seg = 0; seg < this->pl.num_segs - 1; seg++) {
+      off_t size = this->pl.segs[seg].size > 0 ? this->pl.segs[seg].size : (off_t)(rate * this->pl.segs[seg].duration);
+      if (offset < pos + size)
+        break;
+      pos += size;
+    }
+    hls_reposition (this, seg, offset - pos);
+  }
+  this->curpos = offset;
+
+  pthread_mutex_unlock (&this->lock);
+  return offset;
+}
+
+static off_t hls_plugin_seek_time (input_plugin_t *this_gen, int time_offset, int origin) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+  int                 seg;
+
+  if (origin != SEEK_SET || time_offset < 0)
+    return -1;
+
+  pthread_mutex_lock (&this->lock);
+
+  if (this->pl.live) {
+    pthread_mutex_unlock (&this->lock);
+    return -1;
+  }
+
+  /* segments start with a key frame, so land on a segment boundary */
+  for (seg = 0; seg < this->pl.num_segs - 1; seg++) {
+    if (this->pl.segs[seg + 1].start > time_offset)
+      break;
+  }
+  this->init_pos = this->init_size;
+  hls_reposition (this, seg, 0);
+  this->curpos = hls_seg_offset (this, seg, hls_byterate (this));
+  xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+           LOG_MODULE ": seek to %d ms -> segment %d (%" PRId64 " ms)\n",
+           time_offset, seg, this->pl.segs[seg].start);
+
+  pthread_mutex_unlock (&this->lock);
+  return this->curpos;
+}
+
+static off_t hls_plugin_get_current_pos (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+
+  return this->curpos;
+}
+
+static int hls_plugin_get_current_time (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+  int64_t             t = 0;
+
+  pthread_mutex_lock (&this->lock);
+  if (this->read_seg < this->pl.num_segs) {
+    const hls_segment_t *s = &this->pl.segs[this->read_seg];
+    t = s->start;
+    if (s->size > 0)
+      t += (int64_t)s->duration * this->read_offs / s->size;
+  } else if (this->pl.num_segs > 0) {
+    t = this->pl.segs[this->pl.num_segs - 1].start + this->pl.segs[this->pl.num_segs - 1].duration;
+  }
+  pthread_mutex_unlock (&this->lock);
+
+  return t;
+}
+
+static off_t hls_plugin_get_length (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+  off_t               length = 0;
+
+  pthread_mutex_lock (&this->lock);
+  if (!this->pl.live)
+    length = hls_seg_offset (this, this->pl.num_segs, hls_byterate (this));
+  pthread_mutex_unlock (&this->lock);
+
+  return length;
+}
+
+static uint32_t hls_plugin_get_capabilities (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+
+  return INPUT_CAP_PREVIEW | (this->pl.live ? 0 : INPUT_CAP_SLOW_SEEKABLE);
+}
+
+static const char *hls_plugin_get_mrl (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+
+  return this->mrl;
+}
+
+static int hls_plugin_get_optional_data (input_plugin_t *this_gen,
+                                         void *data, int data_type) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+
+  switch (data_type) {
+  case INPUT_OPTIONAL_DATA_PREVIEW:
+    memcpy (data, this->preview, this->preview_size);
+    return this->preview_size;
+
+  case INPUT_OPTIONAL_DATA_MIME_TYPE:
+  case INPUT_OPTIONAL_DATA_DEMUX_MIME_TYPE:
+    if (this->pl.init_uri) {
+      if (data_type == INPUT_OPTIONAL_DATA_MIME_TYPE)
+        *(const char **)data = "video/mp4";
+      return INPUT_OPTIONAL_SUCCESS;
+    }
+    {
+      int is_ts = 0;
+      pthread_mutex_lock (&this->lock);
+      if (this->pl.num_segs > 0) {
+        const char *uri = this->pl.segs[0].uri;
+        size_t      l   = strcspn (uri, "?#");
+        is_ts = l > 3 && !strncasecmp (uri + l - 3, ".ts", 3);
+      }
+      pthread_mutex_unlock (&this->lock);
+      if (is_ts) {
+        if (data_type == INPUT_OPTIONAL_DATA_MIME_TYPE)
+          *(const char **)data = "video/mp2t";
+        return INPUT_OPTIONAL_SUCCESS;
+      }
+    }
+    break;
+  }
+
+  return INPUT_OPTIONAL_UNSUPPORTED;
+}
+
+static void hls_plugin_dispose (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+  int                 i;
+
+  pthread_mutex_lock (&this->lock);
+  this->quit = 1;
+  pthread_cond_broadcast (&this->work_cond);
+  pthread_cond_broadcast (&this->data_cond);
+  /* wake up workers blocked in a read. idle connections stay usable. */
+  for (i = 0; i < this->num_workers; i++) {
+    hls_conn_t *conn = &this->workers[i].conn;
+    if (this->workers[i].running && conn->busy && (conn->fd != -1)) {
+      shutdown (conn->fd, SHUT_RDWR);
+      conn->fd = -1;
+    }
+  }
+  pthread_mutex_unlock (&this->lock);
+
+  for (i = 0; i < this->num_workers; i++) {
+    if (this->workers[i].running)
+      pthread_join (this->workers[i].thread, NULL);
+  }
+  for (i = 0; i < HLS_MAX_WORKERS; i++)
+    hls_conn_release (this, &this->workers[i].conn);
+
+  pthread_cond_destroy (&this->work_cond);
+  pthread_cond_destroy (&this->data_cond);
+  pthread_mutex_destroy (&this->lock);
+
+  if (this->nbc) {
+    nbc_close (this->nbc);
+    this->nbc = NULL;
+  }
+
+  for (i = 0; i < HLS_MAX_SLOTS; i++)
+    free (this->slots[i].data);
+  hls_playlist_clear (&this->pl);
+  for (i = 0; i < this->num_variants; i++)
+    free (this->variants[i].uri);
+  free (this->variants);
+  free (this->init_data);
+  free (this->list_url);
+  free (this->mrl);
+  free (this);
+}
+
+static int hls_plugin_open (input_plugin_t *this_gen) {
+  hls_input_plugin_t *this = (hls_input_plugin_t *) this_gen;
+  hls_input_class_t  *cls  = (hls_input_class_t *) this->input_plugin.input_class;
+  hls_conn_t         *conn = &this->workers[0].conn;
+  char               *url;
+  char               *text;
+  int                 i;
+
+  if (!strncasecmp (this->mrl, "hls://", 6))
+    url = _x_asprintf ("http://%s", this->mrl + 6);
+  else
+    url = strdup (this->mrl);
+  if (!url)
+    return 0;
+
+  text = (char *)hls_fetch (this, conn, &url, 0, 0, HLS_PLAYLIST_MAX, NULL);
+  if (!text || strncmp (text, "#EXTM3U", 7)) {
+    xine_log (this->xine, XINE_LOG_MSG, _("input_hls: %s is not a m3u8 playlist\n"), url);
+    _x_message (this->stream, XINE_MSG_FILE_NOT_FOUND, this->mrl, NULL);
+    free (text);
+    free (url);
+    return 0;
+  }
+
+  if (strstr (text, "#EXT-X-STREAM-INF:")) {
+    if (!hls_parse_master (this, text, url)) {
+      free (text);
+      free (url);
+      return 0;
+    }
+    free (text);
+    free (url);
+    /* adaptive playback starts low and works its way up */
+    this->max_bitrate = cls->max_bitrate > 0 ? (uint32_t)cls->max_bitrate * 1000 : 0;
+    this->adaptive    = cls->adaptive && this->num_variants > 1;
+    while (1) {
+      this->cur_variant = hls_select_variant (this, this->adaptive ? 0 :
+                                              this->max_bitrate ? this->max_bitrate : 0xffffffff);
+      if (this->variants[this->cur_variant].failed) {
+        xine_log (this->xine, XINE_LOG_MSG, _("input_hls: no usable variant in %s\n"), this->mrl);
+        return 0;
+      }
+      xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+               LOG_MODULE ": %d variants, using %u bit/s (%dx%d)\n", this->num_variants,
+               this->variants[this->cur_variant].bandwidth,
+               this->variants[this->cur_variant].width, this->variants[this->cur_variant].height);
+      url  = strdup (this->variants[this->cur_variant].uri);
+      text = url ? (char *)hls_fetch (this, conn, &url, 0, 0, HLS_PLAYLIST_MAX, NULL) : NULL;
+      if (text && !strncmp (text, "#EXTM3U", 7))
+        break;
+      xine_log (this->xine, XINE_LOG_MSG, _("input_hls: media playlist %s not found\n"),
+                url ? url : "");
+      free (text);
+      free (url);
+      this->variants[this->cur_variant].failed = 1;
+    }
+  }
+
+  i = hls_parse_media (&this->pl, text, url);
+  free (text);
+  this->list_url = url;
+  if (i < 0 || this->pl.encrypted) {
+    xine_log (this->xine, XINE_LOG_MSG, _("input_hls: encrypted streams are not supported\n"));
+    _x_message (this->stream, XINE_MSG_ENCRYPTED_SOURCE, this->mrl, NULL);
+    return 0;
+  }
+  if (!this->pl.num_segs) {
+    xine_log (this->xine, XINE_LOG_MSG, _("input_hls: playlist has no segments\n"));
+    return 0;
+  }
+  if (this->pl.init_uri && this->adaptive) {
+    /* the demuxer cannot take a new init section mid-stream */
+    xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": fMP4 stream, adaptive switching disabled\n");
+    this->adaptive = 0;
+  }
+
+  if (this->pl.init_uri) {
+    char *init_url = strdup (this->pl.init_uri);
+    this->init_data = init_url ? hls_fetch (this, conn, &init_url, this->pl.init_offs, this->pl.init_len,
+                                            HLS_INIT_MAX, &this->init_size) : NULL;
+    free (init_url);
+    if (!this->init_data) {
+      xine_log (this->xine, XINE_LOG_MSG, _("input_hls: cannot load init section %s\n"),
+                this->pl.init_uri);
+      return 0;
+    }
+  }
+
+  if (this->pl.live) {
+    this->read_seg    = this->pl.num_segs > HLS_LIVE_START ? this->pl.num_segs - HLS_LIVE_START : 0;
+    this->next_reload = hls_now () + this->pl.target_duration;
+  }
+  this->fetch_seg = this->read_seg;
+
+  xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+           LOG_MODULE ": %s playlist, %d segments, target duration %d ms\n",
+           this->pl.live ? "live" : "vod", this->pl.num_segs, this->pl.target_duration);
+
+  this->num_slots   = cls->prefetch;
+  this->num_workers = cls->connections;
+  for (i = 0; i < HLS_MAX_SLOTS; i++)
+    this->slots[i].seg = -1;
+  for (i = 0; i < this->num_workers; i++) {
+    this->workers[i].hls = this;
+    if (pthread_create (&this->workers[i].thread, NULL, hls_worker, &this->workers[i])) {
+      xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": cannot create worker thread\n");
+      break;
+    }
+    this->workers[i].running = 1;
+  }
+  if (i == 0)
+    return 0;
+
+  this->preview_size = hls_read_int (this, (uint8_t *)this->preview, MAX_PREVIEW_SIZE, 0);
+  if (this->preview_size <= 0) {
+    xine_log (this->xine, XINE_LOG_MSG, _("input_hls: cannot read first segment\n"));
+    return 0;
+  }
+
+  if (this->stream && this->num_variants)
+    _x_stream_info_set (this->stream, XINE_STREAM_INFO_BITRATE,
+                        this->variants[this->cur_variant].bandwidth);
+
+  return 1;
+}
+
+/*
+ * hls input plugin class
+ */
+
+static int hls_is_playlist_url (const char *mrl) {
+  size_t l;
+
+  if (strncasecmp (mrl, "http://", 7) && strncasecmp (mrl, "https://", 8))
+    return 0;
+  l = strcspn (mrl, "?#");
+  return l > 5 && !strncasecmp (mrl + l - 5, ".m3u8", 5);
+}
+
+static input_plugin_t *hls_class_get_instance (input_class_t *cls_gen, xine_stream_t *stream,
+                                               const char *mrl) {
+  hls_input_class_t  *cls = (hls_input_class_t *)cls_gen;
+  hls_input_plugin_t *this;
+  int                 i;
+
+  if (strncasecmp (mrl, "hls://", 6) && !hls_is_playlist_url (mrl))
+    return NULL;
+
+  if (!strncasecmp (mrl, "https://", 8) && !_x_tls_available (cls->xine)) {
+    xine_log (cls->xine, XINE_LOG_MSG, "input_hls: TLS plugin not found\n");
+    return NULL;
+  }
+
+  this = calloc (1, sizeof (hls_input_plugin_t));
+  if (!this)
+    return NULL;
+  for (i = 0; i < HLS_MAX_WORKERS; i++)
+    this->workers[i].conn.fd = -1;
+
+  this->mrl = strdup (mrl);
+  if (!this->mrl) {
+    free (this);
+    return NULL;
+  }
+
+  this->stream = stream;
+  this->xine   = cls->xine;
+  if (stream)
+    this->nbc  = nbc_init (stream);
+
+  pthread_mutex_init (&this->lock, NULL);
+  pthread_cond_init (&this->data_cond, NULL);
+  pthread_cond_init (&this->work_cond, NULL);
+
+  this->input_plugin.open              = hls_plugin_open;
+  this->input_plugin.get_capabilities  = hls_plugin_get_capabilities;
+  this->input_plugin.read              = hls_plugin_read;
+  this->input_plugin.read_block        = _x_input_default_read_block;
+  this->input_plugin.seek              = hls_plugin_seek;
+  this->input_plugin.seek_time         = hls_plugin_seek_time;
+  this->input_plugin.get_current_pos   = hls_plugin_get_current_pos;
+  this->input_plugin.get_current_time  = hls_plugin_get_current_time;
+  this->input_plugin.get_length        = hls_plugin_get_length;
+  this->input_plugin.get_blocksize     = _x_input_default_get_blocksize;
+  this->input_plugin.get_mrl           = hls_plugin_get_mrl;
+  this->input_plugin.get_optional_data = hls_plugin_get_optional_data;
+  this->input_plugin.dispose           = hls_plugin_dispose;
+  this->input_plugin.input_class       = cls_gen;
+
+  return &this->input_plugin;
+}
+
+static void connections_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
+  hls_input_class_t *this = (hls_input_class_t *) this_gen;
+
+  this->connections = cfg->num_value;
+}
+
+static void prefetch_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
+  hls_input_class_t *this = (hls_input_class_t *) this_gen;
+
+  this->prefetch = cfg->num_value;
+}
+
+static void max_bitrate_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
+  hls_input_class_t *this = (hls_input_class_t *) this_gen;
+
+  this->max_bitrate = cfg->num_value;
+}
+
+static void adaptive_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
+  hls_input_class_t *this = (hls_input_class_t *) this_gen;
+
+  this->adaptive = cfg->num_value;
+}
+
+static void hls_class_dispose (input_class_t *this_gen) {
+  hls_input_class_t *this = (hls_input_class_t *) this_gen;
+  config_values_t   *config = this->xine->config;
+
+  config->unregister_callback (config, "media.network.hls_connections");
+  config->unregister_callback (config, "media.network.hls_prefetch");
+  config->unregister_callback (config, "media.network.hls_max_bitrate");
+  config->unregister_callback (config, "media.network.hls_adaptive");
+
+  http_pool_release (&this->pool);
+  free (this);
+}
+
+void *input_hls_init_class (xine_t *xine, const void *data) {
+  hls_input_class_t *this;
+  config_values_t   *config;
+
+  (void)data;
+  this = calloc (1, sizeof (hls_input_class_t));
+  if (!this)
+    return NULL;
+
+  this->xine = xine;
+  config     = xine->config;
+
+  this->pool = http_pool_acquire (xine);
+  if (!this->pool) {
+    free (this);
+    return NULL;
+  }
+
+  this->input_class.get_instance       = hls_class_get_instance;
+  this->input_class.identifier         = "hls";
+  this->input_class.description        = N_("HTTP Live Streaming input plugin");
+  this->input_class.get_dir            = NULL;
+  this->input_class.get_autoplay_list  = NULL;
+  this->input_class.dispose            = hls_class_dispose;
+  this->input_class.eject_media        = NULL;
+
+  this->connections = config->register_range (config,
+    "media.network.hls_connections", 2, 1, HLS_MAX_WORKERS,
+    _("HLS parallel connections"),
+    _("Number of persistent connections used to download HLS segments in parallel."),
+    20, connections_change_cb, this);
+  this->prefetch = config->register_range (config,
+    "media.network.hls_prefetch", 4, 2, HLS_MAX_SLOTS,
+    _("HLS prefetch segments"),
+    _("How many segments ahead of the playback position are kept in memory."),
+    20, prefetch_change_cb, this);
+  this->max_bitrate = config->register_num (config,
+    "media.network.hls_max_bitrate", 0,
+    _("HLS maximum bit rate"),
+    _("Highest variant bit rate in kbit/s to select from a master playlist. "
+      "0 means no limit."),
+    20, max_bitrate_change_cb, this);
+  this->adaptive = config->register_bool (config,
+    "media.network.hls_adaptive", 1,
+    _("HLS adaptive bit rate"),
+    _("Switch between the variants of a master playlist following the measured "
+      "download throughput and the amount of buffered data."),
+    20, adaptive_change_cb, this);
+
+  return this;
+}
@@ -32,6 +32,8 @@
 #endif
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
 #ifdef WIN32
 #include <winsock.h>
@@ -50,6 +52,7 @@
 #include "net_buf_ctrl.h"
 #include "group_network.h"
 #include "http_helper.h"
+#include "http_pool.h"
 #include "input_helper.h"
 
 #define BUFSIZE                 1024
@@ -57,6 +60,12 @@
 #define DEFAULT_HTTP_PORT         80
 #define DEFAULT_HTTPS_PORT       443
 
+#define HTTP_DRAIN_MAX    (64 * 1024)    /* read away smaller response rests instead of reconnecting */
+#define HTTP_RANGE_MIN    (64 * 1024)
+#define HTTP_RANGE_MAX  (2048 * 1024)
+
+#define HTTP_STALE              -100     /* kept-alive connection was closed by the server */
+
 #define TAG_ICY_NAME       "icy-name:"
 #define TAG_ICY_GENRE      "icy-genre:"
 #define TAG_ICY_NOTICE1    "icy-notice1:"
@@ -94,6 +103,29 @@ typedef struct {
   /* set to 1 if server replied with Accept-Ranges: bytes */
   unsigned int     accept_range:1;
 
+  /* connection came from the pool */
+  unsigned int     conn_reused:1;
+  /* server keeps the connection open after current response */
+  unsigned int     keep_alive:1;
+  /* response body uses chunked transfer encoding */
+  unsigned int     chunked:1;
+  /* seek happened, next read requests a new range at curpos */
+  unsigned int     range_pending:1;
+
+  int              use_proxy;
+  int              proxyport;
+
+  /* connect target, to return a kept-alive connection to the pool */
+  char            *conn_host;
+  int              conn_port;
+  int              conn_tls;
+
+  off_t            body_left;    /* unread bytes of response body, -1: until close / last chunk */
+  off_t            chunk_left;   /* unread bytes of current chunk */
+  off_t            range_end;    /* end of current bounded range, 0: response runs to end of resource */
+  off_t            range_size;   /* size of last range request */
+  off_t            pipe_end;     /* end of pipelined range request, 0: none */
+
   /* ShoutCast */
   int              shoutcast_metaint;
   off_t            shoutcast_pos;
@@ -110,6 +142,9 @@ typedef struct {
 
   xine_t           *xine;
 
+  /* kept-alive connections, shared with hls */
+  http_pool_t      *pool;
+
   const char       *proxyhost;
   int               proxyport;
 
@@ -234,6 +269,91 @@ static void http_plugin_basicauth (const char *user, const char *password, char*
   xine_base64_encode(tmp, *dest, totlen);
 }
 
+
+/*
+ * drop the connection, or park it in the pool when the server keeps it open
+ * and the last response has been read completely
+ */
+static void http_release (http_input_plugin_t *this) {
+  http_input_class_t *cls = (http_input_class_t *) this->input_plugin.input_class;
+
+  if (this->tls && this->keep_alive && !this->body_left && !this->pipe_end && this->conn_host) {
+    http_pool_put (cls->pool, &this->tls, this->conn_host, this->conn_port, this->conn_tls);
+  }
+  _x_tls_close (&this->tls);
+  _x_freep (&this->conn_host);
+
+  this->keep_alive = 0;
+  this->body_left  = 0;
+  this->pipe_end   = 0;
+}
+
+/*
+ * read response body, honouring Content-Length and chunked transfer encoding.
+ * Returns less than len only at end of body or on error.
+ */
+static int http_read_body (http_input_plugin_t *this, char *buf, int len) {
+  int done = 0;
+
+  if (!this->tls)
+    return -1;
+
+  if (!this->chunked) {
+    int n;
+    if ((this->body_left >= 0) && (len > this->body_left))
+      len = this->body_left;
+    if (len <= 0)
+      return 0;
+    n = _x_tls_read (this->tls, buf, len);
+    if ((n > 0) && (this->body_left > 0))
+      this->body_left -= n;
+    return n;
+  }
+
+  while ((done < len) && this->body_left) {
+    int n;
+
+    if (!this->chunk_left) {
+      char line[80];
+      long size;
+
+      if (_x_tls_read_line (this->tls, line, sizeof (line)) < 0)
+        return done ? done : -1;
+      size = strtol (line, NULL, 16);
+      if (size < 0)
+        return done ? done : -1;
+      if (size == 0) {
+        /* last chunk: skip trailer */
+        do {
+          if (_x_tls_read_line (this->tls, line, sizeof (line)) < 0)
+            return done ? done : -1;
+        } while (line[0]);
+        this->body_left = 0;
+        break;
+      }
+      this->chunk_left = size;
+    }
+
+    n = len - done;
+    if (n > this->chunk_left)
+      n = this->chunk_left;
+    n = _x_tls_read (this->tls, buf + done, n);
+    if (n <= 0)
+      return done ? done : n;
+    this->chunk_left -= n;
+    done += n;
+
+    /* chunk data is followed by CRLF */
+    if (!this->chunk_left) {
+      char crlf[4];
+      if (_x_tls_read_line (this->tls, crlf, sizeof (crlf)) < 0)
+        return done;
+    }
+  }
+
+  return done;
+}
+
 static int http_plugin_read_metainf (http_input_plugin_t *this) {
 
   char metadata_buf[255 * 16];
@@ -245,13 +365,13 @@ static int http_plugin_read_metainf (http_input_plugin_t *this) {
   xine_ui_data_t data;
 
   /* get the length of the metadata */
-  if (_x_tls_read (this->tls, (char*)&len, 1) != 1)
+  if (http_read_body (this, (char*)&len, 1) != 1)
     return 0;
 
   lprintf ("http_plugin_read_metainf: len=%d\n", len);
 
   if (len > 0) {
-    if (_x_tls_read (this->tls, metadata_buf, len * 16) != (len * 16))
+    if (http_read_body (this, metadata_buf, len * 16) != (len * 16))
       return 0;
 
     metadata_buf[len * 16] = '\0';
@@ -321,7 +441,7 @@ static off_t http_plugin_read_int (http_input_plugin_t *this,
         ((this->shoutcast_pos + nlen) >= this->shoutcast_metaint)) {
       nlen = this->shoutcast_metaint - this->shoutcast_pos;
 
-      nlen = _x_tls_read (this->tls, &buf[read_bytes], nlen);
+      nlen = http_read_body (this, &buf[read_bytes], nlen);
       if (nlen < 0)
         goto error;
 
@@ -330,7 +450,7 @@ static off_t http_plugin_read_int (http_input_plugin_t *this,
       this->shoutcast_pos = 0;
 
     } else {
-      nlen = _x_tls_read (this->tls, &buf[read_bytes], nlen);
+      nlen = http_read_body (this, &buf[read_bytes], nlen);
       if (nlen < 0)
         goto error;
 
@@ -372,649 +492,873 @@ error:
   return read_bytes;
 }
 
-static off_t http_plugin_read (input_plugin_t *this_gen,
-                               void *buf_gen, off_t nlen) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
-  char *buf = (char *)buf_gen;
-  off_t n, num_bytes;
+static void report_progress (xine_stream_t *stream, int p) {
 
-  num_bytes = 0;
+  xine_event_t             event;
+  xine_progress_data_t     prg;
 
-  if (nlen < 0)
-    return -1;
+  if (!stream)
+    return;
 
-  if (this->curpos < this->preview_size) {
+  prg.description = _("Connecting HTTP server...");
+  prg.percent = p;
 
-    if (nlen > (this->preview_size - this->curpos))
-      n = this->preview_size - this->curpos;
-    else
-      n = nlen;
+  event.type = XINE_EVENT_PROGRESS;
+  event.data = &prg;
+  event.data_length = sizeof (xine_progress_data_t);
 
-    lprintf ("%"PRId64" bytes from preview (which has %"PRId64" bytes)\n", n, this->preview_size);
-    memcpy (buf, &this->preview[this->curpos], n);
+  xine_event_send (stream, &event);
+}
 
-    num_bytes += n;
-    this->curpos += n;
+/*
+ * get a connection to the server (or proxy), from the pool if allowed
+ */
+static int http_connect (http_input_plugin_t *this, int pooled) {
+  http_input_class_t  *this_class = (http_input_class_t *) this->input_plugin.input_class;
+  const char          *host = this->url.host;
+  int                  port = this->url.port;
+  int                  use_tls = !strcasecmp (this->url.proto, "https");
+  int                  fh, res;
+
+  if (this->use_proxy && !use_tls) {
+    host = this_class->proxyhost;
+    port = this->proxyport;
   }
 
-  n = nlen - num_bytes;
-
-  if (n > 0) {
-    int read_bytes;
-    read_bytes = http_plugin_read_int (this, &buf[num_bytes], n);
-
-    if (read_bytes < 0)
-      return read_bytes;
+  _x_assert(this->tls == NULL);
 
-    num_bytes += read_bytes;
-    this->curpos += read_bytes;
+  this->conn_reused = 0;
+  if (pooled) {
+    this->tls = http_pool_get (this_class->pool, this->stream, host, port, use_tls);
+    if (this->tls) {
+      this->conn_reused = 1;
+      goto done;
+    }
   }
 
-  return num_bytes;
-}
+  fh = _x_io_tcp_connect (this->stream, host, port);
 
-static int resync_nsv(http_input_plugin_t *this) {
-  uint8_t c;
-  int pos = 0;
-  int read_bytes = 0;
+  if (fh == -1)
+    return -2;
 
-  lprintf("resyncing NSV stream\n");
-  while ((pos < 3) && (read_bytes < (1024*1024))) {
+  {
+    uint32_t         timeout, progress;
+    xine_cfg_entry_t cfgentry;
+    if (xine_config_lookup_entry (this->xine, "media.network.timeout", &cfgentry)) {
+      timeout = cfgentry.num_value * 1000;
+    } else {
+      timeout = 30000; /* 30K msecs = 30 secs */
+    }
 
-    if (http_plugin_read_int(this, (char*)&c, 1) != 1)
-      return 1;
+    progress = 0;
+    do {
+      report_progress(this->stream, progress);
+      res = _x_io_select (this->stream, fh, XIO_WRITE_READY, 500);
+      progress += (500*100000)/timeout;
+    } while ((res == XIO_TIMEOUT) && (progress <= 100000) && !_x_action_pending(this->stream));
 
-    this->preview[pos] = c;
-    switch (pos) {
-      case 0:
-        if (c == 'N')
-          pos++;
-        break;
-      case 1:
-        if (c == 'S')
-          pos++;
-        else
-          if (c != 'N')
-            pos = 0;
-        break;
-      case 2:
-        if (c == 'V')
-          pos++;
-        else
-          if (c == 'N')
-            pos = 1;
-          else
-            pos = 0;
-        break;
+    if (res != XIO_READY) {
+      _x_message(this->stream, XINE_MSG_NETWORK_UNREACHABLE, this->mrl, NULL);
+      _x_io_tcp_close(this->stream, fh);
+      return -3;
     }
-    read_bytes++;
-  }
-  if (pos == 3) {
-    lprintf("NSV stream resynced\n");
-  } else {
-    xprintf(this->xine, XINE_VERBOSITY_DEBUG,
-      "http: cannot resync NSV stream!\n");
-    return 0;
   }
 
-  return 1;
-}
-
-static off_t http_plugin_get_length (input_plugin_t *this_gen) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
-
-  return this->contentlength;
-}
-
-static uint32_t http_plugin_get_capabilities (input_plugin_t *this_gen) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
-  uint32_t caps = INPUT_CAP_PREVIEW;
-
-  /* Nullsoft asked to not allow saving streaming nsv files */
-  if (this->url.uri && strlen(this->url.uri) >= 4 &&
-      !strncmp(this->url.uri + strlen(this->url.uri) - 4, ".nsv", 4))
-    caps |= INPUT_CAP_RIP_FORBIDDEN;
+  /*
+   * TLS
+   */
 
-  if (this->accept_range) {
-    caps |= INPUT_CAP_SLOW_SEEKABLE;
+  this->tls = _x_tls_init(this->xine, this->stream, fh);
+  if (!this->tls) {
+    _x_io_tcp_close(this->stream, fh);
+    return -2;
   }
-  return caps;
-}
+  fh = -1;
 
-static off_t http_plugin_get_current_pos (input_plugin_t *this_gen){
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+  if (use_tls) {
+    int r = _x_tls_handshake(this->tls, this->url.host, -1);
+    if (r < 0) {
+      _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "TLS handshake failed", NULL);
+      xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake failed\n");
+      _x_tls_close (&this->tls);
+      return -4;
+    }
+    xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake succeed, connection is encrypted\n");
+  }
 
-  return this->curpos;
+ done:
+  this->conn_host = strdup (host);
+  this->conn_port = port;
+  this->conn_tls  = use_tls;
+  return 1;
 }
 
-static void http_close(http_input_plugin_t * this)
-{
-  _x_tls_close(&this->tls);
-  _x_url_cleanup(&this->url);
-}
+/*
+ * send GET request. end == 0: up to end of resource.
+ */
+static int http_send_request (http_input_plugin_t *this, off_t start, off_t end) {
+  http_input_class_t  *this_class = (http_input_class_t *) this->input_plugin.input_class;
+  char                 buf[BUFSIZE];
+  size_t               buflen;
 
-static int http_restart(http_input_plugin_t * this, off_t abs_offset)
-{
-  /* save old stream */
-  xine_tls_t *old_tls = this->tls;
-  off_t old_pos = this->curpos;
+  if (this->use_proxy) {
+    if (this->url.port != DEFAULT_HTTP_PORT) {
+      snprintf (buf, sizeof(buf), "GET http://%s:%d%s HTTP/1.1\015\012",
+                this->url.host, this->url.port, this->url.uri);
+    } else {
+      snprintf (buf, sizeof(buf), "GET http://%s%s HTTP/1.1\015\012",
+                this->url.host, this->url.uri);
+    }
+  }
+  else
+    snprintf (buf, sizeof(buf), "GET %s HTTP/1.1\015\012", this->url.uri);
 
-  xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": "
-          "seek to %" PRId64 ": reconnecting ...\n",
-          (int64_t)abs_offset);
+  buflen = strlen(buf);
+  if (this->url.port != DEFAULT_HTTP_PORT)
+    snprintf (buf + buflen, sizeof(buf) - buflen, "Host: %s:%d\015\012",
+              this->url.host, this->url.port);
+  else
+    snprintf (buf + buflen, sizeof(buf) - buflen, "Host: %s\015\012",
+              this->url.host);
 
-  this->tls = NULL;
-  http_close(this);
+  if (end > 0) {
+    buflen = strlen(buf);
+    snprintf (buf + buflen, sizeof(buf) - buflen, "Range: bytes=%" PRId64 "-%" PRId64 "\015\012",
+              (int64_t)start, (int64_t)end - 1);
+    lprintf ("requesting range %" PRId64 "-%" PRId64 "\n", (int64_t)start, (int64_t)end - 1);
+  } else if (start > 0) {
+    /* restart from offset */
+    buflen = strlen(buf);
+    snprintf (buf + buflen, sizeof(buf) - buflen, "Range: bytes=%" PRId64 "-\015\012",
+              (int64_t)start);
+    xprintf(this->xine, XINE_VERBOSITY_DEBUG, "input_http: requesting restart from offset %" PRId64 "\n",
+            (int64_t)start);
+  }
+
+  buflen = strlen(buf);
+  if (this->use_proxy && this_class->proxyuser && strlen(this_class->proxyuser)) {
+    char *proxyauth;
+    http_plugin_basicauth (this_class->proxyuser, this_class->proxypassword,
+			   &proxyauth);
 
-  this->curpos = abs_offset;
-  if (this->input_plugin.open(&this->input_plugin) != 1) {
-    xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
-            "seek to %" PRId64 " failed (http request failed)\n",
-            (int64_t)abs_offset);
-    _x_tls_close(&this->tls);
-    goto fail;
+    snprintf (buf + buflen, sizeof(buf) - buflen,
+              "Proxy-Authorization: Basic %s\015\012", proxyauth);
+    buflen = strlen(buf);
+    free(proxyauth);
   }
+  if (this->url.user && strlen(this->url.user)) {
+    char *auth;
+    http_plugin_basicauth (this->url.user, this->url.password, &auth);
 
-  if (this->curpos != abs_offset) {
-    /* something went wrong ... */
-    xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
-            "seek to %" PRId64 " failed (server returned invalid range)\n",
-            (int64_t)abs_offset);
-    _x_tls_close(&this->tls);
-    goto fail;
+    snprintf (buf + buflen, sizeof(buf) - buflen,
+              "Authorization: Basic %s\015\012", auth);
+    buflen = strlen(buf);
+    free(auth);
   }
 
-  /* close old connection */
-  _x_tls_close(&old_tls);
+  snprintf(buf + buflen, sizeof(buf) - buflen,
+           "User-Agent: %s%sxine/%s\015\012"
+           "Accept: */*\015\012"
+           "Icy-MetaData: 1\015\012"
+           "Connection: keep-alive\015\012"
+           "\015\012",
+           this->user_agent ? this->user_agent : "",
+           this->user_agent ? " " : "",
+           VERSION);
+  buflen = strlen(buf);
+
+  if ((size_t)_x_tls_write(this->tls, buf, buflen) != buflen) {
+    xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": couldn't send request\n");
+    return -4;
+  }
 
-  return 0;
+  lprintf ("request sent: >%s<\n", buf);
 
- fail:
-  /* restore old stream */
-  this->tls = old_tls;
-  this->curpos = old_pos;
-  return -1;
+  return 1;
 }
 
-static off_t http_plugin_seek(input_plugin_t *this_gen, off_t offset, int origin) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
-  off_t abs_offset;
+/*
+ * read and parse response header.
+ * returns 1 on success, 2 on redirection (new this->mrl), HTTP_STALE if a
+ * reused connection was closed by the server, < 0 on error.
+ */
+static int http_read_head (http_input_plugin_t *this, char *mime_type,
+                           int *mpegurl_redirect, int *httpcode_out) {
+  int                  done, len, linenum;
+  int                  httpcode = 0;
+  int                  httpver = 1, httpsub = 0;
+  int                  conn_close = 0, conn_keep = 0, chunked = 0, icy = 0;
+  intmax_t             body_len = -1;
+  intmax_t             range_start = -1, range_end = -1, range_total = -1;
+  char                 buf[BUFSIZE];
 
-  abs_offset = _x_input_seek_preview(this_gen, offset, origin,
-                                     &this->curpos, this->contentlength, this->preview_size);
+  done = 0; len = 0; linenum = 0;
+  this->keep_alive = 0;
 
-  if (abs_offset < 0 && this->accept_range) {
+  while (!done) {
+    /* fprintf (stderr, "input_http: read...\n"); */
 
-    abs_offset = _x_input_translate_seek(offset, origin, this->curpos, this->contentlength);
-    if (abs_offset < 0) {
-      xprintf(this->xine, XINE_VERBOSITY_LOG,
-              "input_http: invalid seek request (%d, %" PRId64 ")\n",
-              origin, (int64_t)offset);
-      return -1;
+    if (_x_tls_read (this->tls, &buf[len], 1) <= 0) {
+      if (this->conn_reused && !linenum && !len)
+        return HTTP_STALE;
+      return -5;
     }
 
-    if (http_restart(this, abs_offset) < 0)
-      return -1;
-  }
-
-  return abs_offset;
-}
+    if (buf[len] == '\012') {
 
-static const char* http_plugin_get_mrl (input_plugin_t *this_gen) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+      buf[len] = '\0';
+      len--;
 
-  return this->mrl;
-}
+      if (len >= 0 && buf[len] == '\015') {
+       buf[len] = '\0';
+	len--;
+      }
 
-static int http_plugin_get_optional_data (input_plugin_t *this_gen,
-					  void *const data, int data_type) {
+      linenum++;
 
-  void **const ptr = (void **const) data;
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+      lprintf ("answer: >%s<\n", buf);
 
-  switch (data_type) {
-  case INPUT_OPTIONAL_DATA_PREVIEW:
-    memcpy (data, this->preview, this->preview_size);
-    return this->preview_size;
+      if (linenum == 1) {
+	char httpstatus[51] = { 0, };
 
-  case INPUT_OPTIONAL_DATA_MIME_TYPE:
-    *ptr = this->mime_type;
-    /* fall through */
-  case INPUT_OPTIONAL_DATA_DEMUX_MIME_TYPE:
-    return *this->mime_type ? INPUT_OPTIONAL_SUCCESS : INPUT_OPTIONAL_UNSUPPORTED;
+	if (
+            (sscanf(buf, "HTTP/%d.%d %d %50[^\015\012]", &httpver, &httpsub,
+		    &httpcode, httpstatus) != 4) &&
+            (sscanf(buf, "HTTP/%d.%d %d", &httpver, &httpsub,
+		    &httpcode) != 3) &&
+            !(icy = (sscanf(buf, "ICY %d %50[^\015\012]", /* icecast 1 ? */
+		    &httpcode, httpstatus) == 2))
+	   ) {
+	    _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "invalid http answer", NULL);
+            xine_log (this->xine, XINE_LOG_MSG,
+		      _("input_http: invalid http answer\n"));
+	    return -6;
+	}
+
+	if (httpcode >= 300 && httpcode < 400) {
+          xine_log (this->xine, XINE_LOG_MSG,
+		    _("input_http: 3xx redirection: >%d %s<\n"),
+		    httpcode, httpstatus);
+	} else if (httpcode == 404) {
+	  _x_message(this->stream, XINE_MSG_FILE_NOT_FOUND, this->mrl, NULL);
+          xine_log (this->xine, XINE_LOG_MSG,
+		    _("input_http: http status not 2xx: >%d %s<\n"),
+		                        httpcode, httpstatus);
+	  return -7;
+	} else if (httpcode == 401) {
+          xine_log (this->xine, XINE_LOG_MSG,
+		    _("input_http: http status not 2xx: >%d %s<\n"),
+		    httpcode, httpstatus);
+          /* don't return - there may be a WWW-Authenticate header... */
+	} else if (httpcode == 403) {
+          _x_message(this->stream, XINE_MSG_PERMISSION_ERROR, this->mrl, NULL);
+          xine_log (this->xine, XINE_LOG_MSG,
+		    _("input_http: http status not 2xx: >%d %s<\n"),
+		    httpcode, httpstatus);
+	  return -8;
+	} else if (httpcode < 200 || httpcode >= 300) {
+	  _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "http status not 2xx: ",
+	               httpstatus, NULL);
+          xine_log (this->xine, XINE_LOG_MSG,
+		    _("input_http: http status not 2xx: >%d %s<\n"),
+		    httpcode, httpstatus);
+	  return -9;
+	}
+      } else {
+	if (body_len < 0) {
+	  intmax_t contentlength;
+
+          if (sscanf(buf, "Content-Length: %" SCNdMAX , &contentlength) == 1) {
+	    xine_log (this->xine, XINE_LOG_MSG,
+              _("input_http: content length = %" PRIdMAX " bytes\n"),
+              contentlength);
+	    body_len = contentlength;
+	  }
+        }
+
+        if (!strncasecmp(buf, "Content-Range", 13)) {
+          if (sscanf(buf, "Content-Range: bytes %" SCNdMAX "-%" SCNdMAX "/%" SCNdMAX,
+                     &range_start, &range_end, &range_total) == 3) {
+            xprintf(this->xine, XINE_VERBOSITY_DEBUG,
+                    "input_http: Stream starting at offset %" PRIdMAX "\n", range_start);
+          } else if (sscanf(buf, "Content-Range: bytes %" SCNdMAX "-%" SCNdMAX "/*",
+                            &range_start, &range_end) == 2) {
+            range_total = -1;
+          } else {
+            xprintf(this->xine, XINE_VERBOSITY_LOG,
+                    "input_http: Error parsing \'%s\'\n", buf);
+          }
+        }
+
+        if (!strncasecmp(buf, "Accept-Ranges", 13)) {
+          if (strstr(buf + 14, "bytes")) {
+            xprintf(this->xine, XINE_VERBOSITY_DEBUG,
+                    "input_http: Server supports request ranges. Enabling seeking support.\n");
+            this->accept_range = 1;
+          } else {
+            xprintf(this->xine, XINE_VERBOSITY_LOG,
+                    "input_http: Unknown value in header \'%s\'\n", buf + 14);
+            this->accept_range = 0;
+          }
+        }
+
+        if (!strncasecmp(buf, "Transfer-Encoding:", 18) && strstr(buf + 18, "chunked"))
+          chunked = 1;
+
+        if (!strncasecmp(buf, "Connection:", 11)) {
+          if (strstr(buf + 11, "close") || strstr(buf + 11, "Close"))
+            conn_close = 1;
+          else if (strstr(buf + 11, "eep-alive") || strstr(buf + 11, "eep-Alive"))
+            conn_keep = 1;
+        }
+
+        if (!strncasecmp(buf, "Location: ", 10)) {
+          char *href = (buf + 10);
+
+	  lprintf ("trying to open target of redirection: >%s<\n", href);
+
+          href = _x_canonicalise_url (this->mrl, href);
+          free(this->mrl);
+          this->mrl = href;
+          return 2;
+        }
+
+        if (!strncasecmp (buf, "WWW-Authenticate: ", 18))
+          strcpy (this->preview, buf + 18);
+
+	if (mpegurl_redirect) {
+	  static const char mpegurl_ct_str[] = "Content-Type: audio/x-mpegurl";
+	  static const size_t mpegurl_ct_size = sizeof(mpegurl_ct_str)-1;
+          if (!strncasecmp(buf, mpegurl_ct_str, mpegurl_ct_size)) {
+	    lprintf("Opening an audio/x-mpegurl file, late redirect.");
+
+	    *mpegurl_redirect = 1;
+	  }
+	}
+
+        /* Icecast / ShoutCast Stuff */
+        if (this->stream) {
+        if (!strncasecmp(buf, TAG_ICY_NAME, sizeof(TAG_ICY_NAME) - 1)) {
+          _x_meta_info_set(this->stream, XINE_META_INFO_ALBUM,
+                           (buf + sizeof(TAG_ICY_NAME) - 1 +
+                            (*(buf + sizeof(TAG_ICY_NAME) - 1) == ' ')));
+          _x_meta_info_set(this->stream, XINE_META_INFO_TITLE,
+                           (buf + sizeof(TAG_ICY_NAME) - 1 +
+                            (*(buf + sizeof(TAG_ICY_NAME) - 1) == ' ')));
+        }
+
+        if (!strncasecmp(buf, TAG_ICY_GENRE, sizeof(TAG_ICY_GENRE) - 1)) {
+          _x_meta_info_set(this->stream, XINE_META_INFO_GENRE,
+                          (buf + sizeof(TAG_ICY_GENRE) - 1 +
+                           (*(buf + sizeof(TAG_ICY_GENRE) - 1) == ' ')));
+        }
+
+        /* icy-notice1 is always the same */
+        if (!strncasecmp(buf, TAG_ICY_NOTICE2, sizeof(TAG_ICY_NOTICE2) - 1)) {
+          char *end;
+          if((end = strstr(buf, "<BR>")))
+            *end = '\0';
+
+          _x_meta_info_set(this->stream, XINE_META_INFO_COMMENT,
+                           (buf + sizeof(TAG_ICY_NOTICE2) - 1 +
+                            (*(buf + sizeof(TAG_ICY_NOTICE2) - 1) == ' ')));
+        }
+        }
+
+        /* metadata interval (in byte) */
+        if (sscanf(buf, TAG_ICY_METAINT"%d", &this->shoutcast_metaint) == 1) {
+          lprintf("shoutcast_metaint: %d\n", this->shoutcast_metaint);
+          this->shoutcast_mode = 1;
+          this->shoutcast_pos = 0;
+        }
+
+        /* content type */
+        if (mime_type && !strncasecmp(buf, TAG_CONTENT_TYPE, sizeof(TAG_CONTENT_TYPE) - 1)) {
+          const char *type = buf + sizeof (TAG_CONTENT_TYPE) - 1;
+          while (isspace (*type))
+            ++type;
+          sprintf (mime_type, "%.255s", type);
+          if (!strncasecmp (type, "video/nsv", 9)) {
+            lprintf("shoutcast nsv detected\n");
+            this->is_nsv = 1;
+          }
+        }
+        if ( !strncasecmp(buf, TAG_LASTFM_SERVER, sizeof(TAG_LASTFM_SERVER)-1) ) {
+	  lprintf("last.fm streaming server detected\n");
+	  this->is_lastfm = 1;
+	}
+      }
+
+      if (len == -1)
+	done = 1;
+      len = 0;
+    } else
+      len ++;
+    if ( len >= (int)sizeof(buf) ) {
+       _x_message(this->stream, XINE_MSG_PERMISSION_ERROR, this->mrl, NULL);
+       xine_log (this->xine, XINE_LOG_MSG,
+         _("input_http: buffer exhausted after %zu bytes."), sizeof(buf));
+       return -10;
+    }
   }
 
-  return INPUT_OPTIONAL_UNSUPPORTED;
+  lprintf ("end of headers\n");
+
+  if (httpcode_out)
+    *httpcode_out = httpcode;
+
+  /* body framing */
+  this->chunked    = chunked;
+  this->chunk_left = 0;
+  if (chunked)
+    this->body_left = -1;
+  else if (body_len >= 0)
+    this->body_left = body_len;
+  else
+    this->body_left = -1;
+
+  /* HTTP/1.1 connections stay open unless told otherwise */
+  this->keep_alive = !icy && !conn_close && (this->body_left >= 0 || chunked) &&
+                     ((httpver > 1) || (httpver == 1 && httpsub >= 1) || conn_keep);
+
+  /* stream position */
+  if (httpcode == 206 && range_start >= 0) {
+    this->curpos       = range_start;
+    this->range_end    = range_end + 1;
+    if (range_total >= 0)
+      this->contentlength = range_total;
+    this->accept_range = 1;
+  } else {
+    this->curpos    = 0;
+    this->range_end = 0;
+    this->contentlength = body_len > 0 ? body_len : 0;
+  }
+
+  return 1;
 }
 
-static void http_plugin_dispose (input_plugin_t *this_gen ) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+/*
+ * connect if needed, send request and read the response header.
+ * A kept-alive connection may have been closed by the server meanwhile,
+ * retry once on a fresh one then.
+ */
+static int http_request (http_input_plugin_t *this, off_t start, off_t end,
+                         char *mime_type, int *mpegurl_redirect, int *httpcode) {
+  int res, pooled = 1;
+
+  /* connection not idle (or not reusable) */
+  if (this->tls && (!this->keep_alive || this->body_left || this->pipe_end))
+    http_release (this);
+
+  while (1) {
+    if (!this->tls) {
+      res = http_connect (this, pooled);
+      if (res < 0)
+        return res;
+    } else {
+      this->conn_reused = 1;
+    }
 
-  http_close(this);
+    res = http_send_request (this, start, end);
+    if (res > 0)
+      res = http_read_head (this, mime_type, mpegurl_redirect, httpcode);
 
-  if (this->nbc) {
-    nbc_close (this->nbc);
-    this->nbc = NULL;
+    if (res > 0)
+      return res;
+
+    _x_tls_close (&this->tls);
+    _x_freep (&this->conn_host);
+    if (!this->conn_reused || (res != HTTP_STALE && res != -4))
+      break;
+    lprintf ("kept-alive connection closed by server, reconnecting\n");
+    pooled = 0;
   }
 
-  _x_freep (&this->mrl);
-  _x_freep (&this->mime_type);
-  free (this);
+  if (res == -4)
+    _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "couldn't send request", NULL);
+  if (res == HTTP_STALE)
+    res = -5;
+  return res;
 }
 
-static void report_progress (xine_stream_t *stream, int p) {
+/*
+ * request next part of the resource at curpos.
+ * returns 1 on success, 0 at end of stream, < 0 on error.
+ */
+static int http_next_range (http_input_plugin_t *this, off_t want) {
+  off_t start = this->curpos, end;
+  int   res;
 
-  xine_event_t             event;
-  xine_progress_data_t     prg;
+  if (this->contentlength > 0 && start >= this->contentlength) {
+    this->range_pending = 0;
+    return 0;
+  }
 
-  if (!stream)
-    return;
+  if (this->pipe_end && !this->range_pending) {
+    /* request has been sent already */
+    end = this->pipe_end;
+    this->pipe_end = 0;
+    res = http_read_head (this, NULL, NULL, NULL);
+    if (res == 1 && this->curpos == start && this->range_end == end)
+      return 1;
+    xprintf (this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": pipelined request failed\n");
+    this->curpos = start;
+    http_release (this);
+  }
 
-  prg.description = _("Connecting HTTP server...");
-  prg.percent = p;
+  if (this->range_pending) {
+    /* after seek: what the demuxer asks for */
+    this->range_size = want < HTTP_RANGE_MIN ? HTTP_RANGE_MIN : want;
+    this->range_pending = 0;
+  } else {
+    /* sequential reading: grow */
+    this->range_size *= 2;
+  }
+  if (this->range_size > HTTP_RANGE_MAX)
+    this->range_size = HTTP_RANGE_MAX;
 
-  event.type = XINE_EVENT_PROGRESS;
-  event.data = &prg;
-  event.data_length = sizeof (xine_progress_data_t);
+  end = start + this->range_size;
+  if (this->contentlength > 0 && end > this->contentlength)
+    end = this->contentlength;
 
-  xine_event_send (stream, &event);
+  res = http_request (this, start, end, NULL, NULL, NULL);
+  if (res == 1 && this->curpos == start)
+    return 1;
+
+  xprintf (this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
+           "range request at %" PRId64 " failed\n", (int64_t)start);
+  this->curpos = start;
+  http_release (this);
+  return -1;
 }
 
-static int http_plugin_open (input_plugin_t *this_gen ) {
-  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
-  http_input_class_t  *this_class = (http_input_class_t *) this->input_plugin.input_class;
-  int                  done, len, linenum;
-  int                  httpcode;
-  int                  res;
-  size_t               buflen;
-  int                  use_proxy;
-  int                  proxyport;
-  int                  mpegurl_redirect = 0;
-  char                 mime_type[256];
-  char                 buf[BUFSIZE];
-  int                  fh, use_tls;
+/*
+ * send request for the following range when the current one is running out
+ */
+static void http_pipeline (http_input_plugin_t *this) {
+  off_t start, end, size;
 
-  mime_type[0] = 0;
-  use_proxy = this_class->proxyhost && strlen(this_class->proxyhost);
+  if (this->pipe_end || !this->keep_alive || this->chunked || !this->range_end ||
+      (this->body_left <= 0) || (this->body_left > this->range_size / 2) ||
+      (this->range_size <= HTTP_RANGE_MIN))
+    return;
+  start = this->range_end;
+  if (this->contentlength <= 0 || start >= this->contentlength)
+    return;
 
-  this->user_agent = _x_url_user_agent (this->mrl);
-  if (!_x_url_parse2(this->mrl, &this->url)) {
-    _x_message(this->stream, XINE_MSG_GENERAL_WARNING, "malformed url", NULL);
-    return 0;
+  size = this->range_size * 2;
+  if (size > HTTP_RANGE_MAX)
+    size = HTTP_RANGE_MAX;
+  end = start + size;
+  if (end > this->contentlength)
+    end = this->contentlength;
+
+  if (http_send_request (this, start, end) == 1) {
+    this->pipe_end   = end;
+    this->range_size = size;
+  } else {
+    /* request may be partially sent */
+    this->keep_alive = 0;
   }
-  use_proxy = use_proxy && _x_use_proxy(this->xine, this_class, this->url.host);
+}
 
-  use_tls = !strcasecmp (this->url.proto, "https");
+/*
+ * read away a small response rest to keep the connection
+ */
+static int http_drain (http_input_plugin_t *this) {
+  char buf[4096];
 
-  if (this->url.port == 0) {
-    if (use_tls)
-      this->url.port = DEFAULT_HTTPS_PORT;
-    else
-      this->url.port = DEFAULT_HTTP_PORT;
+  if (!this->tls || !this->keep_alive || this->pipe_end || this->chunked ||
+      (this->body_left < 0) || (this->body_left > HTTP_DRAIN_MAX))
+    return 0;
+
+  while (this->body_left > 0) {
+    int n = http_read_body (this, buf, this->body_left < (off_t)sizeof (buf) ? this->body_left : (off_t)sizeof (buf));
+    if (n <= 0)
+      return 0;
   }
+  return 1;
+}
 
-  if (this_class->proxyport == 0)
-    proxyport = DEFAULT_HTTP_PORT;
-  else
-    proxyport = this_class->proxyport;
+static off_t http_plugin_read (input_plugin_t *this_gen,
+                               void *buf_gen, off_t nlen) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+  char *buf = (char *)buf_gen;
+  off_t n, num_bytes;
 
-#ifdef LOG
-  {
-    printf ("input_http: host     : >%s<\n", this->url.host);
-    printf ("input_http: port     : >%d<\n", this->url.port);
-    printf ("input_http: user     : >%s<\n", this->url.user);
-    printf ("input_http: password : >%s<\n", this->url.password);
-    printf ("input_http: path     : >%s<\n", this->url.uri);
+  num_bytes = 0;
 
+  if (nlen < 0)
+    return -1;
 
-    if (use_proxy)
-      printf (" via proxy >%s:%d<", this_class->proxyhost, proxyport);
+  if (this->curpos < this->preview_size) {
 
-    printf ("\n");
-  }
+    if (nlen > (this->preview_size - this->curpos))
+      n = this->preview_size - this->curpos;
+    else
+      n = nlen;
 
-#endif
+    lprintf ("%"PRId64" bytes from preview (which has %"PRId64" bytes)\n", n, this->preview_size);
+    memcpy (buf, &this->preview[this->curpos], n);
 
-  if (use_proxy && !use_tls)
-    fh = _x_io_tcp_connect (this->stream, this_class->proxyhost, proxyport);
-  else
-    fh = _x_io_tcp_connect (this->stream, this->url.host, this->url.port);
+    num_bytes += n;
+    this->curpos += n;
+  }
 
-  if (fh == -1)
-    return -2;
+  while ((n = nlen - num_bytes) > 0) {
+    int read_bytes;
 
-  {
-    uint32_t         timeout, progress;
-    xine_cfg_entry_t cfgentry;
-    if (xine_config_lookup_entry (this->xine, "media.network.timeout", &cfgentry)) {
-      timeout = cfgentry.num_value * 1000;
-    } else {
-      timeout = 30000; /* 30K msecs = 30 secs */
+    /* end of current range: continue with the next one */
+    if (this->range_pending || (!this->body_left && this->range_end)) {
+      int r = http_next_range (this, n);
+      if (r < 0)
+        return num_bytes ? num_bytes : -1;
+      if (r == 0)
+        break;
     }
 
-    progress = 0;
-    do {
-      report_progress(this->stream, progress);
-      res = _x_io_select (this->stream, fh, XIO_WRITE_READY, 500);
-      progress += (500*100000)/timeout;
-    } while ((res == XIO_TIMEOUT) && (progress <= 100000) && !_x_action_pending(this->stream));
+    read_bytes = http_plugin_read_int (this, &buf[num_bytes], n);
 
-    if (res != XIO_READY) {
-      _x_message(this->stream, XINE_MSG_NETWORK_UNREACHABLE, this->mrl, NULL);
-      _x_io_tcp_close(this->stream, fh);
-      return -3;
-    }
+    if (read_bytes < 0)
+      return read_bytes;
+    if (read_bytes == 0)
+      break;
+
+    num_bytes += read_bytes;
+    this->curpos += read_bytes;
+
+    http_pipeline (this);
   }
 
-  /*
-   * TLS
-   */
+  return num_bytes;
+}
 
-  _x_assert(this->tls == NULL);
+static int resync_nsv(http_input_plugin_t *this) {
+  uint8_t c;
+  int pos = 0;
+  int read_bytes = 0;
 
-  this->tls = _x_tls_init(this->xine, this->stream, fh);
-  if (!this->tls) {
-    _x_io_tcp_close(this->stream, fh);
-    return -2;
-  }
-  fh = -1;
+  lprintf("resyncing NSV stream\n");
+  while ((pos < 3) && (read_bytes < (1024*1024))) {
 
-  if (use_tls) {
-    int r = _x_tls_handshake(this->tls, this->url.host, -1);
-    if (r < 0) {
-      _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "TLS handshake failed", NULL);
-      xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake failed\n");
-      return -4;
+    if (http_plugin_read_int(this, (char*)&c, 1) != 1)
+      return 1;
+
+    this->preview[pos] = c;
+    switch (pos) {
+      case 0:
+        if (c == 'N')
+          pos++;
+        break;
+      case 1:
+        if (c == 'S')
+          pos++;
+        else
+          if (c != 'N')
+            pos = 0;
+        break;
+      case 2:
+        if (c == 'V')
+          pos++;
+        else
+          if (c == 'N')
+            pos = 1;
+          else
+            pos = 0;
+        break;
     }
-    xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake succeed, connection is encrypted\n");
+    read_bytes++;
+  }
+  if (pos == 3) {
+    lprintf("NSV stream resynced\n");
+  } else {
+    xprintf(this->xine, XINE_VERBOSITY_DEBUG,
+      "http: cannot resync NSV stream!\n");
+    return 0;
   }
 
-  /*
-   * Request
-   */
+  return 1;
+}
 
-  if (use_proxy) {
-    if (this->url.port != DEFAULT_HTTP_PORT) {
-      snprintf (buf, sizeof(buf), "GET http://%s:%d%s HTTP/1.0\015\012",
-                this->url.host, this->url.port, this->url.uri);
-    } else {
-      snprintf (buf, sizeof(buf), "GET http://%s%s HTTP/1.0\015\012",
-                this->url.host, this->url.uri);
-    }
-  }
-  else
-    snprintf (buf, sizeof(buf), "GET %s HTTP/1.0\015\012", this->url.uri);
+static off_t http_plugin_get_length (input_plugin_t *this_gen) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
 
-  buflen = strlen(buf);
-  if (this->url.port != DEFAULT_HTTP_PORT)
-    snprintf (buf + buflen, sizeof(buf) - buflen, "Host: %s:%d\015\012",
-              this->url.host, this->url.port);
-  else
-    snprintf (buf + buflen, sizeof(buf) - buflen, "Host: %s\015\012",
-              this->url.host);
+  return this->contentlength;
+}
 
-  if (this->curpos > 0) {
-      /* restart from offset */
-      buflen = strlen(buf);
-      snprintf (buf + buflen, sizeof(buf) - buflen, "Range: bytes=%" PRId64 "-\015\012",
-                (int64_t)this->curpos/*, (int64_t)this->contentlength - 1*/);
-      xprintf(this->xine, XINE_VERBOSITY_DEBUG, "input_http: requesting restart from offset %" PRId64 "\n",
-              (int64_t)this->curpos);
-  }
+static uint32_t http_plugin_get_capabilities (input_plugin_t *this_gen) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+  uint32_t caps = INPUT_CAP_PREVIEW;
 
-  buflen = strlen(buf);
-  if (use_proxy && this_class->proxyuser && strlen(this_class->proxyuser)) {
-    char *proxyauth;
-    http_plugin_basicauth (this_class->proxyuser, this_class->proxypassword,
-			   &proxyauth);
+  /* Nullsoft asked to not allow saving streaming nsv files */
+  if (this->url.uri && strlen(this->url.uri) >= 4 &&
+      !strncmp(this->url.uri + strlen(this->url.uri) - 4, ".nsv", 4))
+    caps |= INPUT_CAP_RIP_FORBIDDEN;
 
-    snprintf (buf + buflen, sizeof(buf) - buflen,
-              "Proxy-Authorization: Basic %s\015\012", proxyauth);
-    buflen = strlen(buf);
-    free(proxyauth);
+  if (this->accept_range) {
+    caps |= INPUT_CAP_SLOW_SEEKABLE;
   }
-  if (this->url.user && strlen(this->url.user)) {
-    char *auth;
-    http_plugin_basicauth (this->url.user, this->url.password, &auth);
+  return caps;
+}
+
+static off_t http_plugin_get_current_pos (input_plugin_t *this_gen){
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+
+  return this->curpos;
+}
+
+static void http_close(http_input_plugin_t * this)
+{
+  http_release (this);
+  _x_url_cleanup(&this->url);
+}
+
+static off_t http_plugin_seek(input_plugin_t *this_gen, off_t offset, int origin) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+  off_t abs_offset;
 
-    snprintf (buf + buflen, sizeof(buf) - buflen,
-              "Authorization: Basic %s\015\012", auth);
-    buflen = strlen(buf);
-    free(auth);
-  }
+  if (!this->accept_range)
+    return _x_input_seek_preview(this_gen, offset, origin,
+                                 &this->curpos, this->contentlength, this->preview_size);
 
-  snprintf(buf + buflen, sizeof(buf) - buflen,
-           "User-Agent: %s%sxine/%s\015\012"
-           "Accept: */*\015\012"
-           "Icy-MetaData: 1\015\012"
-           "\015\012",
-           this->user_agent ? this->user_agent : "",
-           this->user_agent ? " " : "",
-           VERSION);
-  buflen = strlen(buf);
+  abs_offset = _x_input_translate_seek(offset, origin, this->curpos, this->contentlength);
+  if (abs_offset < 0) {
+    xprintf(this->xine, XINE_VERBOSITY_LOG,
+            "input_http: invalid seek request (%d, %" PRId64 ")\n",
+            origin, (int64_t)offset);
+    return -1;
+  }
 
-  if ((size_t)_x_tls_write(this->tls, buf, buflen) != buflen) {
-    _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "couldn't send request", NULL);
-    xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": couldn't send request\n");
-    return -4;
+  /* seek inside preview */
+  if (abs_offset <= this->preview_size && this->curpos <= this->preview_size) {
+    this->curpos = abs_offset;
+    return abs_offset;
   }
 
-  lprintf ("request sent: >%s<\n", buf);
+  if (abs_offset == this->curpos)
+    return abs_offset;
 
-  /*
-   * Response
-   */
+  /* short skip forward: cheaper to read than to issue a new request */
+  if (!this->range_pending && this->tls && this->curpos >= this->preview_size &&
+      abs_offset > this->curpos && abs_offset - this->curpos <= HTTP_DRAIN_MAX) {
+    if (_x_input_read_skip(this_gen, abs_offset - this->curpos) >= 0 && this->curpos == abs_offset)
+      return abs_offset;
+  }
 
-  /* read and parse reply */
-  done = 0; len = 0; linenum = 0;
-  this->contentlength = 0;
-  this->curpos = 0;
+  xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": "
+          "seek to %" PRId64 "\n", (int64_t)abs_offset);
 
-  while (!done) {
-    /* fprintf (stderr, "input_http: read...\n"); */
+  /* next read requests a range sized to what is asked for */
+  if (this->tls && !http_drain (this))
+    http_release (this);
+  this->curpos        = abs_offset;
+  this->range_pending = 1;
 
-    if (_x_tls_read (this->tls, &buf[len], 1) <= 0) {
-      return -5;
-    }
+  return abs_offset;
+}
 
-    if (buf[len] == '\012') {
+static const char* http_plugin_get_mrl (input_plugin_t *this_gen) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
 
-      buf[len] = '\0';
-      len--;
+  return this->mrl;
+}
 
-      if (len >= 0 && buf[len] == '\015') {
-       buf[len] = '\0';
-	len--;
-      }
+static int http_plugin_get_optional_data (input_plugin_t *this_gen,
+					  void *const data, int data_type) {
 
-      linenum++;
+  void **const ptr = (void **const) data;
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
 
-      lprintf ("answer: >%s<\n", buf);
+  switch (data_type) {
+  case INPUT_OPTIONAL_DATA_PREVIEW:
+    memcpy (data, this->preview, this->preview_size);
+    return this->preview_size;
 
-      if (linenum == 1) {
-        int httpver, httpsub;
-	char httpstatus[51] = { 0, };
+  case INPUT_OPTIONAL_DATA_MIME_TYPE:
+    *ptr = this->mime_type;
+    /* fall through */
+  case INPUT_OPTIONAL_DATA_DEMUX_MIME_TYPE:
+    return *this->mime_type ? INPUT_OPTIONAL_SUCCESS : INPUT_OPTIONAL_UNSUPPORTED;
+  }
 
-	if (
-            (sscanf(buf, "HTTP/%d.%d %d %50[^\015\012]", &httpver, &httpsub,
-		    &httpcode, httpstatus) != 4) &&
-            (sscanf(buf, "HTTP/%d.%d %d", &httpver, &httpsub,
-		    &httpcode) != 3) &&
-            (sscanf(buf, "ICY %d %50[^\015\012]", /* icecast 1 ? */
-		    &httpcode, httpstatus) != 2)
-	   ) {
-	    _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "invalid http answer", NULL);
-            xine_log (this->xine, XINE_LOG_MSG,
-		      _("input_http: invalid http answer\n"));
-	    return -6;
-	}
+  return INPUT_OPTIONAL_UNSUPPORTED;
+}
 
-	if (httpcode >= 300 && httpcode < 400) {
-          xine_log (this->xine, XINE_LOG_MSG,
-		    _("input_http: 3xx redirection: >%d %s<\n"),
-		    httpcode, httpstatus);
-	} else if (httpcode == 404) {
-	  _x_message(this->stream, XINE_MSG_FILE_NOT_FOUND, this->mrl, NULL);
-          xine_log (this->xine, XINE_LOG_MSG,
-		    _("input_http: http status not 2xx: >%d %s<\n"),
-		                        httpcode, httpstatus);
-	  return -7;
-	} else if (httpcode == 401) {
-          xine_log (this->xine, XINE_LOG_MSG,
-		    _("input_http: http status not 2xx: >%d %s<\n"),
-		    httpcode, httpstatus);
-          /* don't return - there may be a WWW-Authenticate header... */
-	} else if (httpcode == 403) {
-          _x_message(this->stream, XINE_MSG_PERMISSION_ERROR, this->mrl, NULL);
-          xine_log (this->xine, XINE_LOG_MSG,
-		    _("input_http: http status not 2xx: >%d %s<\n"),
-		    httpcode, httpstatus);
-	  return -8;
-	} else if (httpcode < 200 || httpcode >= 300) {
-	  _x_message(this->stream, XINE_MSG_CONNECTION_REFUSED, "http status not 2xx: ",
-	               httpstatus, NULL);
-          xine_log (this->xine, XINE_LOG_MSG,
-		    _("input_http: http status not 2xx: >%d %s<\n"),
-		    httpcode, httpstatus);
-	  return -9;
-	}
-      } else {
-	if (this->contentlength == 0) {
-	  intmax_t contentlength;
+static void http_plugin_dispose (input_plugin_t *this_gen ) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
 
-          if (sscanf(buf, "Content-Length: %" SCNdMAX , &contentlength) == 1) {
-	    xine_log (this->xine, XINE_LOG_MSG,
-              _("input_http: content length = %" PRIdMAX " bytes\n"),
-              contentlength);
-	    this->contentlength = (off_t)contentlength;
-	  }
-        }
+  http_close(this);
 
-        if (!strncasecmp(buf, "Content-Range", 13)) {
-          intmax_t contentlength, range_start, range_end;
-          if (sscanf(buf, "Content-Range: bytes %" SCNdMAX "-%" SCNdMAX "/%" SCNdMAX,
-                     &range_start, &range_end, &contentlength) == 3) {
-            this->curpos = range_start;
-            this->contentlength = contentlength;
-            if (contentlength != range_end + 1) {
-              xprintf(this->xine, XINE_VERBOSITY_LOG,
-                      "input_http: Reveived invalid content range: \'%s\'\n", buf);
-              /* truncate - there won't be more data anyway */
-              this->contentlength = range_end + 1;
-            } else {
-              xprintf(this->xine, XINE_VERBOSITY_DEBUG,
-                      "input_http: Stream starting at offset %" PRIdMAX "\n", range_start);
-            }
-          } else {
-            xprintf(this->xine, XINE_VERBOSITY_LOG,
-                    "input_http: Error parsing \'%s\'\n", buf);
-          }
-        }
+  if (this->nbc) {
+    nbc_close (this->nbc);
+    this->nbc = NULL;
+  }
 
-        if (!strncasecmp(buf, "Accept-Ranges", 13)) {
-          if (strstr(buf + 14, "bytes")) {
-            xprintf(this->xine, XINE_VERBOSITY_DEBUG,
-                    "input_http: Server supports request ranges. Enabling seeking support.\n");
-            this->accept_range = 1;
-          } else {
-            xprintf(this->xine, XINE_VERBOSITY_LOG,
-                    "input_http: Unknown value in header \'%s\'\n", buf + 14);
-            this->accept_range = 0;
-          }
-        }
+  _x_freep (&this->mrl);
+  _x_freep (&this->mime_type);
+  free (this);
+}
 
-        if (!strncasecmp(buf, "Location: ", 10)) {
-          char *href = (buf + 10);
+static int http_plugin_open (input_plugin_t *this_gen ) {
+  http_input_plugin_t *this = (http_input_plugin_t *) this_gen;
+  http_input_class_t  *this_class = (http_input_class_t *) this->input_plugin.input_class;
+  int                  httpcode = 0;
+  int                  res;
+  int                  mpegurl_redirect = 0;
+  char                 mime_type[256];
+  int                  use_tls;
 
-	  lprintf ("trying to open target of redirection: >%s<\n", href);
+  mime_type[0] = 0;
+  this->use_proxy = this_class->proxyhost && strlen(this_class->proxyhost);
 
-          href = _x_canonicalise_url (this->mrl, href);
-          free(this->mrl);
-          this->mrl = href;
-          http_close(this);
-          return http_plugin_open(this_gen);
-        }
+  this->user_agent = _x_url_user_agent (this->mrl);
+  if (!_x_url_parse2(this->mrl, &this->url)) {
+    _x_message(this->stream, XINE_MSG_GENERAL_WARNING, "malformed url", NULL);
+    return 0;
+  }
+  this->use_proxy = this->use_proxy && _x_use_proxy(this->xine, this_class, this->url.host);
 
-        if (!strncasecmp (buf, "WWW-Authenticate: ", 18))
-          strcpy (this->preview, buf + 18);
+  use_tls = !strcasecmp (this->url.proto, "https");
 
-	{
-	  static const char mpegurl_ct_str[] = "Content-Type: audio/x-mpegurl";
-	  static const size_t mpegurl_ct_size = sizeof(mpegurl_ct_str)-1;
-          if (!strncasecmp(buf, mpegurl_ct_str, mpegurl_ct_size)) {
-	    lprintf("Opening an audio/x-mpegurl file, late redirect.");
+  if (this->url.port == 0) {
+    if (use_tls)
+      this->url.port = DEFAULT_HTTPS_PORT;
+    else
+      this->url.port = DEFAULT_HTTP_PORT;
+  }
 
-	    mpegurl_redirect = 1;
-	  }
-	}
+  if (this_class->proxyport == 0)
+    this->proxyport = DEFAULT_HTTP_PORT;
+  else
+    this->proxyport = this_class->proxyport;
 
-        /* Icecast / ShoutCast Stuff */
-        if (this->stream) {
-        if (!strncasecmp(buf, TAG_ICY_NAME, sizeof(TAG_ICY_NAME) - 1)) {
-          _x_meta_info_set(this->stream, XINE_META_INFO_ALBUM,
-                           (buf + sizeof(TAG_ICY_NAME) - 1 +
-                            (*(buf + sizeof(TAG_ICY_NAME) - 1) == ' ')));
-          _x_meta_info_set(this->stream, XINE_META_INFO_TITLE,
-                           (buf + sizeof(TAG_ICY_NAME) - 1 +
-                            (*(buf + sizeof(TAG_ICY_NAME) - 1) == ' ')));
-        }
+#ifdef LOG
+  {
+    printf ("input_http: host     : >%s<\n", this->url.host);
+    printf ("input_http: port     : >%d<\n", this->url.port);
+    printf ("input_http: user     : >%s<\n", this->url.user);
+    printf ("input_http: password : >%s<\n", this->url.password);
+    printf ("input_http: path     : >%s<\n", this->url.uri);
 
-        if (!strncasecmp(buf, TAG_ICY_GENRE, sizeof(TAG_ICY_GENRE) - 1)) {
-          _x_meta_info_set(this->stream, XINE_META_INFO_GENRE,
-                          (buf + sizeof(TAG_ICY_GENRE) - 1 +
-                           (*(buf + sizeof(TAG_ICY_GENRE) - 1) == ' ')));
-        }
 
-        /* icy-notice1 is always the same */
-        if (!strncasecmp(buf, TAG_ICY_NOTICE2, sizeof(TAG_ICY_NOTICE2) - 1)) {
-          char *end;
-          if((end = strstr(buf, "<BR>")))
-            *end = '\0';
+    if (this->use_proxy)
+      printf (" via proxy >%s:%d<", this_class->proxyhost, this->proxyport);
 
-          _x_meta_info_set(this->stream, XINE_META_INFO_COMMENT,
-                           (buf + sizeof(TAG_ICY_NOTICE2) - 1 +
-                            (*(buf + sizeof(TAG_ICY_NOTICE2) - 1) == ' ')));
-        }
-        }
+    printf ("\n");
+  }
 
-        /* metadata interval (in byte) */
-        if (sscanf(buf, TAG_ICY_METAINT"%d", &this->shoutcast_metaint) == 1) {
-          lprintf("shoutcast_metaint: %d\n", this->shoutcast_metaint);
-          this->shoutcast_mode = 1;
-          this->shoutcast_pos = 0;
-        }
+#endif
 
-        /* content type */
-        if (!strncasecmp(buf, TAG_CONTENT_TYPE, sizeof(TAG_CONTENT_TYPE) - 1)) {
-          const char *type = buf + sizeof (TAG_CONTENT_TYPE) - 1;
-          while (isspace (*type))
-            ++type;
-          sprintf (mime_type, "%.255s", type);
-          if (!strncasecmp (type, "video/nsv", 9)) {
-            lprintf("shoutcast nsv detected\n");
-            this->is_nsv = 1;
-          }
-        }
-        if ( !strncasecmp(buf, TAG_LASTFM_SERVER, sizeof(TAG_LASTFM_SERVER)-1) ) {
-	  lprintf("last.fm streaming server detected\n");
-	  this->is_lastfm = 1;
-	}
-      }
+  this->range_pending = 0;
+  this->range_size    = 0;
 
-      if (len == -1)
-	done = 1;
-      len = 0;
-    } else
-      len ++;
-    if ( len >= (int)sizeof(buf) ) {
-       _x_message(this->stream, XINE_MSG_PERMISSION_ERROR, this->mrl, NULL);
-       xine_log (this->xine, XINE_LOG_MSG,
-         _("input_http: buffer exhausted after %zu bytes."), sizeof(buf));
-       return -10;
-    }
+  res = http_request (this, 0, 0, mime_type, &mpegurl_redirect, &httpcode);
+  if (res == 2) {
+    http_close(this);
+    return http_plugin_open(this_gen);
   }
-
-  lprintf ("end of headers\n");
+  if (res < 0)
+    return res;
 
   if (httpcode == 401)
     _x_message(this->stream, XINE_MSG_AUTHENTICATION_NEEDED,
@@ -1045,12 +1389,6 @@ static int http_plugin_open (input_plugin_t *this_gen ) {
     }
   }
 
-  if (this->curpos > 0) {
-    /* restarting after seek */
-    this->preview_size = 0;
-    return 1;
-  }
-
   /*
    * fill preview buffer
    */
@@ -1145,6 +1483,8 @@ static void http_class_dispose (input_class_t *this_gen) {
   config->unregister_callback(config, "media.network.http_proxy_password");
   config->unregister_callback(config, "media.network.http_no_proxy");
 
+  http_pool_release (&this->pool);
+
   free (this);
 }
 
@@ -1163,6 +1503,12 @@ void *input_http_init_class (xine_t *xine, const void *data) {
   this->xine   = xine;
   config       = xine->config;
 
+  this->pool = http_pool_acquire (xine);
+  if (!this->pool) {
+    free (this);
+    return NULL;
+  }
+
   this->input_class.get_instance       = http_class_get_instance;
   this->input_class.identifier         = "http";
   this->input_class.description        = N_("http/https input plugin");
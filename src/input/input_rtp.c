@@ -87,7 +87,6 @@
 #include <sys/time.h>
 #include <stdlib.h>
 #include <net/if.h>
-#include <sys/select.h>
 
 #if defined (__SVR4) && defined (__sun)
 #  include <sys/sockio.h>
@@ -117,7 +116,54 @@
   }
 #endif
 
-#define BUFFER_SIZE (1024*1024)
+/* receive buffer and jitter defaults, see config entries */
+#define DEFAULT_RCVBUF_KB     4096
+#define DEFAULT_JITTER_DEPTH  64
+
+/* packet ring between receive callback and reader. slots hold any non
+ * jumbo datagram in place. a larger one borrows one of JUMBO_BUFS
+ * buffers of MAX_DATAGRAM, which goes back when the reader is done with
+ * the slot. without a free one, the datagram is dropped as truncated. */
+#define RING_BITS             11
+#define RING_SIZE             (1 << RING_BITS)
+#define RING_MASK             (RING_SIZE - 1)
+#define SLOT_SIZE             2048
+#define MAX_DATAGRAM          65536
+#define JUMBO_BUFS            16
+/* datagrams per receive call */
+#define RECV_BATCH            32
+/* release a hole in the sequence after waiting this long, msecs */
+#define HOLE_TIMEOUT          20
+
+/* the ring is single producer, single consumer. each side only writes
+ * its own counter, and publishes it to the other side through these. */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7)))
+#  define RING_LOAD(p)     __atomic_load_n ((p), __ATOMIC_SEQ_CST)
+#  define RING_STORE(p,v)  __atomic_store_n ((p), (v), __ATOMIC_SEQ_CST)
+#  define RING_AND(p,v)    __atomic_fetch_and ((p), (v), __ATOMIC_SEQ_CST)
+#  define RING_OR(p,v)     __atomic_fetch_or ((p), (v), __ATOMIC_SEQ_CST)
+#else
+#  define RING_LOAD(p)     __sync_fetch_and_add ((p), 0)
+#  define RING_STORE(p,v)  do { __sync_synchronize (); *(p) = (v); __sync_synchronize (); } while (0)
+#  define RING_AND(p,v)    __sync_fetch_and_and ((p), (v))
+#  define RING_OR(p,v)     __sync_fetch_and_or ((p), (v))
+#endif
+
+typedef struct {
+  uint32_t          pos;        /* ring position this slot was last written for */
+  uint32_t          len;        /* payload length, 0 for a lost packet */
+  uint32_t          size;       /* of data, SLOT_SIZE or MAX_DATAGRAM */
+  int               jumbo;      /* borrowed jumbo buffer + 1, or 0 */
+  uint8_t          *data;       /* into slot_mem or jumbo_mem */
+} rtp_slot_t;
+
+typedef struct {
+  input_class_t     input_class;
+
+  xine_t           *xine;
+  int               rcvbuf_kb;
+  int               jitter_depth;
+} rtp_input_class_t;
 
 typedef struct {
   input_plugin_t    input_plugin;
@@ -131,20 +177,45 @@ typedef struct {
   int               port;
   const char       *interface;    /* For multicast,  eth0, eth1 etc */
   int               is_rtp;
+  int               rcvbuf;
+  int               jitter_depth;
 
   int               fh;
 
-  unsigned char    *buffer;	  /* circular buffer */
-  unsigned char	   *buffer_get_ptr;  /* get pointer used by reader */
-  unsigned char	   *buffer_put_ptr;  /* put pointer used by writer */
-  long              buffer_count; /* number of bytes in the buffer */
+  rtp_slot_t       *ring;
+  uint8_t          *slot_mem;     /* RING_SIZE * SLOT_SIZE */
+  uint8_t          *jumbo_mem;    /* JUMBO_BUFS * MAX_DATAGRAM */
+  uint32_t          jumbo_free;   /* bit mask, taken by receive callback, given back by reader */
+  uint32_t          ring_get;     /* next slot to read, owned by reader */
+  uint32_t          ring_put;     /* end of released slots, owned by receive callback */
+  uint32_t          get_offs;     /* bytes already read from slot ring_get */
+  int               reader_waiting;
+
+  /* receive callback only. the jitter window starts at win_start, the
+   * first position not yet released to the reader. */
+  uint32_t          win_start;
+  uint32_t          win_used;     /* win_start + win_used is past the newest packet */
+  uint16_t          next_seq;     /* sequence number expected at win_start */
+  int               have_seq;
+  struct timeval    hole_time;    /* since when win_start is missing */
+  struct timeval    stats_time;
+  uint8_t          *recv_buf;     /* RECV_BATCH * MAX_DATAGRAM */
+#ifdef HAVE_RECVMMSG
+  struct mmsghdr    recv_msgs[RECV_BATCH];
+  struct iovec      recv_iovs[RECV_BATCH];
+#endif
 
-  unsigned char     packet_buffer[65536];
+  /* statistics */
+  int               lost;
+  int               reordered;
+  int               late;
+  int               truncated;
 
   int               last_input_error;
   int               input_eof;
 
-  pthread_t         reader_thread;
+  /* socket watch on the engine i/o threads */
+  xine_io_watch_t  *watch;
 
   off_t             curpos;
   int               rtp_running;
@@ -155,8 +226,7 @@ typedef struct {
 
   nbc_t		   *nbc;
 
-  pthread_mutex_t   buffer_ring_mut;
-  pthread_cond_t    writer_cond;
+  pthread_mutex_t   reader_mut;
   pthread_cond_t    reader_cond;
 } rtp_input_plugin_t;
 
@@ -168,7 +238,7 @@ typedef struct {
  *
  */
 static int host_connect_attempt(struct in_addr ia, int port,
-				const char *interface,
+				const char *interface, int rcvbuf,
 				xine_t *xine) {
   int s = xine_socket_cloexec(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
   union {
@@ -176,6 +246,7 @@ static int host_connect_attempt(struct in_addr ia, int port,
     struct sockaddr sa;
   } saddr, saddr2;
   int optval;
+  socklen_t optlen;
   int multicast = 0;  /* boolean, assume unicast */
 
   if(s == -1) {
@@ -194,14 +265,19 @@ static int host_connect_attempt(struct in_addr ia, int port,
   }
 
 
-  /* Try to increase receive buffer to 1MB to avoid dropping packets */
-  optval = BUFFER_SIZE;
+  /* Try to increase receive buffer to avoid dropping packets */
+  optval = rcvbuf;
   if ((setsockopt(s, SOL_SOCKET, SO_RCVBUF,
 		  &optval, sizeof(optval))) < 0) {
     LOG_MSG(xine, _("setsockopt(SO_RCVBUF): %s.\n"), strerror(errno));
     close(s);
     return -1;
   }
+  /* the kernel silently limits this (net.core.rmem_max on linux) */
+  optlen = sizeof(optval);
+  if (!getsockopt(s, SOL_SOCKET, SO_RCVBUF, &optval, &optlen) && (optval < rcvbuf))
+    xprintf(xine, XINE_VERBOSITY_LOG,
+      _("input_rtp: receive buffer limited to %d bytes by the system.\n"), optval);
 
   /* If multicast we allow multiple readers to open the same address */
   if (multicast) {
@@ -268,7 +344,7 @@ static int host_connect_attempt(struct in_addr ia, int port,
  *
  */
 static int host_connect(const char *host, int port,
-			const char *interface,
+			const char *interface, int rcvbuf,
 			xine_t *xine)
 {
   struct hostent *h;
@@ -284,164 +360,248 @@ static int host_connect(const char *host, int port,
   for(i=0; h->h_addr_list[i]; i++) {
     struct in_addr ia;
     memcpy(&ia, h->h_addr_list[i],4);
-    s = host_connect_attempt(ia, port, interface, xine);
+    s = host_connect_attempt(ia, port, interface, rcvbuf, xine);
     if (s != -1) return s;
   }
   LOG_MSG(xine, _("unable to bind to '%s'.\n"), host);
   return -1;
 }
 
+static int rtp_elapsed_ms (const struct timeval *since, const struct timeval *now) {
+  return (now->tv_sec - since->tv_sec) * 1000 + (now->tv_usec - since->tv_usec) / 1000;
+}
+
+static void rtp_update_stats (rtp_input_plugin_t *this) {
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_LOST_PACKETS,      this->lost);
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_REORDERED_PACKETS, this->reordered);
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_LATE_PACKETS,      this->late);
+}
+
 /*
- *
+ * Do minimal RTP parsing to extract payload.  See
+ * http://www.faqs.org/rfcs/rfc3550.html for header format.
+ * Returns payload length, or -1 for a broken packet.
  */
-static void * input_plugin_read_loop(void *arg) {
+static int rtp_parse_header (const uint8_t *data, int length, int *offs, uint16_t *seq) {
+  int hlen;
 
-  rtp_input_plugin_t *this  = (rtp_input_plugin_t *) arg;
-  unsigned char *data;
-  long length;
-  fd_set read_fds;
+  if ((length < 12) || ((data[0] & 0xc0) != 0x80))
+    return -1;
 
-  while (1) {
+  *seq = (data[2] << 8) | data[3];
+  hlen = 12 + (data[0] & 0x0f) * 4;
 
-    /* System calls are not a thread cancellation point in Linux
-     * pthreads.  However, the RT signal sent to cancel the thread
-     * will cause recv() to return with EINTR, and we can manually
-     * check cancellation.
-     */
-
-    pthread_testcancel();
-    {
-    struct timeval recv_timeout;
-    int rc;
+  if (data[0] & 0x10) {
+    /* header extension: 16 bit profile, 16 bit length in 32 bit words */
+    if (length < hlen + 4)
+      return -1;
+    hlen += 4 + ((data[hlen + 2] << 8) | data[hlen + 3]) * 4;
+  }
+  length -= hlen;
 
-    recv_timeout.tv_sec = 2;
-    recv_timeout.tv_usec = 0;
+  if (data[0] & 0x20) {
+    /* padding, the last byte counts itself too */
+    if ((length < 1) || (data[hlen + length - 1] > length))
+      return -1;
+    length -= data[hlen + length - 1];
+  }
 
-    FD_ZERO( &read_fds );
-    FD_SET( this->fh, &read_fds );
+  *offs = hlen;
+  return length;
+}
 
-    /* wait for a packet to arrive - but do not hang! */
-    rc = select( this->fh+1, &read_fds, NULL, NULL, &recv_timeout );
-    if( rc > 0 )
-    {
-        length = recv(this->fh, this->packet_buffer,
-                    sizeof(this->packet_buffer), 0);
-    }
-    else if( rc == 0 )
-        length = 0;
-    else
-        length = -1;
-    }
-    pthread_testcancel();
+/* publish released slots, and wake the reader if it sleeps. */
+static void rtp_publish (rtp_input_plugin_t *this) {
+  if (this->ring_put == this->win_start)
+    return;
+  RING_STORE (&this->ring_put, this->win_start);
+  if (RING_LOAD (&this->reader_waiting)) {
+    pthread_mutex_lock (&this->reader_mut);
+    pthread_cond_signal (&this->reader_cond);
+    pthread_mutex_unlock (&this->reader_mut);
+  }
+}
 
-    if (length < 0) {
-      if (errno != EINTR) {
-	LOG_MSG(this->stream->xine, _("recv(): %s.\n"), strerror(errno));
-	return NULL;
-      }
+/* release the packets at window start to the reader.
+ * skip == 1: first skip the hole in front of the next packet.
+ * skip == 2: release all, holes included. */
+static void rtp_release (rtp_input_plugin_t *this, int skip) {
+  uint32_t get = RING_LOAD (&this->ring_get);
+
+  while (this->win_used) {
+    rtp_slot_t *slot = &this->ring[this->win_start & RING_MASK];
+    if (slot->pos != this->win_start) {
+      if (!skip || (this->win_start - get >= RING_SIZE))
+        break;
+      slot->pos = this->win_start;
+      slot->len = 0;
+      this->lost++;
+    } else if (skip == 1) {
+      skip = 0;
     }
-    else {
-      data = this->packet_buffer;
-
-      if (this->is_rtp) {
-	int pad, ext;
-	int csrc;
-
-	/* Do minimal RTP parsing to extract payload.  See
-	 * http://www.faqs.org/rfcs/rfc1889.html for header format.
-	 *
-	 * WARNING: wholly untested code.  I don't have any RTP sender.
-	 */
-
-	if (length < 12) continue;
+    this->win_start++;
+    this->win_used--;
+    this->next_seq++;
+  }
+}
 
-	pad = data[0] & 0x20;
-	ext = data[0] & 0x10;
-	csrc = data[0] & 0x0f;
+static void rtp_receive (rtp_input_plugin_t *this, const uint8_t *data, int length) {
+  rtp_slot_t *slot;
+  uint32_t pos, start = this->win_start, was_used = this->win_used;
+  uint16_t seq;
+  int offs = 0, d;
+
+  if (this->is_rtp) {
+    length = rtp_parse_header (data, length, &offs, &seq);
+    if (length < 0)
+      return;
+  } else {
+    seq = this->next_seq + this->win_used;
+  }
+  if (!this->have_seq) {
+    this->next_seq = seq;
+    this->have_seq = 1;
+  }
 
-	data += 12 + csrc * 4;
-	length -= 12 + csrc * 4;
+  d = (int16_t)(seq - this->next_seq);
+  if ((d < -RING_SIZE) || (d >= RING_SIZE)) {
+    /* sender restart or long outage */
+    lprintf ("sequence jump %d -> %d\n", this->next_seq, seq);
+    rtp_release (this, 2);
+    this->next_seq = seq;
+    d = 0;
+  } else if (d < 0) {
+    /* window already moved past this one, or a duplicate */
+    this->late++;
+    return;
+  }
 
-	if (ext) {
-	  long hlen;
+  if (d >= this->jitter_depth) {
+    /* too far ahead: give up waiting for the oldest ones. */
+    int shift = d - this->jitter_depth + 1;
+    while ((shift > 0) && this->win_used) {
+      uint32_t start = this->win_start;
+      rtp_release (this, 1);
+      if (this->win_start == start)
+        break;
+      shift -= this->win_start - start;
+    }
+    if ((shift > 0) && !this->win_used) {
+      this->next_seq += shift;
+      this->lost += shift;
+    }
+    d = (int16_t)(seq - this->next_seq);
+    if ((d < 0) || (d >= RING_SIZE))
+      return;
+  }
 
-	  if (length < 4) continue;
+  pos = this->win_start + d;
+  if (pos - RING_LOAD (&this->ring_get) >= RING_SIZE) {
+    /* reader is too slow, this will show up as a hole. */
+    return;
+  }
+  slot = &this->ring[pos & RING_MASK];
+  if (slot->pos == pos) {
+    this->late++;
+    return;
+  }
+  if ((uint32_t)length > slot->size) {
+    uint32_t avail = RING_LOAD (&this->jumbo_free);
+    int      i;
+
+    if (!avail) {
+      /* will show up as a hole */
+      this->truncated++;
+      return;
+    }
+    for (i = 0; !(avail & (1u << i)); i++) ;
+    RING_AND (&this->jumbo_free, ~(1u << i));
+    slot->jumbo = i + 1;
+    slot->data  = this->jumbo_mem + i * MAX_DATAGRAM;
+    slot->size  = MAX_DATAGRAM;
+  }
+  if (length > 0)
+    memcpy (slot->data, data + offs, length);
+  slot->len = length;
+  slot->pos = pos;
+
+  if ((uint32_t)d < this->win_used)
+    this->reordered++;
+  else
+    this->win_used = d + 1;
+
+  if (d == 0)
+    rtp_release (this, 0);
+  /* a new hole is at window start now, start waiting for it. */
+  if (this->win_used && (!was_used || (this->win_start != start)))
+    gettimeofday (&this->hole_time, NULL);
+}
 
-	  hlen = (data[2] << 8) | data[3];
-	  data += hlen;
-	  length -= hlen;
-	}
+/*
+ *
+ */
+static int rtp_receive_cb (void *data, int fd, int state) {
 
-	if (pad) {
-	  if (length < 1)
-	    continue;
+  rtp_input_plugin_t *this = (rtp_input_plugin_t *) data;
+  struct timeval now;
+  int i, n;
+#ifndef HAVE_RECVMMSG
+  int lens[RECV_BATCH];
+#endif
 
-	  /* FIXME: is the pad length byte included in the
-	   * length value or not?  We assume it is not.
-	   */
-	  length -= data[length - 1] + 1;
-	}
+  if (state & XIO_READ_READY) {
+#ifdef HAVE_RECVMMSG
+    n = recvmmsg (fd, this->recv_msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+#else
+    for (n = 0; n < RECV_BATCH; n++) {
+      lens[n] = recv (fd, this->recv_buf + n * MAX_DATAGRAM, MAX_DATAGRAM, MSG_DONTWAIT);
+      if (lens[n] < 0)
+        break;
+    }
+    if (n == 0)
+      n = -1;
+#endif
+    if (n < 0) {
+      if ((errno != EINTR) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        LOG_MSG(this->stream->xine, _("recv(): %s.\n"), strerror(errno));
+        this->last_input_error = errno;
+        return XIO_WATCH_STOP;
       }
-
-      /* insert data into cyclic buffer */
-      if (length > 0) {
-
-	/*
-	 * if the buffer is full, wait for the reader
-	 * to signal
-	 */
-
-        pthread_mutex_lock(&this->buffer_ring_mut);
-        /* wait for enough space to write the whole of the recv'ed data */
-	while( (BUFFER_SIZE - this->buffer_count) < length )
-        {
-          struct timeval tv;
-          struct timespec timeout;
-
-          gettimeofday(&tv, NULL);
-
-          timeout.tv_nsec = tv.tv_usec * 1000;
-          timeout.tv_sec = tv.tv_sec + 2;
-
-          if( pthread_cond_timedwait(&this->writer_cond, &this->buffer_ring_mut, &timeout) != 0 )
-          {
-            fprintf( stdout, "input_rtp: buffer ring not read within 2 seconds!\n" );
-          }
-        }
-
-	/* Now there's enough space to write some bytes into the buffer
-	 * determine how many bytes can be written. If the buffer wraps
-	 * around, write in two pieces: from the head pointer to the
-	 * end of the buffer and from the base to the remaining number
-	 * of bytes.
-	 */
-
-        {
-        long buffer_space_remaining = BUFFER_SIZE - (this->buffer_put_ptr - this->buffer);
-
-	if( buffer_space_remaining >= length )
-        {
-            /* data fits inside the buffer */
-            memcpy(this->buffer_put_ptr, data, length);
-            this->buffer_put_ptr += length;
+      n = 0;
     }
-	else
-        {
-            /* data wrapped around the end of the buffer */
-            memcpy(this->buffer_put_ptr, data, buffer_space_remaining);
-            memcpy(this->buffer, &data[buffer_space_remaining], length - buffer_space_remaining);
-            this->buffer_put_ptr = &this->buffer[ length - buffer_space_remaining ];
-        }
-        }
 
-	this->buffer_count += length;
-
-	/* signal the reader that there is new data	*/
-	pthread_cond_signal(&this->reader_cond);
-	pthread_mutex_unlock(&this->buffer_ring_mut);
+    for (i = 0; i < n; i++) {
+#ifdef HAVE_RECVMMSG
+      int length = this->recv_msgs[i].msg_len;
+      int trunc  = this->recv_msgs[i].msg_hdr.msg_flags & MSG_TRUNC;
+#else
+      int length = lens[i];
+      int trunc  = 0;
+#endif
+      if (trunc) {
+        if (!this->truncated++)
+          xprintf (this->stream->xine, XINE_VERBOSITY_LOG,
+            _("input_rtp: dropping datagrams larger than %d bytes.\n"), MAX_DATAGRAM);
+        continue;
       }
+      rtp_receive (this, this->recv_buf + i * MAX_DATAGRAM, length);
     }
   }
+
+  gettimeofday (&now, NULL);
+  if (this->win_used && (rtp_elapsed_ms (&this->hole_time, &now) >= HOLE_TIMEOUT)) {
+    rtp_release (this, 1);
+    this->hole_time = now;
+  }
+  rtp_publish (this);
+
+  if (rtp_elapsed_ms (&this->stats_time, &now) >= 1000) {
+    this->stats_time = now;
+    rtp_update_stats (this);
+  }
+
+  /* do not sit on a hole too long */
+  return this->win_used ? HOLE_TIMEOUT : 1000;
 }
 
 /* ***************************************************************** */
@@ -462,9 +622,7 @@ static off_t rtp_plugin_read (input_plugin_t *this_gen,
 
   while(length > 0) {
 
-    off_t n;
-
-    pthread_mutex_lock(&this->buffer_ring_mut);
+    uint32_t put = RING_LOAD (&this->ring_put);
 
     /*
      * if nothing in the buffer, wait for data for 5 seconds. If
@@ -472,53 +630,52 @@ static off_t rtp_plugin_read (input_plugin_t *this_gen,
      * of bytes already received (which is likely to be 0)
      */
 
-    if(this->buffer_count == 0) {
+    if (put == this->ring_get) {
+      int r = 0;
+
       gettimeofday(&tv, NULL);
       timeout.tv_nsec = tv.tv_usec * 1000;
       timeout.tv_sec = tv.tv_sec + 5;
 
-      if(pthread_cond_timedwait(&this->reader_cond, &this->buffer_ring_mut, &timeout) != 0)
-	{
-	  /* we timed out, no data available */
-	  pthread_mutex_unlock(&this->buffer_ring_mut);
-	  return copied;
-	}
-    }
+      pthread_mutex_lock (&this->reader_mut);
+      RING_STORE (&this->reader_waiting, 1);
+      while (((put = RING_LOAD (&this->ring_put)) == this->ring_get) && !r)
+        r = pthread_cond_timedwait (&this->reader_cond, &this->reader_mut, &timeout);
+      RING_STORE (&this->reader_waiting, 0);
+      pthread_mutex_unlock (&this->reader_mut);
 
-    /* Now determine how many bytes can be read. If the buffer
-     * will wrap the buffer is read in two pieces, first read
-     * to the end of the buffer, wrap the tail pointer and
-     * update the buffer count. Finally read the second piece
-     * from the base to the remaining count
-     */
-    if(length  > this->buffer_count) {
-      n = this->buffer_count;
-    }
-    else {
-      n = length;
+      /* we timed out, no data available */
+      if (put == this->ring_get)
+        break;
     }
 
-    if(((this->buffer_get_ptr - this->buffer) + n) > BUFFER_SIZE) {
-      n = BUFFER_SIZE - (this->buffer_get_ptr - this->buffer);
+    /* copy out whole or partial packets. lost ones are empty. */
+    while ((put != this->ring_get) && (length > 0)) {
+      rtp_slot_t *slot = &this->ring[this->ring_get & RING_MASK];
+      off_t n = slot->len - this->get_offs;
+
+      if (n > length)
+        n = length;
+      memcpy (buf, slot->data + this->get_offs, n);
+
+      buf += n;
+      copied += n;
+      length -= n;
+
+      this->get_offs += n;
+      if (this->get_offs >= slot->len) {
+        /* hand the slot back to the receive callback */
+        this->get_offs = 0;
+        if (slot->jumbo) {
+          uint32_t bit = 1u << (slot->jumbo - 1);
+          slot->jumbo = 0;
+          slot->data  = this->slot_mem + (this->ring_get & RING_MASK) * SLOT_SIZE;
+          slot->size  = SLOT_SIZE;
+          RING_OR (&this->jumbo_free, bit);
+        }
+        RING_STORE (&this->ring_get, this->ring_get + 1);
+      }
     }
-
-    /* the actual read */
-    memcpy(buf, this->buffer_get_ptr, n);
-
-    buf += n;
-    copied += n;
-    length -= n;
-
-    /* update the tail pointer, watch for wrap arounds */
-    this->buffer_get_ptr += n;
-    if(this->buffer_get_ptr - this->buffer >= BUFFER_SIZE)
-      this->buffer_get_ptr = this->buffer;
-
-    this->buffer_count -= n;
-
-    /* signal the writer that there's space in the buffer again */
-    pthread_cond_signal(&this->writer_cond);
-    pthread_mutex_unlock(&this->buffer_ring_mut);
   }
 
   this->curpos += copied;
@@ -605,22 +762,30 @@ static void rtp_plugin_dispose (input_plugin_t *this_gen ) {
   if (this->nbc) nbc_close(this->nbc);
 
   if (this->rtp_running) {
-    LOG_MSG(this->stream->xine, _("RTP: stopping reading thread...\n"));
-    pthread_cancel(this->reader_thread);
-    pthread_join(this->reader_thread, NULL);
-    LOG_MSG(this->stream->xine, _("RTP: reading thread terminated\n"));
+    _x_io_watch_remove (&this->watch);
+    this->rtp_running = 0;
+
+    rtp_update_stats (this);
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      "input_rtp: %d packets lost, %d reordered, %d late, %d too large.\n",
+      this->lost, this->reordered, this->late, this->truncated);
   }
 
   if (this->fh != -1) close(this->fh);
 
-  _x_freep(&this->buffer);
+  pthread_cond_destroy (&this->reader_cond);
+  pthread_mutex_destroy (&this->reader_mut);
+
+  _x_freep(&this->ring);
+  _x_freep(&this->slot_mem);
+  _x_freep(&this->jumbo_mem);
+  _x_freep(&this->recv_buf);
   _x_freep(&this->mrl);
   free(this);
 }
 
 static int rtp_plugin_open (input_plugin_t *this_gen ) {
   rtp_input_plugin_t *this = (rtp_input_plugin_t *) this_gen;
-  int                 err;
 
   _x_assert(this->fh == -1);
   _x_assert(this->rtp_running == 0);
@@ -632,23 +797,38 @@ static int rtp_plugin_open (input_plugin_t *this_gen ) {
 	  this->interface);
 
   this->fh = host_connect(this->address, this->port,
-			  this->interface, this->stream->xine);
+			  this->interface, this->rcvbuf, this->stream->xine);
 
   if (this->fh == -1) return 0;
 
   this->last_input_error = 0;
   this->input_eof = 0;
   this->curpos = 0;
-  this->rtp_running = 1;
 
-  if ((err = pthread_create(&this->reader_thread, NULL,
-		            input_plugin_read_loop, (void *)this)) != 0) {
-    LOG_MSG(this->stream->xine, _("input_rtp: can't create new thread (%s)\n"), strerror(err));
+#ifdef HAVE_RECVMMSG
+  {
+    int i;
+    memset (this->recv_msgs, 0, sizeof (this->recv_msgs));
+    for (i = 0; i < RECV_BATCH; i++) {
+      this->recv_iovs[i].iov_base = this->recv_buf + i * MAX_DATAGRAM;
+      this->recv_iovs[i].iov_len  = MAX_DATAGRAM;
+      this->recv_msgs[i].msg_hdr.msg_iov    = &this->recv_iovs[i];
+      this->recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+#endif
+  gettimeofday (&this->stats_time, NULL);
+
+  /* receive on the shared engine i/o threads */
+  this->watch = _x_io_watch_add (this->stream->xine, this->fh, XIO_READ_READY, 1000,
+                                 rtp_receive_cb, this);
+  if (!this->watch) {
+    LOG_MSG(this->stream->xine, _("input_rtp: can't watch socket\n"));
     close(this->fh);
     this->fh = -1;
-    this->rtp_running = 0;
     return 0;
   }
+  this->rtp_running = 1;
 
   return 1;
 }
@@ -656,6 +836,7 @@ static int rtp_plugin_open (input_plugin_t *this_gen ) {
 static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
 					       xine_stream_t *stream,
 					       const char *data) {
+  rtp_input_class_t  *cls = (rtp_input_class_t *) cls_gen;
   rtp_input_plugin_t *this;
   char               *address = NULL;
   char               *pptr;
@@ -663,6 +844,7 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   char               *mrl;
   int                 is_rtp = 0;
   int                 port = 7658;
+  int                 i;
 
 
   mrl = strdup(data);
@@ -702,6 +884,34 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   }
 
   this = calloc(1, sizeof(rtp_input_plugin_t));
+  if (!this) {
+    free(mrl);
+    return NULL;
+  }
+  this->ring     = malloc(RING_SIZE * sizeof(rtp_slot_t));
+  this->slot_mem = malloc(RING_SIZE * SLOT_SIZE);
+  /* only the pages of datagrams actually received get touched */
+  this->recv_buf  = malloc(RECV_BATCH * MAX_DATAGRAM);
+  this->jumbo_mem = malloc(JUMBO_BUFS * MAX_DATAGRAM);
+  if (!this->ring || !this->slot_mem || !this->recv_buf || !this->jumbo_mem) {
+    free(this->ring);
+    free(this->slot_mem);
+    free(this->recv_buf);
+    free(this->jumbo_mem);
+    free(mrl);
+    free(this);
+    return NULL;
+  }
+  /* no slot holds a valid position yet */
+  for (i = 0; i < RING_SIZE; i++) {
+    this->ring[i].pos   = i - RING_SIZE;
+    this->ring[i].len   = 0;
+    this->ring[i].size  = SLOT_SIZE;
+    this->ring[i].jumbo = 0;
+    this->ring[i].data  = this->slot_mem + i * SLOT_SIZE;
+  }
+  this->jumbo_free = (1u << JUMBO_BUFS) - 1;
+
   this->stream       = stream;
   this->mrl          = mrl;
   this->address      = address;
@@ -711,16 +921,17 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   this->rtp_running  = 0;
   this->preview_size = 0;
   this->interface    = iptr;
+  this->rcvbuf       = cls->rcvbuf_kb * 1024;
+  /* leave the reader at least half of the ring */
+  this->jitter_depth = cls->jitter_depth < 1 ? 1 :
+                       cls->jitter_depth > RING_SIZE / 2 ? RING_SIZE / 2 : cls->jitter_depth;
 
-  pthread_mutex_init(&this->buffer_ring_mut, NULL);
-
+  pthread_mutex_init(&this->reader_mut, NULL);
   pthread_cond_init(&this->reader_cond, NULL);
-  pthread_cond_init(&this->writer_cond, NULL);
 
-  this->buffer = malloc(BUFFER_SIZE);
-  this->buffer_put_ptr = this->buffer;
-  this->buffer_get_ptr = this->buffer;
-  this->buffer_count = 0;
+  this->ring_get = 0;
+  this->ring_put = 0;
+  this->win_start = 0;
   this->curpos = 0;
 
   this->input_plugin.open              = rtp_plugin_open;
@@ -746,21 +957,63 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
 /*
  *  net plugin class
  */
+static void rcvbuf_cb (void *data, xine_cfg_entry_t *cfg) {
+  rtp_input_class_t *this = (rtp_input_class_t *) data;
+
+  this->rcvbuf_kb = cfg->num_value;
+}
+
+static void jitter_depth_cb (void *data, xine_cfg_entry_t *cfg) {
+  rtp_input_class_t *this = (rtp_input_class_t *) data;
+
+  this->jitter_depth = cfg->num_value;
+}
+
+static void rtp_class_dispose (input_class_t *this_gen) {
+  rtp_input_class_t *this   = (rtp_input_class_t *) this_gen;
+  config_values_t   *config = this->xine->config;
+
+  config->unregister_callback (config, "media.network.rtp_receive_buffer");
+  config->unregister_callback (config, "media.network.rtp_jitter_depth");
+
+  free (this);
+}
+
 static void *init_class (xine_t *xine, const void *data) {
 
-  static const input_class_t input_rtp_class = {
-    .get_instance      = rtp_class_get_instance,
-    .description       = N_("RTP and UDP input plugin as shipped with xine"),
-    .identifier        = "RTP/UDP",
-    .get_dir           = NULL,
-    .get_autoplay_list = NULL,
-    .dispose           = NULL,
-    .eject_media       = NULL,
-  };
-
-  (void)xine;
+  rtp_input_class_t *this;
+  config_values_t   *config = xine->config;
+
   (void)data;
-  return (void *)&input_rtp_class;
+  this = calloc (1, sizeof (rtp_input_class_t));
+  if (!this)
+    return NULL;
+
+  this->xine = xine;
+
+  this->input_class.get_instance      = rtp_class_get_instance;
+  this->input_class.description       = N_("RTP and UDP input plugin as shipped with xine");
+  this->input_class.identifier        = "RTP/UDP";
+  this->input_class.get_dir           = NULL;
+  this->input_class.get_autoplay_list = NULL;
+  this->input_class.dispose           = rtp_class_dispose;
+  this->input_class.eject_media       = NULL;
+
+  this->rcvbuf_kb = config->register_num (config,
+    "media.network.rtp_receive_buffer", DEFAULT_RCVBUF_KB,
+    _("RTP/UDP socket receive buffer size (KiB)"),
+    _("How much data the system may queue for the RTP/UDP input while xine is busy.\n"
+      "High bitrate multicast streams need several MiB here. The system may limit this\n"
+      "(net.core.rmem_max on Linux)."),
+    20, rcvbuf_cb, this);
+  this->jitter_depth = config->register_range (config,
+    "media.network.rtp_jitter_depth", DEFAULT_JITTER_DEPTH, 1, RING_SIZE / 2,
+    _("RTP reordering depth (packets)"),
+    _("How many packets an out of order RTP packet may arrive late, before it is\n"
+      "considered lost. Larger values fix more reordering, but add latency on loss."),
+    20, jitter_depth_cb, this);
+
+  return this;
 }
 
 /*
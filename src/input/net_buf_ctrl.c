@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/time.h>
 
 /********** logging **********/
 #define LOG_MODULE "net_buf_ctrl"
@@ -43,9 +44,17 @@
 #endif
 
 #define DEFAULT_HIGH_WATER_MARK 5000 /* in 1/1000 s */
+#define DEFAULT_LOW_WATER_MARK  1000 /* in 1/1000 s, start threshold on a fast link */
 
 #define FULL_FIFO_MARK             5 /* buffers free */
 
+#define RATE_WINDOW              250 /* in 1/1000 s, input rate sample length */
+#define HEALTH_INTERVAL         1000 /* in 1/1000 s */
+
+/* low latency live mode: play slower/faster instead of pausing */
+#define LIVE_SPEED_SLOW  (XINE_FINE_SPEED_NORMAL * 97 / 100)
+#define LIVE_SPEED_FAST  (XINE_FINE_SPEED_NORMAL * 103 / 100)
+
 #define FIFO_PUT                   0
 #define FIFO_GET                   1
 
@@ -69,6 +78,23 @@ struct nbc_s {
   int64_t          audio_fifo_length_int; /* in ms */
 
   int64_t          high_water_mark;
+  /* adaptive start threshold, between low_water_mark and high_water_mark */
+  int64_t          low_water_mark;
+  int64_t          start_mark;
+  /* input rate */
+  int64_t          in_bytes;
+  int64_t          in_time;
+  int64_t          in_rate;               /* bit/s, smoothed */
+  /* buffer health */
+  int64_t          buffering_since;
+  int64_t          last_health;
+  int              started;
+  int              rebuffers;
+  int64_t          rebuffer_time;         /* in ms */
+  /* low latency live mode */
+  int              low_latency;
+  int              live;
+  int              live_speed;
   /* bitrate */
   int64_t          video_last_pts;
   int64_t          audio_last_pts;
@@ -112,6 +138,151 @@ static void report_progress (xine_stream_t *stream, int p) {
   xine_event_send (stream, &event);
 }
 
+static int64_t nbc_now (void) {
+  struct timeval tv;
+
+  xine_monotonic_clock (&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* measure how fast the input delivers. While buffering, this is the network
+ * speed. While playing with full fifos it drops to the stream bitrate. */
+static void nbc_update_in_rate (nbc_t *this, buf_element_t *buf) {
+  int64_t now = nbc_now (), diff;
+
+  this->in_bytes += buf->size;
+  if (!this->in_time) {
+    this->in_time = now;
+    return;
+  }
+  diff = now - this->in_time;
+  if (diff >= RATE_WINDOW) {
+    int64_t rate = this->in_bytes * 8000 / diff;
+    this->in_rate = this->in_rate ? (3 * this->in_rate + rate) / 4 : rate;
+    this->in_bytes = 0;
+    this->in_time  = now;
+  }
+}
+
+/* The smallest buffer that will likely play through: when the input is
+ * clearly faster than the stream, the fifos keep growing during playback
+ * and low_water_mark is enough. When it is not, fall back to the full
+ * high_water_mark. In between, interpolate. */
+static int64_t nbc_start_mark (nbc_t *this) {
+  int64_t media = this->video_br + this->audio_br;
+  int64_t ratio;
+
+  if (!this->in_rate || !media)
+    return this->high_water_mark;
+
+  ratio = this->in_rate * 100 / media;
+  if (ratio >= 150)
+    return this->low_water_mark;
+  if (ratio <= 100)
+    return this->high_water_mark;
+  return this->low_water_mark + (this->high_water_mark - this->low_water_mark) * (150 - ratio) / 50;
+}
+
+static int64_t nbc_buffered (nbc_t *this, int has_video, int has_audio) {
+  if (has_video && has_audio)
+    return (this->video_fifo_length < this->audio_fifo_length) ? this->video_fifo_length : this->audio_fifo_length;
+  if (has_audio)
+    return this->audio_fifo_length;
+  return this->video_fifo_length;
+}
+
+static void nbc_live_speed (nbc_t *this, int speed) {
+  int cur = _x_get_fine_speed (this->stream);
+
+  /* do not fight user pause or trick play */
+  if ((cur != XINE_FINE_SPEED_NORMAL) && (cur != LIVE_SPEED_SLOW) && (cur != LIVE_SPEED_FAST))
+    return;
+  if (cur != speed) {
+    _x_set_fine_speed (this->stream, speed);
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "net_buf_ctrl: live speed %d%%\n",
+      speed * 100 / XINE_FINE_SPEED_NORMAL);
+  }
+  this->live_speed = (speed != XINE_FINE_SPEED_NORMAL);
+}
+
+/* keep a live stream near start_mark by nudging the playback speed */
+static void nbc_live_adjust (nbc_t *this, int64_t buffered) {
+  if (buffered < this->start_mark / 2)
+    nbc_live_speed (this, LIVE_SPEED_SLOW);
+  else if (buffered > 2 * this->start_mark)
+    nbc_live_speed (this, LIVE_SPEED_FAST);
+  else if (this->live_speed &&
+    (((_x_get_fine_speed (this->stream) == LIVE_SPEED_SLOW) && (buffered >= this->start_mark)) ||
+     ((_x_get_fine_speed (this->stream) == LIVE_SPEED_FAST) && (buffered <= this->start_mark))))
+    nbc_live_speed (this, XINE_FINE_SPEED_NORMAL);
+}
+
+static void nbc_live_init (nbc_t *this) {
+  input_plugin_t *input = this->stream->input_plugin;
+  xine_cfg_entry_t entry;
+
+  this->live = 0;
+  if (!this->low_latency || !input || (input->get_length (input) > 0))
+    return;
+  /* audio would be dropped at other speeds */
+  if (_x_stream_info_get (this->stream, XINE_STREAM_INFO_HAS_AUDIO) &&
+    !(xine_config_lookup_entry (this->stream->xine, "audio.synchronization.slow_fast_audio", &entry) && entry.num_value)) {
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      "net_buf_ctrl: low latency mode needs audio.synchronization.slow_fast_audio\n");
+    return;
+  }
+  this->live = 1;
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "net_buf_ctrl: low latency live mode\n");
+}
+
+static void nbc_live_close (nbc_t *this) {
+  if (this->live_speed)
+    nbc_live_speed (this, XINE_FINE_SPEED_NORMAL);
+  this->live = 0;
+}
+
+static void nbc_stop_buffering (nbc_t *this) {
+  int64_t now = nbc_now ();
+
+  if (this->started) {
+    this->rebuffer_time += now - this->buffering_since;
+    _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_REBUFFER_TIME, this->rebuffer_time);
+  } else {
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      "net_buf_ctrl: playback starts after %d ms with %d ms buffered\n",
+      (int)(now - this->buffering_since), (int)this->start_mark);
+    this->started = 1;
+    nbc_live_init (this);
+  }
+}
+
+static void nbc_start_buffering (nbc_t *this) {
+  this->buffering_since = nbc_now ();
+  if (this->started) {
+    /* an underrun: the link is worse than estimated, keep more next time */
+    this->rebuffers++;
+    this->low_water_mark += this->low_water_mark / 2;
+    if (this->low_water_mark > this->high_water_mark)
+      this->low_water_mark = this->high_water_mark;
+    _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_REBUFFERS, this->rebuffers);
+  }
+}
+
+/* buffer health over time */
+static void nbc_health (nbc_t *this, int64_t buffered) {
+  int64_t now = nbc_now ();
+
+  if (now - this->last_health < HEALTH_INTERVAL)
+    return;
+  this->last_health = now;
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    "net_buf_ctrl: health: %d ms buffered, start mark %d ms, input %d kbps, stream %d kbps, "
+    "%d rebuffers (%d ms)\n",
+    (int)buffered, (int)this->start_mark, (int)(this->in_rate / 1000),
+    (int)((this->video_br + this->audio_br) / 1000), this->rebuffers, (int)this->rebuffer_time);
+}
+
 static void nbc_set_speed_pause (nbc_t *this) {
   xine_stream_t *stream = this->stream;
 
@@ -341,6 +512,9 @@ static void report_stats (nbc_t *this, int type) {
   bs.buffering = this->buffering;
   bs.enabled = this->enabled;
   bs.type = type;
+  bs.in_bitrate = this->in_rate;
+  bs.start_mark = this->start_mark;
+  bs.rebuffers = this->rebuffers;
 
   event.type = XINE_EVENT_NBC_STATS;
   event.data = &bs;
@@ -472,6 +646,7 @@ static void nbc_alloc_cb (fifo_buffer_t *fifo, void *this_gen) {
       this->buffering = 0;
 
       xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG, "\nnet_buf_ctrl: nbc_alloc_cb: stops buffering\n");
+      nbc_stop_buffering (this);
 
       nbc_set_speed_normal(this);
     }
@@ -502,12 +677,14 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
         dvbspeed_put (this, fifo, buf);
       else {
         nbc_compute_fifo_length(this, fifo, buf, FIFO_PUT);
+        nbc_update_in_rate (this, buf);
 
         if (this->buffering) {
 
           has_video = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_VIDEO);
           has_audio = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_AUDIO);
-          /* restart playing if high_water_mark is reached by all fifos
+          this->start_mark = nbc_start_mark (this);
+          /* restart playing if start_mark is reached by all fifos
            * do not restart if has_video and has_audio are false to avoid
            * a yoyo effect at the beginning of the stream when these values
            * are not yet known.
@@ -515,8 +692,8 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
            * be sure that the next buffer_pool_alloc() call will not deadlock,
            * we need at least 2 buffers (see buffer.c)
            */
-          if ((((!has_video) || (this->video_fifo_length > this->high_water_mark)) &&
-               ((!has_audio) || (this->audio_fifo_length > this->high_water_mark)) &&
+          if ((((!has_video) || (this->video_fifo_length > this->start_mark)) &&
+               ((!has_audio) || (this->audio_fifo_length > this->start_mark)) &&
                (has_video || has_audio))) {
 
             this->progress = 100;
@@ -524,6 +701,7 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
             this->buffering = 0;
 
             xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG, "\nnet_buf_ctrl: nbc_put_cb: stops buffering\n");
+            nbc_stop_buffering (this);
 
             nbc_set_speed_normal(this);
 #if 0 /* WTF... */
@@ -533,9 +711,9 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
             /*  compute the buffering progress
              *    50%: video
              *    50%: audio */
-            video_p = ((this->video_fifo_length * 50) / this->high_water_mark);
+            video_p = ((this->video_fifo_length * 50) / this->start_mark);
             if (video_p > 50) video_p = 50;
-            audio_p = ((this->audio_fifo_length * 50) / this->high_water_mark);
+            audio_p = ((this->audio_fifo_length * 50) / this->start_mark);
             if (audio_p > 50) audio_p = 50;
 
             if ((has_video) && (has_audio)) {
@@ -563,6 +741,9 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
         if(this->stream->xine->verbosity >= XINE_VERBOSITY_DEBUG)
           display_stats(this);
 
+        nbc_health (this, nbc_buffered (this,
+          _x_stream_info_get (this->stream, XINE_STREAM_INFO_HAS_VIDEO),
+          _x_stream_info_get (this->stream, XINE_STREAM_INFO_HAS_AUDIO)));
         report_stats(this, 0);
       }
     }
@@ -582,6 +763,19 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
           this->audio_last_pts    = 0;
           this->video_fifo_length = 0;
           this->audio_fifo_length = 0;
+          this->in_bytes          = 0;
+          this->in_time           = 0;
+          this->in_rate           = 0;
+          this->started           = 0;
+          this->rebuffers         = 0;
+          this->rebuffer_time     = 0;
+          this->low_water_mark    = DEFAULT_LOW_WATER_MARK;
+          if (this->low_water_mark > this->high_water_mark)
+            this->low_water_mark = this->high_water_mark;
+          this->start_mark        = this->high_water_mark;
+          this->buffering_since   = nbc_now ();
+          _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_REBUFFERS, 0);
+          _x_stream_info_set (this->stream, XINE_STREAM_INFO_NET_REBUFFER_TIME, 0);
           dvbspeed_init (this);
           if (!this->dvbspeed) pause = 1;
           this->progress = 0;
@@ -598,6 +792,7 @@ static void nbc_put_cb (fifo_buffer_t *fifo,
       case BUF_CONTROL_QUIT:
         lprintf("BUF_CONTROL_END\n");
         dvbspeed_close (this);
+        nbc_live_close (this);
         if (this->enabled) {
           /* end of stream :
            *   - disable the nbc
@@ -664,13 +859,16 @@ static void nbc_get_cb (fifo_buffer_t *fifo,
       if (this->dvbspeed)
         dvbspeed_get (this, fifo, buf);
       else {
+        int has_video = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_VIDEO);
+        int has_audio = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_AUDIO);
+
         nbc_compute_fifo_length(this, fifo, buf, FIFO_GET);
 
         if (!this->buffering) {
+          if (this->live)
+            nbc_live_adjust (this, nbc_buffered (this, has_video, has_audio));
           /* start buffering if one fifo is empty
            */
-          int has_video = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_VIDEO);
-          int has_audio = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_AUDIO);
           if (((this->video_fifo_length == 0) && has_video) ||
               ((this->audio_fifo_length == 0) && has_audio)) {
             /* do not pause if a fifo is full to avoid yoyo (play-pause-play-pause) */
@@ -683,6 +881,7 @@ static void nbc_get_cb (fifo_buffer_t *fifo,
               xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
                       "\nnet_buf_ctrl: nbc_get_cb: starts buffering, vid: %d, aud: %d\n",
                       this->video_fifo_fill, this->audio_fifo_fill);
+              nbc_start_buffering (this);
               pause = 1;
             }
           }
@@ -693,6 +892,7 @@ static void nbc_get_cb (fifo_buffer_t *fifo,
         if(this->stream->xine->verbosity >= XINE_VERBOSITY_DEBUG)
           display_stats(this);
 
+        nbc_health (this, nbc_buffered (this, has_video, has_audio));
         report_stats(this, 1);
       }
     }
@@ -761,6 +961,18 @@ nbc_t *nbc_init (xine_stream_t *stream) {
     this->high_water_mark = (double)DEFAULT_HIGH_WATER_MARK * video_fifo_factor;
   else
     this->high_water_mark = (double)DEFAULT_HIGH_WATER_MARK * audio_fifo_factor;
+  this->low_water_mark = DEFAULT_LOW_WATER_MARK;
+  if (this->low_water_mark > this->high_water_mark)
+    this->low_water_mark = this->high_water_mark;
+  this->start_mark = this->high_water_mark;
+
+  this->low_latency = stream->xine->config->register_bool (stream->xine->config,
+    "media.network.low_latency", 0,
+    _("Low latency live streams"),
+    _("Keep little data buffered on live network streams, and play slightly slower "
+      "or faster to follow the sender instead of pausing to refill the buffer. "
+      "Streams with audio need audio.synchronization.slow_fast_audio for this."),
+    20, NULL, NULL);
 
   video_fifo->register_alloc_cb(video_fifo, nbc_alloc_cb, this);
   video_fifo->register_put_cb(video_fifo, nbc_put_cb, this);
@@ -773,6 +985,20 @@ nbc_t *nbc_init (xine_stream_t *stream) {
   return this;
 }
 
+int nbc_get_fifo_length (nbc_t *this) {
+  int64_t length;
+  int has_video, has_audio;
+
+  has_video = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_VIDEO);
+  has_audio = _x_stream_info_get(this->stream, XINE_STREAM_INFO_HAS_AUDIO);
+
+  pthread_mutex_lock(&this->mutex);
+  length = nbc_buffered (this, has_video, has_audio);
+  pthread_mutex_unlock(&this->mutex);
+
+  return (length > 0) ? (int)length : 0;
+}
+
 void nbc_close (nbc_t *this) {
   fifo_buffer_t *video_fifo = this->stream->video_fifo;
   fifo_buffer_t *audio_fifo = this->stream->audio_fifo;
@@ -792,6 +1018,7 @@ void nbc_close (nbc_t *this) {
 
   /* now we are sure that nobody will call a callback */
   this->stream->xine->clock->set_option (this->stream->xine->clock, CLOCK_SCR_ADJUSTABLE, 1);
+  nbc_live_close (this);
 
   pthread_mutex_destroy(&this->mutex);
   free (this);
@@ -35,6 +35,12 @@ nbc_t *nbc_init (xine_stream_t *xine);
 
 void nbc_close (nbc_t *nbc);
 
+/*
+ * play time waiting in the decoder fifos in ms, the smaller one of
+ * audio and video when the stream has both. 0 while unknown.
+ */
+int nbc_get_fifo_length (nbc_t *nbc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,7 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
@@ -45,36 +46,129 @@
 #include "xine_tls_plugin.h"
 
 
+typedef struct {
+  char           *host;
+  int             verify;
+  unsigned int    used;
+  gnutls_datum_t  data;
+} gnutls_cached_session_t;
+
+typedef struct {
+  xine_module_class_t module_class;
+
+  pthread_mutex_t lock;
+
+  /* system trust store, loaded once */
+  gnutls_certificate_credentials_t cred;
+
+  unsigned int            session_seq;
+  gnutls_cached_session_t sessions[TLS_SESSION_CACHE_SIZE];
+} gnutls_class_t;
+
 typedef struct {
   tls_plugin_t tls_plugin;
 
-  xine_stream_t *stream;
-  xine_t        *xine;
+  gnutls_class_t *cls;
+  xine_stream_t  *stream;
+  xine_t         *xine;
 
   int fd;
+  int timeout;
+  int verify;
   int need_shutdown;
+  char *host;
 
   gnutls_session_t session;
-  gnutls_certificate_credentials_t cred;
 
 } tls_gnutls_t;
 
 /*
- * gnutls I/O callbacks
+ * session cache
  */
 
-static ssize_t gnutls_tcp_pull(gnutls_transport_ptr_t tp,
-                               void *buf, size_t len)
+static void _gnutls_save_session(tls_gnutls_t *this)
 {
-  tls_gnutls_t *this = (tls_gnutls_t *)tp;
-  return _x_io_tcp_read(this->stream, this->fd, buf, len);
+  gnutls_class_t          *cls = this->cls;
+  gnutls_cached_session_t *slot = NULL;
+  gnutls_datum_t           data;
+  int                      i;
+
+  if (!this->host || gnutls_session_get_data2(this->session, &data) < 0)
+    return;
+
+  pthread_mutex_lock(&cls->lock);
+  /* same server, or the least recently used entry */
+  for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+    gnutls_cached_session_t *s = &cls->sessions[i];
+    if (s->data.data && s->verify == this->verify && !strcasecmp(s->host, this->host)) {
+      slot = s;
+      break;
+    }
+    if (!slot || (slot->data.data && (!s->data.data || s->used < slot->used)))
+      slot = s;
+  }
+  gnutls_free(slot->data.data);
+  slot->data.data = NULL;
+  if (!slot->host || strcmp(slot->host, this->host)) {
+    free(slot->host);
+    slot->host = strdup(this->host);
+  }
+  if (slot->host) {
+    slot->data   = data;
+    slot->verify = this->verify;
+    slot->used   = ++cls->session_seq;
+  } else {
+    gnutls_free(data.data);
+  }
+  pthread_mutex_unlock(&cls->lock);
 }
 
-static ssize_t gnutls_tcp_push(gnutls_transport_ptr_t tp,
-                               const void *buf, size_t len)
+static void _gnutls_resume_session(tls_gnutls_t *this)
 {
-  tls_gnutls_t *this = (tls_gnutls_t *)tp;
-  return _x_io_tcp_write(this->stream, this->fd, buf, len);
+  gnutls_class_t *cls = this->cls;
+  int             i;
+
+  pthread_mutex_lock(&cls->lock);
+  for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+    gnutls_cached_session_t *s = &cls->sessions[i];
+    if (s->data.data && s->verify == this->verify && !strcasecmp(s->host, this->host)) {
+      gnutls_session_set_data(this->session, s->data.data, s->data.size);
+      s->used = ++cls->session_seq;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&cls->lock);
+}
+
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+/* TLS 1.3 tickets arrive after the handshake */
+static int _gnutls_ticket_hook(gnutls_session_t session, unsigned int htype,
+                               unsigned int when, unsigned int incoming, const gnutls_datum_t *msg)
+{
+  tls_gnutls_t *this = gnutls_session_get_ptr(session);
+
+  (void)htype;
+  (void)when;
+  (void)incoming;
+  (void)msg;
+
+  _gnutls_save_session(this);
+  return 0;
+}
+#endif
+
+/*
+ * the socket is non-blocking. Wait (abortable) for what gnutls asks for.
+ */
+static int _gnutls_wait(tls_gnutls_t *this)
+{
+  int state = gnutls_record_get_direction(this->session) ? XIO_WRITE_READY : XIO_READ_READY;
+
+  if (_x_io_select(this->stream, this->fd, state, this->timeout) != XIO_READY) {
+    errno = EIO;
+    return -1;
+  }
+  return 0;
 }
 
 /*
@@ -108,24 +202,42 @@ static ssize_t _gnutls_write(tls_plugin_t *this_gen, const void *buf, size_t len
   if (!this->session)
     return -1;
 
-  ret = gnutls_record_send(this->session, buf, len);
-  if (ret < 0)
+  while ((ret = gnutls_record_send(this->session, buf, len)) < 0) {
+    if ((ret == GNUTLS_E_AGAIN || ret == GNUTLS_E_INTERRUPTED) && _gnutls_wait(this) == 0)
+      continue;
     return handle_gnutls_error(this, ret);
+  }
   return ret;
 }
 
 static ssize_t _gnutls_read(tls_plugin_t *this_gen, void *buf, size_t len)
 {
   tls_gnutls_t *this = (tls_gnutls_t *)this_gen;
-  int ret;
+  size_t done = 0;
 
   if (!this->session)
     return -1;
 
-  ret = gnutls_record_recv(this->session, buf, len);
-  if (ret < 0)
+  /* take as many records as are already buffered, straight into buf */
+  while (done < len) {
+    int ret = gnutls_record_recv(this->session, (uint8_t *)buf + done, len - done);
+
+    if (ret > 0) {
+      done += ret;
+      if (!gnutls_record_check_pending(this->session))
+        break;
+      continue;
+    }
+    if (ret == 0)
+      break;
+    if (done)
+      break;
+    if ((ret == GNUTLS_E_AGAIN || ret == GNUTLS_E_INTERRUPTED) && _gnutls_wait(this) == 0)
+      continue;
     return handle_gnutls_error(this, ret);
-  return ret;
+  }
+
+  return done;
 }
 
 static void _gnutls_shutdown(tls_plugin_t *this_gen)
@@ -140,37 +252,69 @@ static void _gnutls_shutdown(tls_plugin_t *this_gen)
     gnutls_deinit(this->session);
     this->session = NULL;
   }
-  if (this->cred) {
-    gnutls_certificate_free_credentials(this->cred);
-    this->cred = NULL;
+  _x_freep(&this->host);
+}
+
+static gnutls_certificate_credentials_t _gnutls_get_cred(gnutls_class_t *cls)
+{
+  gnutls_certificate_credentials_t cred;
+
+  pthread_mutex_lock(&cls->lock);
+  if (!cls->cred) {
+    if (gnutls_certificate_allocate_credentials(&cls->cred) >= 0) {
+      gnutls_certificate_set_x509_system_trust(cls->cred);
+      gnutls_certificate_set_verify_flags(cls->cred, GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
+    } else {
+      cls->cred = NULL;
+    }
   }
+  cred = cls->cred;
+  pthread_mutex_unlock(&cls->lock);
+
+  return cred;
 }
 
 static int _gnutls_handshake(tls_plugin_t *this_gen, const char *host, int verify)
 {
   tls_gnutls_t *this = (tls_gnutls_t *)this_gen;
+  gnutls_certificate_credentials_t cred;
   int ret;
 
   _x_assert(this->session == NULL);
 
-  gnutls_init(&this->session, GNUTLS_CLIENT);
+  cred = _gnutls_get_cred(this->cls);
+  if (!cred)
+    return -1;
+
+  if (verify < 0 && this->xine)
+    verify = tls_get_verify_tls_cert(this->xine->config);
+  this->verify = !!verify;
+
+  gnutls_init(&this->session, GNUTLS_CLIENT | GNUTLS_NONBLOCK);
+  gnutls_session_set_ptr(this->session, this);
   if (host) {
     gnutls_server_name_set(this->session, GNUTLS_NAME_DNS, host, strlen(host));
+    this->host = strdup(host);
   }
 
-  gnutls_certificate_allocate_credentials(&this->cred);
-  gnutls_certificate_set_x509_system_trust(this->cred);
-  gnutls_certificate_set_verify_flags(this->cred, verify ? GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT : 0);
-  gnutls_credentials_set(this->session, GNUTLS_CRD_CERTIFICATE, this->cred);
+  gnutls_credentials_set(this->session, GNUTLS_CRD_CERTIFICATE, cred);
 
-  gnutls_transport_set_pull_function(this->session, gnutls_tcp_pull);
-  gnutls_transport_set_push_function(this->session, gnutls_tcp_push);
-  gnutls_transport_set_ptr(this->session, this);
+  /* plain socket i/o lets gnutls use kernel tls where the system enables it */
+  gnutls_transport_set_int(this->session, this->fd);
 
   gnutls_priority_set_direct(this->session, "NORMAL", NULL);
 
-  ret = gnutls_handshake(this->session);
-  if (ret) {
+  if (this->host) {
+    _gnutls_resume_session(this);
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+    gnutls_handshake_set_hook_function(this->session, GNUTLS_HANDSHAKE_NEW_SESSION_TICKET,
+                                       GNUTLS_HOOK_POST, _gnutls_ticket_hook);
+#endif
+  }
+
+  while ((ret = gnutls_handshake(this->session)) < 0) {
+    if (!gnutls_error_is_fatal(ret) && _gnutls_wait(this) == 0)
+      continue;
     xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
             "TLS handshake failed: %s (%d)\n",
             gnutls_strerror(ret), ret);
@@ -179,10 +323,8 @@ static int _gnutls_handshake(tls_plugin_t *this_gen, const char *host, int verif
 
   this->need_shutdown = 1;
 
-  if (verify < 0 && this->xine)
-    verify = tls_get_verify_tls_cert(this->xine->config);
-
-  if (verify) {
+  /* a resumed session was checked when it was established */
+  if (this->verify && !gnutls_session_is_resumed(this->session)) {
     unsigned int status;
     if ((ret = gnutls_certificate_verify_peers2(this->session, &status)) < 0) {
       xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
@@ -218,7 +360,12 @@ static int _gnutls_handshake(tls_plugin_t *this_gen, const char *host, int verif
     }
   }
 
-  return 0;
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+  if (gnutls_protocol_get_version(this->session) != GNUTLS_TLS1_3)
+#endif
+    _gnutls_save_session(this);
+
+  return gnutls_session_is_resumed(this->session) ? 1 : 0;
 }
 
 static void _gnutls_dispose(xine_module_t *this_gen)
@@ -230,14 +377,18 @@ static void _gnutls_dispose(xine_module_t *this_gen)
   free(this_gen);
 }
 
+static void _gnutls_set_stream(tls_plugin_t *this_gen, xine_stream_t *stream)
+{
+  tls_gnutls_t *this = (tls_gnutls_t *)this_gen;
+  this->stream = stream;
+}
+
 static xine_module_t *gnutls_get_instance(xine_module_class_t *cls_gen, const void *params_gen)
 {
   const tls_plugin_params_t *p = params_gen;
   tls_gnutls_t *this;
   int ret;
 
-  (void)cls_gen;
-
   ret = gnutls_global_init();
   if (ret) {
     xprintf(p->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
@@ -258,29 +409,62 @@ static xine_module_t *gnutls_get_instance(xine_module_class_t *cls_gen, const vo
   this->tls_plugin.shutdown  = _gnutls_shutdown;
   this->tls_plugin.read      = _gnutls_read;
   this->tls_plugin.write     = _gnutls_write;
+  this->tls_plugin.set_stream = _gnutls_set_stream;
 
+  this->cls    = (gnutls_class_t *)cls_gen;
   this->xine   = p->xine;
   this->fd     = p->fd;
   this->stream = p->stream;
 
+  this->timeout = p->xine ? tls_get_timeout(p->xine->config) : 30000;
+
   return &this->tls_plugin.module;
 }
 
+static void gnutls_class_dispose(xine_module_class_t *cls_gen)
+{
+  gnutls_class_t *cls = (gnutls_class_t *)cls_gen;
+  int i;
+
+  for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+    gnutls_free(cls->sessions[i].data.data);
+    free(cls->sessions[i].host);
+  }
+  if (cls->cred)
+    gnutls_certificate_free_credentials(cls->cred);
+
+  gnutls_global_deinit();
+
+  pthread_mutex_destroy(&cls->lock);
+  free(cls);
+}
+
 static void *gnutls_init_class(xine_t *xine, const void *data)
 {
-  static const xine_module_class_t tls_gnutls_class = {
-    .get_instance      = gnutls_get_instance,
-    .description       = N_("TLS provider (gnutls)"),
-    .identifier        = "gnutls",
-    .dispose           = NULL,
-  };
-
-  (void)xine;
+  gnutls_class_t *this;
+
   (void)data;
 
+  /* keep the library up while the class holds credentials */
+  if (gnutls_global_init())
+    return NULL;
+
+  this = calloc(1, sizeof(*this));
+  if (!this) {
+    gnutls_global_deinit();
+    return NULL;
+  }
+
+  this->module_class.get_instance      = gnutls_get_instance;
+  this->module_class.description       = N_("TLS provider (gnutls)");
+  this->module_class.identifier        = "gnutls";
+  this->module_class.dispose           = gnutls_class_dispose;
+
+  pthread_mutex_init(&this->lock, NULL);
+
   tls_register_config_keys(xine->config);
 
-  return (void *)&tls_gnutls_class;
+  return this;
 }
 
 /*
@@ -289,7 +473,7 @@ static void *gnutls_init_class(xine_t *xine, const void *data)
 
 static const xine_module_info_t module_info_gnutls = {
   .priority = 10,
-  .type     = "tls_v1",
+  .type     = TLS_PLUGIN_TYPE,
 };
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
@@ -30,6 +30,7 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <errno.h>
 
 #include <openssl/bio.h>
 #include <openssl/ssl.h>
@@ -45,125 +46,158 @@
 
 #include "xine_tls_plugin.h"
 
+#define TLS_KTLS_KEY "media.network.tls_kernel_offload"
+
+typedef struct {
+  char           *host;
+  int             verify;
+  unsigned int    used;
+  SSL_SESSION    *session;
+} openssl_session_t;
+
+typedef struct {
+  xine_module_class_t module_class;
+
+  xine_t         *xine;
+
+  pthread_mutex_t lock;
+  int             inited;
+
+  /* shared by all connections: without / with certificate verification */
+  SSL_CTX        *ctx[2];
+
+  unsigned int      session_seq;
+  openssl_session_t sessions[TLS_SESSION_CACHE_SIZE];
+} openssl_class_t;
 
 typedef struct {
   tls_plugin_t tls_plugin;
 
-  xine_stream_t *stream;
-  xine_t        *xine;
+  openssl_class_t *cls;
+  xine_stream_t   *stream;
+  xine_t          *xine;
 
   int            fd;
+  int            timeout;
+  int            verify;
+  char          *host;
 
-  SSL_CTX       *ctx;
   SSL           *ssl;
-#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
-  BIO_METHOD    *bio_method;
-#endif
 
 } tls_openssl_t;
 
-typedef struct {
-  xine_module_class_t module_class;
-
-  pthread_mutex_t lock;
-  int             inited;
-} openssl_class_t;
-
 /*
- * openssl I/O callbacks
+ * session cache.
+ * With TLS 1.3, tickets arrive after the handshake, so they are collected
+ * from the new session callback instead of after SSL_connect().
  */
 
-static int _bio_read(BIO *b, char *buf, int len)
+static int _openssl_new_session(SSL *ssl, SSL_SESSION *session)
 {
-#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
-  tls_openssl_t *this = BIO_get_data(b);
-#else
-  tls_openssl_t *this = b->ptr;
-#endif
-  return _x_io_tcp_read(this->stream, this->fd, buf, len);
-}
+  tls_openssl_t     *this = SSL_get_app_data(ssl);
+  openssl_class_t   *cls;
+  openssl_session_t *slot = NULL;
+  int                i;
 
-static int _bio_write(BIO *b, const char *buf, int len)
-{
-#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
-  tls_openssl_t *this = BIO_get_data(b);
-#else
-  tls_openssl_t *this = b->ptr;
-#endif
-  return _x_io_tcp_write(this->stream, this->fd, buf, len);
-}
+  if (!this || !this->host)
+    return 0;
+  cls = this->cls;
 
-static int _bio_puts(BIO *b, const char *str)
-{
-  return _bio_write(b, str, strlen(str));
+  pthread_mutex_lock(&cls->lock);
+  /* same server, or the least recently used entry */
+  for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+    openssl_session_t *s = &cls->sessions[i];
+    if (s->session && s->verify == this->verify && !strcasecmp(s->host, this->host)) {
+      slot = s;
+      break;
+    }
+    if (!slot || (slot->session && (!s->session || s->used < slot->used)))
+      slot = s;
+  }
+  if (slot->session) {
+    SSL_SESSION_free(slot->session);
+    slot->session = NULL;
+  }
+  if (!slot->host || strcmp(slot->host, this->host)) {
+    free(slot->host);
+    slot->host = strdup(this->host);
+    if (!slot->host) {
+      pthread_mutex_unlock(&cls->lock);
+      return 0;
+    }
+  }
+  slot->session = session;
+  slot->verify  = this->verify;
+  slot->used    = ++cls->session_seq;
+  pthread_mutex_unlock(&cls->lock);
+
+  /* we keep the reference */
+  return 1;
 }
 
-static long _bio_ctrl(BIO *b, int cmd, long num, void *ptr)
+static void _openssl_resume_session(tls_openssl_t *this)
 {
-  (void)b;
-  (void)num;
-  (void)ptr;
+  openssl_class_t *cls = this->cls;
+  int              i;
 
-  if (cmd == BIO_CTRL_FLUSH)
-    return 1;
-  return 0;
+  pthread_mutex_lock(&cls->lock);
+  for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+    openssl_session_t *s = &cls->sessions[i];
+    if (s->session && s->verify == this->verify && !strcasecmp(s->host, this->host)) {
+      SSL_set_session(this->ssl, s->session);
+      s->used = ++cls->session_seq;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&cls->lock);
 }
 
-static int _bio_create(BIO *b)
+static SSL_CTX *_openssl_get_ctx(openssl_class_t *cls, int verify)
 {
-#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
-  BIO_set_init(b, 1);
-  BIO_set_app_data(b, NULL);
-  BIO_set_flags(b, 0);
-#else
-  b->init  = 1;
-  b->ptr   = NULL;
-  b->flags = 0;
-#endif
-  return 1;
-}
+  SSL_CTX *ctx;
 
-static int _bio_destroy(BIO *b)
-{
-  (void)b;
-  return 1;
+  pthread_mutex_lock(&cls->lock);
+
+  ctx = cls->ctx[!!verify];
+  if (!ctx) {
+    ctx = SSL_CTX_new(SSLv23_client_method());
+    if (!ctx) {
+      xprintf(cls->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
+              "SSL context init failed: %s\n",
+              ERR_error_string(ERR_get_error(), NULL));
+    } else {
+      /* disable deprecated and insecure SSLv2 and SSLv3 */
+      SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+
+      if (verify) {
+        SSL_CTX_set_default_verify_paths(ctx);
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+      }
+
+      SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+      SSL_CTX_sess_set_new_cb(ctx, _openssl_new_session);
+
+      cls->ctx[!!verify] = ctx;
+    }
+  }
+
+  pthread_mutex_unlock(&cls->lock);
+
+  return ctx;
 }
 
-static BIO *_bio_new(tls_openssl_t *this)
+/*
+ * the socket is non-blocking. Wait (abortable) for what openssl asks for.
+ */
+static int _openssl_wait(tls_openssl_t *this, int err)
 {
-  BIO *b;
-
-#if OPENSSL_VERSION_NUMBER < 0x1010000fL
-  static BIO_METHOD bio_method = {
-    .type    = BIO_TYPE_SOURCE_SINK,
-    .name    = "xine bio",
-    .bwrite  = _bio_write,
-    .bread   = _bio_read,
-    .bputs   = _bio_puts,
-    .bgets   = NULL,
-    .ctrl    = _bio_ctrl,
-    .create  = _bio_create,
-    .destroy = _bio_destroy,
-  };
-
-  b = BIO_new(&bio_method);
-  b->ptr = this;
-#else
-  _x_assert(this->bio_method == NULL);
-
-  this->bio_method = BIO_meth_new(BIO_TYPE_SOURCE_SINK, "xine bio");
-  BIO_meth_set_write  (this->bio_method, _bio_write);
-  BIO_meth_set_read   (this->bio_method, _bio_read);
-  BIO_meth_set_puts   (this->bio_method, _bio_puts);
-  BIO_meth_set_ctrl   (this->bio_method, _bio_ctrl);
-  BIO_meth_set_create (this->bio_method, _bio_create);
-  BIO_meth_set_destroy(this->bio_method, _bio_destroy);
-
-  b = BIO_new(this->bio_method);
-  BIO_set_data(b, this);
-#endif
+  int state = (err == SSL_ERROR_WANT_WRITE) ? XIO_WRITE_READY : XIO_READ_READY;
 
-  return b;
+  if (_x_io_select(this->stream, this->fd, state, this->timeout) != XIO_READY) {
+    errno = EIO;
+    return -1;
+  }
+  return 0;
 }
 
 /*
@@ -178,28 +212,65 @@ static ssize_t _openssl_write(tls_plugin_t *this_gen, const void *buf, size_t le
   if (!this->ssl)
     return -1;
 
-  ret = SSL_write(this->ssl, buf, len);
-  if (ret < 0)
+  while ((ret = SSL_write(this->ssl, buf, len)) <= 0) {
+    int err = SSL_get_error(this->ssl, ret);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+      if (_openssl_wait(this, err) < 0)
+        return -1;
+      continue;
+    }
     xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
             "OpenSSL write failed: %s\n",
             ERR_error_string(ERR_get_error(), NULL));
+    return -1;
+  }
   return ret;
 }
 
 static ssize_t _openssl_read(tls_plugin_t *this_gen, void *buf, size_t len)
 {
   tls_openssl_t *this = (tls_openssl_t *)this_gen;
-  int ret;
+  size_t done = 0;
 
   if (!this->ssl)
     return -1;
 
-  ret = SSL_read(this->ssl, buf, len);
-  if (ret < 0)
-    xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
-            "OpenSSL read failed: %s\n",
-            ERR_error_string(ERR_get_error(), NULL));
-  return ret;
+  /* take as many records as are already buffered, straight into buf */
+  while (done < len) {
+    int ret = SSL_read(this->ssl, (uint8_t *)buf + done, len - done);
+
+    if (ret > 0) {
+      done += ret;
+#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
+      if (!SSL_has_pending(this->ssl))
+#else
+      if (!SSL_pending(this->ssl))
+#endif
+        break;
+      continue;
+    }
+
+    switch (SSL_get_error(this->ssl, ret)) {
+      case SSL_ERROR_WANT_READ:
+      case SSL_ERROR_WANT_WRITE:
+        if (done)
+          return done;
+        if (_openssl_wait(this, SSL_get_error(this->ssl, ret)) < 0)
+          return -1;
+        continue;
+      case SSL_ERROR_ZERO_RETURN:
+        return done;
+      default:
+        if (done)
+          return done;
+        xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
+                "OpenSSL read failed: %s\n",
+                ERR_error_string(ERR_get_error(), NULL));
+        return -1;
+    }
+  }
+
+  return done;
 }
 
 static void _openssl_shutdown(tls_plugin_t *this_gen)
@@ -211,43 +282,26 @@ static void _openssl_shutdown(tls_plugin_t *this_gen)
     SSL_free(this->ssl);
     this->ssl = NULL;
   }
-  if (this->ctx) {
-    SSL_CTX_free(this->ctx);
-    this->ctx = NULL;
-  }
-#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
-  if (this->bio_method) {
-    BIO_method_free(this->bio_method);
-    this->bio_method = NULL;
-  }
-#endif
+  _x_freep(&this->host);
 }
 
 static int _openssl_handshake(tls_plugin_t *this_gen, const char *host, int verify)
 {
   tls_openssl_t *this = (tls_openssl_t *)this_gen;
-  BIO *bio;
+  SSL_CTX *ctx;
   int ret;
 
   _x_assert(this->ssl == NULL);
 
-  this->ctx = SSL_CTX_new(SSLv23_client_method());
-  if (!this->ctx) {
-    xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
-            "SSL context init failed: %s\n",
-            ERR_error_string(ERR_get_error(), NULL));
-    return -1;
-  }
-  /* disable deprecated and insecure SSLv2 and SSLv3 */
-  SSL_CTX_set_options(this->ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
-
-
   if (verify < 0 && this->xine)
     verify = tls_get_verify_tls_cert(this->xine->config);
-  if (verify)
-    SSL_CTX_set_verify(this->ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+  this->verify = !!verify;
+
+  ctx = _openssl_get_ctx(this->cls, this->verify);
+  if (!ctx)
+    return -1;
 
-  this->ssl = SSL_new(this->ctx);
+  this->ssl = SSL_new(ctx);
   if (!this->ssl) {
     xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
             "SSL init failed: %s\n",
@@ -256,13 +310,32 @@ static int _openssl_handshake(tls_plugin_t *this_gen, const char *host, int veri
     return -1;
   }
 
-  bio = _bio_new(this);
-  SSL_set_bio(this->ssl, bio, bio);
+  SSL_set_app_data(this->ssl, this);
+  SSL_set_fd(this->ssl, this->fd);
 
-  SSL_set_tlsext_host_name(this->ssl, host);
+#ifdef SSL_OP_ENABLE_KTLS
+  if (this->xine) {
+    cfg_entry_t *entry = this->xine->config->lookup_entry(this->xine->config, TLS_KTLS_KEY);
+    if (entry && entry->num_value)
+      SSL_set_options(this->ssl, SSL_OP_ENABLE_KTLS);
+  }
+  /* kernel tls wants the records one by one */
+  if (!(SSL_get_options(this->ssl) & SSL_OP_ENABLE_KTLS))
+#endif
+    SSL_set_read_ahead(this->ssl, 1);
 
-  ret = SSL_connect(this->ssl);
-  if (ret <= 0) {
+  if (host) {
+    SSL_set_tlsext_host_name(this->ssl, host);
+    this->host = strdup(host);
+    if (this->host)
+      _openssl_resume_session(this);
+  }
+
+  while ((ret = SSL_connect(this->ssl)) <= 0) {
+    int err = SSL_get_error(this->ssl, ret);
+    if ((err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) &&
+        _openssl_wait(this, err) == 0)
+      continue;
     if (ret == 0)
       xprintf(this->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
               "Unable to negotiate TLS/SSL session\n");
@@ -274,7 +347,13 @@ static int _openssl_handshake(tls_plugin_t *this_gen, const char *host, int veri
     return -1;
   }
 
-  return 0;
+#ifdef SSL_OP_ENABLE_KTLS
+  xprintf(this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": "
+          "kernel tls send %d, receive %d\n",
+          (int)BIO_get_ktls_send(SSL_get_wbio(this->ssl)), (int)BIO_get_ktls_recv(SSL_get_rbio(this->ssl)));
+#endif
+
+  return SSL_session_reused(this->ssl) ? 1 : 0;
 }
 
 static void _openssl_dispose(xine_module_t *this_gen)
@@ -283,6 +362,12 @@ static void _openssl_dispose(xine_module_t *this_gen)
   free(this_gen);
 }
 
+static void _openssl_set_stream(tls_plugin_t *this_gen, xine_stream_t *stream)
+{
+  tls_openssl_t *this = (tls_openssl_t *)this_gen;
+  this->stream = stream;
+}
+
 static xine_module_t *_openssl_get_instance(xine_module_class_t *cls_gen, const void *params_gen)
 {
   openssl_class_t *cls = (openssl_class_t *)cls_gen;
@@ -308,17 +393,33 @@ static xine_module_t *_openssl_get_instance(xine_module_class_t *cls_gen, const
   this->tls_plugin.shutdown  = _openssl_shutdown;
   this->tls_plugin.read      = _openssl_read;
   this->tls_plugin.write     = _openssl_write;
+  this->tls_plugin.set_stream = _openssl_set_stream;
 
+  this->cls    = cls;
   this->xine   = p->xine;
   this->fd     = p->fd;
   this->stream = p->stream;
 
+  this->timeout = p->xine ? tls_get_timeout(p->xine->config) : 30000;
+
   return &this->tls_plugin.module;
 }
 
 static void _openssl_class_dispose(xine_module_class_t *cls_gen)
 {
   openssl_class_t *cls = (openssl_class_t *)cls_gen;
+  int i;
+
+  for (i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+    if (cls->sessions[i].session)
+      SSL_SESSION_free(cls->sessions[i].session);
+    free(cls->sessions[i].host);
+  }
+  for (i = 0; i < 2; i++) {
+    if (cls->ctx[i])
+      SSL_CTX_free(cls->ctx[i]);
+  }
+
   pthread_mutex_destroy(&cls->lock);
   free(cls_gen);
 }
@@ -338,10 +439,22 @@ static void *_openssl_init_class(xine_t *xine, const void *data)
   this->module_class.identifier        = "openssl";
   this->module_class.dispose           = _openssl_class_dispose;
 
+  this->xine = xine;
+
   pthread_mutex_init(&this->lock, NULL);
 
   tls_register_config_keys(xine->config);
 
+#ifdef SSL_OP_ENABLE_KTLS
+  xine->config->register_bool(xine->config,
+                              TLS_KTLS_KEY,
+                              0, _("Let the kernel encrypt TLS connections"),
+                              _("Hand TLS record processing over to the operating system "
+                                "(kTLS) when both the kernel and OpenSSL support it. "
+                                "This saves a copy of all received data."),
+                              20, NULL, NULL);
+#endif
+
   return this;
 }
 
@@ -351,7 +464,7 @@ static void *_openssl_init_class(xine_t *xine, const void *data)
 
 static const xine_module_info_t module_info_openssl = {
   .priority = 5,
-  .type     = "tls_v1",
+  .type     = TLS_PLUGIN_TYPE,
 };
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
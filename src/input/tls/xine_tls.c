@@ -29,6 +29,7 @@
 #include "xine_tls.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include <xine/xine_internal.h>
@@ -46,6 +47,10 @@ struct xine_tls {
   tls_plugin_t *tls;
 
   int enabled;
+
+  /* decrypted data read ahead by _x_tls_read_line() */
+  int  rpos, rlen;
+  char rbuf[2048];
 };
 
 /*
@@ -54,7 +59,7 @@ struct xine_tls {
 
 static inline tls_plugin_t *_x_find_tls_plugin(xine_t *xine, tls_plugin_params_t *params)
 {
-  return (tls_plugin_t *)_x_find_module(xine, "tls_v1", NULL, 0, params);
+  return (tls_plugin_t *)_x_find_module(xine, TLS_PLUGIN_TYPE, NULL, 0, params);
 }
 
 static inline void _x_free_tls_plugin(xine_t *xine, tls_plugin_t **tls)
@@ -77,25 +82,66 @@ ssize_t _x_tls_write(xine_tls_t *t, const void *buf, size_t len)
 
 ssize_t _x_tls_read(xine_tls_t *t, void *buf, size_t len)
 {
-  if (t->tls && t->enabled)
-    return t->tls->read(t->tls, buf, len);
+  if (t->tls && t->enabled) {
+    size_t done = 0;
+
+    if (t->rpos < t->rlen) {
+      done = t->rlen - t->rpos;
+      if (done > len)
+        done = len;
+      memcpy(buf, t->rbuf + t->rpos, done);
+      t->rpos += done;
+    }
+
+    /* like _x_io_tcp_read(): fill the whole buffer, several records at a time */
+    while (done < len) {
+      ssize_t r = t->tls->read(t->tls, (char *)buf + done, len - done);
+      if (r <= 0)
+        return done ? (ssize_t)done : r;
+      done += r;
+    }
+    return done;
+  }
 
   return _x_io_tcp_read(t->stream, t->fd, buf, len);
 }
 
 ssize_t _x_tls_read_line(xine_tls_t *t, char *buf, size_t buf_size)
 {
-  if (t->enabled) {
+  if (t->tls && t->enabled) {
     unsigned int i = 0;
-    ssize_t r;
-    char c;
+    int cr = 0;
 
     if (buf_size <= 0)
       return 0;
 
-    while ((r = _x_tls_read(t, &c, 1)) == 1) {
-      if (c == '\r' || c == '\n')
+    while (1) {
+      char c;
+
+      if (t->rpos >= t->rlen) {
+        ssize_t r = t->tls->read(t->tls, t->rbuf, sizeof(t->rbuf));
+        if (r <= 0) {
+          buf[i] = '\0';
+          return (r < 0) ? r : (ssize_t)i;
+        }
+        t->rpos = 0;
+        t->rlen = r;
+      }
+
+      c = t->rbuf[t->rpos];
+      if (cr) {
+        /* swallow the \n of \r\n */
+        if (c == '\n')
+          t->rpos++;
+        break;
+      }
+      t->rpos++;
+      if (c == '\n')
         break;
+      if (c == '\r') {
+        cr = 1;
+        continue;
+      }
       if (i+1 == buf_size)
         break;
 
@@ -103,12 +149,9 @@ ssize_t _x_tls_read_line(xine_tls_t *t, char *buf, size_t buf_size)
       i++;
     }
 
-    if (r == 1 && c == '\r')
-      r = _x_tls_read(t, &c, 1);
-
     buf[i] = '\0';
 
-    return (r >= 0) ? (ssize_t)i : r;
+    return i;
   }
 
   return _x_io_tcp_read_line(t->stream, t->fd, buf, buf_size);
@@ -125,6 +168,7 @@ void _x_tls_shutdown(xine_tls_t *t)
     return;
 
   t->enabled = 0;
+  t->rpos = t->rlen = 0;
 
   if (t->tls)
     t->tls->shutdown(t->tls);
@@ -149,6 +193,18 @@ void _x_tls_close(xine_tls_t **pt)
   }
 }
 
+void _x_tls_set_stream(xine_tls_t *t, xine_stream_t *stream)
+{
+  t->stream = stream;
+  if (t->tls && t->tls->set_stream)
+    t->tls->set_stream(t->tls, stream);
+}
+
+int _x_tls_get_fd(xine_tls_t *t)
+{
+  return t->fd;
+}
+
 xine_tls_t *_x_tls_init(xine_t *xine, xine_stream_t *stream, int fd)
 {
   xine_tls_t *t;
@@ -206,6 +262,13 @@ int _x_tls_handshake(xine_tls_t *t, const char *host, int verify)
   if (ret < 0)
     return ret;
 
+  if (t->stream) {
+    int info = ret ? XINE_STREAM_INFO_NET_TLS_RESUMED : XINE_STREAM_INFO_NET_TLS_HANDSHAKES;
+    _x_stream_info_set(t->stream, info, _x_stream_info_get(t->stream, info) + 1);
+  }
+  xprintf(t->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": %s %s\n",
+          ret ? "resumed session with" : "full handshake with", host ? host : "server");
+
   t->enabled = 1;
   return 0;
 }
@@ -45,6 +45,10 @@ int _x_tls_available(xine_t *xine);
 xine_tls_t *_x_tls_connect(xine_t *xine, xine_stream_t *stream, const char *host, int port);
 xine_tls_t *_x_tls_init(xine_t *xine, xine_stream_t *stream, int fd);
 void        _x_tls_close(xine_tls_t **);  /* note: associated socket is also closed */
+/* hand an open connection over to another stream (or NULL while unused) */
+void        _x_tls_set_stream(xine_tls_t *, xine_stream_t *);
+/* underlying socket, eg. to shutdown() it from another thread */
+int         _x_tls_get_fd(xine_tls_t *);
 
 ssize_t _x_tls_read(xine_tls_t *, void *data, size_t len);
 ssize_t _x_tls_write(xine_tls_t *, const void *data, size_t len);
@@ -28,7 +28,10 @@
 
 #include <xine/xine_module.h>
 
-#define TLS_PLUGIN_TYPE "tls_v1"
+#define TLS_PLUGIN_TYPE "tls_v2"
+
+/* resumable sessions kept per provider class (and thus per xine instance) */
+#define TLS_SESSION_CACHE_SIZE 8
 
 typedef struct {
   xine_t        *xine;
@@ -41,11 +44,16 @@ typedef struct tls_plugin_s tls_plugin_t;
 struct tls_plugin_s {
   xine_module_t module;
 
+  /* returns < 0 on error, 0 after a full handshake, 1 when a cached session was resumed */
   int     (*handshake)(tls_plugin_t *, const char *host, int verify);
   void    (*shutdown)(tls_plugin_t *);
 
+  /* returns what is available (at least 1 byte), 0 at end of stream or -1 on error */
   ssize_t (*read)(tls_plugin_t *, void *buf, size_t len);
   ssize_t (*write)(tls_plugin_t *, const void *buf, size_t len);
+
+  /* move a connection to another stream (or none), may be NULL */
+  void    (*set_stream)(tls_plugin_t *, xine_stream_t *);
 };
 
 /*
@@ -77,4 +85,15 @@ static inline int tls_get_verify_tls_cert(config_values_t *config)
   return 1;
 }
 
+static inline int tls_get_timeout(config_values_t *config)
+{
+  cfg_entry_t *entry;
+
+  entry = config->lookup_entry(config, "media.network.timeout");
+  if (entry) {
+    return entry->num_value * 1000;
+  }
+  return 30000;
+}
+
 #endif /* _XINE_TLS_PLUGIN_H_ */
@@ -25,21 +25,17 @@
 #endif
 
 #include <stdio.h>
+#include <math.h>
 #include <pthread.h>
 
 #include <xine/xine_internal.h>
 #include <xine/xineutils.h>
 #include <xine/post.h>
-#include "dsp.h"
-#include <xine/resample.h>
 
 #include "audio_filters.h"
 
 #define AUDIO_FRAGMENT  120/1000  /* ms of audio */
 
-#define CLIP_INT16(s) ((s) < INT16_MIN) ? INT16_MIN : \
-                      (((s) > INT16_MAX) ? INT16_MAX : (s))
-
 /*
  * ***************************************************
  * stretchable unix System Clock Reference
@@ -184,6 +180,9 @@ static stretchscr_t *XINE_MALLOC stretchscr_init (double *stretch_factor) {
 
 /*****************************************************/
 
+#define STRETCH_MAX_CHANNELS  8
+#define STRETCH_HOP_MS       12   /* output hop, half a WSOLA segment */
+#define STRETCH_SEEK_MS       8   /* segment position search range, +- */
 
 typedef struct post_plugin_stretch_s post_plugin_stretch_t;
 
@@ -198,7 +197,7 @@ typedef struct stretch_parameters_s {
 START_PARAM_DESCR( stretch_parameters_t )
 PARAM_ITEM( POST_PARAM_TYPE_BOOL, preserve_pitch, NULL, 0, 1, 0,
             "Preserve pitch" )
-PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, factor, NULL, 0.5, 1.5, 0,
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, factor, NULL, 0.33, 2.0, 0,
             "Time stretch factor (<1.0 shorten duration)" )
 END_PARAM_DESCR( param_descr )
 
@@ -214,17 +213,41 @@ struct post_plugin_stretch_s {
 
   int                  channels;
   int                  bytes_per_frame;
-
-  int16_t             *audiofrag;         /* audio fragment to work on */
-  int16_t             *outfrag;           /* processed audio fragment  */
-  _ftype_t            *w;
-  int                  frames_per_frag;
-  int                  frames_per_outfrag;
-  int                  num_frames;        /* current # of frames on audiofrag */
-
-  int16_t             last_sample[RESAMPLE_MAX_CHANNELS];
-
-  int64_t              pts;               /* pts for audiofrag */
+  int                  active;            /* 0: pass buffers through */
+  int                  wsola;             /* preserve_pitch when set up */
+
+  /* input history, interleaved, and the sum of its channels for the search */
+  float               *in;
+  float               *mono;
+  int                  in_size;
+  int                  in_frames;
+
+  /* processed audio waiting to be sent */
+  float               *outfrag;
+  int                  out_size;
+  int                  out_frames;
+  int64_t              out_pts;           /* pts for outfrag */
+
+  /*
+   * WSOLA: segments of 2 * hop frames are windowed and overlap-added every
+   * hop output frames. the nominal segment start advances by step input
+   * frames, the actual one is the best match within +- seek frames to the
+   * natural continuation of the previous segment.
+   * without pitch preservation, step is the linear resampler increment.
+   */
+  float               *w;
+  float               *ola;               /* windowed second half of last segment */
+  float               *scratch;
+  int                  hop;
+  int                  seek;
+  int                  cont;              /* where the last segment would go on, -1 if none */
+  double               pos;
+  double               step;
+
+  float              (*dot)(const float *a, const float *b, int n);
+
+  int64_t              pts;               /* pts for input frame pts_pos */
+  int                  pts_pos;
 
   pthread_mutex_t      lock;
 };
@@ -263,13 +286,131 @@ static char * get_help (void) {
            "stream faster or slower by a factor. Pitch is optionally "
            "preserved, so it is possible, for example, to use it to "
            "watch a movie in less time than it was originally shot.\n"
+           "Factors from 0.33 (3x speed) to 2.0 (half speed) are "
+           "supported, for up to 8 channels of 8 bit, 16 bit or float "
+           "audio.\n"
            );
 }
 
+/**************************************************************************
+ * correlation search
+ *************************************************************************/
+
+static float stretch_dot_c (const float *a, const float *b, int n) {
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  int i;
+
+  for (i = 0; i < n; i += 4) {
+    s0 += a[i] * b[i];
+    s1 += a[i + 1] * b[i + 1];
+    s2 += a[i + 2] * b[i + 2];
+    s3 += a[i + 3] * b[i + 3];
+  }
+  return (s0 + s2) + (s1 + s3);
+}
+
+#if defined(ARCH_X86)
+/* n > 0, multiple of 4 */
+static float stretch_dot_sse (const float *a, const float *b, int n) {
+  intptr_t i = -(intptr_t)n * (intptr_t)sizeof (float);
+  float r;
+
+  a += n;
+  b += n;
+  __asm__ __volatile__ (
+    "xorps    %%xmm0, %%xmm0\n\t"
+    "1:\n\t"
+    "movups   (%2,%1), %%xmm1\n\t"
+    "movups   (%3,%1), %%xmm2\n\t"
+    "mulps    %%xmm2, %%xmm1\n\t"
+    "addps    %%xmm1, %%xmm0\n\t"
+    "add      $16, %1\n\t"
+    "jnz      1b\n\t"
+    "movhlps  %%xmm0, %%xmm1\n\t"
+    "addps    %%xmm1, %%xmm0\n\t"
+    "movaps   %%xmm0, %%xmm1\n\t"
+    "shufps   $0x55, %%xmm1, %%xmm1\n\t"
+    "addss    %%xmm1, %%xmm0\n\t"
+    "movss    %%xmm0, %0\n\t"
+    : "=m" (r), "+r" (i)
+    : "r" (a), "r" (b)
+    : "memory", "xmm0", "xmm1", "xmm2");
+  return r;
+}
+#endif
+
+/* normalized cross correlation, sign preserved, without the sqrt */
+static float stretch_score (post_plugin_stretch_t *this, const float *x, const float *t, int n) {
+  float c = this->dot (x, t, n);
+  float e = this->dot (x, x, n);
+
+  return (e > 0.0f) ? c * fabsf (c) / e : 0.0f;
+}
+
+/*
+ * find the segment start near a that continues the last segment best.
+ * a coarse pass runs on the 4:1 decimated mono sum, the winner is then
+ * refined at full resolution.
+ */
+static int stretch_search (post_plugin_stretch_t *this, int a) {
+  const int len = this->hop, len4 = len / 4;
+  const float *t = this->mono + this->cont;
+  const float *c;
+  float *t4 = this->scratch, *c4 = this->scratch + len4;
+  float score, best_score;
+  int dmin = -this->seek, dmax = this->seek;
+  int n4, k, d, lo, hi, best;
+
+  if (a + dmin < 0)
+    dmin = -a;
+  c  = this->mono + a + dmin;
+  n4 = (dmax - dmin) / 4 + 1;
+
+  for (k = 0; k < len4; k++)
+    t4[k] = t[4 * k] + t[4 * k + 1] + t[4 * k + 2] + t[4 * k + 3];
+  for (k = 0; k < n4 + len4 - 1; k++)
+    c4[k] = c[4 * k] + c[4 * k + 1] + c[4 * k + 2] + c[4 * k + 3];
+
+  best = 0;
+  best_score = stretch_score (this, c4, t4, len4);
+  for (k = 1; k < n4; k++) {
+    score = stretch_score (this, c4 + k, t4, len4);
+    if (score > best_score) {
+      best_score = score;
+      best = k;
+    }
+  }
+
+  d  = dmin + 4 * best;
+  lo = (d - 3 < dmin) ? dmin : d - 3;
+  hi = (d + 3 > dmax) ? dmax : d + 3;
+  best = lo;
+  best_score = stretch_score (this, this->mono + a + lo, t, len);
+  for (d = lo + 1; d <= hi; d++) {
+    score = stretch_score (this, this->mono + a + d, t, len);
+    if (score > best_score) {
+      best_score = score;
+      best = d;
+    }
+  }
+
+  return best;
+}
+
 /**************************************************************************
  * xine audio post plugin functions
  *************************************************************************/
 
+static void stretch_free_buffers (post_plugin_stretch_t *this) {
+  _x_freep(&this->in);
+  _x_freep(&this->mono);
+  _x_freep(&this->outfrag);
+  _x_freep(&this->w);
+  _x_freep(&this->ola);
+  _x_freep(&this->scratch);
+  this->active = 0;
+}
+
 static int stretch_port_open(xine_audio_port_t *port_gen, xine_stream_t *stream,
 		   uint32_t bits, uint32_t rate, int mode) {
 
@@ -309,9 +450,7 @@ static void stretch_port_close(xine_audio_port_t *port_gen, xine_stream_t *strea
     this->scr->scr.exit(&this->scr->scr);
   }
 
-  _x_freep(&this->audiofrag);
-  _x_freep(&this->outfrag);
-  _x_freep(&this->w);
+  stretch_free_buffers(this);
 
   port->stream = NULL;
 
@@ -320,150 +459,45 @@ static void stretch_port_close(xine_audio_port_t *port_gen, xine_stream_t *strea
   _x_post_dec_usage(port);
 }
 
-static void stretch_process_fragment( post_audio_port_t *port,
+/* send outfrag, converted to the port sample format */
+static void stretch_flush( post_audio_port_t *port,
   xine_stream_t *stream, extra_info_t *extra_info )
 {
   post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
 
-  audio_buffer_t  *outbuf;
-  int16_t         *data_out = this->outfrag;
-  int num_frames_in = this->num_frames;
-  int num_frames_out = this->num_frames * this->frames_per_outfrag /
-                         this->frames_per_frag;
-
-  if( !this->params.preserve_pitch ) {
-     if( this->channels == 2 )
-       _x_audio_out_resample_stereo(this->last_sample, this->audiofrag, num_frames_in,
-                                    this->outfrag, num_frames_out);
-     else if( this->channels == 1 )
-        _x_audio_out_resample_mono(this->last_sample, this->audiofrag, num_frames_in,
-                                   this->outfrag, num_frames_out);
-  } else {
-     if (this->channels == 2)
-       memcpy (this->last_sample, &this->audiofrag[(num_frames_in - 1) * 2], 2 * sizeof (this->last_sample[0]));
-     else if (this->channels == 1)
-       memcpy (this->last_sample, &this->audiofrag[num_frames_in - 1], sizeof (this->last_sample[0]));
-     if( num_frames_in > num_frames_out )
-     {
-       /*
-        * time compressing strategy
-        *
-        * input chunk has two halves, A and B.
-        * output chunk is composed as follow:
-        * - some frames copied directly from A
-        * - some frames copied from A merged with frames from B
-        *   weighted by an increasing factor (0 -> 1.0)
-        * - frames from A weighted by a decreasing factor (1.0 -> 0)
-        *   merged with frames copied from B
-        * - some frames copied directly from B
-        */
-
-       int merge_frames = num_frames_in - num_frames_out;
-       int copy_frames;
-       int16_t *src = this->audiofrag;
-       int16_t *dst = this->outfrag;
-       int i, j;
-
-       if( merge_frames > num_frames_out )
-         merge_frames = num_frames_out;
-       copy_frames = num_frames_out - merge_frames;
-
-       memcpy(dst, src, copy_frames/2 * this->bytes_per_frame);
-       dst += copy_frames/2 * this->channels;
-       src += copy_frames/2 * this->channels;
-
-       for( i = 0; i < merge_frames/2; i++ )
-       {
-         for( j = 0; j < this->channels; j++, src++, dst++ ) {
-
-           int32_t  s = (int32_t) ((_ftype_t) src[0] +
-                                    src[merge_frames * this->channels] * this->w[i]);
-           *dst = CLIP_INT16(s);
-         }
-       }
-
-       for( ; i < merge_frames; i++ )
-       {
-         for( j = 0; j < this->channels; j++, src++, dst++ ) {
-
-           int32_t  s = (int32_t) ((_ftype_t) src[0] * this->w[i] +
-                                    src[merge_frames * this->channels]);
-           *dst = CLIP_INT16(s);
-         }
-       }
-
-       src += merge_frames * this->channels;
-
-       memcpy(dst, src, (copy_frames - copy_frames/2) *
-                        this->bytes_per_frame);
-
-     } else {
-       /*
-        * time expansion strategy
-        *
-        * output chunk is composed of two versions of the
-        * input chunk:
-        * - first part copied directly from input, and then
-        *   merged with the second (delayed) part using a
-        *   decreasing factor (1.0 -> 0)
-        * - the delayed version of the input is merged with
-        *   an increasing factor (0 -> 1.0) and then (when
-        *   factor reaches 1.0) just copied until the end.
-        */
-
-       int merge_frames = num_frames_out - num_frames_in;
-       int copy_frames = num_frames_out - merge_frames;
-       int16_t *src1 = this->audiofrag;
-       int16_t *src2;
-       int16_t *dst = this->outfrag;
-       int i, j;
-
-       memcpy(dst, src1, copy_frames/2 * this->bytes_per_frame);
-       dst += copy_frames/2 * this->channels;
-       src1 += copy_frames/2 * this->channels;
-       src2 = src1 - merge_frames * this->channels;
-
-       for( i = 0; i < merge_frames/2; i++ )
-       {
-         for( j = 0; j < this->channels; j++, src1++, src2++, dst++ ) {
-
-           int32_t  s = (int32_t) ((_ftype_t) *src1 +
-                                    *src2 * this->w[i]);
-           *dst = CLIP_INT16(s);
-         }
-       }
-
-       for( ; i < merge_frames; i++ )
-       {
-         for( j = 0; j < this->channels; j++, src1++, src2++, dst++ ) {
-
-           int32_t  s = (int32_t) ((_ftype_t) *src1 * this->w[i] +
-                                    *src2);
-           *dst = CLIP_INT16(s);
-         }
-       }
-
-       memcpy(dst, src2, (copy_frames - copy_frames/2) *
-                         this->bytes_per_frame);
-
-    }
-  }
+  const float     *src = this->outfrag;
+  int              num_frames_out = this->out_frames;
 
   /* copy processed fragment into multiple audio buffers, if needed */
   while( num_frames_out ) {
-    outbuf = port->original_port->get_buffer(port->original_port);
+    audio_buffer_t *outbuf = port->original_port->get_buffer(port->original_port);
+    int             num_samples, i;
 
     outbuf->num_frames = outbuf->mem_size / this->bytes_per_frame;
     if( outbuf->num_frames > num_frames_out )
       outbuf->num_frames = num_frames_out;
-
-    memcpy( outbuf->mem, data_out,
-            outbuf->num_frames * this->bytes_per_frame );
+    num_samples = outbuf->num_frames * this->channels;
+
+    if( port->bits == 8 ) {
+      uint8_t *dst = (uint8_t *)outbuf->mem;
+      for( i = 0; i < num_samples; i++ ) {
+        float s = src[i];
+        dst[i] = (s >= 127.0f) ? 255 : (s <= -128.0f) ? 0 : lrintf(s) + 128;
+      }
+    } else if( port->bits == 16 ) {
+      int16_t *dst = (int16_t *)outbuf->mem;
+      for( i = 0; i < num_samples; i++ ) {
+        float s = src[i];
+        dst[i] = (s >= 32767.0f) ? INT16_MAX : (s <= -32768.0f) ? INT16_MIN : lrintf(s);
+      }
+    } else {
+      memcpy( outbuf->mem, src, num_samples * sizeof(float) );
+    }
+    src += num_samples;
     num_frames_out -= outbuf->num_frames;
-    data_out = (uint16_t *)((uint8_t *)data_out + outbuf->num_frames * this->bytes_per_frame);
 
-    outbuf->vpts        = this->pts;
-    this->pts           = 0;
+    outbuf->vpts        = this->out_pts;
+    this->out_pts       = 0;
     outbuf->stream      = stream;
     outbuf->format.bits = port->bits;
     outbuf->format.rate = port->rate;
@@ -474,7 +508,212 @@ static void stretch_process_fragment( post_audio_port_t *port,
     port->original_port->put_buffer(port->original_port, outbuf, stream );
   }
 
-  this->num_frames = 0;
+  this->out_frames = 0;
+}
+
+/* make room for n more output frames */
+static void stretch_reserve( post_audio_port_t *port,
+  xine_stream_t *stream, extra_info_t *extra_info, int n )
+{
+  post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
+
+  if( this->out_frames + n > this->out_size )
+    stretch_flush( port, stream, extra_info );
+}
+
+/* output made from input frame p is about to go to outfrag */
+static void stretch_stamp( post_audio_port_t *port, int p )
+{
+  post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
+
+  if( this->pts && p >= this->pts_pos ) {
+    if( !this->out_pts )
+      this->out_pts = this->pts +
+        ((int64_t)(p - this->pts_pos) - this->out_frames) * 90000 / port->rate;
+    this->pts = 0;
+  }
+}
+
+/* drop input frames that are no longer needed */
+static void stretch_discard( post_plugin_stretch_t *this, int frames )
+{
+  if( frames <= 0 )
+    return;
+  if( frames > this->in_frames )
+    frames = this->in_frames;
+
+  this->in_frames -= frames;
+  memmove( this->in, this->in + frames * this->channels,
+           this->in_frames * this->channels * sizeof(float) );
+  memmove( this->mono, this->mono + frames, this->in_frames * sizeof(float) );
+
+  this->pos -= frames;
+  if( this->cont >= 0 )
+    this->cont -= frames;
+  this->pts_pos -= frames;
+}
+
+static void stretch_append( post_plugin_stretch_t *this, int bits,
+  const void *data, int frames )
+{
+  const int  ch = this->channels;
+  const int  num_samples = frames * ch;
+  float     *dst = this->in + this->in_frames * ch;
+  float     *mono = this->mono + this->in_frames;
+  int        i, j;
+
+  if( bits == 8 ) {
+    const uint8_t *src = (const uint8_t *)data;
+    for( i = 0; i < num_samples; i++ )
+      dst[i] = (int)src[i] - 128;
+  } else if( bits == 16 ) {
+    const int16_t *src = (const int16_t *)data;
+    for( i = 0; i < num_samples; i++ )
+      dst[i] = src[i];
+  } else {
+    memcpy( dst, data, num_samples * sizeof(float) );
+  }
+
+  for( i = 0; i < frames; i++, dst += ch ) {
+    float s = dst[0];
+    for( j = 1; j < ch; j++ )
+      s += dst[j];
+    mono[i] = s;
+  }
+
+  this->in_frames += frames;
+}
+
+/* pitch preserving: waveform similarity overlap-add */
+static void stretch_process_wsola( post_audio_port_t *port,
+  xine_stream_t *stream, extra_info_t *extra_info )
+{
+  post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
+
+  const int  ch = this->channels;
+  const int  hop = this->hop;
+  int        keep;
+
+  while( (int)this->pos + this->seek + 2 * hop <= this->in_frames ) {
+    const int  a = (int)this->pos;
+    const int  s = (this->cont < 0) ? a : a + stretch_search( this, a );
+    const float *src = this->in + s * ch;
+    const float *w = this->w;
+    float     *dst, *ola = this->ola;
+    int        i, j;
+
+    stretch_reserve( port, stream, extra_info, hop );
+    stretch_stamp( port, s );
+    dst = this->outfrag + this->out_frames * ch;
+
+    /* first half completes the overlap, second half is kept for the next one */
+    for( i = 0; i < hop; i++, w++ )
+      for( j = 0; j < ch; j++ )
+        *dst++ = *ola++ + *w * *src++;
+    ola = this->ola;
+    for( i = 0; i < hop; i++, w++ )
+      for( j = 0; j < ch; j++ )
+        *ola++ = *w * *src++;
+
+    this->out_frames += hop;
+    this->cont = s + hop;
+    this->pos += this->step;
+  }
+
+  keep = (int)this->pos - this->seek;
+  if( this->cont >= 0 && this->cont < keep )
+    keep = this->cont;
+  stretch_discard( this, keep );
+}
+
+/* plain linear resampling, pitch changes with speed */
+static void stretch_process_resample( post_audio_port_t *port,
+  xine_stream_t *stream, extra_info_t *extra_info )
+{
+  post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
+
+  const int  ch = this->channels;
+
+  while( (int)this->pos + 1 < this->in_frames ) {
+    const int    p = (int)this->pos;
+    const float  f = this->pos - p;
+    const float *src = this->in + p * ch;
+    float       *dst;
+    int          j;
+
+    stretch_reserve( port, stream, extra_info, 1 );
+    stretch_stamp( port, p );
+    dst = this->outfrag + this->out_frames * ch;
+
+    for( j = 0; j < ch; j++ )
+      dst[j] = src[j] + f * (src[ch + j] - src[j]);
+
+    this->out_frames++;
+    this->pos += this->step;
+  }
+
+  stretch_discard( this, (int)this->pos );
+}
+
+/* call with this->lock held */
+static void stretch_setup( post_audio_port_t *port )
+{
+  post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
+  int i, ch;
+
+  stretch_free_buffers(this);
+
+  this->channels = _x_ao_mode2channels(port->mode);
+  this->bytes_per_frame = port->bits / 8 * this->channels;
+
+  this->in_frames  = 0;
+  this->out_frames = 0;
+  this->out_pts    = 0;
+  this->pts        = 0;
+  this->pos        = 0;
+  this->cont       = -1;
+
+  ch = this->channels;
+  if( this->params.factor == 1.0 || ch < 1 || ch > STRETCH_MAX_CHANNELS ||
+      (port->bits != 8 && port->bits != 16 && port->bits != 32) ) {
+    xprintf(this->post.xine, XINE_VERBOSITY_DEBUG,
+            "stretch: passing through %d channels of %d bits\n", ch, port->bits);
+    return;
+  }
+
+  /* hop and the decimated search lengths must be multiples of 4 */
+  this->hop = (port->rate * STRETCH_HOP_MS / 1000) & ~15;
+  if( this->hop < 16 )
+    this->hop = 16;
+  this->seek = port->rate * STRETCH_SEEK_MS / 1000;
+  this->wsola = this->params.preserve_pitch;
+  if( this->wsola )
+    this->step = this->hop / this->params.factor;
+  else
+    this->step = 1.0 / this->params.factor;
+
+  /* what stays after processing fits in half of it */
+  this->in_size  = 2 * (2 * this->seek + 2 * this->hop + (int)(this->hop / this->params.factor) + 2);
+  this->out_size = port->rate * AUDIO_FRAGMENT;
+  if( this->out_size < this->hop )
+    this->out_size = this->hop;
+
+  this->in      = malloc( this->in_size * ch * sizeof(float) );
+  this->mono    = malloc( this->in_size * sizeof(float) );
+  this->outfrag = malloc( this->out_size * ch * sizeof(float) );
+  this->w       = malloc( 2 * this->hop * sizeof(float) );
+  this->ola     = calloc( this->hop * ch, sizeof(float) );
+  this->scratch = malloc( (this->hop / 2 + this->seek / 2 + 2) * sizeof(float) );
+  if( !this->in || !this->mono || !this->outfrag || !this->w || !this->ola || !this->scratch ) {
+    stretch_free_buffers(this);
+    return;
+  }
+
+  /* periodic hann, overlapping halves sum to 1 */
+  for( i = 0; i < 2 * this->hop; i++ )
+    this->w[i] = 0.5 - 0.5 * cos( M_PI * i / this->hop );
+
+  this->active = 1;
 }
 
 static void stretch_port_put_buffer (xine_audio_port_t *port_gen,
@@ -482,7 +721,8 @@ static void stretch_port_put_buffer (xine_audio_port_t *port_gen,
 
   post_audio_port_t  *port = (post_audio_port_t *)port_gen;
   post_plugin_stretch_t *this = (post_plugin_stretch_t *)port->post;
-  int16_t               *data_in;
+  const uint8_t         *data_in;
+  int                    num_frames;
 
   pthread_mutex_lock (&this->lock);
 
@@ -490,55 +730,18 @@ static void stretch_port_put_buffer (xine_audio_port_t *port_gen,
   if( this->params_changed ) {
     int64_t audio_step;
 
-    if( this->num_frames && this->audiofrag && this->outfrag ) {
+    if( this->active && this->out_frames ) {
       /* output whatever we have before changing parameters */
-      stretch_process_fragment( port, stream, buf->extra_info );
+      stretch_flush( port, stream, buf->extra_info );
     }
 
-    this->channels = _x_ao_mode2channels(port->mode);
-    this->bytes_per_frame = port->bits / 8 * this->channels;
-
     audio_step = ((int64_t)90000 * (int64_t)32768) / (int64_t)port->rate;
     audio_step = (int64_t) ((double)audio_step / this->params.factor);
     stream->metronom->set_audio_rate(stream->metronom, audio_step);
 
     stretchscr_set_speed(&this->scr->scr, this->scr->xine_speed);
 
-    if(this->audiofrag) {
-      free(this->audiofrag);
-      this->audiofrag = NULL;
-    }
-
-    if(this->outfrag) {
-      free(this->outfrag);
-      this->outfrag = NULL;
-    }
-
-    if(this->w) {
-      free(this->w);
-      this->w = NULL;
-    }
-
-    this->frames_per_frag = port->rate * AUDIO_FRAGMENT;
-    this->frames_per_outfrag = (int) ((double)this->params.factor * this->frames_per_frag);
-
-    if( this->frames_per_frag != this->frames_per_outfrag ) {
-      int wsize;
-
-      this->audiofrag = malloc( this->frames_per_frag * this->bytes_per_frame );
-      this->outfrag = malloc( this->frames_per_outfrag * this->bytes_per_frame );
-
-      if( this->frames_per_frag > this->frames_per_outfrag )
-        wsize = this->frames_per_frag - this->frames_per_outfrag;
-      else
-        wsize = this->frames_per_outfrag - this->frames_per_frag;
-
-      this->w = (_ftype_t*) malloc( wsize * sizeof(_ftype_t) );
-      triang(wsize, this->w);
-    }
-
-    this->num_frames = 0;
-    this->pts = 0;
+    stretch_setup( port );
 
     this->params_changed = 0;
   }
@@ -546,10 +749,7 @@ static void stretch_port_put_buffer (xine_audio_port_t *port_gen,
   pthread_mutex_unlock (&this->lock);
 
   /* just pass data through if we have nothing to do */
-  if( this->frames_per_frag == this->frames_per_outfrag ||
-      /* FIXME: we only handle 1 or 2 channels, 16 bits for now */
-      (this->channels != 1 && this->channels != 2) ||
-      port->bits != 16 ) {
+  if( !this->active ) {
 
     port->original_port->put_buffer(port->original_port, buf, stream );
 
@@ -557,28 +757,27 @@ static void stretch_port_put_buffer (xine_audio_port_t *port_gen,
   }
 
   /* update pts for our current audio fragment */
-  if( buf->vpts )
-    this->pts = buf->vpts - (this->num_frames * 90000 / port->rate);
-
-  data_in = buf->mem;
-  while( buf->num_frames ) {
-    int frames_to_copy = this->frames_per_frag - this->num_frames;
+  if( buf->vpts ) {
+    this->pts = buf->vpts;
+    this->pts_pos = this->in_frames;
+  }
 
-    if( frames_to_copy > buf->num_frames )
-      frames_to_copy = buf->num_frames;
+  data_in = (const uint8_t *)buf->mem;
+  num_frames = buf->num_frames;
+  while( num_frames ) {
+    int frames_to_copy = this->in_size - this->in_frames;
 
-    /* copy up to one fragment from input buf to our buffer */
-    memcpy( (uint8_t *)this->audiofrag + this->num_frames * this->bytes_per_frame,
-            data_in, frames_to_copy * this->bytes_per_frame );
+    if( frames_to_copy > num_frames )
+      frames_to_copy = num_frames;
 
-    data_in = (uint16_t *)((uint8_t *)data_in + frames_to_copy * this->bytes_per_frame);
-    this->num_frames += frames_to_copy;
-    buf->num_frames -= frames_to_copy;
+    stretch_append( this, port->bits, data_in, frames_to_copy );
+    data_in += frames_to_copy * this->bytes_per_frame;
+    num_frames -= frames_to_copy;
 
-    /* check if we have a complete audio fragment to process */
-    if( this->num_frames == this->frames_per_frag ) {
-      stretch_process_fragment( port, stream, buf->extra_info );
-    }
+    if( this->wsola )
+      stretch_process_wsola( port, stream, buf->extra_info );
+    else
+      stretch_process_resample( port, stream, buf->extra_info );
   }
 
   buf->num_frames=0; /* UNDOCUMENTED, but hey, it works! Force old audio_out buffer free. */
@@ -635,6 +834,12 @@ static post_plugin_t *stretch_open_plugin(post_class_t *class_gen, int inputs,
 
   pthread_mutex_init (&this->lock, NULL);
 
+  this->dot = stretch_dot_c;
+#if defined(ARCH_X86)
+  if (xine_mm_accel() & MM_ACCEL_X86_SSE)
+    this->dot = stretch_dot_sse;
+#endif
+
   set_parameters (&this->post.xine_post, &init_params);
 
   port = _x_post_intercept_audio_port(&this->post, audio_target[0], &input, &output);
@@ -131,6 +131,13 @@ struct deinterlace_method_s
     deinterlace_frame_t deinterlace_frame;
     int delaysfield; /* xine: this method delays output by one field relative to input */
     const char *description;
+    /**
+     * xine: the scanline functions for a single 8 bit plane, width is in
+     * bytes.  Methods that have them work on YV12 without converting it
+     * to packed 4:2:2 first.
+     */
+    deinterlace_interp_scanline_t interpolate_plane;
+    deinterlace_copy_scanline_t copy_plane;
 };
 
 
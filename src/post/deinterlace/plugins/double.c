@@ -48,6 +48,20 @@ static void copy_scanline( uint8_t *output,
     blit_packed422_scanline( output, data->m0, width );
 }
 
+static void deinterlace_plane_double( uint8_t *output,
+                                      deinterlace_scanline_data_t *data,
+                                      int width )
+{
+    speedy_memcpy( output, data->t0, width );
+}
+
+static void copy_plane( uint8_t *output,
+                        deinterlace_scanline_data_t *data,
+                        int width )
+{
+    speedy_memcpy( output, data->m0, width );
+}
+
 
 static const deinterlace_method_t doublemethod =
 {
@@ -61,7 +75,9 @@ static const deinterlace_method_t doublemethod =
     copy_scanline,
     0,
     0,
-    NULL
+    NULL,
+    deinterlace_plane_double,
+    copy_plane
 };
 
 const deinterlace_method_t *double_get_method( void )
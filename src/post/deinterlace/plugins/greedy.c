@@ -164,6 +164,20 @@ static void deinterlace_greedy_packed422_scanline_mmxext( uint8_t *output,
 #endif
 }
 
+static void copy_plane( uint8_t *output,
+                        deinterlace_scanline_data_t *data,
+                        int width )
+{
+    speedy_memcpy( output, data->m1, width );
+}
+
+static void deinterlace_greedy_plane( uint8_t *output,
+                                      deinterlace_scanline_data_t *data,
+                                      int width )
+{
+    greedy_plane_scanline( output, data->m0, data->t1, data->b1, data->m2, width );
+}
+
 /**
  * The greedy deinterlacer introduces a one-field delay on the input.
  * From the diagrams in deinterlace.h, the field being deinterlaced is
@@ -194,7 +208,9 @@ static const deinterlace_method_t greedymethod =
     "\n"
     "Simple detection uses linear interpolation where motion is detected, "
     "using a two-field buffer.  This is the Greedy: Low Motion deinterlacer "
-    "from DScaler."
+    "from DScaler.",
+    copy_plane,
+    deinterlace_greedy_plane
 };
 
 const deinterlace_method_t *greedy_get_method( void )
@@ -47,6 +47,20 @@ static void copy_scanline( uint8_t *output,
     blit_packed422_scanline( output, data->m0, width );
 }
 
+static void deinterlace_plane_linear( uint8_t *output,
+                                      deinterlace_scanline_data_t *data,
+                                      int width )
+{
+    interpolate_plane_scanline( output, data->t0, data->b0, width );
+}
+
+static void copy_plane( uint8_t *output,
+                        deinterlace_scanline_data_t *data,
+                        int width )
+{
+    speedy_memcpy( output, data->m0, width );
+}
+
 
 static const deinterlace_method_t linearmethod =
 {
@@ -69,7 +83,9 @@ static const deinterlace_method_t linearmethod =
     "your monitor to run at the refresh rate of the video signal.\n"
     "\n"
     "Full resolution mode expands each field to full size for high quality "
-    "fullscreen use."
+    "fullscreen use.",
+    deinterlace_plane_linear,
+    copy_plane
 };
 
 const deinterlace_method_t *linear_get_method( void )
@@ -176,10 +176,26 @@ static void deinterlace_scanline_linear_blend2( uint8_t *output,
 #endif
 }
 
+static void deinterlace_plane_linear_blend( uint8_t *output,
+                                            deinterlace_scanline_data_t *data,
+                                            int width )
+{
+    vfilter_121_plane_scanline( output, data->t0, data->m1, data->b0, width );
+}
+
+static void deinterlace_plane_linear_blend2( uint8_t *output,
+                                             deinterlace_scanline_data_t *data,
+                                             int width )
+{
+    vfilter_121_plane_scanline( output, data->t1, data->m0, data->b1, width );
+}
+
 #if defined(ARCH_X86)
 
 /* MMXEXT version is about 15% faster with Athlon XP [MF] */
 
+static const mmx_t high_mask = { .ub = {0xff,0xff,0xff,0xff,0,0,0,0}};
+
 static void deinterlace_scanline_linear_blend_mmxext( uint8_t *output,
                                                deinterlace_scanline_data_t *data,
                                                int width )
@@ -188,7 +204,6 @@ static void deinterlace_scanline_linear_blend_mmxext( uint8_t *output,
     uint8_t *b0 = data->b0;
     uint8_t *m1 = data->m1;
     int i;
-    static mmx_t high_mask = { .ub = {0xff,0xff,0xff,0xff,0,0,0,0}};
 
     READ_PREFETCH_2048( t0 );
     READ_PREFETCH_2048( b0 );
@@ -265,6 +280,8 @@ static void deinterlace_scanline_linear_blend2_mmxext( uint8_t *output,
     i = width / 8;
     width -= i * 8;
 
+    /* do not rely on mm6 from the interpolate call, scanlines may be built in any order */
+    movd_m2r( high_mask, mm6 );
     pxor_r2r( mm7, mm7 );
     while( i-- ) {
         movd_m2r( *t1, mm0 );
@@ -323,7 +340,9 @@ static deinterlace_method_t linearblendmethod_mmxext =
     deinterlace_scanline_linear_blend2_mmxext,
     0,
     0,
-    linearblendmethod_help
+    linearblendmethod_help,
+    deinterlace_plane_linear_blend,
+    deinterlace_plane_linear_blend2
 };
 
 #endif
@@ -348,7 +367,9 @@ static const deinterlace_method_t linearblendmethod =
     deinterlace_scanline_linear_blend2,
     0,
     0,
-    linearblendmethod_help
+    linearblendmethod_help,
+    deinterlace_plane_linear_blend,
+    deinterlace_plane_linear_blend2
 };
 
 const deinterlace_method_t *linearblend_get_method( void )
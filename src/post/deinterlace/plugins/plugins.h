@@ -38,6 +38,7 @@ const deinterlace_method_t *linearblend_get_method( void );
 const deinterlace_method_t *vfir_get_method( void );
 const deinterlace_method_t *dscaler_tomsmocomp_get_method( void );
 const deinterlace_method_t *dscaler_greedyh_get_method( void );
+const deinterlace_method_t *yadif_get_method( void );
 const deinterlace_method_t *greedy_get_method( void );
 const deinterlace_method_t *weave_get_method( void );
 const deinterlace_method_t *weavetff_get_method( void );
@@ -129,6 +129,20 @@ static void copy_scanline( uint8_t *output,
 }
 
 
+static void deinterlace_plane_vfir( uint8_t *output,
+                                    deinterlace_scanline_data_t *data,
+                                    int width )
+{
+    vfir_plane_scanline( output, data->tt1, data->t0, data->m1, data->b0, data->bb1, width );
+}
+
+static void copy_plane( uint8_t *output,
+                        deinterlace_scanline_data_t *data,
+                        int width )
+{
+    speedy_memcpy( output, data->m0, width );
+}
+
 static const deinterlace_method_t vfirmethod =
 {
     "Vertical Blend (ffmpeg)",
@@ -154,7 +168,9 @@ static const deinterlace_method_t vfirmethod =
     "CPU, and are willing to sacrifice detail.\n"
     "\n"
     "Vertical mode blurs favouring the most recent field for less visible "
-    "trails.  From the deinterlacer filter in ffmpeg."
+    "trails.  From the deinterlacer filter in ffmpeg.",
+    deinterlace_plane_vfir,
+    copy_plane
 };
 
 const deinterlace_method_t *vfir_get_method( void )
@@ -49,6 +49,20 @@ static void copy_scanline( uint8_t *output,
     blit_packed422_scanline( output, data->m0, width );
 }
 
+static void deinterlace_plane_weave( uint8_t *output,
+                                     deinterlace_scanline_data_t *data,
+                                     int width )
+{
+    speedy_memcpy( output, data->m1, width );
+}
+
+static void copy_plane( uint8_t *output,
+                        deinterlace_scanline_data_t *data,
+                        int width )
+{
+    speedy_memcpy( output, data->m0, width );
+}
+
 
 static const deinterlace_method_t weavemethod =
 {
@@ -62,7 +76,9 @@ static const deinterlace_method_t weavemethod =
     copy_scanline,
     0,
     0,
-    "Only updates the most recent field."
+    "Only updates the most recent field.",
+    deinterlace_plane_weave,
+    copy_plane
 };
 
 const deinterlace_method_t *weave_get_method( void )
@@ -0,0 +1,328 @@
+/**
+ * Motion adaptive, edge directed deinterlacing plugin.
+ *
+ * Copyright (C) 2026 the xine project
+ *
+ * The spatial prediction and the temporal clip follow yadif
+ * ("yet another deinterlacing filter") by Michael Niedermayer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+
+#if HAVE_INTTYPES_H
+#include <inttypes.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <xine/attributes.h>
+#include <xine/xineutils.h>
+#include "xine_mmx.h"
+#include "speedy.h"
+#include "deinterlace.h"
+#include "plugins.h"
+
+// Like greedy, this method outputs the previous field (t1/b1 and m1) and
+// fills in the lines between.  For those, the fields before (m2) and after
+// (m0) give a temporal prediction, the previous field of the same parity
+// (t2/b2) and the lines two above and below (tt0/tt2, bb0/bb2) tell how far
+// to trust it.  The result is an edge directed interpolation of t1 and b1
+// that is clipped to the temporal prediction plus/minus that difference.
+//
+// Unlike yadif, the field after the output field is not compared with it:
+// that would need a second field of delay.
+
+static const char yadifmethod_help[] =
+  "Interpolates along edges and uses the neighbouring fields wherever "
+  "the picture does not move.  Use this for high quality output of "
+  "interlaced video at full field rate.\n"
+  "\n"
+  "Output is delayed by one field.  Based on yadif from MPlayer/FFmpeg.";
+
+#define YADIF_ABS(a) (((a) < 0) ? -(a) : (a))
+#define YADIF_MIN(a,b) (((a) < (b)) ? (a) : (b))
+#define YADIF_MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+/* c and e are the lines above and below the missing one, s is the step
+ * from one sample to the next of the same component. */
+#define YADIF_CHECK(j) \
+    { int score = YADIF_ABS( c[x - s + (j)] - e[x - s - (j)] ) \
+                + YADIF_ABS( c[x + (j)] - e[x - (j)] ) \
+                + YADIF_ABS( c[x + s + (j)] - e[x + s - (j)] ); \
+      if( score < spatial_score ) { \
+        spatial_score = score; \
+        spatial_pred = (c[x + (j)] + e[x - (j)]) >> 1;
+
+/**
+ * Bytes start .. end-1 of a missing line.  width is the line length in
+ * bytes, packed selects packed 4:2:2 sample steps.
+ */
+static void yadif_line_c( uint8_t *output, deinterlace_scanline_data_t *data,
+                          int start, int end, int width, int packed )
+{
+    const uint8_t *c = data->t1;
+    const uint8_t *e = data->b1;
+    int x;
+
+    for( x = start; x < end; x++ ) {
+        int s = packed ? ((x & 1) ? 4 : 2) : 1;
+        int d = (data->m2[x] + data->m0[x]) >> 1;
+        int temporal_diff0 = YADIF_ABS( data->m2[x] - data->m0[x] );
+        int temporal_diff1 = (YADIF_ABS( data->t2[x] - c[x] ) + YADIF_ABS( data->b2[x] - e[x] )) >> 1;
+        int diff = YADIF_MAX( temporal_diff0 >> 1, temporal_diff1 );
+        int spatial_pred = (c[x] + e[x]) >> 1;
+        int b = (data->tt2[x] + data->tt0[x]) >> 1;
+        int f = (data->bb2[x] + data->bb0[x]) >> 1;
+        int max, min;
+
+        if( x >= 3 * s && x + 3 * s < width ) {
+            int spatial_score = YADIF_ABS( c[x - s] - e[x - s] ) + YADIF_ABS( c[x] - e[x] )
+                              + YADIF_ABS( c[x + s] - e[x + s] ) - 1;
+
+            YADIF_CHECK( -s ) YADIF_CHECK( -2 * s ) }} }}
+            YADIF_CHECK( s ) YADIF_CHECK( 2 * s ) }} }}
+        }
+
+        max = YADIF_MAX( YADIF_MAX( d - e[x], d - c[x] ), YADIF_MIN( b - c[x], f - e[x] ) );
+        min = YADIF_MIN( YADIF_MIN( d - e[x], d - c[x] ), YADIF_MAX( b - c[x], f - e[x] ) );
+        diff = YADIF_MAX( YADIF_MAX( diff, min ), -max );
+
+        if( spatial_pred > d + diff ) {
+            spatial_pred = d + diff;
+        } else if( spatial_pred < d - diff ) {
+            spatial_pred = d - diff;
+        }
+
+        output[x] = spatial_pred;
+    }
+}
+
+static void copy_scanline( uint8_t *output,
+                           deinterlace_scanline_data_t *data,
+                           int width )
+{
+    blit_packed422_scanline( output, data->m1, width );
+}
+
+static void deinterlace_yadif_packed422_scanline( uint8_t *output,
+                                                  deinterlace_scanline_data_t *data,
+                                                  int width )
+{
+    yadif_line_c( output, data, 0, width * 2, width * 2, 1 );
+}
+
+static void copy_plane( uint8_t *output,
+                        deinterlace_scanline_data_t *data,
+                        int width )
+{
+    speedy_memcpy( output, data->m1, width );
+}
+
+static void deinterlace_yadif_plane( uint8_t *output,
+                                     deinterlace_scanline_data_t *data,
+                                     int width )
+{
+    yadif_line_c( output, data, 0, width, width, 0 );
+}
+
+#if defined(ARCH_X86)
+
+/* 8 bytes to words */
+#define YADIF_LOAD(p,r) \
+    movq_m2r( *(p), r ); \
+    punpcklbw_r2r( xmm7, r );
+
+/* r = (p + q) >> 1 as words */
+#define YADIF_AVG(p,q,r,t) \
+    YADIF_LOAD( p, r ); \
+    YADIF_LOAD( q, t ); \
+    paddw_r2r( t, r ); \
+    psrlw_i2r( 1, r );
+
+/* r = |p - q| as words */
+#define YADIF_ABSDIFF(p,q,r,t0,t1) \
+    movq_m2r( *(p), r ); \
+    movq_m2r( *(q), t0 ); \
+    movq_r2r( r, t1 ); \
+    psubusb_r2r( t0, r ); \
+    psubusb_r2r( t1, t0 ); \
+    por_r2r( t0, r ); \
+    punpcklbw_r2r( xmm7, r );
+
+/* score to xmm3, prediction to xmm2, xmm1 is set where the score is better */
+#define YADIF_SCORE(j) \
+    YADIF_ABSDIFF( c + x - 1 + (j), e + x - 1 - (j), xmm3, xmm0, xmm1 ); \
+    YADIF_ABSDIFF( c + x + (j), e + x - (j), xmm2, xmm0, xmm1 ); \
+    paddw_r2r( xmm2, xmm3 ); \
+    YADIF_ABSDIFF( c + x + 1 + (j), e + x + 1 - (j), xmm2, xmm0, xmm1 ); \
+    paddw_r2r( xmm2, xmm3 ); \
+    YADIF_AVG( c + x + (j), e + x - (j), xmm2, xmm0 ); \
+    movdqa_r2r( xmm6, xmm1 ); \
+    pcmpgtw_r2r( xmm3, xmm1 );
+
+/* take score (xmm6) and prediction (xmm5) from xmm3 and xmm2 where xmm1 is set */
+#define YADIF_SELECT \
+    pand_r2r( xmm1, xmm3 ); \
+    movdqa_r2r( xmm1, xmm0 ); \
+    pandn_r2r( xmm6, xmm0 ); \
+    por_r2r( xmm3, xmm0 ); \
+    movdqa_r2r( xmm0, xmm6 ); \
+    pand_r2r( xmm1, xmm2 ); \
+    pandn_r2r( xmm5, xmm1 ); \
+    por_r2r( xmm2, xmm1 ); \
+    movdqa_r2r( xmm1, xmm5 );
+
+/**
+ * Same as yadif_line_c() for planes, 8 pixels a time in 16 bit lanes.
+ * The first and last 3 pixels have no edge search and are left to C.
+ */
+static void deinterlace_yadif_plane_sse2( uint8_t *output,
+                                          deinterlace_scanline_data_t *data,
+                                          int width )
+{
+    const uint8_t *c = data->t1;
+    const uint8_t *e = data->b1;
+    sse_t diff;
+    int x = YADIF_MIN( 3, width );
+
+    yadif_line_c( output, data, 0, x, width, 0 );
+
+    /* rely on gcc not using xmm regs */
+    pxor_r2r( xmm7, xmm7 );
+    for( ; x + 11 <= width; x += 8 ) {
+        /* spatial prediction along the best of 5 directions */
+        YADIF_ABSDIFF( c + x - 1, e + x - 1, xmm6, xmm0, xmm1 );
+        YADIF_ABSDIFF( c + x, e + x, xmm2, xmm0, xmm1 );
+        paddw_r2r( xmm2, xmm6 );
+        YADIF_ABSDIFF( c + x + 1, e + x + 1, xmm2, xmm0, xmm1 );
+        paddw_r2r( xmm2, xmm6 );
+        pcmpeqw_r2r( xmm2, xmm2 );
+        paddw_r2r( xmm2, xmm6 );
+        YADIF_AVG( c + x, e + x, xmm5, xmm0 );
+
+        YADIF_SCORE( -1 );
+        movdqa_r2r( xmm1, xmm4 );
+        YADIF_SELECT;
+        YADIF_SCORE( -2 );
+        pand_r2r( xmm4, xmm1 );
+        YADIF_SELECT;
+
+        YADIF_SCORE( 1 );
+        movdqa_r2r( xmm1, xmm4 );
+        YADIF_SELECT;
+        YADIF_SCORE( 2 );
+        pand_r2r( xmm4, xmm1 );
+        YADIF_SELECT;
+
+        /* temporal difference */
+        YADIF_ABSDIFF( data->t2 + x, c + x, xmm3, xmm0, xmm1 );
+        YADIF_ABSDIFF( data->b2 + x, e + x, xmm2, xmm0, xmm1 );
+        paddw_r2r( xmm2, xmm3 );
+        psrlw_i2r( 1, xmm3 );
+        YADIF_ABSDIFF( data->m2 + x, data->m0 + x, xmm2, xmm0, xmm1 );
+        psrlw_i2r( 1, xmm2 );
+        pmaxsw_r2r( xmm2, xmm3 );
+        movdqa_r2m( xmm3, diff );
+
+        /* raise it where the missing line does not fit in between */
+        YADIF_AVG( data->m2 + x, data->m0 + x, xmm4, xmm0 );
+        YADIF_LOAD( c + x, xmm0 );
+        YADIF_LOAD( e + x, xmm1 );
+        YADIF_AVG( data->tt2 + x, data->tt0 + x, xmm2, xmm3 );
+        YADIF_AVG( data->bb2 + x, data->bb0 + x, xmm3, xmm6 );
+        psubw_r2r( xmm0, xmm2 );
+        psubw_r2r( xmm1, xmm3 );
+        movdqa_r2r( xmm2, xmm6 );
+        pminsw_r2r( xmm3, xmm6 );
+        pmaxsw_r2r( xmm3, xmm2 );
+        movdqa_r2r( xmm4, xmm3 );
+        psubw_r2r( xmm1, xmm3 );
+        movdqa_r2r( xmm4, xmm1 );
+        psubw_r2r( xmm0, xmm1 );
+        movdqa_r2r( xmm3, xmm0 );
+        pmaxsw_r2r( xmm1, xmm0 );
+        pmaxsw_r2r( xmm6, xmm0 );
+        pminsw_r2r( xmm1, xmm3 );
+        pminsw_r2r( xmm2, xmm3 );
+        pxor_r2r( xmm1, xmm1 );
+        psubw_r2r( xmm0, xmm1 );
+        movdqa_m2r( diff, xmm6 );
+        pmaxsw_r2r( xmm3, xmm6 );
+        pmaxsw_r2r( xmm1, xmm6 );
+
+        /* clip the spatial prediction */
+        movdqa_r2r( xmm4, xmm0 );
+        psubw_r2r( xmm6, xmm0 );
+        paddw_r2r( xmm6, xmm4 );
+        pmaxsw_r2r( xmm0, xmm5 );
+        pminsw_r2r( xmm4, xmm5 );
+        packuswb_r2r( xmm5, xmm5 );
+        movq_r2m( xmm5, output[x] );
+    }
+
+    yadif_line_c( output, data, x, width, width, 0 );
+}
+
+static const deinterlace_method_t yadifmethod_sse2 =
+{
+    "Motion Adaptive Edge Directed (yadif)",
+    "Yadif",
+    4,
+    MM_ACCEL_X86_SSE2,
+    0,
+    1,
+    copy_scanline,
+    deinterlace_yadif_packed422_scanline,
+    0,
+    1,
+    yadifmethod_help,
+    copy_plane,
+    deinterlace_yadif_plane_sse2
+};
+
+#endif
+
+static const deinterlace_method_t yadifmethod =
+{
+    "Motion Adaptive Edge Directed (yadif)",
+    "Yadif",
+    4,
+    0,
+    0,
+    1,
+    copy_scanline,
+    deinterlace_yadif_packed422_scanline,
+    0,
+    1,
+    yadifmethod_help,
+    copy_plane,
+    deinterlace_yadif_plane
+};
+
+const deinterlace_method_t *yadif_get_method( void )
+{
+#if defined(ARCH_X86)
+    if( xine_mm_accel() & MM_ACCEL_X86_SSE2 )
+      return &yadifmethod_sse2;
+    else
+#endif
+      return &yadifmethod;
+}
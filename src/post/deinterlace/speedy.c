@@ -153,6 +153,14 @@ void (*vfilter_chroma_121_packed422_scanline)( uint8_t *output, int width,
                                                uint8_t *m, uint8_t *t, uint8_t *b );
 void (*vfilter_chroma_332_packed422_scanline)( uint8_t *output, int width,
                                                uint8_t *m, uint8_t *t, uint8_t *b );
+void (*interpolate_plane_scanline)( uint8_t *output, uint8_t *top,
+                                    uint8_t *bot, int width );
+void (*vfilter_121_plane_scanline)( uint8_t *output, uint8_t *top,
+                                    uint8_t *mid, uint8_t *bot, int width );
+void (*vfir_plane_scanline)( uint8_t *output, uint8_t *tt, uint8_t *t,
+                             uint8_t *m, uint8_t *b, uint8_t *bb, int width );
+void (*greedy_plane_scanline)( uint8_t *output, uint8_t *m0, uint8_t *t1,
+                               uint8_t *b1, uint8_t *m2, int width );
 
 
 /**
@@ -2583,6 +2591,362 @@ static void chroma_420_to_422_mpeg2_plane_c( uint8_t *dst, uint8_t *src,
 
 static uint32_t speedy_accel;
 
+/* Planar scanline functions, width is in bytes. */
+
+static void interpolate_plane_scanline_c( uint8_t *output, uint8_t *top,
+                                          uint8_t *bot, int width )
+{
+    while( width-- ) {
+        *output++ = (*top++ + *bot++ + 1) >> 1;
+    }
+}
+
+static void vfilter_121_plane_scanline_c( uint8_t *output, uint8_t *top,
+                                          uint8_t *mid, uint8_t *bot, int width )
+{
+    while( width-- ) {
+        *output++ = (*top++ + (*mid++ << 1) + *bot++) >> 2;
+    }
+}
+
+static void vfir_plane_scanline_c( uint8_t *output, uint8_t *tt, uint8_t *t,
+                                   uint8_t *m, uint8_t *b, uint8_t *bb, int width )
+{
+    while( width-- ) {
+        int sum = ((*t++ + *b++) << 2) + (*m++ << 1) + 4 - (*tt++ + *bb++);
+        if( sum < 0 ) sum = 0;
+        sum >>= 3;
+        *output++ = (sum > 255) ? 255 : sum;
+    }
+}
+
+#define GREEDY_MAX_COMB 15
+
+static void greedy_plane_scanline_c( uint8_t *output, uint8_t *m0, uint8_t *t1,
+                                     uint8_t *b1, uint8_t *m2, int width )
+{
+    while( width-- ) {
+        int avg = (*t1 + *b1 + 1) >> 1;
+        int l2comb = *m0 - avg, lp2comb = *m2 - avg;
+        int best, hi, lo;
+
+        if( l2comb < 0 ) l2comb = -l2comb;
+        if( lp2comb < 0 ) lp2comb = -lp2comb;
+        best = (lp2comb <= l2comb) ? *m2 : *m0;
+
+        /* allow some comb, but not much beyond the range of the lines around */
+        if( *t1 > *b1 ) {
+            hi = *t1; lo = *b1;
+        } else {
+            hi = *b1; lo = *t1;
+        }
+        hi += GREEDY_MAX_COMB; if( hi > 255 ) hi = 255;
+        lo -= GREEDY_MAX_COMB; if( lo < 0 ) lo = 0;
+
+        if( best < lo ) best = lo;
+        if( best > hi ) best = hi;
+        *output++ = best;
+        m0++; t1++; b1++; m2++;
+    }
+}
+
+#if defined(ARCH_X86)
+static const sse_t dqwFour = { .uw = { 4, 4, 4, 4, 4, 4, 4, 4 } };
+static const sse_t dqwGreedyMaxComb = { .ub = { GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB,
+                                                GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB,
+                                                GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB,
+                                                GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB, GREEDY_MAX_COMB } };
+
+static void interpolate_plane_scanline_sse2( uint8_t *output, uint8_t *top,
+                                             uint8_t *bot, int width )
+{
+    for( ; width >= 16; width -= 16 ) {
+        movdqu_m2r( *top, xmm0 );
+        movdqu_m2r( *bot, xmm1 );
+        pavgb_r2r( xmm1, xmm0 );
+        movdqu_r2m( xmm0, *output );
+        output += 16; top += 16; bot += 16;
+    }
+    interpolate_plane_scanline_c( output, top, bot, width );
+}
+
+static void vfilter_121_plane_scanline_sse2( uint8_t *output, uint8_t *top,
+                                             uint8_t *mid, uint8_t *bot, int width )
+{
+    pxor_r2r( xmm7, xmm7 );
+    for( ; width >= 16; width -= 16 ) {
+        movdqu_m2r( *top, xmm0 );
+        movdqu_m2r( *mid, xmm1 );
+        movdqu_m2r( *bot, xmm2 );
+        movdqa_r2r( xmm0, xmm3 );
+        movdqa_r2r( xmm1, xmm4 );
+        movdqa_r2r( xmm2, xmm5 );
+        punpcklbw_r2r( xmm7, xmm0 );
+        punpckhbw_r2r( xmm7, xmm3 );
+        punpcklbw_r2r( xmm7, xmm1 );
+        punpckhbw_r2r( xmm7, xmm4 );
+        punpcklbw_r2r( xmm7, xmm2 );
+        punpckhbw_r2r( xmm7, xmm5 );
+        psllw_i2r( 1, xmm1 );
+        psllw_i2r( 1, xmm4 );
+        paddw_r2r( xmm1, xmm0 );
+        paddw_r2r( xmm4, xmm3 );
+        paddw_r2r( xmm2, xmm0 );
+        paddw_r2r( xmm5, xmm3 );
+        psrlw_i2r( 2, xmm0 );
+        psrlw_i2r( 2, xmm3 );
+        packuswb_r2r( xmm3, xmm0 );
+        movdqu_r2m( xmm0, *output );
+        output += 16; top += 16; mid += 16; bot += 16;
+    }
+    vfilter_121_plane_scanline_c( output, top, mid, bot, width );
+}
+
+static void vfir_plane_scanline_sse2( uint8_t *output, uint8_t *tt, uint8_t *t,
+                                      uint8_t *m, uint8_t *b, uint8_t *bb, int width )
+{
+    pxor_r2r( xmm7, xmm7 );
+    for( ; width >= 16; width -= 16 ) {
+        /* 4 * (t + b) */
+        movdqu_m2r( *t, xmm0 );
+        movdqu_m2r( *b, xmm2 );
+        movdqa_r2r( xmm0, xmm1 );
+        movdqa_r2r( xmm2, xmm3 );
+        punpcklbw_r2r( xmm7, xmm0 );
+        punpckhbw_r2r( xmm7, xmm1 );
+        punpcklbw_r2r( xmm7, xmm2 );
+        punpckhbw_r2r( xmm7, xmm3 );
+        paddw_r2r( xmm2, xmm0 );
+        paddw_r2r( xmm3, xmm1 );
+        psllw_i2r( 2, xmm0 );
+        psllw_i2r( 2, xmm1 );
+        /* + 2 * m + 4 */
+        movdqu_m2r( *m, xmm2 );
+        movdqa_r2r( xmm2, xmm3 );
+        punpcklbw_r2r( xmm7, xmm2 );
+        punpckhbw_r2r( xmm7, xmm3 );
+        psllw_i2r( 1, xmm2 );
+        psllw_i2r( 1, xmm3 );
+        paddw_r2r( xmm2, xmm0 );
+        paddw_r2r( xmm3, xmm1 );
+        movdqu_m2r( dqwFour, xmm6 );
+        paddw_r2r( xmm6, xmm0 );
+        paddw_r2r( xmm6, xmm1 );
+        /* - (tt + bb), saturating at 0 */
+        movdqu_m2r( *tt, xmm2 );
+        movdqu_m2r( *bb, xmm4 );
+        movdqa_r2r( xmm2, xmm3 );
+        movdqa_r2r( xmm4, xmm5 );
+        punpcklbw_r2r( xmm7, xmm2 );
+        punpckhbw_r2r( xmm7, xmm3 );
+        punpcklbw_r2r( xmm7, xmm4 );
+        punpckhbw_r2r( xmm7, xmm5 );
+        paddw_r2r( xmm4, xmm2 );
+        paddw_r2r( xmm5, xmm3 );
+        psubusw_r2r( xmm2, xmm0 );
+        psubusw_r2r( xmm3, xmm1 );
+        psrlw_i2r( 3, xmm0 );
+        psrlw_i2r( 3, xmm1 );
+        packuswb_r2r( xmm1, xmm0 );
+        movdqu_r2m( xmm0, *output );
+        output += 16; tt += 16; t += 16; m += 16; b += 16; bb += 16;
+    }
+    vfir_plane_scanline_c( output, tt, t, m, b, bb, width );
+}
+
+static void greedy_plane_scanline_sse2( uint8_t *output, uint8_t *m0, uint8_t *t1,
+                                        uint8_t *b1, uint8_t *m2, int width )
+{
+    movdqu_m2r( dqwGreedyMaxComb, xmm6 );
+    for( ; width >= 16; width -= 16 ) {
+        movdqu_m2r( *t1, xmm1 );
+        movdqu_m2r( *m0, xmm2 );
+        movdqu_m2r( *b1, xmm3 );
+        movdqu_m2r( *m2, xmm0 );
+
+        /* average of t1 and b1 */
+        movdqa_r2r( xmm1, xmm4 );
+        pavgb_r2r( xmm3, xmm4 );
+
+        /* comb of m0 */
+        movdqa_r2r( xmm2, xmm5 );
+        psubusb_r2r( xmm4, xmm5 );
+        movdqa_r2r( xmm4, xmm7 );
+        psubusb_r2r( xmm2, xmm7 );
+        por_r2r( xmm7, xmm5 );
+
+        /* comb of m2 */
+        movdqa_r2r( xmm0, xmm7 );
+        psubusb_r2r( xmm4, xmm7 );
+        psubusb_r2r( xmm0, xmm4 );
+        por_r2r( xmm7, xmm4 );
+
+        /* m2 where its comb is not larger, else m0 */
+        psubusb_r2r( xmm5, xmm4 );
+        pxor_r2r( xmm7, xmm7 );
+        pcmpeqb_r2r( xmm7, xmm4 );
+        movdqa_r2r( xmm4, xmm5 );
+        pand_r2r( xmm0, xmm4 );
+        pandn_r2r( xmm2, xmm5 );
+        por_r2r( xmm5, xmm4 );
+
+        /* clip to min - MaxComb .. max + MaxComb of t1 and b1 */
+        movdqa_r2r( xmm1, xmm5 );
+        pmaxub_r2r( xmm3, xmm5 );
+        paddusb_r2r( xmm6, xmm5 );
+        pminub_r2r( xmm3, xmm1 );
+        psubusb_r2r( xmm6, xmm1 );
+        pmaxub_r2r( xmm1, xmm4 );
+        pminub_r2r( xmm5, xmm4 );
+
+        movdqu_r2m( xmm4, *output );
+        output += 16; m0 += 16; t1 += 16; b1 += 16; m2 += 16;
+    }
+    greedy_plane_scanline_c( output, m0, t1, b1, m2, width );
+}
+#endif
+
+#if defined(ARCH_X86_64) && defined(HAVE_AVX2)
+static void interpolate_plane_scanline_avx2( uint8_t *output, uint8_t *top,
+                                             uint8_t *bot, int width )
+{
+    for( ; width >= 32; width -= 32 ) {
+        __asm__ __volatile__ (
+            "vmovdqu  (%1), %%ymm0           \n\t"
+            "vpavgb   (%2), %%ymm0, %%ymm0   \n\t"
+            "vmovdqu  %%ymm0, (%0)           \n\t"
+            : : "r" (output), "r" (top), "r" (bot)
+            : "memory" );
+        output += 32; top += 32; bot += 32;
+    }
+    __asm__ __volatile__ ("vzeroupper");
+    interpolate_plane_scanline_c( output, top, bot, width );
+}
+
+static void vfilter_121_plane_scanline_avx2( uint8_t *output, uint8_t *top,
+                                             uint8_t *mid, uint8_t *bot, int width )
+{
+    for( ; width >= 32; width -= 32 ) {
+        __asm__ __volatile__ (
+            "vpxor      %%ymm7, %%ymm7, %%ymm7   \n\t"
+            "vmovdqu    (%1), %%ymm0             \n\t"
+            "vmovdqu    (%2), %%ymm1             \n\t"
+            "vmovdqu    (%3), %%ymm2             \n\t"
+            "vpunpckhbw %%ymm7, %%ymm0, %%ymm3   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm0, %%ymm0   \n\t"
+            "vpunpckhbw %%ymm7, %%ymm1, %%ymm4   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm1, %%ymm1   \n\t"
+            "vpunpckhbw %%ymm7, %%ymm2, %%ymm5   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm2, %%ymm2   \n\t"
+            "vpsllw     $1, %%ymm1, %%ymm1       \n\t"
+            "vpsllw     $1, %%ymm4, %%ymm4       \n\t"
+            "vpaddw     %%ymm1, %%ymm0, %%ymm0   \n\t"
+            "vpaddw     %%ymm4, %%ymm3, %%ymm3   \n\t"
+            "vpaddw     %%ymm2, %%ymm0, %%ymm0   \n\t"
+            "vpaddw     %%ymm5, %%ymm3, %%ymm3   \n\t"
+            "vpsrlw     $2, %%ymm0, %%ymm0       \n\t"
+            "vpsrlw     $2, %%ymm3, %%ymm3       \n\t"
+            "vpackuswb  %%ymm3, %%ymm0, %%ymm0   \n\t"
+            "vmovdqu    %%ymm0, (%0)             \n\t"
+            : : "r" (output), "r" (top), "r" (mid), "r" (bot)
+            : "memory" );
+        output += 32; top += 32; mid += 32; bot += 32;
+    }
+    __asm__ __volatile__ ("vzeroupper");
+    vfilter_121_plane_scanline_c( output, top, mid, bot, width );
+}
+
+static void vfir_plane_scanline_avx2( uint8_t *output, uint8_t *tt, uint8_t *t,
+                                      uint8_t *m, uint8_t *b, uint8_t *bb, int width )
+{
+    for( ; width >= 32; width -= 32 ) {
+        __asm__ __volatile__ (
+            "vpxor      %%ymm7, %%ymm7, %%ymm7   \n\t"
+            /* 4 * (t + b) */
+            "vmovdqu    (%2), %%ymm0             \n\t"
+            "vmovdqu    (%4), %%ymm2             \n\t"
+            "vpunpckhbw %%ymm7, %%ymm0, %%ymm1   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm0, %%ymm0   \n\t"
+            "vpunpckhbw %%ymm7, %%ymm2, %%ymm3   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm2, %%ymm2   \n\t"
+            "vpaddw     %%ymm2, %%ymm0, %%ymm0   \n\t"
+            "vpaddw     %%ymm3, %%ymm1, %%ymm1   \n\t"
+            "vpsllw     $2, %%ymm0, %%ymm0       \n\t"
+            "vpsllw     $2, %%ymm1, %%ymm1       \n\t"
+            /* + 2 * m + 4 */
+            "vmovdqu    (%3), %%ymm2             \n\t"
+            "vpunpckhbw %%ymm7, %%ymm2, %%ymm3   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm2, %%ymm2   \n\t"
+            "vpsllw     $1, %%ymm2, %%ymm2       \n\t"
+            "vpsllw     $1, %%ymm3, %%ymm3       \n\t"
+            "vpaddw     %%ymm2, %%ymm0, %%ymm0   \n\t"
+            "vpaddw     %%ymm3, %%ymm1, %%ymm1   \n\t"
+            "vbroadcasti128 %6, %%ymm6           \n\t"
+            "vpaddw     %%ymm6, %%ymm0, %%ymm0   \n\t"
+            "vpaddw     %%ymm6, %%ymm1, %%ymm1   \n\t"
+            /* - (tt + bb), saturating at 0 */
+            "vmovdqu    (%1), %%ymm2             \n\t"
+            "vmovdqu    (%5), %%ymm4             \n\t"
+            "vpunpckhbw %%ymm7, %%ymm2, %%ymm3   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm2, %%ymm2   \n\t"
+            "vpunpckhbw %%ymm7, %%ymm4, %%ymm5   \n\t"
+            "vpunpcklbw %%ymm7, %%ymm4, %%ymm4   \n\t"
+            "vpaddw     %%ymm4, %%ymm2, %%ymm2   \n\t"
+            "vpaddw     %%ymm5, %%ymm3, %%ymm3   \n\t"
+            "vpsubusw   %%ymm2, %%ymm0, %%ymm0   \n\t"
+            "vpsubusw   %%ymm3, %%ymm1, %%ymm1   \n\t"
+            "vpsrlw     $3, %%ymm0, %%ymm0       \n\t"
+            "vpsrlw     $3, %%ymm1, %%ymm1       \n\t"
+            "vpackuswb  %%ymm1, %%ymm0, %%ymm0   \n\t"
+            "vmovdqu    %%ymm0, (%0)             \n\t"
+            : : "r" (output), "r" (tt), "r" (t), "r" (m), "r" (b), "r" (bb), "m" (dqwFour)
+            : "memory" );
+        output += 32; tt += 32; t += 32; m += 32; b += 32; bb += 32;
+    }
+    __asm__ __volatile__ ("vzeroupper");
+    vfir_plane_scanline_c( output, tt, t, m, b, bb, width );
+}
+
+static void greedy_plane_scanline_avx2( uint8_t *output, uint8_t *m0, uint8_t *t1,
+                                        uint8_t *b1, uint8_t *m2, int width )
+{
+    for( ; width >= 32; width -= 32 ) {
+        __asm__ __volatile__ (
+            "vbroadcasti128 %5, %%ymm6           \n\t"
+            "vmovdqu    (%2), %%ymm1             \n\t" /* t1 */
+            "vmovdqu    (%1), %%ymm2             \n\t" /* m0 */
+            "vmovdqu    (%3), %%ymm3             \n\t" /* b1 */
+            "vmovdqu    (%4), %%ymm0             \n\t" /* m2 */
+            "vpavgb     %%ymm3, %%ymm1, %%ymm4   \n\t"
+            /* comb of m0 and m2 */
+            "vpsubusb   %%ymm4, %%ymm2, %%ymm5   \n\t"
+            "vpsubusb   %%ymm2, %%ymm4, %%ymm7   \n\t"
+            "vpor       %%ymm7, %%ymm5, %%ymm5   \n\t"
+            "vpsubusb   %%ymm4, %%ymm0, %%ymm7   \n\t"
+            "vpsubusb   %%ymm0, %%ymm4, %%ymm4   \n\t"
+            "vpor       %%ymm7, %%ymm4, %%ymm4   \n\t"
+            /* m2 where its comb is not larger, else m0 */
+            "vpsubusb   %%ymm5, %%ymm4, %%ymm4   \n\t"
+            "vpxor      %%ymm7, %%ymm7, %%ymm7   \n\t"
+            "vpcmpeqb   %%ymm7, %%ymm4, %%ymm4   \n\t"
+            "vpblendvb  %%ymm4, %%ymm0, %%ymm2, %%ymm4 \n\t"
+            /* clip */
+            "vpmaxub    %%ymm3, %%ymm1, %%ymm5   \n\t"
+            "vpaddusb   %%ymm6, %%ymm5, %%ymm5   \n\t"
+            "vpminub    %%ymm3, %%ymm1, %%ymm1   \n\t"
+            "vpsubusb   %%ymm6, %%ymm1, %%ymm1   \n\t"
+            "vpmaxub    %%ymm1, %%ymm4, %%ymm4   \n\t"
+            "vpminub    %%ymm5, %%ymm4, %%ymm4   \n\t"
+            "vmovdqu    %%ymm4, (%0)             \n\t"
+            : : "r" (output), "r" (m0), "r" (t1), "r" (b1), "r" (m2), "m" (dqwGreedyMaxComb)
+            : "memory" );
+        output += 32; m0 += 32; t1 += 32; b1 += 32; m2 += 32;
+    }
+    __asm__ __volatile__ ("vzeroupper");
+    greedy_plane_scanline_c( output, m0, t1, b1, m2, width );
+}
+#endif
+
 void setup_speedy_calls( uint32_t accel, int verbose )
 {
     speedy_accel = accel;
@@ -2625,6 +2989,10 @@ void setup_speedy_calls( uint32_t accel, int verbose )
     invert_colour_packed422_inplace_scanline = invert_colour_packed422_inplace_scanline_c;
     vfilter_chroma_121_packed422_scanline = vfilter_chroma_121_packed422_scanline_c;
     vfilter_chroma_332_packed422_scanline = vfilter_chroma_332_packed422_scanline_c;
+    interpolate_plane_scanline = interpolate_plane_scanline_c;
+    vfilter_121_plane_scanline = vfilter_121_plane_scanline_c;
+    vfir_plane_scanline = vfir_plane_scanline_c;
+    greedy_plane_scanline = greedy_plane_scanline_c;
 
 #if defined(ARCH_X86)
     if( speedy_accel & MM_ACCEL_X86_MMXEXT ) {
@@ -2677,6 +3045,22 @@ void setup_speedy_calls( uint32_t accel, int verbose )
         }
         diff_factor_packed422_scanline = diff_factor_packed422_scanline_sse2;
         vfilter_chroma_332_packed422_scanline = vfilter_chroma_332_packed422_scanline_sse2;
+        interpolate_plane_scanline = interpolate_plane_scanline_sse2;
+        vfilter_121_plane_scanline = vfilter_121_plane_scanline_sse2;
+        vfir_plane_scanline = vfir_plane_scanline_sse2;
+        greedy_plane_scanline = greedy_plane_scanline_sse2;
+    }
+#endif
+
+#if defined(ARCH_X86_64) && defined(HAVE_AVX2)
+    if( speedy_accel & MM_ACCEL_X86_AVX2 ) {
+        if( verbose ) {
+            printf( "speedycode: Using AVX2 optimized planar functions.\n" );
+        }
+        interpolate_plane_scanline = interpolate_plane_scanline_avx2;
+        vfilter_121_plane_scanline = vfilter_121_plane_scanline_avx2;
+        vfir_plane_scanline = vfir_plane_scanline_avx2;
+        greedy_plane_scanline = greedy_plane_scanline_avx2;
     }
 #endif
 }
@@ -310,6 +310,36 @@ extern void (*chroma_422_to_444_mpeg2_plane)( uint8_t *dst, uint8_t *src,
 extern void (*chroma_420_to_422_mpeg2_plane)( uint8_t *dst, uint8_t *src,
                                               int width, int height, int progressive );
 
+/**
+ * Scanline functions for one plane of 8 bit samples, as in YV12.  Here
+ * width is in bytes.
+ */
+
+/**
+ * Interpolates a scanline, rounding up like pavgb.
+ */
+extern void (*interpolate_plane_scanline)( uint8_t *output, uint8_t *top,
+                                           uint8_t *bot, int width );
+
+/**
+ * Vertical [1 2 1] filter: (top + 2*mid + bot) / 4.
+ */
+extern void (*vfilter_121_plane_scanline)( uint8_t *output, uint8_t *top,
+                                           uint8_t *mid, uint8_t *bot, int width );
+
+/**
+ * Vertical [-1 4 2 4 -1] filter, clipped to 0..255.
+ */
+extern void (*vfir_plane_scanline)( uint8_t *output, uint8_t *tt, uint8_t *t,
+                                    uint8_t *m, uint8_t *b, uint8_t *bb, int width );
+
+/**
+ * DScaler greedy low motion: takes whichever of m0 and m2 combs less with
+ * the average of t1 and b1, clipped to the range of t1 and b1 plus a margin.
+ */
+extern void (*greedy_plane_scanline)( uint8_t *output, uint8_t *m0, uint8_t *t1,
+                                      uint8_t *b1, uint8_t *m2, int width );
+
 /**
  * Sets up the function pointers to point at the fastest function
  * available.  Requires accelleration settings (see mm_accel.h).
@@ -103,27 +103,6 @@
  * frame, and in case 2, we only need the previous frame, since the
  * current frame contains both Field 3 and Field 4.
  */
-static void pulldown_merge_fields( uint8_t *output,
-                                   uint8_t *topfield,
-                                   uint8_t *botfield,
-                                   int width,
-                                   int frame_height,
-                                   int fieldstride,
-                                   int outstride )
-{
-    int i;
-
-    for( i = 0; i < frame_height; i++ ) {
-        uint8_t *curoutput = output + (i * outstride);
-
-        if( i & 1 ) {
-            blit_packed422_scanline( curoutput, botfield + ((i / 2) * fieldstride), width );
-        } else {
-            blit_packed422_scanline( curoutput, topfield + ((i / 2) * fieldstride), width );
-        }
-    }
-}
-
 static void calculate_pulldown_score_vektor( tvtime_t *tvtime,
                                              uint8_t *curframe,
                                              uint8_t *lastframe,
@@ -149,18 +128,15 @@ static void calculate_pulldown_score_vektor( tvtime_t *tvtime,
 }
 
 
-int tvtime_build_deinterlaced_frame( tvtime_t *tvtime, uint8_t *output,
-                                             uint8_t *curframe,
-                                             uint8_t *lastframe,
-                                             uint8_t *secondlastframe,
-                                             int bottom_field, int second_field,
-                                             int width,
-                                             int frame_height,
-                                             int instride,
-                                             int outstride )
+int tvtime_pulldown_field( tvtime_t *tvtime,
+                           uint8_t *curframe,
+                           uint8_t *lastframe,
+                           int bottom_field,
+                           int width,
+                           int frame_height,
+                           int instride,
+                           int *topsource, int *botsource )
 {
-    int i;
-
     if( tvtime->pulldown_alg != PULLDOWN_VEKTOR ) {
         /* If we leave vektor pulldown mode, lose our state. */
         tvtime->filmmode = 0;
@@ -211,17 +187,11 @@ int tvtime_build_deinterlaced_frame( tvtime_t *tvtime, uint8_t *output,
                 }
 
                 if( pulldown_drop( tvtime->pdoffset, 0 ) )
-                  return 0;
-
-                if( pulldown_source( tvtime->pdoffset, 0 ) ) {
-                    pulldown_merge_fields( output, lastframe, lastframe + instride,
-                                           width, frame_height, instride*2, outstride );
-                } else {
-                    pulldown_merge_fields( output, curframe, lastframe + instride,
-                                           width, frame_height, instride*2, outstride );
-                }
+                    return TVTIME_DROP;
 
-                return 1;
+                *topsource = pulldown_source( tvtime->pdoffset, 0 ) ? 1 : 0;
+                *botsource = 1;
+                return TVTIME_MERGE;
             } else {
                 if( tvtime->filmmode ) {
                     printf( "Film mode disabled.\n" );
@@ -230,132 +200,182 @@ int tvtime_build_deinterlaced_frame( tvtime_t *tvtime, uint8_t *output,
             }
         } else if( !tvtime->pderror ) {
             if( pulldown_drop( tvtime->pdoffset, 1 ) )
-                return 0;
-
-            if( pulldown_source( tvtime->pdoffset, 1 ) ) {
-                pulldown_merge_fields( output, curframe, lastframe + instride,
-                                       width, frame_height, instride*2, outstride );
-            } else {
-                pulldown_merge_fields( output, curframe, curframe + instride,
-                                       width, frame_height, instride*2, outstride );
-            }
+                return TVTIME_DROP;
 
-            return 1;
+            *topsource = 0;
+            *botsource = pulldown_source( tvtime->pdoffset, 1 ) ? 1 : 0;
+            return TVTIME_MERGE;
         }
     }
 
-    if( !tvtime->curmethod->scanlinemode ) {
-        deinterlace_frame_data_t data;
+    return TVTIME_DEINTERLACE;
+}
 
-        data.f0 = curframe;
-        data.f1 = lastframe;
-        data.f2 = secondlastframe;
+void tvtime_merge_lines( uint8_t *output,
+                         uint8_t *topframe,
+                         uint8_t *botframe,
+                         int width,
+                         int instride,
+                         int outstride,
+                         int planar, int y0, int y1 )
+{
+    int i;
 
-        tvtime->curmethod->deinterlace_frame( output, outstride, &data, bottom_field, second_field,
-                                      width, frame_height );
+    output += y0 * outstride;
+    for( i = y0; i < y1; i++, output += outstride ) {
+        uint8_t *src = (i & 1) ? botframe + ((i | 1) * instride) : topframe + (i * instride);
 
-    } else {
-        int loop_size;
-        int scanline = 0;
+        if( planar ) {
+            speedy_memcpy( output, src, width );
+        } else {
+            blit_packed422_scanline( output, src, width );
+        }
+    }
+}
 
-        if( bottom_field ) {
-            /* Advance frame pointers to the next input line. */
-            curframe += instride;
-            lastframe += instride;
-            secondlastframe += instride;
+/**
+ * Every output line is a copy of the current field (the first lines, and
+ * the last one of top fields), or alternately an interpolate and a copy call
+ * of the method.  Lines do not depend on each other, so any range of them
+ * can be built on its own.
+ */
+void tvtime_build_deinterlaced_lines( tvtime_t *tvtime, uint8_t *output,
+                                      uint8_t *curframe,
+                                      uint8_t *lastframe,
+                                      uint8_t *secondlastframe,
+                                      int bottom_field, int second_field,
+                                      int width,
+                                      int frame_height,
+                                      int instride,
+                                      int outstride,
+                                      int planar, int y0, int y1 )
+{
+    deinterlace_interp_scanline_t interpolate;
+    deinterlace_copy_scanline_t copy;
+    int loop_size = (frame_height - 2) / 2;
+    int y;
+
+    if( planar ) {
+        interpolate = tvtime->curmethod->interpolate_plane;
+        copy = tvtime->curmethod->copy_plane;
+    } else {
+        interpolate = tvtime->curmethod->interpolate_scanline;
+        copy = tvtime->curmethod->copy_scanline;
+    }
 
-            /* Double the top scanline a scanline. */
-            blit_packed422_scanline( output, curframe, width );
+    if( bottom_field ) {
+        /* Advance frame pointers to the next input line. */
+        curframe += instride;
+        lastframe += instride;
+        secondlastframe += instride;
+    }
 
-            output += outstride;
-            scanline++;
+    output += y0 * outstride;
+    for( y = y0; y < y1; y++, output += outstride ) {
+        deinterlace_scanline_data_t data;
+        uint8_t *cur, *last, *secondlast;
+        uint8_t *f1, *f3;
+        int j = y - 1 - bottom_field;
+        int k, first, final;
+
+        if( j < 0 || j >= 2 * loop_size ) {
+            /* Double the top or the bottom scanline. */
+            uint8_t *src = curframe + ((j < 0) ? 0 : (2 * loop_size * instride));
+            if( planar ) {
+                speedy_memcpy( output, src, width );
+            } else {
+                blit_packed422_scanline( output, src, width );
+            }
+            continue;
         }
 
-        /* Copy a scanline. */
-        blit_packed422_scanline( output, curframe, width );
+        k = j >> 1;
+        first = (k == 0);
+        final = (k == loop_size - 1);
+        cur = curframe + (2 * k * instride);
+        last = lastframe + (2 * k * instride);
+        secondlast = secondlastframe + (2 * k * instride);
+        f1 = second_field ? cur : last;
+        f3 = second_field ? last : secondlast;
 
-        output += outstride;
-        scanline++;
+        data.bottom_field = bottom_field;
 
-        /* Something is wrong here. -Billy */
-        loop_size = ((frame_height - 2) / 2);
-        for( i = loop_size; i; --i ) {
-            deinterlace_scanline_data_t data;
+        data.t0 = cur;
+        data.b0 = cur + (instride*2);
 
-            data.bottom_field = bottom_field;
+        data.tt1 = first ? (f1 + instride) : (f1 - instride);
+        data.m1  = f1 + instride;
+        data.bb1 = final ? (f1 + instride) : (f1 + (instride*3));
 
-            data.t0 = curframe;
-            data.b0 = curframe + (instride*2);
+        data.t2 = last;
+        data.b2 = last + (instride*2);
 
-            if( second_field ) {
-                data.tt1 = (i < loop_size) ? (curframe - instride) : (curframe + instride);
-                data.m1  = curframe + instride;
-                data.bb1 = (i > 1) ? (curframe + (instride*3)) : (curframe + instride);
-            } else {
-                data.tt1 = (i < loop_size) ? (lastframe - instride) : (lastframe + instride);
-                data.m1  = lastframe + instride;
-                data.bb1 = (i > 1) ? (lastframe + (instride*3)) : (lastframe + instride);
-            }
+        data.tt3 = first ? (f3 + instride) : (f3 - instride);
+        data.m3  = f3 + instride;
+        data.bb3 = final ? (f3 + instride) : (f3 + (instride*3));
 
-            data.t2 = lastframe;
-            data.b2 = lastframe + (instride*2);
-
-            if( second_field ) {
-                data.tt3 = (i < loop_size) ? (lastframe - instride) : (lastframe + instride);
-                data.m3  = lastframe + instride;
-                data.bb3 = (i > 1) ? (lastframe + (instride*3)) : (lastframe + instride);
-            } else {
-                data.tt3 = (i < loop_size) ? (secondlastframe - instride) : (secondlastframe + instride);
-                data.m3  = secondlastframe + instride;
-                data.bb3 = (i > 1) ? (secondlastframe + (instride*3)) : (secondlastframe + instride);
-            }
+        if( !(j & 1) ) {
+            interpolate( output, &data, width );
+            continue;
+        }
 
-            tvtime->curmethod->interpolate_scanline( output, &data, width );
+        data.tt0 = cur;
+        data.m0  = cur + (instride*2);
+        data.bb0 = final ? (cur + (instride*2)) : (cur + (instride*4));
 
-            output += outstride;
-            scanline++;
+        data.t1 = f1 + instride;
+        data.b1 = final ? (f1 + instride) : (f1 + (instride*3));
 
-            data.tt0 = curframe;
-            data.m0  = curframe + (instride*2);
-            data.bb0 = (i > 1) ? (curframe + (instride*4)) : (curframe + (instride*2));
+        data.tt2 = last;
+        data.m2  = last + (instride*2);
+        data.bb2 = final ? (last + (instride*2)) : (last + (instride*4));
 
-            if( second_field ) {
-                data.t1 = curframe + instride;
-                data.b1 = (i > 1) ? (curframe + (instride*3)) : (curframe + instride);
-            } else {
-                data.t1 = lastframe + instride;
-                data.b1 = (i > 1) ? (lastframe + (instride*3)) : (lastframe + instride);
-            }
+        data.t2 = f3 + instride;
+        data.b2 = final ? (f3 + instride) : (f3 + (instride*3));
 
-            data.tt2 = lastframe;
-            data.m2  = lastframe + (instride*2);
-            data.bb2 = (i > 1) ? (lastframe + (instride*4)) : (lastframe + (instride*2));
+        /* Copy a scanline. */
+        copy( output, &data, width );
+    }
+}
 
-            if( second_field ) {
-                data.t2 = lastframe + instride;
-                data.b2 = (i > 1) ? (lastframe + (instride*3)) : (lastframe + instride);
-            } else {
-                data.t2 = secondlastframe + instride;
-                data.b2 = (i > 1) ? (secondlastframe + (instride*3)) : (secondlastframe + instride);
-            }
+int tvtime_build_deinterlaced_frame( tvtime_t *tvtime, uint8_t *output,
+                                             uint8_t *curframe,
+                                             uint8_t *lastframe,
+                                             uint8_t *secondlastframe,
+                                             int bottom_field, int second_field,
+                                             int width,
+                                             int frame_height,
+                                             int instride,
+                                             int outstride )
+{
+    int topsource, botsource;
+
+    switch( tvtime_pulldown_field( tvtime, curframe, lastframe, bottom_field,
+                                   width, frame_height, instride, &topsource, &botsource ) ) {
+    case TVTIME_DROP:
+        return 0;
+    case TVTIME_MERGE:
+        tvtime_merge_lines( output, topsource ? lastframe : curframe, botsource ? lastframe : curframe,
+                            width, instride, outstride, 0, 0, frame_height );
+        return 1;
+    default:
+        break;
+    }
 
-            /* Copy a scanline. */
-            tvtime->curmethod->copy_scanline( output, &data, width );
-            curframe += instride * 2;
-            lastframe += instride * 2;
-            secondlastframe += instride * 2;
+    if( !tvtime->curmethod->scanlinemode ) {
+        deinterlace_frame_data_t data;
 
-            output += outstride;
-            scanline++;
-        }
+        data.f0 = curframe;
+        data.f1 = lastframe;
+        data.f2 = secondlastframe;
 
-        if( !bottom_field ) {
-            /* Double the bottom scanline. */
-            blit_packed422_scanline( output, curframe, width );
+        tvtime->curmethod->deinterlace_frame( output, outstride, &data, bottom_field, second_field,
+                                      width, frame_height );
 
-            output += outstride;
-            scanline++;
-        }
+    } else {
+        tvtime_build_deinterlaced_lines( tvtime, output, curframe, lastframe, secondlastframe,
+                                         bottom_field, second_field, width, frame_height,
+                                         instride, outstride, 0, 0, (frame_height & ~1) );
     }
 
     return 1;
@@ -44,6 +44,15 @@ enum
     FRAMERATE_MAX = 3
 };
 
+/**
+ * Result of the pulldown decision for a field.
+ */
+enum {
+    TVTIME_DROP = 0,        /* no output for this field. */
+    TVTIME_DEINTERLACE = 1, /* run the deinterlacing method. */
+    TVTIME_MERGE = 2        /* weave the fields given by topsource/botsource. */
+};
+
 
 typedef struct {
   /**
@@ -85,6 +94,51 @@ int tvtime_build_deinterlaced_frame( tvtime_t *this, uint8_t *output,
                                              int instride,
                                              int outstride );
 
+/**
+ * The parts of tvtime_build_deinterlaced_frame() on their own, for callers
+ * that work on several planes or split a frame into bands of lines.
+ *
+ * tvtime_pulldown_field() makes the pulldown decision for a field and must be
+ * called once per field.  For TVTIME_MERGE, *topsource and *botsource are 0
+ * for curframe and 1 for lastframe.
+ */
+int tvtime_pulldown_field( tvtime_t *this,
+                           uint8_t *curframe,
+                           uint8_t *lastframe,
+                           int bottom_field,
+                           int width,
+                           int frame_height,
+                           int instride,
+                           int *topsource, int *botsource );
+
+/**
+ * Build output lines y0 .. y1-1 of a scanline mode method.  With planar set,
+ * the method's plane functions are used and width is in bytes, else width
+ * is in packed 4:2:2 pixels.
+ */
+void tvtime_build_deinterlaced_lines( tvtime_t *this, uint8_t *output,
+                                      uint8_t *curframe,
+                                      uint8_t *lastframe,
+                                      uint8_t *secondlastframe,
+                                      int bottom_field, int second_field,
+                                      int width,
+                                      int frame_height,
+                                      int instride,
+                                      int outstride,
+                                      int planar, int y0, int y1 );
+
+/**
+ * Weave lines y0 .. y1-1 from the top field of topframe and the bottom
+ * field of botframe.
+ */
+void tvtime_merge_lines( uint8_t *output,
+                         uint8_t *topframe,
+                         uint8_t *botframe,
+                         int width,
+                         int instride,
+                         int outstride,
+                         int planar, int y0, int y1 );
+
 
 int tvtime_build_copied_field( tvtime_t *this, uint8_t *output,
                                        uint8_t *curframe,
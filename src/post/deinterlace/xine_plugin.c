@@ -311,6 +311,7 @@ static void *deinterlace_init_plugin(xine_t *xine, const void *data)
   register_deinterlace_method( &class->methods, scalerbob_get_method() );
   register_deinterlace_method( &class->methods, dscaler_greedyh_get_method() );
   register_deinterlace_method( &class->methods, dscaler_tomsmocomp_get_method() );
+  register_deinterlace_method( &class->methods, yadif_get_method() );
 
   filter_deinterlace_methods( &class->methods, config_flags, 5 /*fieldsavailable*/ );
   if( !get_num_deinterlace_methods( class->methods ) ) {
@@ -408,6 +409,7 @@ static post_plugin_t *deinterlace_open_plugin(post_class_t *class_gen, int input
   port->new_port.flush        = deinterlace_flush;
   port->intercept_frame       = deinterlace_intercept_frame;
   port->new_frame->draw       = deinterlace_draw;
+  port->need_all_frames       = 1;
 
   xine_list_push_back(this->post.input, (void *)&params_input);
 
@@ -558,6 +560,121 @@ static void apply_chroma_filter( uint8_t *data, int stride, int width, int heigh
   }
 }
 
+/* chroma filter for the U and V planes of YV12 output */
+static void apply_chroma_filter_plane( uint8_t *data, int stride, int width, int height )
+{
+  int i, x;
+
+  for( i = 0; i < height; i++, data += stride ) {
+    const uint8_t *above = (i) ? (data - stride) : data;
+    const uint8_t *below = (i < height-1) ? (data + stride) : data;
+
+    for( x = 0; x < width; x++ )
+      data[x] = (3 * above[x] + 3 * data[x] + 2 * below[x]) >> 3;
+  }
+}
+
+static void deinterlace_chroma_filter( vo_frame_t *frame, int width, int height )
+{
+  if( frame->format == XINE_IMGFMT_YUY2 ) {
+    apply_chroma_filter( frame->base[0], frame->pitches[0], width, height );
+  } else {
+    apply_chroma_filter_plane( frame->base[1], frame->pitches[1], width / 2, height / 2 );
+    apply_chroma_filter_plane( frame->base[2], frame->pitches[2], width / 2, height / 2 );
+  }
+}
+
+/* Methods with plane functions deinterlace YV12 without a conversion to YUY2. */
+static int deinterlace_method_planar( const deinterlace_method_t *method )
+{
+  return method->scanlinemode && method->interpolate_plane && method->copy_plane;
+}
+
+/* One field of a scanline mode method, split into bands of lines. */
+typedef struct {
+  tvtime_t   *tvtime;
+  vo_frame_t *output;
+  vo_frame_t *cur, *last, *secondlast;
+  int         bottom_field, second_field;
+  int         merge, topsource, botsource;
+  int         planar, num_planes;
+  int         width[3], height[3];
+} deinterlace_job_t;
+
+static void deinterlace_slice( void *data, int band, int start, int end )
+{
+  deinterlace_job_t *job = (deinterlace_job_t *)data;
+  int i;
+
+  (void)band;
+  for( i = 0; i < job->num_planes; i++ ) {
+    int y0 = i ? start / 2 : start;
+    int y1 = i ? end / 2 : end;
+
+    if( job->merge ) {
+      tvtime_merge_lines( job->output->base[i],
+                          (job->topsource ? job->last : job->cur)->base[i],
+                          (job->botsource ? job->last : job->cur)->base[i],
+                          job->width[i], job->cur->pitches[i], job->output->pitches[i],
+                          job->planar, y0, y1 );
+    } else {
+      tvtime_build_deinterlaced_lines( job->tvtime, job->output->base[i],
+                          job->cur->base[i], job->last->base[i], job->secondlast->base[i],
+                          job->bottom_field, job->second_field, job->width[i], job->height[i],
+                          job->cur->pitches[i], job->output->pitches[i],
+                          job->planar, y0, y1 );
+    }
+  }
+}
+
+static int deinterlace_build_lines( post_plugin_deinterlace_t *this,
+                                    vo_frame_t *deinterlaced_frame, vo_frame_t *frame,
+                                    vo_frame_t *yuy2_frame, int bottom_field, int second_field )
+{
+  deinterlace_job_t job;
+
+  job.tvtime       = this->tvtime;
+  job.output       = deinterlaced_frame;
+  job.cur          = yuy2_frame;
+  job.last         = (this->recent_frame[0]) ? this->recent_frame[0] : yuy2_frame;
+  job.secondlast   = (this->recent_frame[1]) ? this->recent_frame[1] : yuy2_frame;
+  job.bottom_field = bottom_field;
+  job.second_field = second_field;
+  job.merge        = 0;
+  job.topsource    = job.botsource = 0;
+
+  if( yuy2_frame->format == XINE_IMGFMT_YUY2 ) {
+    job.planar     = 0;
+    job.num_planes = 1;
+    job.width[0]   = frame->width;
+    job.height[0]  = frame->height;
+  } else {
+    job.planar     = deinterlace_method_planar( this->tvtime->curmethod );
+    job.num_planes = 3;
+    /* packed functions on planes (cheap mode) work on 2 bytes per pixel */
+    job.width[0]   = job.planar ? frame->width : frame->width / 2;
+    job.width[1]   = job.width[2] = job.width[0] / 2;
+    job.height[0]  = frame->height;
+    job.height[1]  = job.height[2] = frame->height / 2;
+  }
+
+  /* pulldown decision is made once per field, from the luma plane */
+  switch( tvtime_pulldown_field( this->tvtime, job.cur->base[0], job.last->base[0], bottom_field,
+                                 job.planar ? frame->width / 2 : job.width[0], frame->height,
+                                 job.cur->pitches[0], &job.topsource, &job.botsource ) ) {
+  case TVTIME_DROP:
+    return 0;
+  case TVTIME_MERGE:
+    job.merge = 1;
+    break;
+  default:
+    break;
+  }
+
+  _x_post_slices( &this->post, frame->height & ~1, 2, deinterlace_slice, &job );
+  return 1;
+}
+
 /* Build the output frame from the specified field. */
 static int deinterlace_build_output_field(
              post_plugin_deinterlace_t *this, post_video_port_t *port,
@@ -617,6 +734,9 @@ static int deinterlace_build_output_field(
                            frame->width/4, frame->height/2,
                            yuy2_frame->pitches[2], deinterlaced_frame->pitches[2] );
       }
+    } else if( this->tvtime->curmethod->scanlinemode ) {
+      deinterlaced_frame->bad_frame = !deinterlace_build_lines( this, deinterlaced_frame, frame,
+                                                                yuy2_frame, bottom_field, second_field );
     } else {
       if( yuy2_frame->format == XINE_IMGFMT_YUY2 ) {
         deinterlaced_frame->bad_frame = !tvtime_build_deinterlaced_frame(this->tvtime,
@@ -663,8 +783,8 @@ static int deinterlace_build_output_field(
         deinterlaced_frame->pts = 0;
       deinterlaced_frame->duration = FPS_24_DURATION;
       if( this->chroma_filter && !this->cheap_mode )
-        apply_chroma_filter( deinterlaced_frame->base[0], deinterlaced_frame->pitches[0],
-                             frame->width, frame->height / scaler );
+        deinterlace_chroma_filter( deinterlaced_frame, frame->width, frame->height / scaler );
+      _x_post_frame_writable(deinterlaced_frame);
       skip = deinterlaced_frame->draw(deinterlaced_frame, stream);
     } else {
       skip = 0;
@@ -673,8 +793,8 @@ static int deinterlace_build_output_field(
     deinterlaced_frame->pts = pts;
     deinterlaced_frame->duration = duration;
     if( this->chroma_filter && !this->cheap_mode && !deinterlaced_frame->bad_frame )
-      apply_chroma_filter( deinterlaced_frame->base[0], deinterlaced_frame->pitches[0],
-                           frame->width, frame->height / scaler );
+      deinterlace_chroma_filter( deinterlaced_frame, frame->width, frame->height / scaler );
+    _x_post_frame_writable(deinterlaced_frame);
     skip = deinterlaced_frame->draw(deinterlaced_frame, stream);
   }
 
@@ -761,7 +881,8 @@ static int deinterlace_draw(vo_frame_t *frame, xine_stream_t *stream)
     frame->flags &= ~VO_INTERLACED_FLAG;
 
     /* convert to YUY2 if needed */
-    if( frame->format == XINE_IMGFMT_YV12 && !this->cheap_mode ) {
+    if( frame->format == XINE_IMGFMT_YV12 && !this->cheap_mode &&
+        !deinterlace_method_planar( this->tvtime->curmethod ) ) {
 
       yuy2_frame = port->original_port->get_frame(port->original_port,
         frame->width, frame->height, frame->ratio, XINE_IMGFMT_YUY2, frame->flags | VO_BOTH_FIELDS);
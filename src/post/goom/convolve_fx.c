@@ -6,10 +6,13 @@
 #include "goom_plugin_info.h"
 /*#include "goomsl.h"*/
 #include "goom_config.h"
+#include "cpu_info.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <xine/attributes.h>
 
 //#define CONV_MOTIF_W 32
 //#define CONV_MOTIF_WMASK 0x1f
@@ -43,6 +46,7 @@ typedef struct _CONV_DATA{
   float visibility;
   Motif conv_motif;
   int   inverse_motif;
+  int   sse2;
   
 } ConvData;
 
@@ -106,6 +110,7 @@ static void convolve_init(VisualFX *_this, PluginInfo *info) {
   data->visibility = 1.0;
   set_motif(data, CONV_MOTIF2.motif);
   data->inverse_motif = 0;
+  data->sse2 = (cpu_flavour() & CPU_OPTION_SSE2) != 0;
 
   _this->params = &data->params;
 }
@@ -118,133 +123,117 @@ static void convolve_free(VisualFX *_this) {
   }
 }
 
-static void create_output_with_brightness(VisualFX *_this, Pixel *src, Pixel *dest,
-                                         PluginInfo *info, int iff)
-{
-  ConvData *data = (ConvData*)_this->fx_data;
-  
-  int x,y;
-  int i = 0;//info->screen.height * info->screen.width - 1;
-
-  const int c = data->h_cos [data->theta];
-  const int s = data->h_sin [data->theta];
-
-  const int xi = -(info->screen.width/2) * c;
-  const int yi =  (info->screen.width/2) * s;
-
-  const int xj = -(info->screen.height/2) * s;
-  const int yj = -(info->screen.height/2) * c;
+#if defined(HAVE_MMX) && defined(ARCH_X86)
+static const uint16_t conv_sse2_const[16] ATTR_ALIGN(16) = {
+  /* saturation to 255 */
+  0xff00, 0xff00, 0xff00, 0xff00, 0xff00, 0xff00, 0xff00, 0xff00,
+  /* clears the alpha channel */
+#if A_OFFSET == 0
+  0xff00, 0xffff, 0xff00, 0xffff, 0xff00, 0xffff, 0xff00, 0xffff
+#else
+  0xffff, 0x00ff, 0xffff, 0x00ff, 0xffff, 0x00ff, 0xffff, 0x00ff
+#endif
+};
 
-  int xprime = xj;
-  int yprime = yj;
+/* dest = src * iff2 >> 8 like the C code, for n / 4 groups of 4 pixels.
+ * iff2 is clamped to 0..65535 which does not change the saturated result. */
+static void brightness_sse2 (const Pixel *src, Pixel *dest, const uint16_t *iff2, intptr_t n)
+{
+  __asm__ __volatile__ (
+    "pxor      %%xmm7, %%xmm7         \n\t"
+    "movdqa      (%4), %%xmm6         \n\t"
+    "movdqa    16(%4), %%xmm5         \n\t"
+    "1:\n\t"
+    "movq      (%3), %%xmm2           \n\t"
+    "movdqu    (%1), %%xmm0           \n\t"
+    "punpcklwd %%xmm2, %%xmm2         \n\t"
+    "movdqa    %%xmm0, %%xmm1         \n\t"
+    "punpcklbw %%xmm7, %%xmm0         \n\t"
+    "punpckhbw %%xmm7, %%xmm1         \n\t"
+    "pshufd    $0x50, %%xmm2, %%xmm3  \n\t"
+    "pshufd    $0xfa, %%xmm2, %%xmm2  \n\t"
+    "psllw     $8, %%xmm0             \n\t"
+    "psllw     $8, %%xmm1             \n\t"
+    "pmulhuw   %%xmm3, %%xmm0         \n\t"
+    "pmulhuw   %%xmm2, %%xmm1         \n\t"
+    "paddusw   %%xmm6, %%xmm0         \n\t"
+    "paddusw   %%xmm6, %%xmm1         \n\t"
+    "psubw     %%xmm6, %%xmm0         \n\t"
+    "psubw     %%xmm6, %%xmm1         \n\t"
+    "packuswb  %%xmm1, %%xmm0         \n\t"
+    "pand      %%xmm5, %%xmm0         \n\t"
+    "movdqu    %%xmm0, (%2)           \n\t"
+    "add       $16, %1                \n\t"
+    "add       $16, %2                \n\t"
+    "add       $8, %3                 \n\t"
+    "sub       $4, %0                 \n\t"
+    "jnz       1b                     \n\t"
+    : "+r" (n), "+r" (src), "+r" (dest), "+r" (iff2)
+    : "r" (conv_sse2_const)
+    : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7");
+}
+#endif
 
+typedef struct {
+  ConvData *data;
+  Pixel *src, *dest;
+  int width;
+  int c, s, xi, yi, xj, yj;
   int ifftab[16];
-  if (data->inverse_motif) {
-    int i;
-    for (i=0;i<16;++i)
-      ifftab[i] = (double)iff * (1.0 + data->visibility * (15.0 - i) / 15.0);
-  }
-  else {
-    int i;
-    for (i=0;i<16;++i)
-      ifftab[i] = (double)iff / (1.0 + data->visibility * (15.0 - i) / 15.0);
-  }
+} ConvSlice;
 
-  for (y=info->screen.height;y--;) {
-    int xtex,ytex;
-
-    xtex = xprime + xi + CONV_MOTIF_W * 0x10000 / 2;
-    xprime += s;
-
-    ytex = yprime + yi + CONV_MOTIF_W * 0x10000 / 2;
-    yprime += c;
-
-#if defined(HAVE_MMX) && !defined(__sun)
-
-    __asm__ __volatile__
-      ("\n\t pxor      %%mm7, %%mm7"  /* mm7 = 0 */
-       "\n\t movd      %0,    %%mm2"
-       "\n\t movd      %1,    %%mm3"
-       "\n\t punpckldq %%mm3, %%mm2"  /* mm2 = [ ytex | xtex ] */
-       "\n\t movd      %2,    %%mm4"
-       "\n\t movd      %3,    %%mm6"
-       "\n\t pxor      %%mm5, %%mm5"
-       "\n\t psubd     %%mm6, %%mm5"
-       "\n\t punpckldq %%mm5, %%mm4"  /* mm4 = [ -s | c ] */
-#if defined(ARCH_X86_64)
-       "\n\t movq      %4,    %%mm6"  /* mm6 = motif */
-#else
-       "\n\t movd      %4,    %%mm6"  /* mm6 = motif */
-#endif
-       ::"g"(xtex) ,"g"(ytex)
-        , "g"(c), "g"(s)
-        , "g"(&data->conv_motif[0][0]));
-    
-    for (x=info->screen.width;x--;)
-    {
-      __asm__ __volatile__
-        (
-         "\n\t movd  %1,    %%mm0"   /* mm0 = src */
-         "\n\t paddd %%mm4, %%mm2"   /* [ ytex | xtex ] += [ -s | s ] */
-#if defined(ARCH_X86_64) || defined(ARCH_X86_X32)
-         "\n\t movq  %%rsi, %%mm5"   /* save rsi into mm5 */
-#else
-         "\n\t movd  %%esi, %%mm5"   /* save esi into mm5 */
-#endif
-         "\n\t movq  %%mm2, %%mm3"
-         "\n\t psrld $16,   %%mm3"   /* mm3 = [ (ytex>>16) | (xtex>>16) ] */
-         "\n\t movd  %%mm3, %%eax"   /* eax = xtex' */
-
-         "\n\t psrlq $25,   %%mm3"
-         "\n\t movd  %%mm3, %%ecx"   /* ecx = ytex' << 7 */
-
-         "\n\t andl  $127,   %%eax"
-         "\n\t andl  $16256, %%ecx"
-         
-         "\n\t addl  %%ecx, %%eax"
-#if defined(ARCH_X86_64)
-         "\n\t movq   %%mm6, %%rsi"          /* rsi = motif */
-         "\n\t movzbl (%%rax,%%rsi), %%ecx"
-         "\n\t movq   %2,    %%rax"
-         "\n\t movq   %%mm5, %%rsi"          /* restore rsi from mm5 */
-         "\n\t movd  (%%rax,%%rcx,4), %%mm1" /* mm1 = [0|0|0|iff2] */
-#elif defined(ARCH_X86_X32)
-         "\n\t movd   %%mm6, %%esi"          /* esi = motif */
-         "\n\t movzbl (%%rax,%%rsi), %%ecx"
-         "\n\t movl   %2,    %%eax"
-         "\n\t movq   %%mm5, %%rsi"          /* restore rsi from mm5 */
-         "\n\t movd  (%%rax,%%rcx,4), %%mm1" /* mm1 = [0|0|0|iff2] */
-#else
-         "\n\t movd   %%mm6, %%esi"          /* esi = motif */
-         "\n\t movzbl (%%eax,%%esi), %%ecx"
-         "\n\t movl   %2,    %%eax"
-         "\n\t movd   %%mm5, %%esi"          /* restore esi from mm5 */
-         "\n\t movd  (%%eax,%%ecx,4), %%mm1" /* mm1 = [0|0|0|iff2] */
-#endif
+#define sat(a) ((a)>0xFF?0xFF:(a))
 
-         "\n\t punpcklwd %%mm1, %%mm1"
-         "\n\t punpcklbw %%mm7, %%mm0"
-         "\n\t punpckldq %%mm1, %%mm1"
-         "\n\t psrlw     $1,    %%mm0"
-         "\n\t psrlw     $2,    %%mm1"
-         "\n\t pmullw    %%mm1, %%mm0"
-         "\n\t psrlw     $5,    %%mm0"
-         "\n\t packuswb  %%mm7, %%mm0"
-         "\n\t movd      %%mm0, %0"
-         : "=g" (dest[i].val)
-         : "g"  (src[i].val), "g"(&ifftab[0])
-         :
-#if defined(ARCH_X86_64) || defined(ARCH_X86_X32)
-         "rax", "rcx"
-#else
-         "eax", "ecx"
-#endif
-      );
-      i++;
+static void brightness_slice (void *job_gen, int band, int y0, int y1)
+{
+  ConvSlice *job = (ConvSlice *)job_gen;
+  const ConvData *data = job->data;
+  const int c = job->c, s = job->s;
+  int x, y;
+
+  (void)band;
+
+  for (y = y0; y < y1; y++) {
+    /* the rotozoom state at the start of row y */
+    int xtex = job->xj + y * s + job->xi + CONV_MOTIF_W * 0x10000 / 2;
+    int ytex = job->yj + y * c + job->yi + CONV_MOTIF_W * 0x10000 / 2;
+    const Pixel *src = job->src + y * job->width;
+    Pixel *dest = job->dest + y * job->width;
+
+#if defined(HAVE_MMX) && defined(ARCH_X86)
+    if (data->sse2) {
+      uint16_t f[64] ATTR_ALIGN(16);
+
+      for (x = 0; x < job->width; x += 64) {
+        int i, n = job->width - x;
+
+        if (n > 64)
+          n = 64;
+        for (i = 0; i < n; i++) {
+          int iff2;
+
+          xtex += c;
+          ytex -= s;
+          iff2 = job->ifftab[data->conv_motif[(ytex >>16) & CONV_MOTIF_WMASK][(xtex >> 16) & CONV_MOTIF_WMASK]];
+          f[i] = iff2 < 0 ? 0 : iff2 > 0xffff ? 0xffff : iff2;
+        }
+        if (n & ~3)
+          brightness_sse2 (src + x, dest + x, f, n & ~3);
+        for (i = n & ~3; i < n; i++) {
+          unsigned int f0, f1, f2, f3;
+
+          f0 = src[x + i].val;
+          f1 = ((f0 >> R_OFFSET) & 0xFF) * f[i] >> 8;
+          f2 = ((f0 >> G_OFFSET) & 0xFF) * f[i] >> 8;
+          f3 = ((f0 >> B_OFFSET) & 0xFF) * f[i] >> 8;
+          dest[x + i].val = (sat(f1) << R_OFFSET) | (sat(f2) << G_OFFSET) | (sat(f3) << B_OFFSET);
+        }
+      }
+      continue;
     }
+#endif
 
-#else
-    for (x=info->screen.width;x--;) {
+    for (x = 0; x < job->width; x++) {
 
       int iff2;
       unsigned int f0,f1,f2,f3;
@@ -252,32 +241,48 @@ static void create_output_with_brightness(VisualFX *_this, Pixel *src, Pixel *de
       xtex += c;
       ytex -= s;
       
-      iff2 = ifftab[data->conv_motif[(ytex >>16) & CONV_MOTIF_WMASK][(xtex >> 16) & CONV_MOTIF_WMASK]];
+      iff2 = job->ifftab[data->conv_motif[(ytex >>16) & CONV_MOTIF_WMASK][(xtex >> 16) & CONV_MOTIF_WMASK]];
 
-#define sat(a) ((a)>0xFF?0xFF:(a))
-      f0 = src[i].val;
+      f0 = src[x].val;
       f1 = ((f0 >> R_OFFSET) & 0xFF) * iff2 >> 8;
       f2 = ((f0 >> G_OFFSET) & 0xFF) * iff2 >> 8;
       f3 = ((f0 >> B_OFFSET) & 0xFF) * iff2 >> 8;
-      dest[i].val = (sat(f1) << R_OFFSET) | (sat(f2) << G_OFFSET) | (sat(f3) << B_OFFSET);
-/*
-      f0 = (src[i].cop[0] * iff2) >> 8;
-      f1 = (src[i].cop[1] * iff2) >> 8;
-      f2 = (src[i].cop[2] * iff2) >> 8;
-      f3 = (src[i].cop[3] * iff2) >> 8;
-
-      dest[i].cop[0] = (f0 & 0xffffff00) ? 0xff : (unsigned char)f0;
-      dest[i].cop[1] = (f1 & 0xffffff00) ? 0xff : (unsigned char)f1;
-      dest[i].cop[2] = (f2 & 0xffffff00) ? 0xff : (unsigned char)f2;
-      dest[i].cop[3] = (f3 & 0xffffff00) ? 0xff : (unsigned char)f3;
-*/
-      i++;
+      dest[x].val = (sat(f1) << R_OFFSET) | (sat(f2) << G_OFFSET) | (sat(f3) << B_OFFSET);
     }
-#endif 
   }
-#ifdef HAVE_MMX
-  __asm__ __volatile__ ("\n\t emms");
-#endif
+}
+
+static void create_output_with_brightness(VisualFX *_this, Pixel *src, Pixel *dest,
+                                         PluginInfo *info, int iff)
+{
+  ConvData *data = (ConvData*)_this->fx_data;
+  ConvSlice job;
+  int i;
+
+  job.data  = data;
+  job.src   = src;
+  job.dest  = dest;
+  job.width = info->screen.width;
+
+  job.c = data->h_cos [data->theta];
+  job.s = data->h_sin [data->theta];
+
+  job.xi = -(info->screen.width/2) * job.c;
+  job.yi =  (info->screen.width/2) * job.s;
+
+  job.xj = -(info->screen.height/2) * job.s;
+  job.yj = -(info->screen.height/2) * job.c;
+
+  if (data->inverse_motif) {
+    for (i=0;i<16;++i)
+      job.ifftab[i] = (double)iff * (1.0 + data->visibility * (15.0 - i) / 15.0);
+  }
+  else {
+    for (i=0;i<16;++i)
+      job.ifftab[i] = (double)iff / (1.0 + data->visibility * (15.0 - i) / 15.0);
+  }
+
+  plugin_info_slices (info, info->screen.height, 1, brightness_slice, &job);
     
   compute_tables(_this, info);
 }
@@ -15,6 +15,7 @@
 
 #ifdef CPU_X86
 #include "mmx.h"
+#include <xine/xineutils.h>
 #endif
 
 #ifdef CPU_POWERPC
@@ -59,6 +60,11 @@ static void autoset_cpu_info (void)
 #ifdef CPU_X86
     if (mmx_supported()) CPU_FLAVOUR |= CPU_OPTION_MMX;
     if (xmmx_supported()) CPU_FLAVOUR |= CPU_OPTION_XMMX;
+    {
+        uint32_t accel = xine_mm_accel();
+        if (accel & MM_ACCEL_X86_SSE2) CPU_FLAVOUR |= CPU_OPTION_SSE2;
+        if (accel & MM_ACCEL_X86_AVX2) CPU_FLAVOUR |= CPU_OPTION_AVX2;
+    }
 #endif /* CPU_X86 */
 }
 
@@ -26,6 +26,7 @@ unsigned int cpu_flavour (void);
 #define CPU_OPTION_SSE      0x10
 #define CPU_OPTION_SSE2     0x20
 #define CPU_OPTION_3DNOW    0x40
+#define CPU_OPTION_AVX2     0x80
 
 
 /* Returns the CPU number */
@@ -87,12 +87,17 @@ static inline void getPixelRGB_ (Pixel *buffer, Uint x, Color * c)
 /* faire : a / sqrtperte <=> a >> PERTEDEC */
 #define PERTEDEC 4
 
-/* pure c version of the zoom filter */
-static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned int prevY, signed int *brutS, signed int *brutD, int buffratio, int precalCoef[BUFFPOINTNB][BUFFPOINTNB]);
+/* pure c version of the zoom filter, dest rows [y0, y1) */
+static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned int prevY, signed int *brutS, signed int *brutD, int buffratio, int precalCoef[BUFFPOINTNB][BUFFPOINTNB], int y0, int y1);
 
 /* simple wrapper to give it the same proto than the others */
 void zoom_filter_c (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]) {
-    c_zoom(src, dest, sizeX, sizeY, brutS, brutD, buffratio, precalCoef);
+    src[0].val = src[sizeX-1].val = src[sizeX*sizeY-1].val = src[sizeX*sizeY-sizeX].val = 0;
+    c_zoom(src, dest, sizeX, sizeY, brutS, brutD, buffratio, precalCoef, 0, sizeY);
+}
+
+void zoom_rows_c (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16], int y0, int y1) {
+    c_zoom(src, dest, sizeX, sizeY, brutS, brutD, buffratio, precalCoef, y0, y1);
 }
 
 static void generatePrecalCoef (int precalCoef[BUFFPOINTNB][BUFFPOINTNB]);
@@ -405,19 +410,17 @@ static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, int INTERLACE_I
 
 
 static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned int prevY, signed int *brutS, signed int *brutD,
-                    int buffratio, int precalCoef[16][16])
+                    int buffratio, int precalCoef[16][16], int y0, int y1)
 {
     int     myPos, myPos2;
     Color   couleur;
     
     unsigned int ax = (prevX - 1) << PERTEDEC, ay = (prevY - 1) << PERTEDEC;
     
-    int     bufsize = prevX * prevY * 2;
+    int     bufsize = prevX * y1 * 2;
     int     bufwidth = prevX;
     
-    expix1[0].val=expix1[prevX-1].val=expix1[prevX*prevY-1].val=expix1[prevX*prevY-prevX].val=0;
-    
-    for (myPos = 0; myPos < bufsize; myPos += 2) {
+    for (myPos = prevX * y0 * 2; myPos < bufsize; myPos += 2) {
         Color   col1, col2, col3, col4;
         int     c1, c2, c3, c4, px, py;
         int     pos;
@@ -525,6 +528,22 @@ static void generateTheWaterFXHorizontalDirectionBuffer(PluginInfo *goomInfo, Zo
  *  So that is why you have this name, for the nostalgy of the first days of goom
  *  when it was just a tiny program writen in Turbo Pascal on my i486...
  */
+typedef struct {
+    PluginInfo *goomInfo;
+    ZoomFilterFXWrapperData *data;
+    Pixel *src, *dest;
+} ZoomSlice;
+
+static void zoom_slice (void *job_gen, int band, int y0, int y1)
+{
+    ZoomSlice *job = (ZoomSlice *)job_gen;
+    ZoomFilterFXWrapperData *data = job->data;
+    
+    (void)band;
+    job->goomInfo->methods.zoom_rows (data->prevX, data->prevY, job->src, job->dest,
+                                      data->brutS, data->brutD, data->buffratio, data->precalCoef, y0, y1);
+}
+
 void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFilterData * zf, Uint resx, Uint resy, int switchIncr, float switchMult)
 {
     Uint x, y;
@@ -644,8 +663,19 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
     
     data->zoom_width = data->prevX;
     
-    goomInfo->methods.zoom_filter (data->prevX, data->prevY, pix1, pix2,
-                                   data->brutS, data->brutD, data->buffratio, data->precalCoef);
+    if (goomInfo->methods.zoom_rows) {
+        ZoomSlice job;
+        
+        job.goomInfo = goomInfo;
+        job.data = data;
+        job.src  = pix1;
+        job.dest = pix2;
+        pix1[0].val = pix1[resx-1].val = pix1[resx*resy-1].val = pix1[resx*resy-resx].val = 0;
+        plugin_info_slices (goomInfo, resy, 1, zoom_slice, &job);
+    }
+    else
+        goomInfo->methods.zoom_filter (data->prevX, data->prevY, pix1, pix2,
+                                       data->brutS, data->brutD, data->buffratio, data->precalCoef);
 }
 
 static void generatePrecalCoef (int precalCoef[16][16])
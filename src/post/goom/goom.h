@@ -25,6 +25,19 @@ guint32 *goom_update (PluginInfo *goomInfo, gint16 data[2][512], int forceMode,
 /* returns 0 if the buffer wasn't accepted */
 int goom_set_screenbuffer(PluginInfo *goomInfo, void *buffer);
 
+/* xine: let goom_update () split its full screen passes into bands of rows,
+ * and hand them to run (). run must call func on all rows 0..n-1, with band
+ * borders at multiples of align, and return when all bands are done. */
+void goom_set_slices (PluginInfo *goomInfo,
+                      void (*run) (void *user, int n, int align, GoomSliceFunc func, void *data),
+                      void *user);
+
+/* xine: make the next goom_update () calls write their image to the given
+ * YV12 planes, using a "bgra" ("argb" on big endian) rgb2yuy2 converter.
+ * The screen buffer is not filled then. planes == NULL switches back. */
+void goom_set_yv12_buffer (PluginInfo *goomInfo, void *rgb2yuy2,
+                           unsigned char *const planes[3], const int pitches[3]);
+
 void goom_close (PluginInfo *goomInfo);
 
 #endif
@@ -142,6 +142,47 @@ int goom_set_screenbuffer(PluginInfo *goomInfo, void *buffer)
   return 1;
 }
 
+void goom_set_slices (PluginInfo *goomInfo,
+                      void (*run) (void *user, int n, int align, GoomSliceFunc func, void *data),
+                      void *user)
+{
+  goomInfo->slices.run  = run;
+  goomInfo->slices.user = user;
+}
+
+void goom_set_yv12_buffer (PluginInfo *goomInfo, void *rgb2yuy2,
+                           unsigned char *const planes[3], const int pitches[3])
+{
+  int i;
+
+  goomInfo->yv12.rgb2yuy2 = rgb2yuy2;
+  for (i = 0; i < 3; i++) {
+    goomInfo->yv12.planes[i]  = planes ? planes[i] : NULL;
+    goomInfo->yv12.pitches[i] = planes ? pitches[i] : 0;
+  }
+}
+
+typedef struct {
+  PluginInfo *goomInfo;
+  const Pixel *src;
+} YV12Slice;
+
+static void yv12_slice (void *job_gen, int band, int start, int end)
+{
+  YV12Slice *job = (YV12Slice *)job_gen;
+  PluginInfo *goomInfo = job->goomInfo;
+  unsigned char *const *planes = goomInfo->yv12.planes;
+  const int *pitches = goomInfo->yv12.pitches;
+
+  (void)band;
+  rgb2yv12_slice (goomInfo->yv12.rgb2yuy2,
+                  (const uint8_t *)(job->src + start * goomInfo->screen.width), 4 * goomInfo->screen.width,
+                  planes[0] + start * pitches[0], pitches[0],
+                  planes[1] + start / 2 * pitches[1], pitches[1],
+                  planes[2] + start / 2 * pitches[2], pitches[2],
+                  goomInfo->screen.width, end - start);
+}
+
 /********************************************
 *                  UPDATE                  *
 ********************************************
@@ -746,6 +787,15 @@ guint32 *goom_update (PluginInfo *goomInfo, gint16 data[2][512],
         /*
         goomInfo->convolve_fx.apply(&goomInfo->convolve_fx,return_val,goomInfo->outputBuf,goomInfo);
         */
+        if (goomInfo->yv12.planes[0]) {
+            /* xine: convert straight from the render buffer, in bands */
+            YV12Slice job;
+
+            job.goomInfo = goomInfo;
+            job.src = return_val;
+            plugin_info_slices (goomInfo, goomInfo->screen.height, 2, yv12_slice, &job);
+            return (guint32*)return_val;
+        }
         xine_fast_memcpy(goomInfo->outputBuf, return_val, goomInfo->screen.size * sizeof(Pixel));
 
         
@@ -26,6 +26,9 @@ typedef struct {
 
 #define STATES_MAX_NB 128
 
+/* runs on rows [start, end) of a slice, band numbers the slice */
+typedef void (*GoomSliceFunc) (void *data, int band, int start, int end);
+
 /**
  * Gives informations about the sound.
  */
@@ -161,7 +164,23 @@ struct _PLUGIN_INFO {
 	struct {
 		void (*draw_line) (Pixel *data, int x1, int y1, int x2, int y2, int col, int screenx, int screeny);
 		void (*zoom_filter) (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+		/* zoom_filter for dest rows [y0, y1) only. does not clear the corners of src.
+		 * NULL if there is just the whole image version. */
+		void (*zoom_rows) (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16], int y0, int y1);
 	} methods;
+
+	/** xine: row parallel processing, see goom_set_slices () */
+	struct {
+		void (*run) (void *user, int n, int align, GoomSliceFunc func, void *data);
+		void *user;
+	} slices;
+
+	/** xine: YV12 output, see goom_set_yv12_buffer () */
+	struct {
+		void *rgb2yuy2;
+		unsigned char *planes[3];
+		int pitches[3];
+	} yv12;
 	
 	GoomRandom *gRandom;
     
@@ -174,6 +193,9 @@ struct _PLUGIN_INFO {
 
 void plugin_info_init(PluginInfo *p, int nbVisual); 
 
+/* runs func on rows 0..n-1, in bands starting at multiples of align */
+void plugin_info_slices(PluginInfo *p, int n, int align, GoomSliceFunc func, void *data);
+
 /* i = [0..p->nbVisual-1] */
 void plugin_info_add_visual(PluginInfo *p, int i, VisualFX *visual);
 
@@ -21,6 +21,7 @@
 
 #ifdef CPU_X86
 #include "mmx.h"
+#include "sse2.h"
 #endif /* CPU_X86 */
 
 
@@ -34,15 +35,26 @@ static void setOptimizedMethods(PluginInfo *p) {
     /* set default methods */
     p->methods.draw_line = draw_line;
     p->methods.zoom_filter = zoom_filter_c;
+    p->methods.zoom_rows = zoom_rows_c;
 /*    p->methods.create_output_with_brightness = create_output_with_brightness;*/
 
 #ifdef CPU_X86
-	if (cpuFlavour & CPU_OPTION_XMMX) {
+	if (cpuFlavour & CPU_OPTION_SSE2) {
+		/* row split, so it can run on all cores */
+		p->methods.draw_line = draw_line_mmx;
+		p->methods.zoom_rows = zoom_rows_sse2;
+#if defined(ARCH_X86_64) && defined(HAVE_AVX2)
+		if (cpuFlavour & CPU_OPTION_AVX2)
+			p->methods.zoom_rows = zoom_rows_avx2;
+#endif
+	}
+	else if (cpuFlavour & CPU_OPTION_XMMX) {
 #ifdef VERBOSE
 		printf ("Extented MMX detected. Using the fastest methods !\n");
 #endif
 		p->methods.draw_line = draw_line_mmx;
 		p->methods.zoom_filter = zoom_filter_xmmx;
+		p->methods.zoom_rows = NULL;
 	}
 	else if (cpuFlavour & CPU_OPTION_MMX) {
 #ifdef VERBOSE
@@ -50,6 +62,7 @@ static void setOptimizedMethods(PluginInfo *p) {
 #endif
 		p->methods.draw_line = draw_line_mmx;
 		p->methods.zoom_filter = zoom_filter_mmx;
+		p->methods.zoom_rows = NULL;
 	}
 #ifdef VERBOSE
         else
@@ -62,15 +75,18 @@ static void setOptimizedMethods(PluginInfo *p) {
         if ((cpuFlavour & CPU_OPTION_64_BITS) != 0) {
 /*            p->methods.create_output_with_brightness = ppc_brightness_G5;        */
             p->methods.zoom_filter = ppc_zoom_generic;
+            p->methods.zoom_rows = NULL;
         }
         else if ((cpuFlavour & CPU_OPTION_ALTIVEC) != 0) {
 /*            p->methods.create_output_with_brightness = ppc_brightness_G4;        */
             p->methods.zoom_filter = ppc_zoom_G4;
+            p->methods.zoom_rows = NULL;
         }
         else
         {
 /*            p->methods.create_output_with_brightness = ppc_brightness_generic;*/
             p->methods.zoom_filter = ppc_zoom_generic;
+            p->methods.zoom_rows = NULL;
         }        
 #endif /* CPU_POWERPC */
 
@@ -209,3 +225,10 @@ void plugin_info_add_visual(PluginInfo *p, int i, VisualFX *visual) {
 		}
 	}  
 }
+
+void plugin_info_slices(PluginInfo *p, int n, int align, GoomSliceFunc func, void *data) {
+	if (p->slices.run)
+		p->slices.run (p->slices.user, n, align, func, data);
+	else
+		func (data, 0, 0, n);
+}
@@ -0,0 +1,227 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(HAVE_MMX) && defined(ARCH_X86)
+
+#include <stdint.h>
+#include <xine/attributes.h>
+
+#include "sse2.h"
+
+#define BUFFPOINTNB 16
+
+#define sqrtperte 16
+/* faire : a % sqrtperte <=> a & pertemask */
+#define PERTEMASK 0xf
+/* faire : a / sqrtperte <=> a >> PERTEDEC */
+#define PERTEDEC 4
+
+/* the per channel sum of 4 pixels weighted by the coeffs is below 65536,
+ * so a 16 bit multiply is exact, and a saturated subtract of 5 does
+ * the "if (c > 5) c -= 5" of c_zoom (). */
+static const uint16_t zoom_five[8] ATTR_ALIGN(16) = { 5, 5, 5, 5, 5, 5, 5, 5 };
+
+static void zoom_pixels_sse2 (int prevX, int prevY, Pixel *expix1, Pixel *expix2,
+                              int *brutS, int *brutD, int buffratio, int precalCoef[16][16],
+                              int first, int last)
+{
+  int ax = (prevX - 1) << PERTEDEC, ay = (prevY - 1) << PERTEDEC;
+  intptr_t stride = (intptr_t)prevX * sizeof (Pixel);
+  int i;
+
+  for (i = first; i < last; i++) {
+    int px, py, pos;
+    unsigned int coeffs, v;
+
+    px = brutS[2 * i] + (((brutD[2 * i] - brutS[2 * i]) * buffratio) >> BUFFPOINTNB);
+    py = brutS[2 * i + 1] + (((brutD[2 * i + 1] - brutS[2 * i + 1]) * buffratio) >> BUFFPOINTNB);
+
+    if ((py >= ay) || (px >= ax)) {
+      pos = coeffs = 0;
+    } else {
+      pos = (px >> PERTEDEC) + prevX * (py >> PERTEDEC);
+      coeffs = precalCoef[px & PERTEMASK][py & PERTEMASK];
+    }
+
+    /* [col1 col2] * [c1 c2] + [col3 col4] * [c3 c4], then fold the halves */
+    __asm__ __volatile__ (
+      "movd      %3, %%xmm2             \n\t"
+      "pxor      %%xmm7, %%xmm7         \n\t"
+      "movq      (%1), %%xmm0           \n\t"
+      "movq      (%1,%2), %%xmm1        \n\t"
+      "punpcklbw %%xmm7, %%xmm2         \n\t"
+      "punpcklbw %%xmm7, %%xmm0         \n\t"
+      "punpcklbw %%xmm7, %%xmm1         \n\t"
+      "punpcklwd %%xmm2, %%xmm2         \n\t"
+      "pshufd    $0x50, %%xmm2, %%xmm3  \n\t"
+      "pshufd    $0xfa, %%xmm2, %%xmm2  \n\t"
+      "pmullw    %%xmm3, %%xmm0         \n\t"
+      "pmullw    %%xmm2, %%xmm1         \n\t"
+      "paddw     %%xmm1, %%xmm0         \n\t"
+      "pshufd    $0xee, %%xmm0, %%xmm1  \n\t"
+      "paddw     %%xmm1, %%xmm0         \n\t"
+      "psubusw   %4, %%xmm0             \n\t"
+      "psrlw     $8, %%xmm0             \n\t"
+      "packuswb  %%xmm0, %%xmm0         \n\t"
+      "movd      %%xmm0, %0             \n\t"
+      : "=r" (v)
+      : "r" (expix1 + pos), "r" (stride), "r" (coeffs), "m" (*zoom_five)
+      : "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+
+    /* c_zoom () leaves the alpha channel of dest alone */
+    expix2[i].val = (expix2[i].val & A_CHANNEL) | (v & ~A_CHANNEL);
+  }
+}
+
+void zoom_rows_sse2 (int prevX, int prevY, Pixel *expix1, Pixel *expix2,
+                     int *brutS, int *brutD, int buffratio, int precalCoef[16][16], int y0, int y1)
+{
+  zoom_pixels_sse2 (prevX, prevY, expix1, expix2, brutS, brutD, buffratio, precalCoef,
+                    prevX * y0, prevX * y1);
+}
+
+#if defined(ARCH_X86_64) && defined(HAVE_AVX2)
+/* vpshufb masks spreading coeff byte k of each pixel over the 4 words of that
+ * pixel, for the low and high unpacked halves of 8 pixels */
+#define ZS(a,b) a,0x80,a,0x80,a,0x80,a,0x80,b,0x80,b,0x80,b,0x80,b,0x80
+static const uint8_t zoom_avx2_shuf[8][32] ATTR_ALIGN(32) = {
+  { ZS(0, 4), ZS(0, 4) }, { ZS( 8, 12), ZS( 8, 12) },
+  { ZS(1, 5), ZS(1, 5) }, { ZS( 9, 13), ZS( 9, 13) },
+  { ZS(2, 6), ZS(2, 6) }, { ZS(10, 14), ZS(10, 14) },
+  { ZS(3, 7), ZS(3, 7) }, { ZS(11, 15), ZS(11, 15) }
+};
+#undef ZS
+
+void zoom_rows_avx2 (int prevX, int prevY, Pixel *expix1, Pixel *expix2,
+                     int *brutS, int *brutD, int buffratio, int precalCoef[16][16], int y0, int y1)
+{
+  const int32_t k[8] = {
+    buffratio, (prevX - 1) << PERTEDEC, (prevY - 1) << PERTEDEC, prevX,
+    PERTEMASK, (int32_t)A_CHANNEL, 0x00050005, 0
+  };
+  int first = prevX * y0, last = prevX * y1;
+  intptr_t n = (last - first) >> 3;
+
+  if (n > 0) {
+    int *s = brutS + 2 * first, *d = brutD + 2 * first;
+    Pixel *dest = expix2 + first;
+
+    /* 8 pixels per round. px, py, pos and coeffs like c_zoom (), with
+     * out of range points reading pixel 0 with zero weight, then gather
+     * the 4 source pixels and blend like zoom_pixels_sse2 (). */
+    __asm__ __volatile__ (
+      "vpbroadcastd   (%8), %%ymm15           \n\t" /* buffratio */
+      "vpbroadcastd  4(%8), %%ymm14           \n\t" /* ax */
+      "vpbroadcastd  8(%8), %%ymm13           \n\t" /* ay */
+      "vpbroadcastd 12(%8), %%ymm12           \n\t" /* prevX */
+      "vpbroadcastd 16(%8), %%ymm11           \n\t" /* PERTEMASK */
+      "vpbroadcastd 24(%8), %%ymm10           \n\t" /* 5 */
+      "vpbroadcastd 20(%8), %%ymm9            \n\t" /* A_CHANNEL */
+      "vpxor      %%ymm8, %%ymm8, %%ymm8      \n\t"
+      "1:\n\t"
+      "vmovdqu      (%1), %%ymm0              \n\t"
+      "vmovdqu    32(%1), %%ymm1              \n\t"
+      "vmovdqu      (%2), %%ymm2              \n\t"
+      "vmovdqu    32(%2), %%ymm3              \n\t"
+      "vpsubd     %%ymm0, %%ymm2, %%ymm2      \n\t"
+      "vpsubd     %%ymm1, %%ymm3, %%ymm3      \n\t"
+      "vpmulld    %%ymm15, %%ymm2, %%ymm2     \n\t"
+      "vpmulld    %%ymm15, %%ymm3, %%ymm3     \n\t"
+      "vpsrad     $16, %%ymm2, %%ymm2         \n\t"
+      "vpsrad     $16, %%ymm3, %%ymm3         \n\t"
+      "vpaddd     %%ymm2, %%ymm0, %%ymm0      \n\t"
+      "vpaddd     %%ymm3, %%ymm1, %%ymm1      \n\t"
+      /* deinterleave to px in ymm2, py in ymm3 */
+      "vpshufd    $0xd8, %%ymm0, %%ymm0       \n\t"
+      "vpshufd    $0xd8, %%ymm1, %%ymm1       \n\t"
+      "vpunpcklqdq %%ymm1, %%ymm0, %%ymm2     \n\t"
+      "vpunpckhqdq %%ymm1, %%ymm0, %%ymm3     \n\t"
+      "vpermq     $0xd8, %%ymm2, %%ymm2       \n\t"
+      "vpermq     $0xd8, %%ymm3, %%ymm3       \n\t"
+      /* ymm4 = inside, ymm5 = coeff index, ymm2 = pos */
+      "vpcmpgtd   %%ymm2, %%ymm14, %%ymm4     \n\t"
+      "vpcmpgtd   %%ymm3, %%ymm13, %%ymm5     \n\t"
+      "vpand      %%ymm5, %%ymm4, %%ymm4      \n\t"
+      "vpand      %%ymm11, %%ymm2, %%ymm5     \n\t"
+      "vpslld     $4, %%ymm5, %%ymm5          \n\t"
+      "vpand      %%ymm11, %%ymm3, %%ymm6     \n\t"
+      "vpaddd     %%ymm6, %%ymm5, %%ymm5      \n\t"
+      "vpsrad     $4, %%ymm2, %%ymm2          \n\t"
+      "vpsrad     $4, %%ymm3, %%ymm3          \n\t"
+      "vpmulld    %%ymm12, %%ymm3, %%ymm3     \n\t"
+      "vpaddd     %%ymm3, %%ymm2, %%ymm2      \n\t"
+      "vpand      %%ymm4, %%ymm2, %%ymm2      \n\t"
+      /* ymm6 = coeffs, ymm0 ymm1 ymm3 ymm4 = col1 .. col4 */
+      "vpcmpeqd   %%ymm7, %%ymm7, %%ymm7      \n\t"
+      "vpgatherdd %%ymm7, (%6,%%ymm5,4), %%ymm6  \n\t"
+      "vpand      %%ymm4, %%ymm6, %%ymm6      \n\t"
+      "vpcmpeqd   %%ymm7, %%ymm7, %%ymm7      \n\t"
+      "vpgatherdd %%ymm7, (%4,%%ymm2,4), %%ymm0  \n\t"
+      "vpcmpeqd   %%ymm7, %%ymm7, %%ymm7      \n\t"
+      "vpgatherdd %%ymm7, 4(%4,%%ymm2,4), %%ymm1 \n\t"
+      "vpcmpeqd   %%ymm7, %%ymm7, %%ymm7      \n\t"
+      "vpgatherdd %%ymm7, (%5,%%ymm2,4), %%ymm3  \n\t"
+      "vpcmpeqd   %%ymm7, %%ymm7, %%ymm7      \n\t"
+      "vpgatherdd %%ymm7, 4(%5,%%ymm2,4), %%ymm4 \n\t"
+      /* low halves sum up in ymm2, high halves in ymm0 */
+      "vpshufb       (%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpcklbw %%ymm8, %%ymm0, %%ymm2      \n\t"
+      "vpmullw    %%ymm5, %%ymm2, %%ymm2      \n\t"
+      "vpshufb     32(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpckhbw %%ymm8, %%ymm0, %%ymm0      \n\t"
+      "vpmullw    %%ymm5, %%ymm0, %%ymm0      \n\t"
+      "vpshufb     64(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpcklbw %%ymm8, %%ymm1, %%ymm7      \n\t"
+      "vpmullw    %%ymm5, %%ymm7, %%ymm7      \n\t"
+      "vpaddw     %%ymm7, %%ymm2, %%ymm2      \n\t"
+      "vpshufb     96(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpckhbw %%ymm8, %%ymm1, %%ymm1      \n\t"
+      "vpmullw    %%ymm5, %%ymm1, %%ymm1      \n\t"
+      "vpaddw     %%ymm1, %%ymm0, %%ymm0      \n\t"
+      "vpshufb    128(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpcklbw %%ymm8, %%ymm3, %%ymm7      \n\t"
+      "vpmullw    %%ymm5, %%ymm7, %%ymm7      \n\t"
+      "vpaddw     %%ymm7, %%ymm2, %%ymm2      \n\t"
+      "vpshufb    160(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpckhbw %%ymm8, %%ymm3, %%ymm3      \n\t"
+      "vpmullw    %%ymm5, %%ymm3, %%ymm3      \n\t"
+      "vpaddw     %%ymm3, %%ymm0, %%ymm0      \n\t"
+      "vpshufb    192(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpcklbw %%ymm8, %%ymm4, %%ymm7      \n\t"
+      "vpmullw    %%ymm5, %%ymm7, %%ymm7      \n\t"
+      "vpaddw     %%ymm7, %%ymm2, %%ymm2      \n\t"
+      "vpshufb    224(%7), %%ymm6, %%ymm5     \n\t"
+      "vpunpckhbw %%ymm8, %%ymm4, %%ymm4      \n\t"
+      "vpmullw    %%ymm5, %%ymm4, %%ymm4      \n\t"
+      "vpaddw     %%ymm4, %%ymm0, %%ymm0      \n\t"
+      "vpsubusw   %%ymm10, %%ymm2, %%ymm2     \n\t"
+      "vpsubusw   %%ymm10, %%ymm0, %%ymm0     \n\t"
+      "vpsrlw     $8, %%ymm2, %%ymm2          \n\t"
+      "vpsrlw     $8, %%ymm0, %%ymm0          \n\t"
+      "vpackuswb  %%ymm0, %%ymm2, %%ymm2      \n\t"
+      /* keep the alpha of dest */
+      "vpand      (%3), %%ymm9, %%ymm1        \n\t"
+      "vpandn     %%ymm2, %%ymm9, %%ymm2      \n\t"
+      "vpor       %%ymm1, %%ymm2, %%ymm2      \n\t"
+      "vmovdqu    %%ymm2, (%3)                \n\t"
+      "add        $64, %1                     \n\t"
+      "add        $64, %2                     \n\t"
+      "add        $32, %3                     \n\t"
+      "dec        %0                          \n\t"
+      "jnz        1b                          \n\t"
+      "vzeroupper                             \n\t"
+      : "+r" (n), "+r" (s), "+r" (d), "+r" (dest)
+      : "r" (expix1), "r" (expix1 + prevX), "r" (&precalCoef[0][0]), "r" (&zoom_avx2_shuf[0][0]), "r" (k)
+      : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+        "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15");
+
+    first = last - ((last - first) & 7);
+  }
+
+  zoom_pixels_sse2 (prevX, prevY, expix1, expix2, brutS, brutD, buffratio, precalCoef,
+                    first, last);
+}
+#endif /* ARCH_X86_64 && HAVE_AVX2 */
+
+#endif /* HAVE_MMX && ARCH_X86 */
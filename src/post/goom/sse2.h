@@ -0,0 +1,13 @@
+#ifndef _GOOM_SSE2_H
+#define _GOOM_SSE2_H
+
+#include "goom_graphic.h"
+
+/* SSE2 and AVX2 versions of zoom_rows_c (), giving the same pixels as the
+ * C code. zoom_rows_avx2 is x86_64 only. */
+void zoom_rows_sse2 (int prevX, int prevY, Pixel *expix1, Pixel *expix2,
+                     int *brutS, int *brutD, int buffratio, int precalCoef[16][16], int y0, int y1);
+void zoom_rows_avx2 (int prevX, int prevY, Pixel *expix1, Pixel *expix2,
+                     int *brutS, int *brutD, int buffratio, int precalCoef[16][16], int y0, int y1);
+
+#endif
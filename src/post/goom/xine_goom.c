@@ -44,6 +44,8 @@
   goom: csc_method 1 min 12718 us avg 12855 us
   goom: csc_method 2 min 4199 us avg 4289 us
   Seems gcc 4.5 has a very nice 64bit math emulation :-)
+  These are conversion only. Since method 3 converts inside of goom_update (),
+  the counter now includes rendering.
 */
 #define BENCHMARK 1
 
@@ -64,6 +66,7 @@ static const char* const goom_csc_methods[]={
   "Fast but not photorealistic",
   "Slow but looks better",
   "Mostly fast and good quality",
+  "Threaded, straight to YV12",
   NULL
 };
 
@@ -158,12 +161,13 @@ static void fps_changed_cb(void *data, xine_cfg_entry_t *cfg) {
   }
 }
 
+/* whole chroma samples for YUY2 and YV12 */
 static void width_changed_cb(void *data, xine_cfg_entry_t *cfg) {
   post_class_goom_t *class = (post_class_goom_t*) data;
 
   if(class->ip) {
     post_plugin_goom_t *this = class->ip;
-    this->width = cfg->num_value;
+    this->width = (cfg->num_value + 1) & ~1;
   }
 }
 
@@ -172,7 +176,7 @@ static void height_changed_cb(void *data, xine_cfg_entry_t *cfg) {
 
   if(class->ip) {
     post_plugin_goom_t *this = class->ip;
-    this->height = cfg->num_value;
+    this->height = (cfg->num_value + 1) & ~1;
   }
 }
 
@@ -185,6 +189,13 @@ static void csc_method_changed_cb(void *data, xine_cfg_entry_t *cfg) {
   }
 }
 
+/* goom row bands run on the post plugin slice threads */
+static void goom_slices(void *user, int n, int align, GoomSliceFunc func, void *data) {
+  post_plugin_goom_t *this = (post_plugin_goom_t *)user;
+
+  _x_post_slices (&this->post, n, align, func, data);
+}
+
 static void *goom_init_plugin(xine_t *xine, const void *data)
 {
   post_class_goom_t *this = calloc(1, sizeof(post_class_goom_t));
@@ -221,11 +232,13 @@ static void *goom_init_plugin(xine_t *xine, const void *data)
                                     10, height_changed_cb, this);
 
 
-  cfg->register_enum (cfg, "effects.goom.csc_method", 0,
+  cfg->register_enum (cfg, "effects.goom.csc_method", 3,
                            (char **)goom_csc_methods,
                            _("colour space conversion method"),
                            _("You can choose the colour space conversion method used by goom.\n"
-			     "The available selections should be self-explaining."),
+			     "The available selections should be self-explaining.\n"
+			     "The threaded one also renders on all CPU cores, use it for large "
+			     "image sizes."),
 			   20, csc_method_changed_cb, this);
 
   return &this->class;
@@ -285,6 +298,7 @@ static post_plugin_t *goom_open_plugin(post_class_t *class_gen, int inputs,
 
   srand((unsigned int)time((time_t *)NULL));
   this->goom = goom_init (this->width_back, this->height_back);
+  goom_set_slices (this->goom, goom_slices, this);
 
   this->ratio = (double)this->width_back/(double)this->height_back;
 
@@ -521,7 +535,7 @@ static void goom_port_put_buffer (xine_audio_port_t *port_gen,
       }
 
       frame = this->vo_port->get_frame (this->vo_port, this->width_back, this->height_back,
-                this->ratio, XINE_IMGFMT_YUY2,
+                this->ratio, (this->csc_method == 3) ? XINE_IMGFMT_YV12 : XINE_IMGFMT_YUY2,
                 VO_BOTH_FIELDS);
 
       frame->extra_info->invalid = 1;
@@ -532,19 +546,21 @@ static void goom_port_put_buffer (xine_audio_port_t *port_gen,
 
       if (!this->skip_frame) {
 #ifdef BENCHMARK
-        int elapsed;
+        int elapsed = -now ();
 #endif
+
         /* Try to be fast */
+        goom_set_yv12_buffer (this->goom, this->rgb2yuy2,
+                              (frame->format == XINE_IMGFMT_YV12) ? frame->base : NULL, frame->pitches);
         goom_frame = (uint8_t *)goom_update (this->goom, this->data, 0, 0, NULL, NULL);
 
         dest_ptr = frame -> base[0];
         goom_frame_end = goom_frame + 4 * (this->width_back * this->height_back);
 
-#ifdef BENCHMARK
-        elapsed = -now ();
-#endif
-
-        if (this->csc_method == 2) {
+        if (frame->format == XINE_IMGFMT_YV12) {
+          /* goom_update () did it */
+        }
+        else if (this->csc_method == 2) {
 
           if (!frame->proc_slice || (frame->height & 15)) {
             /* do all at once */
@@ -628,7 +644,7 @@ static void goom_port_put_buffer (xine_audio_port_t *port_gen,
           this->benchmark_time += elapsed;
           if (elapsed < this->benchmark_min) this->benchmark_min = elapsed;
           this->benchmark_frames++;
-          if (this->benchmark_frames == 200) printf ("goom: csc_method %d min %d us avg %d us\n",
+          if (this->benchmark_frames == 200) printf ("goom: csc_method %d render + csc min %d us avg %d us\n",
             this->csc_method, this->benchmark_min, this->benchmark_time / 200);
         }
 #endif
@@ -649,6 +665,7 @@ static void goom_port_put_buffer (xine_audio_port_t *port_gen,
       if ((width != this->width_back) || (height != this->height_back)) {
         goom_close(this->goom);
         this->goom = goom_init (this->width, this->height);
+        goom_set_slices (this->goom, goom_slices, this);
         this->width_back = width;
         this->height_back = height;
         this->ratio = (double)width/(double)height;
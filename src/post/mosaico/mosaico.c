@@ -20,6 +20,11 @@
 
 /*
  * simple video mosaico plugin
+ *
+ * Every picture input scales its frames into a tile of its own, in the
+ * decoder thread of that input, as soon as they arrive. The background
+ * input then only copies rows: the background picture and the newest tile
+ * of every input, in row bands on the post slice threads.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -27,6 +32,7 @@
 #endif
 
 #include <pthread.h>
+#include <sys/time.h>
 
 #define LOG_MODULE "mosaico"
 #define LOG_VERBOSE
@@ -36,6 +42,7 @@
 
 #include <xine/xine_internal.h>
 #include <xine/post.h>
+#include <xine/xineutils.h>
 
 /* FIXME: This plugin needs to handle overlays as well. */
 
@@ -43,8 +50,14 @@
 typedef struct mosaico_parameters_s {
   unsigned int  pip_num;
   unsigned int  x, y, w, h;
+  unsigned int  method;
+  /* statistics of the picture slot, read only */
+  unsigned int  frames, dropped;
+  unsigned int  latency, latency_max;
 } mosaico_parameters_t;
 
+static const char *const enum_methods[] = { "bilinear", "bicubic", "lanczos", NULL };
+
 START_PARAM_DESCR(mosaico_parameters_t)
 PARAM_ITEM(POST_PARAM_TYPE_INT, pip_num, NULL, 1, INT_MAX, 1,
   "which picture slots settings are being edited")
@@ -56,6 +69,16 @@ PARAM_ITEM(POST_PARAM_TYPE_INT, w, NULL, 0, INT_MAX, 150,
   "width of the pasted picture")
 PARAM_ITEM(POST_PARAM_TYPE_INT, h, NULL, 0, INT_MAX, 150,
   "height of the pasted picture")
+PARAM_ITEM(POST_PARAM_TYPE_INT, method, (char **)enum_methods, 0, 0, 0,
+  "scaling filter of the pasted picture")
+PARAM_ITEM(POST_PARAM_TYPE_INT, frames, NULL, 0, INT_MAX, 1,
+  "pictures received")
+PARAM_ITEM(POST_PARAM_TYPE_INT, dropped, NULL, 0, INT_MAX, 1,
+  "pictures replaced before they were shown")
+PARAM_ITEM(POST_PARAM_TYPE_INT, latency, NULL, 0, INT_MAX, 1,
+  "average time from arrival to first output, in microseconds")
+PARAM_ITEM(POST_PARAM_TYPE_INT, latency_max, NULL, 0, INT_MAX, 1,
+  "maximum time from arrival to first output, in microseconds")
 END_PARAM_DESCR(mosaico_param_descr)
 
 typedef struct post_mosaico_s post_mosaico_t;
@@ -63,9 +86,28 @@ typedef struct post_mosaico_s post_mosaico_t;
 /* plugin structures */
 typedef struct mosaico_pip_s mosaico_pip_t;
 struct mosaico_pip_s {
-  unsigned int  x, y, w, h;
-  vo_frame_t   *frame;
+  unsigned int  x, y, w, h, method;
   char         *input_name;
+
+  /* 2 YV12 tiles of tile_w x tile_h. the input thread scales into the
+   * back one and then flips, the background thread reads tile[front].
+   * front is -1 while there is nothing to show. */
+  uint8_t      *tile[2];
+  int           tile_w, tile_h;
+  int           front;
+
+  /* only used by the input thread */
+  xine_scaler_t *scaler[2];
+  int           src_width, src_height, src_format, src_method;
+  int           dst_width, dst_height;
+
+  /* statistics */
+  int64_t       arrival;       /* of tile[front], monotonic usec */
+  int           shown;         /* tile[front] made it to the output */
+  unsigned int  frames, dropped;
+  unsigned int  latency, latency_max;
+  uint64_t      latency_sum;   /* of all shown tiles, latency is its mean */
+  unsigned int  latency_count;
 };
 
 struct post_mosaico_s {
@@ -80,6 +122,14 @@ struct post_mosaico_s {
   unsigned int     pip_count;
 };
 
+static int64_t mosaico_now(void)
+{
+  struct timeval tv;
+
+  xine_monotonic_clock(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 /* parameter functions */
 
 static xine_post_api_descr_t *mosaico_get_param_descr(void)
@@ -91,12 +141,18 @@ static int mosaico_set_parameters(xine_post_t *this_gen, const void *param_gen)
 {
   post_mosaico_t *this = (post_mosaico_t *)this_gen;
   const mosaico_parameters_t *param = (const mosaico_parameters_t *)param_gen;
+  mosaico_pip_t *pip;
 
-  if (param->pip_num > this->pip_count) return 0;
-  this->pip[param->pip_num - 1].x = param->x;
-  this->pip[param->pip_num - 1].y = param->y;
-  this->pip[param->pip_num - 1].w = param->w;
-  this->pip[param->pip_num - 1].h = param->h;
+  if (param->pip_num > this->pip_count || param->pip_num < 1) return 0;
+  pip = &this->pip[param->pip_num - 1];
+  pthread_mutex_lock(&this->mutex);
+  pip->x = param->x;
+  pip->y = param->y;
+  pip->w = param->w;
+  pip->h = param->h;
+  if (param->method <= XINE_SCALER_LANCZOS)
+    pip->method = param->method;
+  pthread_mutex_unlock(&this->mutex);
   return 1;
 }
 
@@ -104,26 +160,129 @@ static int mosaico_get_parameters(xine_post_t *this_gen, void *param_gen)
 {
   post_mosaico_t *this = (post_mosaico_t *)this_gen;
   mosaico_parameters_t *param = (mosaico_parameters_t *)param_gen;
+  mosaico_pip_t *pip;
 
   if (param->pip_num > this->pip_count || param->pip_num < 1)
     param->pip_num = 1;
-  param->x = this->pip[param->pip_num - 1].x;
-  param->y = this->pip[param->pip_num - 1].y;
-  param->w = this->pip[param->pip_num - 1].w;
-  param->h = this->pip[param->pip_num - 1].h;
+  pip = &this->pip[param->pip_num - 1];
+  pthread_mutex_lock(&this->mutex);
+  param->x           = pip->x;
+  param->y           = pip->y;
+  param->w           = pip->w;
+  param->h           = pip->h;
+  param->method      = pip->method;
+  param->frames      = pip->frames;
+  param->dropped     = pip->dropped;
+  param->latency     = pip->latency;
+  param->latency_max = pip->latency_max;
+  pthread_mutex_unlock(&this->mutex);
   return 1;
 }
 
 static char *mosaico_get_help(void)
 {
   return _("Mosaico does simple picture in picture effects.\n"
+           "Each picture is scaled once when it arrives, in the thread of "
+           "its own input, so many inputs can share one output.\n"
            "\n"
            "Parameters\n"
            "  pip_num: the number of the picture slot the following settings apply to\n"
            "  x: the x coordinate of the left upper corner of the picture\n"
            "  y: the y coordinate of the left upper corner of the picture\n"
            "  w: the width of the picture\n"
-           "  h: the height of the picture\n");
+           "  h: the height of the picture\n"
+           "  method: scaling filter, bilinear (fastest), bicubic or lanczos\n"
+           "\n"
+           "Statistics of the picture slot (read only)\n"
+           "  frames: pictures received\n"
+           "  dropped: pictures replaced by a newer one before they were shown\n"
+           "  latency: average time from arrival to first output, in microseconds\n"
+           "  latency_max: the longest of these times\n");
+}
+
+/* picture tiles */
+
+static void mosaico_free_scalers(mosaico_pip_t *pip)
+{
+  xine_scaler_delete(pip->scaler[0]);
+  xine_scaler_delete(pip->scaler[1]);
+  pip->scaler[0] = pip->scaler[1] = NULL;
+  pip->src_width = 0;
+}
+
+static void mosaico_free_tiles(mosaico_pip_t *pip)
+{
+  xine_freep_aligned(&pip->tile[0]);
+  xine_freep_aligned(&pip->tile[1]);
+  pip->tile_w = pip->tile_h = 0;
+  pip->front = -1;
+}
+
+/* call with this->mutex held. (re)allocates the tiles for the current size
+ * and returns the tile to scale into, or NULL. */
+static uint8_t *mosaico_back_tile(mosaico_pip_t *pip)
+{
+  /* whole chroma samples */
+  int w = pip->w & ~1, h = pip->h & ~1;
+
+  if (w < 2 || h < 2)
+    return NULL;
+  if (w != pip->tile_w || h != pip->tile_h) {
+    size_t size = (size_t)w * h * 3 / 2;
+    mosaico_free_tiles(pip);
+    pip->tile[0] = xine_malloc_aligned(size);
+    pip->tile[1] = xine_malloc_aligned(size);
+    if (!pip->tile[0] || !pip->tile[1]) {
+      mosaico_free_tiles(pip);
+      return NULL;
+    }
+    pip->tile_w = w;
+    pip->tile_h = h;
+  }
+  return pip->tile[pip->front == 0 ? 1 : 0];
+}
+
+/* runs unlocked in the input thread. returns 0 when the frame cannot be
+ * scaled. */
+static int mosaico_scale(mosaico_pip_t *pip, vo_frame_t *frame, uint8_t *tile, int w, int h, int method)
+{
+  uint8_t *u = tile + w * h, *v = u + (w / 2) * (h / 2);
+
+  if (!pip->scaler[0] || pip->src_width != frame->width || pip->src_height != frame->height ||
+      pip->src_format != frame->format || pip->src_method != method ||
+      pip->dst_width != w || pip->dst_height != h) {
+    mosaico_free_scalers(pip);
+    if (frame->width < 2 || frame->height < 2)
+      return 0;
+    pip->scaler[0] = xine_scaler_new(method, frame->width, frame->height, w, h);
+    if (frame->format == XINE_IMGFMT_YV12)
+      pip->scaler[1] = xine_scaler_new(method, (frame->width + 1) / 2, (frame->height + 1) / 2,
+                                       w / 2, h / 2);
+    else
+      pip->scaler[1] = xine_scaler_new(method, frame->width / 2, frame->height, w / 2, h / 2);
+    if (!pip->scaler[0] || !pip->scaler[1]) {
+      mosaico_free_scalers(pip);
+      return 0;
+    }
+    pip->src_width  = frame->width;
+    pip->src_height = frame->height;
+    pip->src_format = frame->format;
+    pip->src_method = method;
+    pip->dst_width  = w;
+    pip->dst_height = h;
+  }
+
+  if (frame->format == XINE_IMGFMT_YV12) {
+    xine_scaler_rows(pip->scaler[0], frame->base[0], frame->pitches[0], 1, tile, w, 1, 0, h);
+    xine_scaler_rows(pip->scaler[1], frame->base[1], frame->pitches[1], 1, u, w / 2, 1, 0, h / 2);
+    xine_scaler_rows(pip->scaler[1], frame->base[2], frame->pitches[2], 1, v, w / 2, 1, 0, h / 2);
+  } else {
+    /* Y at 0 and 2, U at 1, V at 3. 4:2:2 chroma rows are halved here. */
+    xine_scaler_rows(pip->scaler[0], frame->base[0], frame->pitches[0], 2, tile, w, 1, 0, h);
+    xine_scaler_rows(pip->scaler[1], frame->base[0] + 1, frame->pitches[0], 4, u, w / 2, 1, 0, h / 2);
+    xine_scaler_rows(pip->scaler[1], frame->base[0] + 3, frame->pitches[0], 4, v, w / 2, 1, 0, h / 2);
+  }
+  return 1;
 }
 
 /* replaced video port functions */
@@ -132,7 +291,6 @@ static void mosaico_close(xine_video_port_t *port_gen, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)port_gen;
   post_mosaico_t *this = (post_mosaico_t *)port->post;
-  vo_frame_t *free_frame;
   unsigned int pip_num;
 
   (void)stream;
@@ -141,20 +299,22 @@ static void mosaico_close(xine_video_port_t *port_gen, xine_stream_t *stream)
     if (this->post.xine_post.video_input[pip_num+1] == port_gen) break;
 
   pthread_mutex_lock(&this->mutex);
-  free_frame = this->pip[pip_num].frame;
-  this->pip[pip_num].frame = NULL;
+  /* the tiles stay for the next stream, but the last picture goes */
+  this->pip[pip_num].front = -1;
+  xprintf(this->post.xine, XINE_VERBOSITY_DEBUG,
+          LOG_MODULE ": %s: %u frames, %u dropped, latency %u us average, %u us max\n",
+          this->pip[pip_num].input_name, this->pip[pip_num].frames, this->pip[pip_num].dropped,
+          this->pip[pip_num].latency, this->pip[pip_num].latency_max);
   port->original_port->close(port->original_port, port->stream);
   pthread_mutex_unlock(&this->mutex);
 
-  if (free_frame)
-    free_frame->free(free_frame);
   port->stream = NULL;
   _x_post_dec_usage(port);
 }
 
 /* frame intercept check */
 
-static int mosaico_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
+static int mosaico_intercept_background(post_video_port_t *port, vo_frame_t *frame)
 {
   (void)port;
 
@@ -162,96 +322,68 @@ static int mosaico_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
   return (frame->format == XINE_IMGFMT_YV12);
 }
 
+static int mosaico_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
+{
+  (void)port;
+
+  /* pictures are converted to YV12 when scaling */
+  return (frame->format == XINE_IMGFMT_YV12 || frame->format == XINE_IMGFMT_YUY2);
+}
+
 /* replaced vo_frame functions */
 
-static void frame_copy_content(vo_frame_t *to, vo_frame_t *from)
+typedef struct {
+  post_mosaico_t *this;
+  vo_frame_t     *from, *to;
+} mosaico_slice_t;
+
+/* copies rows y0 .. y1 - 1 of the background, then the tiles over it.
+ * runs with this->mutex held by mosaico_draw_background (). */
+static void mosaico_composite_slice(void *data, int band, int y0, int y1)
 {
-  int size;
+  mosaico_slice_t *job = (mosaico_slice_t *)data;
+  post_mosaico_t *this = job->this;
+  vo_frame_t *from = job->from, *to = job->to;
+  int width = to->width, height = to->height;
+  int c0 = y0 / 2, c1 = (y1 == height) ? (height + 1) / 2 : y1 / 2;
+  unsigned int pip_num;
+  int i, y;
 
-  switch (from->format) {
-  case XINE_IMGFMT_YUY2:
-    /* TODO: implement conversion to YV12 or implement support to paste
-     * frames of different types together */
-    break;
+  (void)band;
 
-  case XINE_IMGFMT_YV12:
-    /* Y */
-    size = to->pitches[0] * to->height;
-    xine_fast_memcpy(to->base[0], from->base[0], size);
+  for (y = y0; y < y1; y++)
+    xine_fast_memcpy(to->base[0] + y * to->pitches[0], from->base[0] + y * from->pitches[0], width);
+  for (i = 1; i < 3; i++)
+    for (y = c0; y < c1; y++)
+      xine_fast_memcpy(to->base[i] + y * to->pitches[i], from->base[i] + y * from->pitches[i],
+                       (width + 1) / 2);
 
-    /* U */
-    size = to->pitches[1] * ((to->height + 1) / 2);
-    xine_fast_memcpy(to->base[1], from->base[1], size);
+  for (pip_num = 0; pip_num < this->pip_count; pip_num++) {
+    mosaico_pip_t *pip = &this->pip[pip_num];
+    const uint8_t *tile;
+    int x0 = pip->x & ~1, py = pip->y & ~1, w, h, ty0, ty1;
 
-    /* V */
-    size = to->pitches[2] * ((to->height + 1) / 2);
-    xine_fast_memcpy(to->base[2], from->base[2], size);
-  }
-}
+    if (pip->front < 0 || x0 >= width || py >= height)
+      continue;
+    tile = pip->tile[pip->front];
+    w = pip->tile_w < width - x0 ? pip->tile_w : width - x0;
+    h = pip->tile_h < height - py ? pip->tile_h : height - py;
 
-static void frame_paste(post_mosaico_t *this, vo_frame_t *background, int pip_num)
-{
-  unsigned long target_width, target_height;
-  unsigned long source_width, source_height;
-  unsigned long background_width;
-  unsigned long scale_x, scale_y;
-  const int shift_x = 3, shift_y = 3;
-  unsigned long pos_x, pos_y, pos;
-  unsigned long target_offset, source_offset;
-  unsigned long i, j;
-
-  if (!this->pip[pip_num].frame) return;
-
-  target_width  = this->pip[pip_num].w;
-  target_height = this->pip[pip_num].h;
-  background_width = background->width;
-  source_width = this->pip[pip_num].frame->width;
-  source_height = this->pip[pip_num].frame->height;
-  scale_x = (source_width << shift_x) / target_width;
-  scale_y = (source_height << shift_y) / target_height;
-  pos_x = this->pip[pip_num].x;
-  pos_y = this->pip[pip_num].y;
-  pos = pos_y * background_width + pos_x;
-
-  switch (this->pip[pip_num].frame->format) {
-  case XINE_IMGFMT_YUY2:
-    /* TODO: implement YUY2 */
-    break;
-
-  case XINE_IMGFMT_YV12:
     /* Y */
-    target_offset = 0;
-    for (j = 0; j < target_height; j++, target_offset += (background_width - target_width))
-      for (i = 0; i < target_width; i++, target_offset++) {
-        source_offset = ((i * scale_x) >> shift_x) + (((j * scale_y) >> shift_y) * source_width);
-        background->base[0][pos + target_offset] = this->pip[pip_num].frame->base[0][source_offset];
-      }
-
-    background_width = (background_width + 1) / 2;
-    source_width = (source_width + 1) / 2;
-    pos_x = (pos_x + 1) / 2;
-    pos_y = (pos_y + 1) / 2;
-    pos = pos_y * background_width + pos_x;
-    target_width = (target_width + 1) / 2;
-    target_height = (target_height + 1) / 2;
-
-    /* U */
-    target_offset = 0;
-    for (j = 0; j < target_height; j++, target_offset += (background_width - target_width))
-      for (i = 0; i < target_width; i++, target_offset++) {
-        source_offset = ((i * scale_x) >> shift_x) + (((j * scale_y) >> shift_y) * source_width);
-        background->base[1][pos + target_offset] = this->pip[pip_num].frame->base[1][source_offset];
-      }
-
-    /* V */
-    target_offset = 0;
-    for (j = 0; j < target_height; j++, target_offset += (background_width - target_width))
-      for (i = 0; i < target_width; i++, target_offset++) {
-        source_offset = ((i * scale_x) >> shift_x) + (((j * scale_y) >> shift_y) * source_width);
-        background->base[2][pos + target_offset] = this->pip[pip_num].frame->base[2][source_offset];
-      }
-
-    break;
+    ty0 = y0 > py ? y0 : py;
+    ty1 = y1 < py + h ? y1 : py + h;
+    for (y = ty0; y < ty1; y++)
+      xine_fast_memcpy(to->base[0] + y * to->pitches[0] + x0, tile + (y - py) * pip->tile_w, w);
+
+    /* U, V */
+    ty0 = c0 > py / 2 ? c0 : py / 2;
+    ty1 = c1 < py / 2 + (h + 1) / 2 ? c1 : py / 2 + (h + 1) / 2;
+    for (i = 1; i < 3; i++) {
+      const uint8_t *t = tile + pip->tile_w * pip->tile_h + (i - 1) * (pip->tile_w / 2) * (pip->tile_h / 2);
+      for (y = ty0; y < ty1; y++)
+        xine_fast_memcpy(to->base[i] + y * to->pitches[i] + x0 / 2,
+                         t + (y - py / 2) * (pip->tile_w / 2), (w + 1) / 2);
+    }
   }
 }
 
@@ -260,7 +392,9 @@ static int mosaico_draw_background(vo_frame_t *frame, xine_stream_t *stream)
   post_video_port_t *port = (post_video_port_t *)frame->port;
   post_mosaico_t *this = (post_mosaico_t *)port->post;
   vo_frame_t *background;
+  mosaico_slice_t job;
   unsigned int pip_num;
+  int64_t now;
   int skip;
 
   pthread_mutex_lock(&this->mutex);
@@ -286,10 +420,29 @@ static int mosaico_draw_background(vo_frame_t *frame, xine_stream_t *stream)
   background = port->original_port->get_frame(port->original_port,
     frame->width, frame->height, frame->ratio, frame->format, frame->flags | VO_BOTH_FIELDS);
   _x_post_frame_copy_down(frame, background);
-  frame_copy_content(background, frame);
 
-  for (pip_num = 0; pip_num < this->pip_count; pip_num++)
-    frame_paste(this, background, pip_num);
+  job.this = this;
+  job.from = frame;
+  job.to   = background;
+  _x_post_slices(&this->post, frame->height, 2, mosaico_composite_slice, &job);
+
+  now = mosaico_now();
+  for (pip_num = 0; pip_num < this->pip_count; pip_num++) {
+    mosaico_pip_t *pip = &this->pip[pip_num];
+    int64_t latency;
+
+    if (pip->front < 0 || pip->shown)
+      continue;
+    pip->shown = 1;
+    latency = now > pip->arrival ? now - pip->arrival : 0;
+    if (latency > INT_MAX)
+      latency = INT_MAX;
+    pip->latency_sum += latency;
+    pip->latency_count++;
+    pip->latency = pip->latency_sum / pip->latency_count;
+    if (latency > pip->latency_max)
+      pip->latency_max = latency;
+  }
 
   skip = background->draw(background, stream);
   _x_post_frame_copy_up(frame, background);
@@ -312,26 +465,49 @@ static int mosaico_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)frame->port;
   post_mosaico_t *this = (post_mosaico_t *)port->post;
-  vo_frame_t *free_frame;
+  mosaico_pip_t *pip;
+  uint8_t *tile;
+  int64_t arrival = mosaico_now();
   unsigned int pip_num;
+  int w, h, method, scaled = 0;
   int skip;
 
   for (pip_num = 0; pip_num < this->pip_count; pip_num++)
     if (this->post.xine_post.video_input[pip_num+1] == frame->port) break;
   _x_assert(pip_num < this->pip_count);
-
-  frame->lock(frame);
+  pip = &this->pip[pip_num];
 
   pthread_mutex_lock(&this->mutex);
 
   /* the original output will never see this frame again */
   _x_post_frame_u_turn(frame, stream);
+  pip->frames++;
+  tile   = frame->bad_frame ? NULL : mosaico_back_tile(pip);
+  w      = pip->tile_w;
+  h      = pip->tile_h;
+  method = pip->method;
+
+  pthread_mutex_unlock(&this->mutex);
+
+  /* only this thread resizes the tiles or touches the back one, so the
+   * scaling may run in parallel to the other inputs and the output. */
+  if (tile)
+    scaled = mosaico_scale(pip, frame, tile, w, h, method);
+
+  pthread_mutex_lock(&this->mutex);
+
   while (frame->vpts > this->vpts_limit || !this->vpts_limit)
     /* we are too early */
     pthread_cond_wait(&this->vpts_limit_changed, &this->mutex);
-  free_frame = this->pip[pip_num].frame;
-  if (port->stream)
-    this->pip[pip_num].frame = frame;
+
+  if (scaled && port->stream) {
+    if (pip->front >= 0 && !pip->shown)
+      pip->dropped++;
+    pip->front   = tile == pip->tile[0] ? 0 : 1;
+    pip->shown   = 0;
+    pip->arrival = arrival;
+  } else
+    pip->dropped++;
 
   if (this->skip && frame->vpts <= this->skip_vpts)
     skip = this->skip;
@@ -340,13 +516,6 @@ static int mosaico_draw(vo_frame_t *frame, xine_stream_t *stream)
 
   pthread_mutex_unlock(&this->mutex);
 
-  if (free_frame)
-    free_frame->free(free_frame);
-  if (!port->stream)
-    /* do not keep this frame when no stream is connected to us,
-     * otherwise, this frame might never get freed */
-    frame->free(frame);
-
   return skip;
 }
 
@@ -358,8 +527,11 @@ static void mosaico_dispose(post_plugin_t *this_gen)
 
   if (_x_post_dispose(this_gen)) {
     unsigned int i;
-    for (i = 0; i < this->pip_count; i++)
+    for (i = 0; i < this->pip_count; i++) {
+      mosaico_free_scalers(&this->pip[i]);
+      mosaico_free_tiles(&this->pip[i]);
       free(this->pip[i].input_name);
+    }
     free(this->pip);
     pthread_cond_destroy(&this->vpts_limit_changed);
     pthread_mutex_destroy(&this->mutex);
@@ -409,7 +581,7 @@ static post_plugin_t *mosaico_open_plugin(post_class_t *class_gen, int inputs,
 
   /* the port for the background video */
   port = _x_post_intercept_video_port(&this->post, video_target[0], &input, &output);
-  port->intercept_frame = mosaico_intercept_frame;
+  port->intercept_frame = mosaico_intercept_background;
   port->new_frame->draw = mosaico_draw_background;
   port->port_lock       = &this->mutex;
   port->frame_lock      = &this->mutex;
@@ -421,6 +593,8 @@ static post_plugin_t *mosaico_open_plugin(post_class_t *class_gen, int inputs,
     this->pip[i].y = 50;
     this->pip[i].w = 150;
     this->pip[i].h = 150;
+    this->pip[i].method = XINE_SCALER_BILINEAR;
+    this->pip[i].front = -1;
     this->pip[i].input_name = _x_asprintf("video in %d", i+1);
 
     port = _x_post_intercept_video_port(&this->post, video_target[0], &input, NULL);
@@ -0,0 +1,760 @@
+/*
+ * Copyright (C) 2000-2018 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * video analysis: luma levels, black and frozen pictures, blockiness and
+ * scene changes of every frame, without touching the picture.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "planar.h"
+
+#include <xine/xine_internal.h>
+#include <xine/post.h>
+#include <xine/xineutils.h>
+#include <xine/attributes.h>
+#include <pthread.h>
+
+/* the metrics of the last ANALYZE_RING frames stay readable. */
+#define ANALYZE_RING 256
+
+/* the ring has a single writer, the thread drawing the frames. readers
+ * check the frame number of an entry before and after copying it. the
+ * fences keep the plain metric stores and loads between these checks. */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7)))
+#  define RING_LOAD(p)     __atomic_load_n ((p), __ATOMIC_SEQ_CST)
+#  define RING_STORE(p,v)  __atomic_store_n ((p), (v), __ATOMIC_SEQ_CST)
+#  define RING_FENCE_RELEASE() __atomic_thread_fence (__ATOMIC_RELEASE)
+#  define RING_FENCE_ACQUIRE() __atomic_thread_fence (__ATOMIC_ACQUIRE)
+#else
+#  define RING_LOAD(p)     __sync_fetch_and_add ((p), 0)
+#  define RING_STORE(p,v)  do { __sync_synchronize (); *(p) = (v); __sync_synchronize (); } while (0)
+#  define RING_FENCE_RELEASE() __sync_synchronize ()
+#  define RING_FENCE_ACQUIRE() __sync_synchronize ()
+#endif
+
+typedef struct post_plugin_analyze_s post_plugin_analyze_t;
+
+/*
+ * this is the struct used by "parameters api"
+ */
+typedef struct analyze_parameters_s {
+
+  int    black_level;
+  int    black_ratio;
+  double freeze_level;
+
+  /* in: frame number to read, 0 for the newest. out: the one returned. */
+  int    frame;
+
+  /* metrics of that frame, read only */
+  int    frames;
+  double vpts;
+  int    width, height;
+  double average;
+  int    minimum, maximum;
+  int    black, frozen;
+  double difference;
+  double blockiness;
+  double scene;
+  int    histogram[256];
+
+} analyze_parameters_t;
+
+/*
+ * description of params struct
+ */
+START_PARAM_DESCR( analyze_parameters_t )
+PARAM_ITEM( POST_PARAM_TYPE_INT, black_level, NULL, 0, 255, 0,
+            "luma at or below which a pixel is black" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, black_ratio, NULL, 1, 100, 0,
+            "percentage of black pixels in a black frame" )
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, freeze_level, NULL, 0, 255, 0,
+            "mean difference to the previous frame below which a frame is frozen" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, frame, NULL, 0, INT_MAX, 0,
+            "number of the frame to read, 0 for the newest" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, frames, NULL, 0, INT_MAX, 1,
+            "frames analyzed so far" )
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, vpts, NULL, 0, 0, 1,
+            "presentation time of the frame" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, width, NULL, 0, INT_MAX, 1,
+            "width of the frame" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, height, NULL, 0, INT_MAX, 1,
+            "height of the frame" )
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, average, NULL, 0, 255, 1,
+            "average luma" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, minimum, NULL, 0, 255, 1,
+            "lowest luma" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, maximum, NULL, 0, 255, 1,
+            "highest luma" )
+PARAM_ITEM( POST_PARAM_TYPE_BOOL, black, NULL, 0, 1, 1,
+            "black frame" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, frozen, NULL, 0, INT_MAX, 1,
+            "number of frozen frames in a row up to this one" )
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, difference, NULL, -1, 255, 1,
+            "mean luma difference to the previous frame, -1 if there is none" )
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, blockiness, NULL, 0, 256, 1,
+            "gradient at 8x8 block edges relative to elsewhere, 1 = no blocking" )
+PARAM_ITEM( POST_PARAM_TYPE_DOUBLE, scene, NULL, 0, 1, 1,
+            "histogram change to the previous frame, 1 = completely new picture" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, histogram, NULL, 0, INT_MAX, 1,
+            "luma histogram" )
+END_PARAM_DESCR( param_descr )
+
+
+typedef struct {
+  uint32_t  frame;       /* 0 while being written */
+  int64_t   vpts;
+  int       width, height;
+  double    average;
+  int       minimum, maximum;
+  int       black, frozen;
+  double    difference, blockiness, scene;
+  uint32_t  histogram[256];
+} analyze_metrics_t;
+
+/* sums of one row band */
+typedef struct {
+  int       used;
+  uint32_t  hist[4][256];
+  uint64_t  sad;             /* to the previous frame */
+  uint64_t  hgrad, hedge;    /* horizontal neighbours, all and across block edges */
+  uint64_t  vgrad, vedge;    /* vertical neighbours */
+  uint8_t  *row[2];          /* packed YUY2 luma */
+} analyze_band_t;
+
+/* plugin structure */
+struct post_plugin_analyze_s {
+  post_plugin_t      post;
+
+  /* private data */
+  analyze_parameters_t params;
+  pthread_mutex_t    lock;
+
+  uint32_t         (*sad_row)   (const uint8_t *a, const uint8_t *b, int width);
+  uint32_t         (*grad_row)  (const uint8_t *p, int width, uint32_t *edge);
+
+  /* luma of the previous frame, width x height, and its histogram */
+  uint8_t           *prev;
+  int                prev_width, prev_height, prev_valid;
+  uint32_t           prev_hist[256];
+  int                frozen;
+
+  analyze_band_t     band[POST_SLICES_MAX];
+  int                band_width;
+
+  uint32_t           written;
+  analyze_metrics_t  ring[ANALYZE_RING];
+};
+
+
+/* row kernels. sad_row () returns the sum of |a - b|. grad_row () returns
+ * the sum of |p[x] - p[x + 1]|, and in *edge the part of it across 8 pixel
+ * block edges, that is, for x = 7, 15, 23, ... */
+
+static uint32_t sad_row_c (const uint8_t *a, const uint8_t *b, int width) {
+  uint32_t sum = 0;
+  int x;
+
+  for (x = 0; x < width; x++)
+    sum += abs (a[x] - b[x]);
+  return sum;
+}
+
+static uint32_t grad_row_tail (const uint8_t *p, int x, int width, uint32_t *edge) {
+  uint32_t sum = 0, e = 0;
+
+  for (; x < width - 1; x++) {
+    uint32_t d = abs (p[x] - p[x + 1]);
+    sum += d;
+    if ((x & 7) == 7)
+      e += d;
+  }
+  *edge += e;
+  return sum;
+}
+
+static uint32_t grad_row_c (const uint8_t *p, int width, uint32_t *edge) {
+  *edge = 0;
+  return grad_row_tail (p, 0, width, edge);
+}
+
+#if defined(ARCH_X86_64)
+
+static const uint8_t ATTR_ALIGN(32) edge_mask[32] = {
+  0, 0, 0, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0, 0, 0, 0xff,
+  0, 0, 0, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0, 0, 0, 0xff
+};
+
+static uint32_t sad_row_sse2 (const uint8_t *a, const uint8_t *b, int width) {
+  long x = 0, n = width & ~15;
+  uint32_t sum = 0;
+
+  if (n) {
+    __asm__ __volatile__ (
+      "pxor      %%xmm2, %%xmm2         \n\t"
+      "1:                               \n\t"
+      "movdqu    (%2,%0), %%xmm0        \n\t"
+      "movdqu    (%3,%0), %%xmm1        \n\t"
+      "psadbw    %%xmm1, %%xmm0         \n\t"
+      "paddq     %%xmm0, %%xmm2         \n\t"
+      "add       $16, %0                \n\t"
+      "cmp       %4, %0                 \n\t"
+      "jb        1b                     \n\t"
+      "pshufd    $0xee, %%xmm2, %%xmm0  \n\t"
+      "paddq     %%xmm0, %%xmm2         \n\t"
+      "movd      %%xmm2, %1             \n\t"
+      : "+r" (x), "=m" (sum)
+      : "r" (a), "r" (b), "r" (n)
+      : "memory", "xmm0", "xmm1", "xmm2");
+  }
+  return sum + sad_row_c (a + x, b + x, width - x);
+}
+
+static uint32_t grad_row_sse2 (const uint8_t *p, int width, uint32_t *edge) {
+  /* p[x + 16] is the last one read */
+  long x = 0, n = (width - 1) & ~15;
+  uint32_t sum = 0;
+
+  *edge = 0;
+  if (n) {
+    __asm__ __volatile__ (
+      "pxor      %%xmm4, %%xmm4         \n\t"
+      "pxor      %%xmm5, %%xmm5         \n\t"
+      "pxor      %%xmm6, %%xmm6         \n\t"
+      "movdqa    (%4), %%xmm7           \n\t"
+      "1:                               \n\t"
+      "movdqu    (%3,%0), %%xmm0        \n\t"
+      "movdqu    1(%3,%0), %%xmm1       \n\t"
+      "movdqa    %%xmm0, %%xmm2         \n\t"
+      "psubusb   %%xmm1, %%xmm0         \n\t"
+      "psubusb   %%xmm2, %%xmm1         \n\t"
+      "por       %%xmm1, %%xmm0         \n\t"
+      "movdqa    %%xmm0, %%xmm1         \n\t"
+      "pand      %%xmm7, %%xmm1         \n\t"
+      "psadbw    %%xmm6, %%xmm0         \n\t"
+      "psadbw    %%xmm6, %%xmm1         \n\t"
+      "paddq     %%xmm0, %%xmm4         \n\t"
+      "paddq     %%xmm1, %%xmm5         \n\t"
+      "add       $16, %0                \n\t"
+      "cmp       %5, %0                 \n\t"
+      "jb        1b                     \n\t"
+      "pshufd    $0xee, %%xmm4, %%xmm0  \n\t"
+      "pshufd    $0xee, %%xmm5, %%xmm1  \n\t"
+      "paddq     %%xmm0, %%xmm4         \n\t"
+      "paddq     %%xmm1, %%xmm5         \n\t"
+      "movd      %%xmm4, %1             \n\t"
+      "movd      %%xmm5, %2             \n\t"
+      : "+r" (x), "=m" (sum), "=m" (*edge)
+      : "r" (p), "r" (edge_mask), "r" (n)
+      : "memory", "xmm0", "xmm1", "xmm2", "xmm4", "xmm5", "xmm6", "xmm7");
+  }
+  return sum + grad_row_tail (p, x, width, edge);
+}
+
+#if defined(HAVE_AVX2)
+static uint32_t sad_row_avx2 (const uint8_t *a, const uint8_t *b, int width) {
+  long x = 0, n = width & ~31;
+  uint32_t sum = 0;
+
+  if (n) {
+    __asm__ __volatile__ (
+      "vpxor        %%ymm2, %%ymm2, %%ymm2         \n\t"
+      "1:                                          \n\t"
+      "vmovdqu      (%2,%0), %%ymm0                \n\t"
+      "vpsadbw      (%3,%0), %%ymm0, %%ymm0        \n\t"
+      "vpaddq       %%ymm0, %%ymm2, %%ymm2         \n\t"
+      "add          $32, %0                        \n\t"
+      "cmp          %4, %0                         \n\t"
+      "jb           1b                             \n\t"
+      "vextracti128 $1, %%ymm2, %%xmm0             \n\t"
+      "vpaddq       %%xmm0, %%xmm2, %%xmm2         \n\t"
+      "vpshufd      $0xee, %%xmm2, %%xmm0          \n\t"
+      "vpaddq       %%xmm0, %%xmm2, %%xmm2         \n\t"
+      "vmovd        %%xmm2, %1                     \n\t"
+      "vzeroupper                                  \n\t"
+      : "+r" (x), "=m" (sum)
+      : "r" (a), "r" (b), "r" (n)
+      : "memory", "xmm0", "xmm1", "xmm2");
+  }
+  return sum + sad_row_c (a + x, b + x, width - x);
+}
+
+static uint32_t grad_row_avx2 (const uint8_t *p, int width, uint32_t *edge) {
+  long x = 0, n = (width - 1) & ~31;
+  uint32_t sum = 0;
+
+  *edge = 0;
+  if (n) {
+    __asm__ __volatile__ (
+      "vpxor        %%ymm4, %%ymm4, %%ymm4         \n\t"
+      "vpxor        %%ymm5, %%ymm5, %%ymm5         \n\t"
+      "vpxor        %%ymm6, %%ymm6, %%ymm6         \n\t"
+      "vmovdqa      (%4), %%ymm7                   \n\t"
+      "1:                                          \n\t"
+      "vmovdqu      (%3,%0), %%ymm0                \n\t"
+      "vmovdqu      1(%3,%0), %%ymm1               \n\t"
+      "vpmaxub      %%ymm1, %%ymm0, %%ymm2         \n\t"
+      "vpminub      %%ymm1, %%ymm0, %%ymm0         \n\t"
+      "vpsubb       %%ymm0, %%ymm2, %%ymm0         \n\t"
+      "vpand        %%ymm7, %%ymm0, %%ymm1         \n\t"
+      "vpsadbw      %%ymm6, %%ymm0, %%ymm0         \n\t"
+      "vpsadbw      %%ymm6, %%ymm1, %%ymm1         \n\t"
+      "vpaddq       %%ymm0, %%ymm4, %%ymm4         \n\t"
+      "vpaddq       %%ymm1, %%ymm5, %%ymm5         \n\t"
+      "add          $32, %0                        \n\t"
+      "cmp          %5, %0                         \n\t"
+      "jb           1b                             \n\t"
+      "vextracti128 $1, %%ymm4, %%xmm0             \n\t"
+      "vextracti128 $1, %%ymm5, %%xmm1             \n\t"
+      "vpaddq       %%xmm0, %%xmm4, %%xmm4         \n\t"
+      "vpaddq       %%xmm1, %%xmm5, %%xmm5         \n\t"
+      "vpshufd      $0xee, %%xmm4, %%xmm0          \n\t"
+      "vpshufd      $0xee, %%xmm5, %%xmm1          \n\t"
+      "vpaddq       %%xmm0, %%xmm4, %%xmm4         \n\t"
+      "vpaddq       %%xmm1, %%xmm5, %%xmm5         \n\t"
+      "vmovd        %%xmm4, %1                     \n\t"
+      "vmovd        %%xmm5, %2                     \n\t"
+      "vzeroupper                                  \n\t"
+      : "+r" (x), "=m" (sum), "=m" (*edge)
+      : "r" (p), "r" (edge_mask), "r" (n)
+      : "memory", "xmm0", "xmm1", "xmm2", "xmm4", "xmm5", "xmm6", "xmm7");
+  }
+  return sum + grad_row_tail (p, x, width, edge);
+}
+#endif /* HAVE_AVX2 */
+
+#endif /* ARCH_X86_64 */
+
+
+static int set_parameters (xine_post_t *this_gen, const void *param_gen) {
+  post_plugin_analyze_t *this = (post_plugin_analyze_t *)this_gen;
+  const analyze_parameters_t *param = (const analyze_parameters_t *)param_gen;
+
+  pthread_mutex_lock (&this->lock);
+
+  this->params.black_level  = param->black_level;
+  this->params.black_ratio  = param->black_ratio;
+  this->params.freeze_level = param->freeze_level;
+
+  pthread_mutex_unlock (&this->lock);
+
+  return 1;
+}
+
+static int get_parameters (xine_post_t *this_gen, void *param_gen) {
+  post_plugin_analyze_t *this = (post_plugin_analyze_t *)this_gen;
+  analyze_parameters_t *param = (analyze_parameters_t *)param_gen;
+  analyze_metrics_t m;
+  uint32_t newest, want;
+  int i;
+
+  pthread_mutex_lock (&this->lock);
+  param->black_level  = this->params.black_level;
+  param->black_ratio  = this->params.black_ratio;
+  param->freeze_level = this->params.freeze_level;
+  pthread_mutex_unlock (&this->lock);
+
+  /* lock free, so a monitor polling this never stalls the video. */
+  want = param->frame;
+  for (;;) {
+    newest = RING_LOAD (&this->written);
+    if (!newest) {
+      memset (&m, 0, sizeof (m));
+      break;
+    }
+    if (!want || want > newest)
+      want = newest;
+    else if (newest - want >= ANALYZE_RING)
+      want = newest - ANALYZE_RING + 1;
+    if (RING_LOAD (&this->ring[want % ANALYZE_RING].frame) == want) {
+      memcpy (&m, &this->ring[want % ANALYZE_RING], sizeof (m));
+      RING_FENCE_ACQUIRE ();
+      if (RING_LOAD (&this->ring[want % ANALYZE_RING].frame) == want)
+        break;
+    }
+    /* overwritten meanwhile, take the oldest one left */
+    want = 1;
+  }
+
+  param->frame      = m.frame;
+  param->frames     = newest;
+  param->vpts       = m.vpts;
+  param->width      = m.width;
+  param->height     = m.height;
+  param->average    = m.average;
+  param->minimum    = m.minimum;
+  param->maximum    = m.maximum;
+  param->black      = m.black;
+  param->frozen     = m.frozen;
+  param->difference = m.difference;
+  param->blockiness = m.blockiness;
+  param->scene      = m.scene;
+  for (i = 0; i < 256; i++)
+    param->histogram[i] = m.histogram[i];
+
+  return 1;
+}
+
+static xine_post_api_descr_t * get_param_descr (void) {
+  return &param_descr;
+}
+
+static char * get_help (void) {
+  return _("Measures every frame and passes it on unchanged, eg. for quality "
+           "monitoring of live feeds. It also works with the \"none\" video "
+           "output, as fast as the decoder goes.\n"
+           "The metrics of the last 256 frames can be read through the "
+           "parameters: set frame to a frame number, or to 0 for the newest "
+           "one, and read the parameters back.\n"
+           "\n"
+           "Parameters\n"
+           "  black_level: luma at or below which a pixel is black\n"
+           "  black_ratio: percentage of black pixels in a black frame\n"
+           "  freeze_level: mean luma difference to the previous frame below "
+           "which a frame counts as frozen\n"
+           "\n"
+           "Metrics (read only)\n"
+           "  average, minimum, maximum: luma levels\n"
+           "  black: the frame is black\n"
+           "  frozen: frozen frames in a row up to this one\n"
+           "  difference: mean luma difference to the previous frame\n"
+           "  blockiness: gradient across 8x8 block edges relative to "
+           "elsewhere, around 1 for clean pictures\n"
+           "  scene: histogram change to the previous frame, 0 to 1, high "
+           "values mark scene cuts\n"
+           "  histogram: the 256 luma counts\n"
+           "\n"
+           "Only YV12 and YUY2 frames are measured.\n"
+           );
+}
+
+
+static void analyze_free_buffers (post_plugin_analyze_t *this) {
+  int i;
+
+  xine_freep_aligned (&this->prev);
+  this->prev_width = this->prev_height = 0;
+  this->prev_valid = 0;
+  for (i = 0; i < POST_SLICES_MAX; i++) {
+    xine_freep_aligned (&this->band[i].row[0]);
+    this->band[i].row[1] = NULL;
+  }
+  this->band_width = 0;
+}
+
+static void analyze_dispose (post_plugin_t *this_gen) {
+  post_plugin_analyze_t *this = (post_plugin_analyze_t *)this_gen;
+
+  if (_x_post_dispose (this_gen)) {
+    analyze_free_buffers (this);
+    pthread_mutex_destroy (&this->lock);
+    free (this);
+  }
+}
+
+
+static int analyze_intercept_frame (post_video_port_t *port, vo_frame_t *frame) {
+  (void)port;
+  return (frame->format == XINE_IMGFMT_YV12 || frame->format == XINE_IMGFMT_YUY2);
+}
+
+
+typedef struct {
+  post_plugin_analyze_t *this;
+  vo_frame_t            *frame;
+} analyze_slice_t;
+
+static const uint8_t *analyze_luma_row (analyze_band_t *b, vo_frame_t *frame, int y) {
+  const uint8_t *src = frame->base[0] + y * frame->pitches[0];
+  uint8_t *dst;
+  int x;
+
+  if (frame->format == XINE_IMGFMT_YV12)
+    return src;
+  dst = b->row[y & 1];
+  for (x = 0; x < frame->width; x++)
+    dst[x] = src[2 * x];
+  return dst;
+}
+
+static void analyze_slice (void *data, int band, int y0, int y1) {
+  analyze_slice_t *job = (analyze_slice_t *)data;
+  post_plugin_analyze_t *this = job->this;
+  vo_frame_t *frame = job->frame;
+  analyze_band_t *b = &this->band[band];
+  int width = frame->width, height = frame->height;
+  const uint8_t *cur, *next;
+  int x, y;
+
+  memset (b->hist, 0, sizeof (b->hist));
+  b->sad = b->hgrad = b->hedge = b->vgrad = b->vedge = 0;
+  b->used = 1;
+
+  cur = analyze_luma_row (b, frame, y0);
+  for (y = y0; y < y1; y++) {
+    uint8_t *prev = this->prev + y * width;
+    uint32_t sum, edge;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+      b->hist[0][cur[x]]++;
+      b->hist[1][cur[x + 1]]++;
+      b->hist[2][cur[x + 2]]++;
+      b->hist[3][cur[x + 3]]++;
+    }
+    for (; x < width; x++)
+      b->hist[0][cur[x]]++;
+
+    sum = this->grad_row (cur, width, &edge);
+    b->hgrad += sum;
+    b->hedge += edge;
+
+    /* the first row of the next band is only read */
+    next = (y + 1 < height) ? analyze_luma_row (b, frame, y + 1) : NULL;
+    if (next) {
+      sum = this->sad_row (cur, next, width);
+      b->vgrad += sum;
+      if ((y & 7) == 7)
+        b->vedge += sum;
+    }
+
+    if (this->prev_valid)
+      b->sad += this->sad_row (cur, prev, width);
+    xine_fast_memcpy (prev, cur, width);
+
+    cur = next;
+  }
+}
+
+/* call with this->lock held */
+static int analyze_setup (post_plugin_analyze_t *this, vo_frame_t *frame) {
+  int i;
+
+  if (frame->width < 2 || frame->height < 2)
+    return 0;
+
+  if (this->prev_width != frame->width || this->prev_height != frame->height) {
+    analyze_free_buffers (this);
+    this->prev = xine_malloc_aligned ((size_t)frame->width * frame->height);
+    if (!this->prev)
+      return 0;
+    this->prev_width  = frame->width;
+    this->prev_height = frame->height;
+  }
+
+  if (frame->format == XINE_IMGFMT_YUY2 && this->band_width != frame->width) {
+    for (i = 0; i < POST_SLICES_MAX; i++) {
+      xine_free_aligned (this->band[i].row[0]);
+      this->band[i].row[0] = xine_malloc_aligned (2 * ((frame->width + 31) & ~31));
+      if (!this->band[i].row[0]) {
+        analyze_free_buffers (this);
+        return 0;
+      }
+      this->band[i].row[1] = this->band[i].row[0] + ((frame->width + 31) & ~31);
+    }
+    this->band_width = frame->width;
+  }
+  return 1;
+}
+
+/* call with this->lock held */
+static void analyze_frame (post_plugin_analyze_t *this, vo_frame_t *frame) {
+  int width = frame->width, height = frame->height;
+  uint32_t pixels = (uint32_t)width * height, frame_num;
+  analyze_metrics_t *m;
+  analyze_slice_t job;
+  uint64_t sad = 0, grad = 0, edge = 0, sum = 0, changed = 0, black, n_edge, n_grad;
+  int i, j;
+
+  for (i = 0; i < POST_SLICES_MAX; i++)
+    this->band[i].used = 0;
+
+  job.this  = this;
+  job.frame = frame;
+  _x_post_slices (&this->post, height, 8, analyze_slice, &job);
+
+  frame_num = this->written + 1;
+  if (!frame_num)
+    frame_num = 1;
+  m = &this->ring[frame_num % ANALYZE_RING];
+  RING_STORE (&m->frame, 0);
+  RING_FENCE_RELEASE ();
+
+  memset (m->histogram, 0, sizeof (m->histogram));
+  for (i = 0; i < POST_SLICES_MAX; i++) {
+    analyze_band_t *b = &this->band[i];
+    if (!b->used)
+      continue;
+    for (j = 0; j < 256; j++)
+      m->histogram[j] += b->hist[0][j] + b->hist[1][j] + b->hist[2][j] + b->hist[3][j];
+    sad  += b->sad;
+    grad += b->hgrad + b->vgrad;
+    edge += b->hedge + b->vedge;
+  }
+
+  m->vpts   = frame->vpts;
+  m->width  = width;
+  m->height = height;
+
+  /* levels */
+  black = 0;
+  for (j = 0; j < 256; j++) {
+    sum += (uint64_t)j * m->histogram[j];
+    if (j <= this->params.black_level)
+      black += m->histogram[j];
+    changed += abs ((int)m->histogram[j] - (int)this->prev_hist[j]);
+  }
+  for (j = 0; j < 255 && !m->histogram[j]; j++) ;
+  m->minimum = j;
+  for (j = 255; j > 0 && !m->histogram[j]; j--) ;
+  m->maximum = j;
+  m->average = (double)sum / pixels;
+  m->black   = black * 100 >= (uint64_t)this->params.black_ratio * pixels;
+
+  /* temporal */
+  if (this->prev_valid) {
+    m->difference = (double)sad / pixels;
+    m->scene      = (double)changed / (2.0 * pixels);
+    this->frozen  = (m->difference <= this->params.freeze_level) ? this->frozen + 1 : 0;
+  } else {
+    m->difference = -1.0;
+    m->scene      = 1.0;
+    this->frozen  = 0;
+  }
+  m->frozen = this->frozen;
+  memcpy (this->prev_hist, m->histogram, sizeof (this->prev_hist));
+  this->prev_valid = 1;
+
+  /* mean gradient across block edges vs. inside the blocks */
+  n_edge = (uint64_t)height * ((width - 1) >> 3) + (uint64_t)width * ((height - 1) >> 3);
+  n_grad = (uint64_t)height * (width - 1) + (uint64_t)width * (height - 1);
+  if (n_edge && n_grad > n_edge)
+    m->blockiness = ((double)edge / n_edge + 1.0) / ((double)(grad - edge) / (n_grad - n_edge) + 1.0);
+  else
+    m->blockiness = 1.0;
+
+  RING_STORE (&m->frame, frame_num);
+  RING_STORE (&this->written, frame_num);
+}
+
+static int analyze_draw (vo_frame_t *frame, xine_stream_t *stream) {
+  post_video_port_t *port = (post_video_port_t *)frame->port;
+  post_plugin_analyze_t *this = (post_plugin_analyze_t *)port->post;
+  int skip;
+
+  if (!frame->bad_frame) {
+    pthread_mutex_lock (&this->lock);
+    if (analyze_setup (this, frame))
+      analyze_frame (this, frame);
+    pthread_mutex_unlock (&this->lock);
+  }
+
+  _x_post_frame_copy_down (frame, frame->next);
+  skip = frame->next->draw (frame->next, stream);
+  _x_post_frame_copy_up (frame, frame->next);
+
+  return skip;
+}
+
+static post_plugin_t *analyze_open_plugin (post_class_t *class_gen, int inputs,
+                                           xine_audio_port_t **audio_target,
+                                           xine_video_port_t **video_target) {
+  post_plugin_analyze_t *this = calloc (1, sizeof (post_plugin_analyze_t));
+  post_in_t             *input;
+  post_out_t            *output;
+  post_video_port_t     *port;
+  uint32_t               accel;
+
+  static const xine_post_api_t post_api = {
+    .set_parameters  = set_parameters,
+    .get_parameters  = get_parameters,
+    .get_param_descr = get_param_descr,
+    .get_help        = get_help,
+  };
+  static const xine_post_in_t params_input = {
+    .name = "parameters",
+    .type = XINE_POST_DATA_PARAMETERS,
+    .data = (void *)&post_api,
+  };
+
+  if (!this || !video_target || !video_target[0]) {
+    free (this);
+    return NULL;
+  }
+
+  (void)class_gen;
+  (void)inputs;
+  (void)audio_target;
+
+  _x_post_init (&this->post, 0, 1);
+
+  this->params.black_level  = 24;
+  this->params.black_ratio  = 98;
+  this->params.freeze_level = 0.5;
+
+  accel = xine_mm_accel ();
+  (void)accel;
+  this->sad_row  = sad_row_c;
+  this->grad_row = grad_row_c;
+#if defined(ARCH_X86_64)
+  if (accel & MM_ACCEL_X86_SSE2) {
+    this->sad_row  = sad_row_sse2;
+    this->grad_row = grad_row_sse2;
+  }
+#  if defined(HAVE_AVX2)
+  if (accel & MM_ACCEL_X86_AVX2) {
+    this->sad_row  = sad_row_avx2;
+    this->grad_row = grad_row_avx2;
+  }
+#  endif
+#endif
+
+  pthread_mutex_init (&this->lock, NULL);
+
+  port = _x_post_intercept_video_port (&this->post, video_target[0], &input, &output);
+  port->intercept_frame = analyze_intercept_frame;
+  port->new_frame->draw = analyze_draw;
+
+  xine_list_push_back (this->post.input, (void *)&params_input);
+
+  input->xine_in.name   = "video";
+  output->xine_out.name = "analyzed video";
+
+  this->post.xine_post.video_input[0] = &port->new_port;
+
+  this->post.dispose = analyze_dispose;
+
+  return &this->post;
+}
+
+void *analyze_init_plugin (xine_t *xine, const void *data) {
+  static const post_class_t post_analyze_class = {
+    .open_plugin     = analyze_open_plugin,
+    .identifier      = "analyze",
+    .description     = N_("measures luma levels, black and frozen frames, blockiness and scene changes"),
+    .dispose         = NULL,
+  };
+
+  (void)xine;
+  (void)data;
+
+  return (void *)&post_analyze_class;
+}
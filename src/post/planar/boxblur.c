@@ -203,14 +203,56 @@ static void vBlur(uint8_t *dst, uint8_t *src, int w, int h, int dstStride, int s
 }
 
 
+typedef struct {
+  vo_frame_t *src, *dst;
+  int         width;
+  int         luma_radius, luma_power;
+  int         chroma_radius, chroma_power;
+} boxblur_slice_t;
+
+/* horizontal pass, bands of rows */
+static void boxblur_slice_h(void *data, int band, int y0, int y1)
+{
+  boxblur_slice_t *job = (boxblur_slice_t *)data;
+  vo_frame_t *src = job->src, *dst = job->dst;
+  int i;
+
+  (void)band;
+
+  hBlur(dst->base[0] + y0 * dst->pitches[0], src->base[0] + y0 * src->pitches[0], job->width, y1 - y0,
+        dst->pitches[0], src->pitches[0], job->luma_radius, job->luma_power);
+  y0 /= 2;
+  y1 /= 2;
+  for (i = 1; i < 3; i++)
+    hBlur(dst->base[i] + y0 * dst->pitches[i], src->base[i] + y0 * src->pitches[i], job->width/2, y1 - y0,
+          dst->pitches[i], src->pitches[i], job->chroma_radius, job->chroma_power);
+}
+
+/* vertical pass in place, bands of columns */
+static void boxblur_slice_v(void *data, int band, int x0, int x1)
+{
+  boxblur_slice_t *job = (boxblur_slice_t *)data;
+  vo_frame_t *dst = job->dst;
+  int i;
+
+  (void)band;
+
+  vBlur(dst->base[0] + x0, dst->base[0] + x0, x1 - x0, dst->height,
+        dst->pitches[0], dst->pitches[0], job->luma_radius, job->luma_power);
+  x0 /= 2;
+  x1 /= 2;
+  for (i = 1; i < 3; i++)
+    vBlur(dst->base[i] + x0, dst->base[i] + x0, x1 - x0, dst->height/2,
+          dst->pitches[i], dst->pitches[i], job->chroma_radius, job->chroma_power);
+}
+
 static int boxblur_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)frame->port;
   post_plugin_boxblur_t *this = (post_plugin_boxblur_t *)port->post;
   vo_frame_t *out_frame;
   vo_frame_t *yv12_frame;
-  int chroma_radius, chroma_power;
-  int cw, ch;
+  boxblur_slice_t job;
   int skip;
 
   if( !frame->bad_frame ) {
@@ -243,29 +285,24 @@ static int boxblur_draw(vo_frame_t *frame, xine_stream_t *stream)
 
     pthread_mutex_lock (&this->lock);
 
-    chroma_radius = (this->params.chroma_radius != -1) ? this->params.chroma_radius :
-                                                         this->params.luma_radius;
-    chroma_power = (this->params.chroma_power != -1) ? this->params.chroma_power :
-                                                       this->params.luma_power;
-    cw = yv12_frame->width/2;
-    ch = yv12_frame->height/2;
-
-    hBlur(out_frame->base[0], yv12_frame->base[0], yv12_frame->width, yv12_frame->height,
-          out_frame->pitches[0], yv12_frame->pitches[0], this->params.luma_radius, this->params.luma_power);
-    hBlur(out_frame->base[1], yv12_frame->base[1], cw,ch,
-          out_frame->pitches[1], yv12_frame->pitches[1], chroma_radius, chroma_power);
-    hBlur(out_frame->base[2], yv12_frame->base[2], cw,ch,
-          out_frame->pitches[2], yv12_frame->pitches[2], chroma_radius, chroma_power);
-
-    vBlur(out_frame->base[0], out_frame->base[0], yv12_frame->width, yv12_frame->height,
-          out_frame->pitches[0], out_frame->pitches[0], this->params.luma_radius, this->params.luma_power);
-    vBlur(out_frame->base[1], out_frame->base[1], cw,ch,
-          out_frame->pitches[1], out_frame->pitches[1], chroma_radius, chroma_power);
-    vBlur(out_frame->base[2], out_frame->base[2], cw,ch,
-          out_frame->pitches[2], out_frame->pitches[2], chroma_radius, chroma_power);
+    job.src           = yv12_frame;
+    job.dst           = out_frame;
+    job.width         = yv12_frame->width;
+    job.luma_radius   = this->params.luma_radius;
+    job.luma_power    = this->params.luma_power;
+    job.chroma_radius = (this->params.chroma_radius != -1) ? this->params.chroma_radius :
+                                                             this->params.luma_radius;
+    job.chroma_power  = (this->params.chroma_power != -1) ? this->params.chroma_power :
+                                                            this->params.luma_power;
+
+    /* column bands of 32 luma pixels keep cache lines apart */
+    _x_post_slices (&this->post, yv12_frame->height, 2, boxblur_slice_h, &job);
+    _x_post_slices (&this->post, yv12_frame->width, 32, boxblur_slice_v, &job);
 
     pthread_mutex_unlock (&this->lock);
 
+    _x_post_frame_writable(out_frame);
+
     skip = out_frame->draw(out_frame, stream);
 
     _x_post_frame_copy_up(frame, out_frame);
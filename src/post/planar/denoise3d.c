@@ -37,6 +37,8 @@
 #define PARAM2_DEFAULT 3.0
 #define PARAM3_DEFAULT 6.0
 #define MAX_LINE_WIDTH 2048
+/* rows a band runs ahead to settle the vertical low pass */
+#define BAND_OVERLAP 16
 
 
 typedef struct post_plugin_denoise3d_s post_plugin_denoise3d_t;
@@ -74,7 +76,7 @@ struct post_plugin_denoise3d_s {
   denoise3d_parameters_t params;
 
   int                    Coefs[4][512];
-  unsigned char          Line[MAX_LINE_WIDTH];
+  unsigned char          Line[POST_SLICES_MAX][MAX_LINE_WIDTH];
   vo_frame_t            *prev_frame;
 
   pthread_mutex_t        lock;
@@ -183,31 +185,55 @@ static int denoise3d_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 
 #define LowPass(Prev, Curr, Coef) (((Prev)*Coef[Prev - Curr] + (Curr)*(65536-(Coef[Prev - Curr]))) / 65536)
 
+/*
+ * filter rows Y0..Y1-1. The vertical low pass depends on all rows above,
+ * bands other than the first start BAND_OVERLAP rows early without writing.
+ */
 static void deNoise(unsigned char *Frame,
                     unsigned char *FramePrev,
                     unsigned char *FrameDest,
                     unsigned char *LineAnt,
                     int W, int H, int sStride, int pStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+                    int *Horizontal, int *Vertical, int *Temporal,
+                    int Y0, int Y1)
 {
-    int X, Y;
-    int sLineOffs = 0, pLineOffs = 0, dLineOffs = 0;
+    int X, Y, S;
+    int sLineOffs, pLineOffs, dLineOffs;
     unsigned char PixelAnt;
 
-    /* First pixel has no left nor top neightbour. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0];
-    FrameDest[0] = LowPass(FramePrev[0], LineAnt[0], Temporal);
+    if (Y1 > H)
+        Y1 = H;
+    if (Y0 >= Y1)
+        return;
+    S = (Y0 > BAND_OVERLAP) ? Y0 - BAND_OVERLAP : 0;
+    sLineOffs = S * sStride, pLineOffs = S * pStride, dLineOffs = S * dStride;
 
     /* Fist line has no top neightbour. Only left one for each pixel and
      * last frame */
+    LineAnt[0] = PixelAnt = Frame[sLineOffs];
     for (X = 1; X < W; X++)
     {
-        PixelAnt = LowPass(PixelAnt, Frame[X], Horizontal);
+        PixelAnt = LowPass(PixelAnt, Frame[sLineOffs+X], Horizontal);
         LineAnt[X] = PixelAnt;
-        FrameDest[X] = LowPass(FramePrev[X], LineAnt[X], Temporal);
+    }
+    if (S == Y0)
+        for (X = 0; X < W; X++)
+            FrameDest[dLineOffs+X] = LowPass(FramePrev[pLineOffs+X], LineAnt[X], Temporal);
+
+    for (Y = S + 1; Y < Y0; Y++)
+    {
+	sLineOffs += sStride, pLineOffs += pStride, dLineOffs += dStride;
+        PixelAnt = Frame[sLineOffs];
+        LineAnt[0] = LowPass(LineAnt[0], PixelAnt, Vertical);
+
+        for (X = 1; X < W; X++)
+        {
+            PixelAnt = LowPass(PixelAnt, Frame[sLineOffs+X], Horizontal);
+            LineAnt[X] = LowPass(LineAnt[X], PixelAnt, Vertical);
+        }
     }
 
-    for (Y = 1; Y < H; Y++)
+    for (Y = (S + 1 > Y0) ? S + 1 : Y0; Y < Y1; Y++)
     {
 	sLineOffs += sStride, pLineOffs += pStride, dLineOffs += dStride;
         /* First pixel on each line doesn't have previous pixel */
@@ -225,15 +251,45 @@ static void deNoise(unsigned char *Frame,
     }
 }
 
+typedef struct {
+  post_plugin_denoise3d_t *this;
+  vo_frame_t *src, *prev, *dst;
+} denoise3d_slice_t;
+
+static void denoise3d_slice(void *data, int band, int y0, int y1)
+{
+  denoise3d_slice_t *job = (denoise3d_slice_t *)data;
+  post_plugin_denoise3d_t *this = job->this;
+  vo_frame_t *src = job->src, *prev = job->prev, *dst = job->dst;
+  int cw = src->width/2;
+  int ch = src->height/2;
+  int i;
+
+  deNoise(src->base[0], prev->base[0], dst->base[0],
+          this->Line[band], src->width, src->height,
+          src->pitches[0], prev->pitches[0], dst->pitches[0],
+          this->Coefs[0] + 256,
+          this->Coefs[0] + 256,
+          this->Coefs[1] + 256,
+          y0, y1);
+  for (i = 1; i < 3; i++)
+    deNoise(src->base[i], prev->base[i], dst->base[i],
+            this->Line[band], cw, ch,
+            src->pitches[i], prev->pitches[i], dst->pitches[i],
+            this->Coefs[2] + 256,
+            this->Coefs[2] + 256,
+            this->Coefs[3] + 256,
+            y0/2, y1/2);
+}
+
 
 static int denoise3d_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)frame->port;
   post_plugin_denoise3d_t *this = (post_plugin_denoise3d_t *)port->post;
   vo_frame_t *out_frame;
-  vo_frame_t *prev_frame;
   vo_frame_t *yv12_frame;
-  int cw, ch;
+  denoise3d_slice_t job;
   int skip;
 
   if( !frame->bad_frame ) {
@@ -266,31 +322,16 @@ static int denoise3d_draw(vo_frame_t *frame, xine_stream_t *stream)
 
     pthread_mutex_lock (&this->lock);
 
-    cw = yv12_frame->width/2;
-    ch = yv12_frame->height/2;
-    prev_frame = (this->prev_frame) ? this->prev_frame : yv12_frame;
-
-    deNoise(yv12_frame->base[0], prev_frame->base[0], out_frame->base[0],
-            this->Line, yv12_frame->width, yv12_frame->height,
-            yv12_frame->pitches[0], prev_frame->pitches[0], out_frame->pitches[0],
-            this->Coefs[0] + 256,
-            this->Coefs[0] + 256,
-            this->Coefs[1] + 256);
-    deNoise(yv12_frame->base[1], prev_frame->base[1], out_frame->base[1],
-            this->Line, cw, ch,
-            yv12_frame->pitches[1], prev_frame->pitches[1], out_frame->pitches[1],
-            this->Coefs[2] + 256,
-            this->Coefs[2] + 256,
-            this->Coefs[3] + 256);
-    deNoise(yv12_frame->base[2], prev_frame->base[2], out_frame->base[2],
-            this->Line, cw, ch,
-            yv12_frame->pitches[2], prev_frame->pitches[2], out_frame->pitches[2],
-            this->Coefs[2] + 256,
-            this->Coefs[2] + 256,
-            this->Coefs[3] + 256);
+    job.this = this;
+    job.src  = yv12_frame;
+    job.prev = (this->prev_frame) ? this->prev_frame : yv12_frame;
+    job.dst  = out_frame;
+    _x_post_slices (&this->post, yv12_frame->height, 2, denoise3d_slice, &job);
 
     pthread_mutex_unlock (&this->lock);
 
+    _x_post_frame_writable(out_frame);
+
     skip = out_frame->draw(out_frame, stream);
 
     _x_post_frame_copy_up(frame, out_frame);
@@ -358,6 +399,7 @@ static post_plugin_t *denoise3d_open_plugin(post_class_t *class_gen, int inputs,
   port->new_port.close  = denoise3d_close;
   port->intercept_frame = denoise3d_intercept_frame;
   port->new_frame->draw = denoise3d_draw;
+  port->need_all_frames = 1;
 
   xine_list_push_back(this->post.input, (void *)&params_input);
 
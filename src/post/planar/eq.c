@@ -168,6 +168,8 @@ struct post_plugin_eq_s {
 
   /* private data */
   eq_parameters_t    params;
+  /* what the current frame gets filtered with */
+  eq_parameters_t    band_params;
 
   pthread_mutex_t    lock;
 };
@@ -264,60 +266,73 @@ static int eq_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 }
 
 
-static int eq_draw(vo_frame_t *frame, xine_stream_t *stream)
+static void eq_band(void *data, vo_frame_t *src, vo_frame_t *dst, int y0, int y1)
+{
+  const eq_parameters_t *params = (const eq_parameters_t *)data;
+  int i;
+
+  process(dst->base[0] + y0 * dst->pitches[0], dst->pitches[0],
+          src->base[0] + y0 * src->pitches[0], src->pitches[0],
+          src->width, y1 - y0, params->brightness, params->contrast);
+
+  if (src == dst)
+    return;
+  for (i = 1; i < 3; i++)
+    xine_fast_memcpy(dst->base[i] + y0 / 2 * dst->pitches[i],
+                     src->base[i] + y0 / 2 * src->pitches[i],
+                     src->pitches[i] * ((y1 + 1) / 2 - y0 / 2));
+}
+
+static int eq_band_op(post_video_port_t *port, vo_frame_t *frame, post_band_op_t *op)
 {
-  post_video_port_t *port = (post_video_port_t *)frame->port;
   post_plugin_eq_t *this = (post_plugin_eq_t *)port->post;
-  vo_frame_t *out_frame;
-  vo_frame_t *yv12_frame;
-  int skip;
 
-  if( !frame->bad_frame &&
-      ((this->params.brightness != 0) || (this->params.contrast != 0)) ) {
+  (void)frame;
+
+  pthread_mutex_lock (&this->lock);
+  this->band_params = this->params;
+  pthread_mutex_unlock (&this->lock);
 
-    /* convert to YV12 if needed */
-    if( frame->format != XINE_IMGFMT_YV12 ) {
+  if ((this->band_params.brightness == 0) && (this->band_params.contrast == 0))
+    return 0;
 
-      yv12_frame = port->original_port->get_frame(port->original_port,
-        frame->width, frame->height, frame->ratio, XINE_IMGFMT_YV12, frame->flags | VO_BOTH_FIELDS);
+  op->func = eq_band;
+  op->data = &this->band_params;
+  return 1;
+}
 
-      _x_post_frame_copy_down(frame, yv12_frame);
 
-      yuy2_to_yv12(frame->base[0], frame->pitches[0],
-                   yv12_frame->base[0], yv12_frame->pitches[0],
-                   yv12_frame->base[1], yv12_frame->pitches[1],
-                   yv12_frame->base[2], yv12_frame->pitches[2],
-                   frame->width, frame->height);
+static int eq_draw(vo_frame_t *frame, xine_stream_t *stream)
+{
+  post_video_port_t *port = (post_video_port_t *)frame->port;
+  vo_frame_t *yv12_frame;
+  post_band_op_t op;
+  int skip;
 
-    } else {
-      yv12_frame = frame;
-      yv12_frame->lock(yv12_frame);
-    }
+  if (frame->format == XINE_IMGFMT_YV12)
+    return _x_post_band_draw(frame, stream);
 
+  if( !frame->bad_frame && eq_band_op(port, frame, &op) ) {
 
-    out_frame = port->original_port->get_frame(port->original_port,
+    /* convert to YV12, and filter that in place */
+    yv12_frame = port->original_port->get_frame(port->original_port,
       frame->width, frame->height, frame->ratio, XINE_IMGFMT_YV12, frame->flags | VO_BOTH_FIELDS);
 
-    _x_post_frame_copy_down(frame, out_frame);
+    _x_post_frame_copy_down(frame, yv12_frame);
 
-    pthread_mutex_lock (&this->lock);
-
-    process(out_frame->base[0], out_frame->pitches[0],
-            yv12_frame->base[0], yv12_frame->pitches[0],
-            frame->width, frame->height,
-            this->params.brightness, this->params.contrast);
-    xine_fast_memcpy(out_frame->base[1],yv12_frame->base[1],
-                     yv12_frame->pitches[1] * frame->height/2);
-    xine_fast_memcpy(out_frame->base[2],yv12_frame->base[2],
-                     yv12_frame->pitches[2] * frame->height/2);
+    yuy2_to_yv12(frame->base[0], frame->pitches[0],
+                 yv12_frame->base[0], yv12_frame->pitches[0],
+                 yv12_frame->base[1], yv12_frame->pitches[1],
+                 yv12_frame->base[2], yv12_frame->pitches[2],
+                 frame->width, frame->height);
 
-    pthread_mutex_unlock (&this->lock);
+    op.func(op.data, yv12_frame, yv12_frame, 0, frame->height);
 
-    skip = out_frame->draw(out_frame, stream);
+    _x_post_frame_writable(yv12_frame);
+    skip = yv12_frame->draw(yv12_frame, stream);
 
-    _x_post_frame_copy_up(frame, out_frame);
+    _x_post_frame_copy_up(frame, yv12_frame);
 
-    out_frame->free(out_frame);
     yv12_frame->free(yv12_frame);
 
   } else {
@@ -377,6 +392,7 @@ static post_plugin_t *eq_open_plugin(post_class_t *class_gen, int inputs,
   port->new_port.set_property = eq_set_property;
   port->intercept_frame       = eq_intercept_frame;
   port->new_frame->draw       = eq_draw;
+  port->band_op               = eq_band_op;
 
   xine_list_push_back(this->post.input, (void *)&params_input);
 
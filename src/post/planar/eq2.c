@@ -330,6 +330,8 @@ struct post_plugin_eq2_s {
   eq2_parameters_t   params;
 
   vf_eq2_t           eq2;
+  /* what the current frame gets filtered with */
+  eq2_param_t        band[3];
 
   pthread_mutex_t    lock;
 };
@@ -451,66 +453,96 @@ static int eq2_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 }
 
 
-static int eq2_draw(vo_frame_t *frame, xine_stream_t *stream)
+static void eq2_band (void *data, vo_frame_t *src, vo_frame_t *dst, int y0, int y1)
+{
+  eq2_param_t *param = (eq2_param_t *)data;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    int start = (i==0) ? y0 : y0/2;
+    int end   = (i==0) ? y1 : (y1+1)/2;
+    int width = (i==0) ? src->width : (src->width+1)/2;
+    unsigned char *s = src->base[i] + start * src->pitches[i];
+    unsigned char *d = dst->base[i] + start * dst->pitches[i];
+
+    if (param[i].adjust != NULL)
+      param[i].adjust (&param[i], d, s, width, end - start, dst->pitches[i], src->pitches[i]);
+    else if (src != dst)
+      xine_fast_memcpy (d, s, src->pitches[i] * (end - start));
+  }
+}
+
+static int eq2_band_op(post_video_port_t *port, vo_frame_t *frame, post_band_op_t *op)
 {
-  post_video_port_t *port = (post_video_port_t *)frame->port;
   post_plugin_eq2_t *this = (post_plugin_eq2_t *)port->post;
-  vo_frame_t *out_frame;
-  vo_frame_t *yv12_frame;
-  vf_eq2_t   *eq2 = &this->eq2;
-  int skip;
+  vf_eq2_t *eq2 = &this->eq2;
   int i;
 
-  if( !frame->bad_frame &&
-      (eq2->param[0].adjust || eq2->param[1].adjust || eq2->param[2].adjust) ) {
+  (void)frame;
 
-    /* convert to YV12 if needed */
-    if( frame->format != XINE_IMGFMT_YV12 ) {
+  pthread_mutex_lock (&this->lock);
+  /* bands share the tables */
+  for (i = 0; i < 3; i++) {
+    if (eq2->param[i].adjust == apply_lut && !eq2->param[i].lut_clean)
+      create_lut (&eq2->param[i]);
+  }
+  memcpy (this->band, eq2->param, sizeof (this->band));
+  pthread_mutex_unlock (&this->lock);
 
-      yv12_frame = port->original_port->get_frame(port->original_port,
-        frame->width, frame->height, frame->ratio, XINE_IMGFMT_YV12, frame->flags | VO_BOTH_FIELDS);
+  if (!this->band[0].adjust && !this->band[1].adjust && !this->band[2].adjust)
+    return 0;
 
-      _x_post_frame_copy_down(frame, yv12_frame);
+  op->func = eq2_band;
+  op->data = this->band;
+  return 1;
+}
 
-      yuy2_to_yv12(frame->base[0], frame->pitches[0],
-                   yv12_frame->base[0], yv12_frame->pitches[0],
-                   yv12_frame->base[1], yv12_frame->pitches[1],
-                   yv12_frame->base[2], yv12_frame->pitches[2],
-                   frame->width, frame->height);
+typedef struct {
+  post_band_op_t op;
+  vo_frame_t    *frame;
+} eq2_slice_t;
 
-    } else {
-      yv12_frame = frame;
-      yv12_frame->lock(yv12_frame);
-    }
+static void eq2_slice (void *data, int band, int y0, int y1)
+{
+  eq2_slice_t *job = (eq2_slice_t *)data;
 
-    out_frame = port->original_port->get_frame(port->original_port,
-      frame->width, frame->height, frame->ratio, XINE_IMGFMT_YV12, frame->flags | VO_BOTH_FIELDS);
+  (void)band;
+  job->op.func (job->op.data, job->frame, job->frame, y0, y1);
+}
 
-    _x_post_frame_copy_down(frame, out_frame);
+static int eq2_draw(vo_frame_t *frame, xine_stream_t *stream)
+{
+  post_video_port_t *port = (post_video_port_t *)frame->port;
+  post_plugin_eq2_t *this = (post_plugin_eq2_t *)port->post;
+  vo_frame_t *yv12_frame;
+  eq2_slice_t job;
+  int skip;
 
-    pthread_mutex_lock (&this->lock);
+  if (frame->format == XINE_IMGFMT_YV12)
+    return _x_post_band_draw(frame, stream);
 
-    for (i = 0; i < 3; i++) {
-      int height, width;
-      height = (i==0) ? frame->height : frame->height/2;
-      width = (i==0) ? frame->width : frame->width/2;
-      if (eq2->param[i].adjust != NULL) {
-        eq2->param[i].adjust (&eq2->param[i], out_frame->base[i], yv12_frame->base[i],
-          width, height, out_frame->pitches[i], yv12_frame->pitches[i]);
-      }
-      else {
-        xine_fast_memcpy(out_frame->base[i],yv12_frame->base[i],
-                         yv12_frame->pitches[i] * height);
-      }
-    }
+  if( !frame->bad_frame && eq2_band_op(port, frame, &job.op) ) {
+
+    /* convert to YV12, and filter that in place */
+    yv12_frame = port->original_port->get_frame(port->original_port,
+      frame->width, frame->height, frame->ratio, XINE_IMGFMT_YV12, frame->flags | VO_BOTH_FIELDS);
+
+    _x_post_frame_copy_down(frame, yv12_frame);
+
+    yuy2_to_yv12(frame->base[0], frame->pitches[0],
+                 yv12_frame->base[0], yv12_frame->pitches[0],
+                 yv12_frame->base[1], yv12_frame->pitches[1],
+                 yv12_frame->base[2], yv12_frame->pitches[2],
+                 frame->width, frame->height);
 
-    pthread_mutex_unlock (&this->lock);
+    job.frame = yv12_frame;
+    _x_post_slices (&this->post, frame->height, 2, eq2_slice, &job);
 
-    skip = out_frame->draw(out_frame, stream);
+    _x_post_frame_writable(yv12_frame);
+    skip = yv12_frame->draw(yv12_frame, stream);
 
-    _x_post_frame_copy_up(frame, out_frame);
+    _x_post_frame_copy_up(frame, yv12_frame);
 
-    out_frame->free(out_frame);
     yv12_frame->free(yv12_frame);
 
   } else {
@@ -571,6 +603,7 @@ static post_plugin_t *eq2_open_plugin(post_class_t *class_gen, int inputs,
   port->new_port.set_property = eq2_set_property;
   port->intercept_frame       = eq2_intercept_frame;
   port->new_frame->draw       = eq2_draw;
+  port->band_op               = eq2_band_op;
 
   xine_list_push_back(this->post.input, (void *)&params_input);
 
@@ -42,12 +42,45 @@ static int invert_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 }
 
 
+static void invert_band(void *data, vo_frame_t *src, vo_frame_t *dst, int y0, int y1)
+{
+  int i, x, y;
+
+  (void)data;
+
+  for (i = 0; i < 3; i++) {
+    int width = (i == 0) ? src->width : (src->width + 1) / 2;
+    int start = (i == 0) ? y0 : y0 / 2;
+    int end   = (i == 0) ? y1 : (y1 + 1) / 2;
+
+    for (y = start; y < end; y++) {
+      const uint8_t *s = src->base[i] + y * src->pitches[i];
+      uint8_t *d = dst->base[i] + y * dst->pitches[i];
+      for (x = 0; x < width; x++)
+        d[x] = 0xff - s[x];
+    }
+  }
+}
+
+static int invert_band_op(post_video_port_t *port, vo_frame_t *frame, post_band_op_t *op)
+{
+  (void)port;
+  (void)frame;
+  op->func = invert_band;
+  op->data = NULL;
+  return 1;
+}
+
+
 static int invert_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)frame->port;
   vo_frame_t *inverted_frame;
   int size, i, skip;
 
+  if (frame->format == XINE_IMGFMT_YV12)
+    return _x_post_band_draw(frame, stream);
+
   if (frame->bad_frame) {
     _x_post_frame_copy_down(frame, frame->next);
     skip = frame->next->draw(frame->next, stream);
@@ -59,27 +92,11 @@ static int invert_draw(vo_frame_t *frame, xine_stream_t *stream)
     frame->width, frame->height, frame->ratio, frame->format, frame->flags | VO_BOTH_FIELDS);
   _x_post_frame_copy_down(frame, inverted_frame);
 
-  switch (inverted_frame->format) {
-  case XINE_IMGFMT_YUY2:
-    size = inverted_frame->pitches[0] * inverted_frame->height;
-    for (i = 0; i < size; i++)
-      inverted_frame->base[0][i] = 0xff - frame->base[0][i];
-    break;
-  case XINE_IMGFMT_YV12:
-    /* Y */
-    size = inverted_frame->pitches[0] * inverted_frame->height;
-    for (i = 0; i < size; i++)
-      inverted_frame->base[0][i] = 0xff - frame->base[0][i];
-    /* U */
-    size = inverted_frame->pitches[1] * ((inverted_frame->height + 1) / 2);
-    for (i = 0; i < size; i++)
-      inverted_frame->base[1][i] = 0xff - frame->base[1][i];
-    /* V */
-    size = inverted_frame->pitches[2] * ((inverted_frame->height + 1) / 2);
-    for (i = 0; i < size; i++)
-      inverted_frame->base[2][i] = 0xff - frame->base[2][i];
-    break;
-  }
+  /* YUY2 */
+  size = inverted_frame->pitches[0] * inverted_frame->height;
+  for (i = 0; i < size; i++)
+    inverted_frame->base[0][i] = 0xff - frame->base[0][i];
+  _x_post_frame_writable(inverted_frame);
   skip = inverted_frame->draw(inverted_frame, stream);
   _x_post_frame_copy_up(frame, inverted_frame);
   inverted_frame->free(inverted_frame);
@@ -110,6 +127,7 @@ static post_plugin_t *invert_open_plugin(post_class_t *class_gen, int inputs,
   port = _x_post_intercept_video_port(this, video_target[0], &input, &output);
   port->intercept_frame = invert_intercept_frame;
   port->new_frame->draw = invert_draw;
+  port->band_op         = invert_band_op;
   input->xine_in.name   = "video";
   output->xine_out.name = "inverted video";
   this->xine_post.video_input[0] = &port->new_port;
@@ -160,46 +160,84 @@ static inline void lineNoiseAvg_C(uint8_t *dst, const uint8_t *src, int len, int
 
 /***************************************************************************/
 
-static void noise(uint8_t *dst, const uint8_t *src, int dstStride, int srcStride, int width, int height, noise_param_t *fp)
+/* one plane of a frame. The random line shifts are drawn before the
+ * lines get split up, so bands can run in any order. */
+typedef struct {
+    uint8_t       *dst;
+    const uint8_t *src;
+    int            dstStride, srcStride, width, height;
+    noise_param_t *fp;
+    int            shiftptr;
+    int            shift[MAX_RES];
+} noise_plane_t;
+
+static void noise_prepare(noise_plane_t *p, uint8_t *dst, const uint8_t *src, int dstStride, int srcStride,
+                          int width, int height, noise_param_t *fp)
 {
+    int y;
+
+    p->dst= dst;
+    p->src= src;
+    p->dstStride= dstStride;
+    p->srcStride= srcStride;
+    p->width= width;
+    p->height= height;
+    p->fp= fp;
+    p->shiftptr= fp->shiftptr;
+
+    if(!fp->noise) return;
+
+    for(y=0; y<height; y++)
+    {
+        int shift;
+        if(fp->temporal)    shift=  rand()&(MAX_SHIFT  -1);
+        else                shift= nonTempRandShift[y];
+
+        if(fp->quality==0) shift&= ~7;
+        p->shift[y]= shift;
+    }
+    fp->shiftptr++;
+    if (fp->shiftptr == 3) fp->shiftptr = 0;
+}
+
+static void noise(noise_plane_t *p, int y0, int y1)
+{
+    noise_param_t *fp= p->fp;
     int8_t *noise= fp->noise;
+    uint8_t *dst= p->dst + y0*p->dstStride;
+    const uint8_t *src= p->src + y0*p->srcStride;
     int y;
-    int shift=0;
+
+    if(y1 > p->height) y1= p->height;
 
     if(!noise)
     {
         if(src==dst) return;
 
-        if(dstStride==srcStride) memcpy(dst, src, srcStride*height);
+        if(p->dstStride==p->srcStride) memcpy(dst, src, p->srcStride*(y1-y0));
         else
         {
-            for(y=0; y<height; y++)
+            for(y=y0; y<y1; y++)
             {
-                memcpy(dst, src, width);
-                dst+= dstStride;
-                src+= srcStride;
+                memcpy(dst, src, p->width);
+                dst+= p->dstStride;
+                src+= p->srcStride;
             }
         }
         return;
     }
 
-    for(y=0; y<height; y++)
+    for(y=y0; y<y1; y++)
     {
-        if(fp->temporal)    shift=  rand()&(MAX_SHIFT  -1);
-        else                shift= nonTempRandShift[y];
-
-        if(fp->quality==0) shift&= ~7;
         if (fp->averaged) {
-            fp->lineNoiseAvg(dst, src, width, fp->prev_shift[y]);
-            fp->prev_shift[y][fp->shiftptr] = noise + shift;
+            fp->lineNoiseAvg(dst, src, p->width, fp->prev_shift[y]);
+            fp->prev_shift[y][p->shiftptr] = noise + p->shift[y];
         } else {
-            fp->lineNoise(dst, src, noise, width, shift);
+            fp->lineNoise(dst, src, noise, p->width, p->shift[y]);
         }
-        dst+= dstStride;
-        src+= srcStride;
+        dst+= p->dstStride;
+        src+= p->srcStride;
     }
-    fp->shiftptr++;
-    if (fp->shiftptr == 3) fp->shiftptr = 0;
 }
 
 
@@ -239,6 +277,8 @@ struct post_plugin_noise_s {
 
   /* private data */
   noise_param_t params[2]; // luma and chroma
+  noise_plane_t planes[3];
+  int           num_planes;
 
   pthread_mutex_t    lock;
 };
@@ -332,6 +372,26 @@ static int noise_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 }
 
 
+static void noise_slice(void *data, int band, int y0, int y1)
+{
+    post_plugin_noise_t *this = (post_plugin_noise_t *)data;
+    int i;
+
+    (void)band;
+
+    noise(&this->planes[0], y0, y1);
+    /* Cb before Cr on each line, they share prev_shift */
+    for (i = 1; i < this->num_planes; i++)
+        noise(&this->planes[i], y0/2, y1/2);
+
+#ifdef ARCH_X86
+    if (xine_mm_accel() & MM_ACCEL_X86_MMX)
+        __asm__ __volatile__ ("emms\n\t");
+    if (xine_mm_accel() & MM_ACCEL_X86_MMXEXT)
+        __asm__ __volatile__ ("sfence\n\t");
+#endif
+}
+
 static int noise_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
     post_video_port_t *port = (post_video_port_t *)frame->port;
@@ -356,30 +416,28 @@ static int noise_draw(vo_frame_t *frame, xine_stream_t *stream)
     pthread_mutex_lock (&this->lock);
 
     if (frame->format == XINE_IMGFMT_YV12) {
-        noise(out_frame->base[0], frame->base[0],
+        noise_prepare(&this->planes[0], out_frame->base[0], frame->base[0],
               out_frame->pitches[0], frame->pitches[0],
               frame->width, frame->height, &this->params[0]);
-        noise(out_frame->base[1], frame->base[1],
+        noise_prepare(&this->planes[1], out_frame->base[1], frame->base[1],
               out_frame->pitches[1], frame->pitches[1],
               frame->width/2, frame->height/2, &this->params[1]);
-        noise(out_frame->base[2], frame->base[2],
+        noise_prepare(&this->planes[2], out_frame->base[2], frame->base[2],
               out_frame->pitches[2], frame->pitches[2],
               frame->width/2, frame->height/2, &this->params[1]);
+        this->num_planes = 3;
     } else {
         // Chroma strength is ignored for YUY2.
-        noise(out_frame->base[0], frame->base[0],
+        noise_prepare(&this->planes[0], out_frame->base[0], frame->base[0],
               out_frame->pitches[0], frame->pitches[0],
               frame->width * 2, frame->height, &this->params[0]);
+        this->num_planes = 1;
     }
 
-#ifdef ARCH_X86
-    if (xine_mm_accel() & MM_ACCEL_X86_MMX)
-        __asm__ __volatile__ ("emms\n\t");
-    if (xine_mm_accel() & MM_ACCEL_X86_MMXEXT)
-        __asm__ __volatile__ ("sfence\n\t");
-#endif
+    _x_post_slices (&this->post, frame->height, 2, noise_slice, this);
 
     pthread_mutex_unlock (&this->lock);
+    _x_post_frame_writable(out_frame);
     skip = out_frame->draw(out_frame, stream);
     _x_post_frame_copy_up(frame, out_frame);
 
@@ -35,6 +35,7 @@ static const post_info_t gen_special_info = {
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
+  { PLUGIN_POST, 10, "analyze",   XINE_VERSION_CODE, &gen_special_info, &analyze_init_plugin },
   { PLUGIN_POST, 10, "boxblur",   XINE_VERSION_CODE, &gen_special_info, &boxblur_init_plugin },
   { PLUGIN_POST, 10, "denoise3d", XINE_VERSION_CODE, &gen_special_info, &denoise3d_init_plugin },
   { PLUGIN_POST, 10, "eq",        XINE_VERSION_CODE, &gen_special_info, &eq_init_plugin },
@@ -46,6 +47,7 @@ const plugin_info_t xine_plugin_info[] EXPORTED = {
 #ifdef HAVE_POSTPROC
   { PLUGIN_POST, 10, "pp",        XINE_VERSION_CODE, &gen_special_info, &pp_init_plugin },
 #endif
+  { PLUGIN_POST, 10, "scale",     XINE_VERSION_CODE, &gen_special_info, &scale_init_plugin },
   { PLUGIN_POST, 10, "unsharp",   XINE_VERSION_CODE, &gen_special_info, &unsharp_init_plugin },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
@@ -25,6 +25,7 @@
 
 #include <xine/xine_internal.h>
 
+void *analyze_init_plugin   (xine_t *xine, const void *);
 void *boxblur_init_plugin   (xine_t *xine, const void *);
 void *denoise3d_init_plugin (xine_t *xine, const void *);
 void *eq_init_plugin        (xine_t *xine, const void *);
@@ -36,6 +37,7 @@ void *noise_init_plugin     (xine_t *xine, const void *);
 #ifdef HAVE_POSTPROC
 void *pp_init_plugin        (xine_t *xine, const void *);
 #endif
+void *scale_init_plugin     (xine_t *xine, const void *);
 void *unsharp_init_plugin   (xine_t *xine, const void *);
 
 #endif /* XINE_POST_PLANAR_H */
@@ -45,6 +45,7 @@
 #endif
 
 #define PP_STRING_SIZE 256 /* size of pp mode string (including all options) */
+#define PP_BAND_MARGIN 16  /* rows processed above and below a band and then dropped */
 
 typedef struct post_plugin_pp_s post_plugin_pp_t;
 
@@ -69,6 +70,14 @@ PARAM_ITEM( POST_PARAM_TYPE_CHAR, mode, NULL, 0, 0, 0,
 END_PARAM_DESCR( param_descr )
 
 
+/* libpostproc keeps per picture state, so each band gets its own context */
+typedef struct {
+  pp_context        *context;
+  int                width, height;
+  uint8_t           *buf;
+  int                pitches[3];
+} pp_band_t;
+
 /* plugin structure */
 struct post_plugin_pp_s {
   post_plugin_t post;
@@ -81,8 +90,12 @@ struct post_plugin_pp_s {
 
   /* libpostproc specific stuff */
   int                pp_flags;
-  pp_context        *our_context;
   pp_mode           *our_mode;
+  pp_band_t          bands[POST_SLICES_MAX];
+
+  /* frame being processed */
+  vo_frame_t        *src_frame;
+  vo_frame_t        *dst_frame;
 
   pthread_mutex_t    lock;
 };
@@ -141,6 +154,20 @@ static char * get_help (void) {
   return help;
 }
 
+static void pp_free_bands(post_plugin_pp_t *this)
+{
+  int i;
+
+  for (i = 0; i < POST_SLICES_MAX; i++) {
+    pp_band_t *b = &this->bands[i];
+    if (b->context) {
+      pp_free_context(b->context);
+      b->context = NULL;
+    }
+    _x_freep(&b->buf);
+  }
+}
+
 static void pp_dispose(post_plugin_t *this_gen)
 {
   post_plugin_pp_t *this = (post_plugin_pp_t *)this_gen;
@@ -150,10 +177,7 @@ static void pp_dispose(post_plugin_t *this_gen)
       pp_free_mode(this->our_mode);
       this->our_mode = NULL;
     }
-    if(this->our_context) {
-      pp_free_context(this->our_context);
-      this->our_context = NULL;
-    }
+    pp_free_bands(this);
     free(this);
   }
 }
@@ -166,6 +190,72 @@ static int pp_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 }
 
 
+/*
+ * Bands are postprocessed with PP_BAND_MARGIN extra rows on either side
+ * into a scratch picture, so deblocking and deringing see the same
+ * neighbourhood as in one full frame pass. Only the band itself is
+ * copied to the output.
+ */
+static void pp_slice(void *data, int band, int y0, int y1)
+{
+  post_plugin_pp_t *this = (post_plugin_pp_t *)data;
+  pp_band_t        *b = &this->bands[band];
+  vo_frame_t       *src = this->src_frame;
+  vo_frame_t       *dst = this->dst_frame;
+  int               width = (src->width + 7) & ~7;
+  int               top = y0 > PP_BAND_MARGIN ? y0 - PP_BAND_MARGIN : 0;
+  int               bottom = y1 + PP_BAND_MARGIN < src->height ? y1 + PP_BAND_MARGIN : src->height;
+  int               h = bottom - top;
+  const uint8_t    *sp[3];
+  uint8_t          *dp[3];
+  int               i;
+
+  if (!b->context || b->width != width || b->height != h) {
+    if (b->context)
+      pp_free_context(b->context);
+    _x_freep(&b->buf);
+    b->width  = width;
+    b->height = h;
+    b->context = pp_get_context(width, h, this->pp_flags);
+    if (top != y0 || bottom != y1) {
+      b->pitches[0] = (width + 15) & ~15;
+      b->pitches[1] = b->pitches[2] = b->pitches[0] / 2;
+      b->buf = malloc(b->pitches[0] * h + 2 * b->pitches[1] * ((h + 1) / 2));
+    }
+  }
+  if (!b->context)
+    return;
+
+  sp[0] = src->base[0] + top * src->pitches[0];
+  sp[1] = src->base[1] + top / 2 * src->pitches[1];
+  sp[2] = src->base[2] + top / 2 * src->pitches[2];
+
+  if (top == y0 && bottom == y1) {
+    /* no margins, write directly */
+    dp[0] = dst->base[0] + top * dst->pitches[0];
+    dp[1] = dst->base[1] + top / 2 * dst->pitches[1];
+    dp[2] = dst->base[2] + top / 2 * dst->pitches[2];
+    pp_postprocess(sp, src->pitches, dp, dst->pitches, width, h,
+                   NULL, 0, this->our_mode, b->context, 0);
+    return;
+  }
+
+  if (!b->buf)
+    return;
+  dp[0] = b->buf;
+  dp[1] = dp[0] + b->pitches[0] * h;
+  dp[2] = dp[1] + b->pitches[1] * ((h + 1) / 2);
+  pp_postprocess(sp, src->pitches, dp, b->pitches, width, h,
+                 NULL, 0, this->our_mode, b->context, 0);
+
+  for (i = y0; i < y1; i++)
+    memcpy(dst->base[0] + i * dst->pitches[0], dp[0] + (i - top) * b->pitches[0], width);
+  for (i = y0 / 2; i < (y1 + 1) / 2; i++) {
+    memcpy(dst->base[1] + i * dst->pitches[1], dp[1] + (i - top / 2) * b->pitches[1], width / 2);
+    memcpy(dst->base[2] + i * dst->pitches[2], dp[2] + (i - top / 2) * b->pitches[2], width / 2);
+  }
+}
+
 static int pp_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)frame->port;
@@ -173,7 +263,6 @@ static int pp_draw(vo_frame_t *frame, xine_stream_t *stream)
   vo_frame_t *out_frame;
   vo_frame_t *yv12_frame;
   int skip;
-  int pp_flags;
 
   if( !frame->bad_frame ) {
 
@@ -203,18 +292,13 @@ static int pp_draw(vo_frame_t *frame, xine_stream_t *stream)
 
     pthread_mutex_lock (&this->lock);
 
-    if( !this->our_context ||
-        this->frame_width != yv12_frame->width ||
+    if( this->frame_width != yv12_frame->width ||
         this->frame_height != yv12_frame->height ) {
 
       this->frame_width = yv12_frame->width;
       this->frame_height = yv12_frame->height;
-      pp_flags = this->pp_flags;
-
-      if(this->our_context)
-        pp_free_context(this->our_context);
 
-      this->our_context = pp_get_context(frame->width, frame->height, pp_flags);
+      pp_free_bands(this);
 
       if(this->our_mode) {
         pp_free_mode(this->our_mode);
@@ -226,17 +310,16 @@ static int pp_draw(vo_frame_t *frame, xine_stream_t *stream)
       this->our_mode = pp_get_mode_by_name_and_quality(this->params.mode,
                                                       this->params.quality);
 
-    if(this->our_mode)
-      pp_postprocess((const uint8_t **)yv12_frame->base, yv12_frame->pitches,
-                     out_frame->base, out_frame->pitches,
-                     (frame->width+7)&(~7), frame->height,
-                     NULL, 0,
-                     this->our_mode, this->our_context,
-                     0 /*this->av_frame->pict_type*/);
+    if(this->our_mode) {
+      this->src_frame = yv12_frame;
+      this->dst_frame = out_frame;
+      _x_post_slices(&this->post, frame->height, 16, pp_slice, this);
+    }
 
     pthread_mutex_unlock (&this->lock);
 
     if(this->our_mode) {
+      _x_post_frame_writable(out_frame);
       skip = out_frame->draw(out_frame, stream);
       _x_post_frame_copy_up(frame, out_frame);
     } else {
@@ -308,7 +391,6 @@ static post_plugin_t *pp_open_plugin(post_class_t *class_gen, int inputs,
 #endif
 
   this->our_mode = NULL;
-  this->our_context = NULL;
 
   pthread_mutex_init (&this->lock, NULL);
 
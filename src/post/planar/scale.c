@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2000-2018 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * software video scaler, using the xine-utils scaler
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "planar.h"
+
+#include <xine/xine_internal.h>
+#include <xine/post.h>
+#include <xine/xineutils.h>
+#include <pthread.h>
+
+typedef struct post_plugin_scale_s post_plugin_scale_t;
+
+/*
+ * this is the struct used by "parameters api"
+ */
+typedef struct scale_parameters_s {
+
+  int width;
+  int height;
+  int method;
+
+} scale_parameters_t;
+
+static const char *const enum_methods[] = { "bilinear", "bicubic", "lanczos", NULL };
+
+/*
+ * description of params struct
+ */
+START_PARAM_DESCR( scale_parameters_t )
+PARAM_ITEM( POST_PARAM_TYPE_INT, width, NULL, 0, 4096, 0,
+            "output width (0 = keep aspect, or source width)" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, height, NULL, 0, 4096, 0,
+            "output height (0 = keep aspect, or source height)" )
+PARAM_ITEM( POST_PARAM_TYPE_INT, method, (char **)enum_methods, 0, 0, 0,
+            "interpolation filter" )
+END_PARAM_DESCR( param_descr )
+
+
+/* plugin structure */
+struct post_plugin_scale_s {
+  post_plugin_t      post;
+
+  /* private data */
+  scale_parameters_t params;
+
+  /* luma and chroma scalers of the current geometry */
+  xine_scaler_t     *scaler[2];
+  int                src_width, src_height, format, method;
+  int                dst_width, dst_height;
+
+  pthread_mutex_t    lock;
+};
+
+
+static int set_parameters (xine_post_t *this_gen, const void *param_gen) {
+  post_plugin_scale_t *this = (post_plugin_scale_t *)this_gen;
+  const scale_parameters_t *param = (const scale_parameters_t *)param_gen;
+
+  pthread_mutex_lock (&this->lock);
+
+  memcpy( &this->params, param, sizeof(scale_parameters_t) );
+  /* rebuild the scalers on next frame */
+  this->src_width = 0;
+
+  pthread_mutex_unlock (&this->lock);
+
+  return 1;
+}
+
+static int get_parameters (xine_post_t *this_gen, void *param_gen) {
+  post_plugin_scale_t *this = (post_plugin_scale_t *)this_gen;
+  scale_parameters_t *param = (scale_parameters_t *)param_gen;
+
+
+  memcpy( param, &this->params, sizeof(scale_parameters_t) );
+
+  return 1;
+}
+
+static xine_post_api_descr_t * get_param_descr (void) {
+  return &param_descr;
+}
+
+static char * get_help (void) {
+  return _("Scales video frames to a fixed size in software, eg. to downscale "
+           "before encoding or to make thumbnails.\n"
+           "The display aspect ratio does not change. Put a deinterlacer "
+           "in front of it when scaling interlaced video.\n"
+           "\n"
+           "Parameters\n"
+           "  width: output width, 0 derives it from height and the source "
+           "size\n"
+           "  height: output height, 0 derives it from width and the source "
+           "size\n"
+           "  method: bilinear (fastest), bicubic or lanczos (sharpest)\n"
+           "\n"
+           );
+}
+
+
+static void scale_free_scalers(post_plugin_scale_t *this)
+{
+  xine_scaler_delete(this->scaler[0]);
+  xine_scaler_delete(this->scaler[1]);
+  this->scaler[0] = this->scaler[1] = NULL;
+}
+
+static void scale_dispose(post_plugin_t *this_gen)
+{
+  post_plugin_scale_t *this = (post_plugin_scale_t *)this_gen;
+
+  if (_x_post_dispose(this_gen)) {
+    scale_free_scalers(this);
+    pthread_mutex_destroy(&this->lock);
+    free(this);
+  }
+}
+
+
+static int scale_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
+{
+  (void)port;
+  return (frame->format == XINE_IMGFMT_YV12 || frame->format == XINE_IMGFMT_YUY2);
+}
+
+
+/* call with this->lock held. returns 0 when the frame passes unchanged. */
+static int scale_setup(post_plugin_scale_t *this, vo_frame_t *frame)
+{
+  int width = this->params.width, height = this->params.height;
+
+  if (frame->width < 2 || frame->height < 2 || (!width && !height))
+    return 0;
+
+  if (this->params.method < XINE_SCALER_BILINEAR || this->params.method > XINE_SCALER_LANCZOS)
+    this->params.method = XINE_SCALER_BICUBIC;
+
+  if (this->scaler[0] && this->src_width == frame->width && this->src_height == frame->height &&
+      this->format == frame->format && this->method == this->params.method)
+    return 1;
+
+  if (!width)
+    width = (int64_t)height * frame->width / frame->height;
+  else if (!height)
+    height = (int64_t)width * frame->height / frame->width;
+  /* whole chroma samples */
+  width  = (width + 1) & ~1;
+  height = (height + 1) & ~1;
+  if (width < 2)
+    width = 2;
+  if (height < 2)
+    height = 2;
+
+  scale_free_scalers(this);
+  this->src_width  = frame->width;
+  this->src_height = frame->height;
+  this->format     = frame->format;
+  this->method     = this->params.method;
+  this->dst_width  = width;
+  this->dst_height = height;
+
+  if (frame->format == XINE_IMGFMT_YV12) {
+    this->scaler[0] = xine_scaler_new(this->method, frame->width, frame->height, width, height);
+    this->scaler[1] = xine_scaler_new(this->method, (frame->width + 1) / 2, (frame->height + 1) / 2,
+                                      width / 2, height / 2);
+  } else {
+    this->scaler[0] = xine_scaler_new(this->method, frame->width, frame->height, width, height);
+    this->scaler[1] = xine_scaler_new(this->method, frame->width / 2, frame->height, width / 2, height);
+  }
+  if (!this->scaler[0] || !this->scaler[1]) {
+    scale_free_scalers(this);
+    this->src_width = 0;
+    return 0;
+  }
+
+  xprintf(this->post.xine, XINE_VERBOSITY_DEBUG, "post_scale: %dx%d -> %dx%d, %s\n",
+          frame->width, frame->height, width, height, enum_methods[this->method]);
+  return 1;
+}
+
+
+typedef struct {
+  post_plugin_scale_t *this;
+  vo_frame_t *src, *dst;
+} scale_slice_t;
+
+static void scale_slice(void *data, int band, int y0, int y1)
+{
+  scale_slice_t *job = (scale_slice_t *)data;
+  xine_scaler_t **scaler = job->this->scaler;
+  vo_frame_t *src = job->src, *dst = job->dst;
+  int i;
+
+  (void)band;
+
+  if (src->format == XINE_IMGFMT_YV12) {
+    xine_scaler_rows(scaler[0], src->base[0], src->pitches[0], 1,
+                     dst->base[0], dst->pitches[0], 1, y0, y1);
+    for (i = 1; i < 3; i++)
+      xine_scaler_rows(scaler[1], src->base[i], src->pitches[i], 1,
+                       dst->base[i], dst->pitches[i], 1, y0 / 2, y1 / 2);
+  } else {
+    /* Y at 0 and 2, U at 1, V at 3 */
+    xine_scaler_rows(scaler[0], src->base[0], src->pitches[0], 2,
+                     dst->base[0], dst->pitches[0], 2, y0, y1);
+    for (i = 1; i < 4; i += 2)
+      xine_scaler_rows(scaler[1], src->base[0] + i, src->pitches[0], 4,
+                       dst->base[0] + i, dst->pitches[0], 4, y0, y1);
+  }
+}
+
+static int scale_draw(vo_frame_t *frame, xine_stream_t *stream)
+{
+  post_video_port_t *port = (post_video_port_t *)frame->port;
+  post_plugin_scale_t *this = (post_plugin_scale_t *)port->post;
+  vo_frame_t *out_frame;
+  scale_slice_t job;
+  int skip;
+
+  pthread_mutex_lock (&this->lock);
+
+  if (frame->bad_frame || !scale_setup(this, frame)) {
+    pthread_mutex_unlock (&this->lock);
+    _x_post_frame_copy_down(frame, frame->next);
+    skip = frame->next->draw(frame->next, stream);
+    _x_post_frame_copy_up(frame, frame->next);
+    return skip;
+  }
+
+  out_frame = port->original_port->get_frame(port->original_port,
+    this->dst_width, this->dst_height, frame->ratio, frame->format, frame->flags | VO_BOTH_FIELDS);
+
+  _x_post_frame_copy_down(frame, out_frame);
+  out_frame->crop_left   = (int64_t)frame->crop_left   * this->dst_width  / frame->width;
+  out_frame->crop_right  = (int64_t)frame->crop_right  * this->dst_width  / frame->width;
+  out_frame->crop_top    = (int64_t)frame->crop_top    * this->dst_height / frame->height;
+  out_frame->crop_bottom = (int64_t)frame->crop_bottom * this->dst_height / frame->height;
+
+  job.this = this;
+  job.src  = frame;
+  job.dst  = out_frame;
+  _x_post_slices (&this->post, this->dst_height, 2, scale_slice, &job);
+
+  pthread_mutex_unlock (&this->lock);
+
+  _x_post_frame_writable(out_frame);
+  skip = out_frame->draw(out_frame, stream);
+
+  _x_post_frame_copy_up(frame, out_frame);
+
+  out_frame->free(out_frame);
+
+  return skip;
+}
+
+static post_plugin_t *scale_open_plugin(post_class_t *class_gen, int inputs,
+                                        xine_audio_port_t **audio_target,
+                                        xine_video_port_t **video_target)
+{
+  post_plugin_scale_t *this = calloc(1, sizeof(post_plugin_scale_t));
+  post_in_t           *input;
+  post_out_t          *output;
+  post_video_port_t   *port;
+
+  static const xine_post_api_t post_api = {
+    .set_parameters  = set_parameters,
+    .get_parameters  = get_parameters,
+    .get_param_descr = get_param_descr,
+    .get_help        = get_help,
+  };
+  static const xine_post_in_t params_input = {
+    .name = "parameters",
+    .type = XINE_POST_DATA_PARAMETERS,
+    .data = (void *)&post_api,
+  };
+
+  if (!this || !video_target || !video_target[0]) {
+    free(this);
+    return NULL;
+  }
+
+  (void)class_gen;
+  (void)inputs;
+  (void)audio_target;
+
+  _x_post_init(&this->post, 0, 1);
+
+  this->params.width  = 0;
+  this->params.height = 0;
+  this->params.method = XINE_SCALER_BICUBIC;
+
+  pthread_mutex_init(&this->lock, NULL);
+
+  port = _x_post_intercept_video_port(&this->post, video_target[0], &input, &output);
+  port->intercept_frame = scale_intercept_frame;
+  port->new_frame->draw = scale_draw;
+
+  xine_list_push_back(this->post.input, (void *)&params_input);
+
+  input->xine_in.name     = "video";
+  output->xine_out.name   = "scaled video";
+
+  this->post.xine_post.video_input[0] = &port->new_port;
+
+  this->post.dispose = scale_dispose;
+
+  return &this->post;
+}
+
+void *scale_init_plugin(xine_t *xine, const void *data)
+{
+  static const post_class_t post_scale_class = {
+    .open_plugin     = scale_open_plugin,
+    .identifier      = "scale",
+    .description     = N_("software video scaler"),
+    .dispose         = NULL,
+  };
+
+  (void)xine;
+  (void)data;
+
+  return (void *)&post_scale_class;
+}
@@ -40,7 +40,8 @@
 typedef struct FilterParam {
     int msizeX, msizeY;
     double amount;
-    uint32_t *SC[MAX_MATRIX_SIZE-1];
+    /* 2*stepsY rows of column sums for each band */
+    uint32_t *SC[POST_SLICES_MAX];
 } FilterParam;
 
 struct vf_priv_s {
@@ -62,11 +63,13 @@ Originally published Boston, Nov 98
 
 */
 
-static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp ) {
+/* filter rows y0..y1-1, reading the rows around as needed */
+static void unsharp( uint8_t *dst, const uint8_t *src, int dstStride, int srcStride, int width, int height,
+                     int y0, int y1, FilterParam *fp, int band ) {
 
-    uint32_t **SC = fp->SC;
+    uint32_t *SC;
     uint32_t SR[MAX_MATRIX_SIZE-1], Tmp1, Tmp2;
-    uint8_t* src2 = src;
+    const uint8_t* src2;
 
     int32_t res;
     int x, y, z;
@@ -75,23 +78,36 @@ static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, i
     int stepsY = fp->msizeY/2;
     int scalebits = (stepsX+stepsY)*2;
     int32_t halfscale = 1 << ((stepsX+stepsY)*2-1);
+    int scw = width+2*stepsX;
+
+    if( y1 > height )
+	y1 = height;
+    if( y0 >= y1 )
+	return;
 
     if( !fp->amount ) {
-	if( src == dst )
-	    return;
+	src += y0*srcStride;
+	dst += y0*dstStride;
 	if( dstStride == srcStride )
-	    xine_fast_memcpy( dst, src, srcStride*height );
+	    xine_fast_memcpy( dst, src, srcStride*(y1-y0) );
 	else
-	    for( y=0; y<height; y++, dst+=dstStride, src+=srcStride )
+	    for( y=y0; y<y1; y++, dst+=dstStride, src+=srcStride )
 		xine_fast_memcpy( dst, src, width );
 	return;
     }
 
-    for( y=0; y<2*stepsY; y++ )
-	memset( SC[y], 0, sizeof(SC[y][0]) * (width+2*stepsX) );
+    if( !fp->SC[band] ) {
+	fp->SC[band] = malloc( sizeof(*SC) * 2*stepsY * scw );
+	if( !fp->SC[band] )
+	    return;
+    }
+    SC = fp->SC[band];
+    memset( SC, 0, sizeof(*SC) * 2*stepsY * scw );
 
-    for( y=-stepsY; y<height+stepsY; y++ ) {
-	if( y < height ) src2 = src;
+    /* the window starts stepsY rows above the first output row,
+     * rows outside the picture repeat the border rows */
+    for( y=y0-stepsY; y<y1+stepsY; y++ ) {
+	src2 = src + (y < 0 ? 0 : y >= height ? height-1 : y) * srcStride;
 	memset( SR, 0, sizeof(SR[0]) * (2*stepsX-1) );
 	for( x=-stepsX; x<width+stepsX; x++ ) {
 	    Tmp1 = x<=0 ? src2[0] : x>=width ? src2[width-1] : src2[x];
@@ -100,21 +116,18 @@ static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, i
 		Tmp1 = SR[z+1] + Tmp2; SR[z+1] = Tmp2;
 	    }
 	    for( z=0; z<stepsY*2; z+=2 ) {
-		Tmp2 = SC[z+0][x+stepsX] + Tmp1; SC[z+0][x+stepsX] = Tmp1;
-		Tmp1 = SC[z+1][x+stepsX] + Tmp2; SC[z+1][x+stepsX] = Tmp2;
+		uint32_t *sc = SC + z*scw + x+stepsX;
+		Tmp2 = sc[0] + Tmp1; sc[0] = Tmp1;
+		Tmp1 = sc[scw] + Tmp2; sc[scw] = Tmp2;
 	    }
-	    if( x>=stepsX && y>=stepsY ) {
-		uint8_t* srx = src - stepsY*srcStride + x - stepsX;
-		uint8_t* dsx = dst - stepsY*dstStride + x - stepsX;
+	    if( x>=stepsX && y>=y0+stepsY ) {
+		const uint8_t* srx = src + (y-stepsY)*srcStride + x - stepsX;
+		uint8_t* dsx = dst + (y-stepsY)*dstStride + x - stepsX;
 
 		res = (int32_t)*srx + ( ( ( (int32_t)*srx - (int32_t)((Tmp1+halfscale) >> scalebits) ) * amount ) >> 16 );
 		*dsx = res>255 ? 255 : res<0 ? 0 : (uint8_t)res;
 	    }
 	}
-	if( y >= 0 ) {
-	    dst += dstStride;
-	    src += srcStride;
-	}
     }
 }
 
@@ -241,18 +254,9 @@ static void unsharp_free_SC(post_plugin_unsharp_t *this)
 {
   int i;
 
-  for( i = 0; i < MAX_MATRIX_SIZE-1; i++ ) {
-    if( this->priv.lumaParam.SC[i] ) {
-      free( this->priv.lumaParam.SC[i] );
-      this->priv.lumaParam.SC[i] = NULL;
-    }
-  }
-
-  for( i = 0; i < MAX_MATRIX_SIZE-1; i++ ) {
-    if( this->priv.chromaParam.SC[i] ) {
-      free( this->priv.chromaParam.SC[i] );
-      this->priv.chromaParam.SC[i] = NULL;
-    }
+  for( i = 0; i < POST_SLICES_MAX; i++ ) {
+    _x_freep( &this->priv.lumaParam.SC[i] );
+    _x_freep( &this->priv.chromaParam.SC[i] );
   }
 }
 
@@ -276,12 +280,31 @@ static int unsharp_intercept_frame(post_video_port_t *port, vo_frame_t *frame)
 }
 
 
+typedef struct {
+  post_plugin_unsharp_t *this;
+  vo_frame_t *src, *dst;
+} unsharp_slice_t;
+
+static void unsharp_slice(void *data, int band, int y0, int y1)
+{
+  unsharp_slice_t *job = (unsharp_slice_t *)data;
+  vo_frame_t *src = job->src, *dst = job->dst;
+  int i;
+
+  unsharp( dst->base[0], src->base[0], dst->pitches[0], src->pitches[0], src->width, src->height,
+           y0, y1, &job->this->priv.lumaParam, band );
+  for( i = 1; i < 3; i++ )
+    unsharp( dst->base[i], src->base[i], dst->pitches[i], src->pitches[i], src->width/2, src->height/2,
+             y0/2, y1/2, &job->this->priv.chromaParam, band );
+}
+
 static int unsharp_draw(vo_frame_t *frame, xine_stream_t *stream)
 {
   post_video_port_t *port = (post_video_port_t *)frame->port;
   post_plugin_unsharp_t *this = (post_plugin_unsharp_t *)port->post;
   vo_frame_t *out_frame;
   vo_frame_t *yv12_frame;
+  unsharp_slice_t job;
   int skip;
 
   if( !frame->bad_frame &&
@@ -315,34 +338,22 @@ static int unsharp_draw(vo_frame_t *frame, xine_stream_t *stream)
 
     pthread_mutex_lock (&this->lock);
 
+    /* bands allocate their buffers as needed */
     if( frame->width != this->priv.width || frame->height != this->priv.height ) {
-       int z, stepsX, stepsY;
-       FilterParam *fp;
-
        this->priv.width = frame->width;
        this->priv.height = frame->height;
-
        unsharp_free_SC(this);
-
-       fp = &this->priv.lumaParam;
-       stepsX = fp->msizeX/2;
-       stepsY = fp->msizeY/2;
-       for( z=0; z<2*stepsY; z++ )
-         fp->SC[z] = malloc( sizeof(*(fp->SC[z])) * (frame->width+2*stepsX) );
-
-       fp = &this->priv.chromaParam;
-       stepsX = fp->msizeX/2;
-       stepsY = fp->msizeY/2;
-       for( z=0; z<2*stepsY; z++ )
-         fp->SC[z] = malloc( sizeof(*(fp->SC[z])) * (frame->width+2*stepsX) );
     }
 
-    unsharp( out_frame->base[0], yv12_frame->base[0], out_frame->pitches[0], yv12_frame->pitches[0], yv12_frame->width,   yv12_frame->height,   &this->priv.lumaParam );
-    unsharp( out_frame->base[1], yv12_frame->base[1], out_frame->pitches[1], yv12_frame->pitches[1], yv12_frame->width/2, yv12_frame->height/2, &this->priv.chromaParam );
-    unsharp( out_frame->base[2], yv12_frame->base[2], out_frame->pitches[2], yv12_frame->pitches[2], yv12_frame->width/2, yv12_frame->height/2, &this->priv.chromaParam );
+    job.this = this;
+    job.src  = yv12_frame;
+    job.dst  = out_frame;
+    _x_post_slices (&this->post, yv12_frame->height, 2, unsharp_slice, &job);
 
     pthread_mutex_unlock (&this->lock);
 
+    _x_post_frame_writable(out_frame);
+
     skip = out_frame->draw(out_frame, stream);
 
     _x_post_frame_copy_up(frame, out_frame);
@@ -19,6 +19,7 @@
  *
  * FFT code by Steve Haehnichen, originally licensed under GPL v1
  * modified by Thibaut Mattern (tmattern@noos.fr) to remove global vars
+ * reworked into a float real input transform with SIMD butterflies
  */
 
 #ifdef HAVE_CONFIG_H
@@ -28,6 +29,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <pthread.h>
+
+#include <xine/xineutils.h>
 
 #include "fft.h"
 
@@ -35,19 +39,39 @@
  * fft specific decode functions
  *************************************************************************/
 
-# define                SINE(x)         (fft->SineTable[(x)])
-# define                COSINE(x)       (fft->CosineTable[(x)])
-# define                WINDOW(x)       (fft->WinTable[(x)])
-
-#define PERMUTE(x, y)   reverse((x), (y))
-
-/* Number of samples in one "frame" */
-#define SAMPLES         (1 << bits)
+#define FFT_MAX_BITS    16
 
-#define REAL(x)         wave[(x)].re
-#define IMAG(x)         wave[(x)].im
 #define ALPHA           0.54
 
+/*
+ *  N real samples are transformed as N/2 complex ones, even samples in
+ *  the real and odd ones in the imaginary part. the complex transform is
+ *  radix 2 decimation in frequency on separate real and imaginary arrays,
+ *  so that each butterfly pass is a plain vector loop with a contiguous
+ *  twiddle table. a final pass splits the result into the real spectrum.
+ */
+typedef struct {
+  int      bits;
+  int      refs;
+  float   *win;       /* window, including the 1/N scale */
+  float   *tw_re;     /* per pass twiddles, pass with half size h at M - 2h */
+  float   *tw_im;
+  float   *post_cos;  /* cos, sin (2 pi k / N) for the split pass */
+  float   *post_sin;
+  int     *permute;   /* bit reversal over M */
+} fft_tables_t;
+
+struct fft_s {
+  int           bits;
+  fft_tables_t *t;
+  float        *re, *im;
+  void        (*bfly) (float *re, float *im, const float *wr, const float *wi, int h);
+  int           simd_min;  /* smallest h for bfly */
+};
+
+static pthread_mutex_t fft_tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static fft_tables_t   *fft_tables[FFT_MAX_BITS + 1];
+
 /*
  *  Bit reverser for unsigned ints
  *  Reverses 'bits' bits.
@@ -66,117 +90,263 @@ reverse (unsigned int val, int bits)
   return (retn);
 }
 
-/*
- *  Here is the real work-horse.
- *  It's a generic FFT, so nothing is lost or approximated.
- *  The samples in wave[] should be in order, and they
- *  will be decimated when fft() returns.
- */
-void fft_compute (fft_t *fft, complex_t wave[])
+static void fft_tables_free (fft_tables_t *t)
 {
-  int      loop;
-  unsigned i1;             /* going to right shift this */
-  int      i2;
-  int      bits = fft->bits;
+  xine_free_aligned (t->win);
+  xine_free_aligned (t->tw_re);
+  xine_free_aligned (t->tw_im);
+  free (t->post_cos);
+  free (t->permute);
+  free (t);
+}
 
-  i1 = SAMPLES / 2;
-  i2 = 1;
+static fft_tables_t *fft_tables_new (int bits)
+{
+  const int n = 1 << bits, m = n / 2;
+  const double twopi = atan (1.0) * 8.0;
+  fft_tables_t *t;
+  int h, i;
 
-  /* perform the butterflys */
+  t = calloc (1, sizeof (*t));
+  if (!t)
+    return NULL;
+  t->bits     = bits;
+  t->win      = xine_malloc_aligned (n * sizeof (float));
+  t->tw_re    = xine_malloc_aligned (m * sizeof (float));
+  t->tw_im    = xine_malloc_aligned (m * sizeof (float));
+  t->post_cos = malloc (2 * m * sizeof (float));
+  t->permute  = malloc (m * sizeof (int));
+  if (!t->win || !t->tw_re || !t->tw_im || !t->post_cos || !t->permute) {
+    fft_tables_free (t);
+    return NULL;
+  }
+  t->post_sin = t->post_cos + m;
+
+  /*
+   * Generalized Hamming window function.
+   * Set ALPHA to 0.54 for a hanning window. (Good idea)
+   */
+  for (i = 0; i < n; i++)
+    t->win[i] = (ALPHA + ((1.0 - ALPHA) * cos (twopi / (n - 1) * (i - n / 2)))) / n;
+
+  for (h = m / 2; h >= 1; h >>= 1) {
+    float *wr = t->tw_re + m - 2 * h, *wi = t->tw_im + m - 2 * h;
+    for (i = 0; i < h; i++) {
+      wr[i] = cos (twopi * i / (2 * h));
+      wi[i] = -sin (twopi * i / (2 * h));
+    }
+  }
 
-  for (loop = 0; loop < bits; loop++)
-    {
-      int loop1;
-      int i3, i4;
+  for (i = 0; i < m; i++) {
+    t->post_cos[i] = cos (twopi * i / n);
+    t->post_sin[i] = sin (twopi * i / n);
+    t->permute[i]  = reverse (i, bits - 1);
+  }
 
-      i3 = 0;
-      i4 = i1;
+  return t;
+}
 
-      for (loop1 = 0; loop1 < i2; loop1++)
-        {
-          int loop2;
-          int y;
-          double z1, z2;
+/*
+ *  One butterfly block: a = [0..h), b = [h..2h).
+ *  a' = a + b, b' = (a - b) * w
+ */
+static void fft_bfly_c (float *re, float *im, const float *wr, const float *wi, int h)
+{
+  float *re2 = re + h, *im2 = im + h;
+  int i;
 
-          y  = fft->PermuteTable[(i3 / (int)i1) & fft->bmask];
-          z1 = COSINE(y);
-          z2 = -SINE(y);
+  for (i = 0; i < h; i++) {
+    float dr = re[i] - re2[i];
+    float di = im[i] - im2[i];
+    re[i] += re2[i];
+    im[i] += im2[i];
+    re2[i] = dr * wr[i] - di * wi[i];
+    im2[i] = dr * wi[i] + di * wr[i];
+  }
+}
 
-          for (loop2 = i3; loop2 < i4; loop2++)
-            {
-              double a1, a2, b1, b2;
+#if defined(ARCH_X86_64)
+/* h multiple of 4 */
+static void fft_bfly_sse (float *re, float *im, const float *wr, const float *wi, int h)
+{
+  intptr_t i = -(intptr_t)h * (intptr_t)sizeof (float);
+
+  __asm__ __volatile__ (
+    "1:\n\t"
+    "movups   (%1,%0), %%xmm0\n\t"
+    "movups   (%2,%0), %%xmm1\n\t"
+    "movups   (%3,%0), %%xmm2\n\t"
+    "movups   (%4,%0), %%xmm3\n\t"
+    "movaps   %%xmm0, %%xmm4\n\t"
+    "addps    %%xmm2, %%xmm0\n\t"
+    "subps    %%xmm2, %%xmm4\n\t"
+    "movaps   %%xmm1, %%xmm5\n\t"
+    "addps    %%xmm3, %%xmm1\n\t"
+    "subps    %%xmm3, %%xmm5\n\t"
+    "movups   %%xmm0, (%1,%0)\n\t"
+    "movups   %%xmm1, (%2,%0)\n\t"
+    "movups   (%5,%0), %%xmm6\n\t"
+    "movups   (%6,%0), %%xmm7\n\t"
+    "movaps   %%xmm4, %%xmm0\n\t"
+    "mulps    %%xmm6, %%xmm0\n\t"
+    "movaps   %%xmm5, %%xmm1\n\t"
+    "mulps    %%xmm7, %%xmm1\n\t"
+    "subps    %%xmm1, %%xmm0\n\t"
+    "mulps    %%xmm7, %%xmm4\n\t"
+    "mulps    %%xmm6, %%xmm5\n\t"
+    "addps    %%xmm5, %%xmm4\n\t"
+    "movups   %%xmm0, (%3,%0)\n\t"
+    "movups   %%xmm4, (%4,%0)\n\t"
+    "add      $16, %0\n\t"
+    "jnz      1b\n\t"
+    : "+r" (i)
+    : "r" (re + h), "r" (im + h), "r" (re + 2 * h), "r" (im + 2 * h), "r" (wr + h), "r" (wi + h)
+    : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+}
 
-              a1 = REAL(loop2);
-              a2 = IMAG(loop2);
+#  if defined(HAVE_AVX2)
+/* h multiple of 8 */
+static void fft_bfly_avx2 (float *re, float *im, const float *wr, const float *wi, int h)
+{
+  intptr_t i = -(intptr_t)h * (intptr_t)sizeof (float);
+
+  __asm__ __volatile__ (
+    "1:\n\t"
+    "vmovups  (%1,%0), %%ymm0\n\t"
+    "vmovups  (%2,%0), %%ymm1\n\t"
+    "vmovups  (%3,%0), %%ymm2\n\t"
+    "vmovups  (%4,%0), %%ymm3\n\t"
+    "vaddps   %%ymm2, %%ymm0, %%ymm4\n\t"
+    "vsubps   %%ymm2, %%ymm0, %%ymm0\n\t"
+    "vaddps   %%ymm3, %%ymm1, %%ymm5\n\t"
+    "vsubps   %%ymm3, %%ymm1, %%ymm1\n\t"
+    "vmovups  %%ymm4, (%1,%0)\n\t"
+    "vmovups  %%ymm5, (%2,%0)\n\t"
+    "vmovups  (%5,%0), %%ymm6\n\t"
+    "vmovups  (%6,%0), %%ymm7\n\t"
+    "vmulps   %%ymm6, %%ymm0, %%ymm2\n\t"
+    "vmulps   %%ymm7, %%ymm1, %%ymm3\n\t"
+    "vsubps   %%ymm3, %%ymm2, %%ymm2\n\t"
+    "vmulps   %%ymm7, %%ymm0, %%ymm0\n\t"
+    "vmulps   %%ymm6, %%ymm1, %%ymm1\n\t"
+    "vaddps   %%ymm1, %%ymm0, %%ymm0\n\t"
+    "vmovups  %%ymm2, (%3,%0)\n\t"
+    "vmovups  %%ymm0, (%4,%0)\n\t"
+    "add      $32, %0\n\t"
+    "jnz      1b\n\t"
+    "vzeroupper\n\t"
+    : "+r" (i)
+    : "r" (re + h), "r" (im + h), "r" (re + 2 * h), "r" (im + 2 * h), "r" (wr + h), "r" (wi + h)
+    : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+}
+#  endif
+#endif
 
-              b1 = z1 * REAL(loop2+i1) - z2 * IMAG(loop2+i1);
-              b2 = z2 * REAL(loop2+i1) + z1 * IMAG(loop2+i1);
+/* window, complex passes, then split into the real spectrum */
+static void fft_real (fft_t *fft, const float *wave, float *amp)
+{
+  const fft_tables_t *t = fft->t;
+  const int m = 1 << (fft->bits - 1);
+  float *re = fft->re, *im = fft->im;
+  int h, b, k;
+
+  for (k = 0; k < m; k++) {
+    re[k] = wave[2 * k] * t->win[2 * k];
+    im[k] = wave[2 * k + 1] * t->win[2 * k + 1];
+  }
 
-              REAL(loop2) = a1 + b1;
-              IMAG(loop2) = a2 + b2;
+  for (h = m / 2; h >= 1; h >>= 1) {
+    const float *wr = t->tw_re + m - 2 * h, *wi = t->tw_im + m - 2 * h;
+    if (h >= fft->simd_min) {
+      for (b = 0; b < m; b += 2 * h)
+        fft->bfly (re + b, im + b, wr, wi, h);
+    } else {
+      for (b = 0; b < m; b += 2 * h)
+        fft_bfly_c (re + b, im + b, wr, wi, h);
+    }
+  }
 
-              REAL(loop2+i1) = a1 - b1;
-              IMAG(loop2+i1) = a2 - b2;
-            }
+  /*
+   * Z = FFT (even + i odd), with Z[k] at permute[k]:
+   * X[k] = (Z[k] + Z*[m-k]) / 2 + e^(-2 pi i k / n) (Z[k] - Z*[m-k]) / 2i
+   */
+  amp[0] = fabsf (re[0] + im[0]);
+  for (k = 1; k < m; k++) {
+    const int p = t->permute[k], q = t->permute[m - k];
+    const float c = t->post_cos[k], s = t->post_sin[k];
+    float er = 0.5f * (re[p] + re[q]), ei = 0.5f * (im[p] - im[q]);
+    float or = 0.5f * (im[p] + im[q]), oi = -0.5f * (re[p] - re[q]);
+    float xr = er + c * or + s * oi;
+    float xi = ei + c * oi - s * or;
+    amp[k] = sqrtf (xr * xr + xi * xi);
+  }
+}
 
-          i3 += (i1 << 1);
-          i4 += (i1 << 1);
-        }
+void fft_amp_batch (fft_t *fft, int channels,
+                    const float *wave, int wave_stride,
+                    float *amp, int amp_stride)
+{
+  int c;
 
-      i1 >>= 1;
-      i2 <<= 1;
-    }
+  for (c = 0; c < channels; c++)
+    fft_real (fft, wave + c * wave_stride, amp + c * amp_stride);
 }
 
 /*
- *  Initializer for FFT routines.  Currently only sets up tables.
- *  - Generates scaled lookup tables for sin() and cos()
- *  - Fills a table for the Hamming window function
+ *  Initializer for FFT routines.
+ *  Tables are made by the first user of a size, and shared.
  */
 fft_t *fft_new (int bits)
 {
   fft_t *fft;
-  int i;
-  const double   TWOPIoN   = (atan(1.0) * 8.0) / (double)SAMPLES;
-  const double   TWOPIoNm1 = (atan(1.0) * 8.0) / (double)(SAMPLES - 1);
+  int m;
 
-  /* printf("fft_new: bits=%d\n", bits); */
+  /* xine just uses 9 or 11. */
+  if (bits < 2 || bits > FFT_MAX_BITS)
+    return NULL;
+  m = 1 << (bits - 1);
 
-  fft = malloc (sizeof (fft_t));
+  fft = calloc (1, sizeof (fft_t));
   if (!fft)
     return NULL;
-
-  /* xine just uses 9 or 11. */
   fft->bits = bits;
-  fft->bmask = SAMPLES - 1;
-  fft->PermuteTable = malloc (sizeof (int) * SAMPLES);
-  if (!fft->PermuteTable) {
-    free (fft);
+  fft->re = xine_malloc_aligned (m * sizeof (float));
+  fft->im = xine_malloc_aligned (m * sizeof (float));
+  if (!fft->re || !fft->im) {
+    fft_dispose (fft);
     return NULL;
   }
-  for (i = 0; i < SAMPLES; i++) {
-    fft->PermuteTable[i] = PERMUTE (i, bits);
-  }
 
-  fft->SineTable   = malloc (3 * sizeof(double) * SAMPLES);
-  if (!fft->SineTable) {
-    free (fft->PermuteTable);
-    free (fft);
+  pthread_mutex_lock (&fft_tables_lock);
+  if (!fft_tables[bits])
+    fft_tables[bits] = fft_tables_new (bits);
+  fft->t = fft_tables[bits];
+  if (fft->t)
+    fft->t->refs++;
+  pthread_mutex_unlock (&fft_tables_lock);
+  if (!fft->t) {
+    fft_dispose (fft);
     return NULL;
   }
-  fft->CosineTable = fft->SineTable + SAMPLES;
-  fft->WinTable    = fft->SineTable + 2 * SAMPLES;
-  for (i = 0; i < SAMPLES; i++) {
-    double a = (double) i * TWOPIoN;
-    fft->SineTable[i]   = sin (a);
-    fft->CosineTable[i] = cos (a);
+
+  fft->bfly = fft_bfly_c;
+  fft->simd_min = m + 1;
+#if defined(ARCH_X86_64)
+  {
+    uint32_t accel = xine_mm_accel ();
+
+    if (accel & MM_ACCEL_X86_SSE) {
+      fft->bfly = fft_bfly_sse;
+      fft->simd_min = 4;
+    }
+#  if defined(HAVE_AVX2)
+    if (accel & MM_ACCEL_X86_AVX2) {
+      fft->bfly = fft_bfly_avx2;
+      fft->simd_min = 8;
+    }
+#  endif
   }
-      /*
-       * Generalized Hamming window function.
-       * Set ALPHA to 0.54 for a hanning window. (Good idea)
-       */
-  for (i = 0; i < SAMPLES; i++)
-    fft->WinTable[i] = ALPHA + ((1.0 - ALPHA) * cos (TWOPIoNm1 * (i - SAMPLES/2)));
+#endif
 
   return fft;
 }
@@ -185,53 +355,16 @@ void fft_dispose(fft_t *fft)
 {
   if (fft)
   {
-    free(fft->PermuteTable);
-    free(fft->SineTable);
-    free(fft);
-  }
-}
-
-/*
- *  Apply some windowing function to the samples.
- */
-void fft_window (fft_t *fft, complex_t wave[])
-{
-  int i;
-  int bits = fft->bits;
-
-  for (i = 0; i < SAMPLES; i++)
-    {
-      REAL(i) *= WINDOW(i);
-      IMAG(i) *= WINDOW(i);
+    if (fft->t) {
+      pthread_mutex_lock (&fft_tables_lock);
+      if (--fft->t->refs == 0) {
+        fft_tables[fft->bits] = NULL;
+        fft_tables_free (fft->t);
+      }
+      pthread_mutex_unlock (&fft_tables_lock);
     }
-}
-
-/*
- *  Calculate amplitude of component n in the decimated wave[] array.
- */
-double fft_amp (int n, complex_t wave[], int bits)
-{
-  n = PERMUTE (n, bits);
-  return (hypot (REAL(n), IMAG(n)));
-}
-
-double fft_amp2 (fft_t *fft, int n, complex_t wave[])
-{
-  n = fft->PermuteTable[n & fft->bmask];
-  return (hypot (REAL(n), IMAG(n)));
-}
-
-/*
- *  Scale sampled values.
- *  Do this *before* the fft.
- */
-void fft_scale (complex_t wave[], int bits)
-{
-  int i, n = 1 << bits;
-  double m = (double)1 / n;
-
-  for (i = 0; i < n; i++)  {
-    wave[i].re *= m;
-    wave[i].im *= m;
+    xine_free_aligned (fft->re);
+    xine_free_aligned (fft->im);
+    free(fft);
   }
 }
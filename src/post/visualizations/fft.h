@@ -21,33 +21,22 @@
 #ifndef FFT_H
 #define FFT_H
 
-struct complex_s
-{
-  double re;
-  double im;
-};
-typedef struct complex_s complex_t;
-
-
-struct fft_s {
-  int bits;
-  double *SineTable;
-  double *CosineTable;
-  double *WinTable;
-  int    *PermuteTable;
-  int     bmask;
-};
 typedef struct fft_s fft_t;
 
+/* a transform of 1 << bits real samples. tables are shared by all
+ * instances of the same size. */
 fft_t  *fft_new (int bits);
 void    fft_dispose(fft_t *fft);
 
-void    fft_compute (fft_t *fft, complex_t wave[]);
-void    fft_window (fft_t *fft, complex_t wave[]);
-
-double  fft_amp (int n, complex_t wave[], int bits);
-void    fft_scale (complex_t wave[], int bits);
-
-double  fft_amp2 (fft_t *fft, int n, complex_t wave[]);
+/*
+ *  Windowed spectrum of one or more channels.
+ *  wave + c * wave_stride holds the 1 << bits samples of channel c,
+ *  amp + c * amp_stride receives the amplitudes of its first
+ *  (1 << bits) / 2 frequency bins, scaled by 1 / (1 << bits).
+ *  wave is left untouched.
+ */
+void    fft_amp_batch (fft_t *fft, int channels,
+                       const float *wave, int wave_stride,
+                       float *amp, int amp_stride);
 
 #endif /* FFT_H */
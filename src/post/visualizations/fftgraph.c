@@ -62,7 +62,8 @@ struct post_plugin_fftgraph_s {
   double ratio;
 
   int data_idx;
-  complex_t wave[MAXCHANNELS][NUMSAMPLES];
+  float wave[MAXCHANNELS][NUMSAMPLES];
+  float amp[MAXCHANNELS][NUMSAMPLES / 2];
   audio_buffer_t buf;   /* dummy buffer just to hold a copy of audio data */
 
   int channels;
@@ -128,17 +129,16 @@ static void draw_fftgraph(post_plugin_fftgraph_t *this, vo_frame_t *frame) {
 			(0xFF << 8) |
 			0x80);
 
-  for (c = 0; c < this->channels; c++){
-    /* perform FFT for channel data */
-    fft_window(this->fft, this->wave[c]);
-    fft_scale(this->wave[c], this->fft->bits);
-    fft_compute(this->fft, this->wave[c]);
+  /* perform FFT for channel data */
+  fft_amp_batch(this->fft, this->channels, this->wave[0], NUMSAMPLES,
+                this->amp[0], NUMSAMPLES / 2);
 
+  for (c = 0; c < this->channels; c++){
     /* plot the FFT points for the channel */
     line = this->cur_line + c * this->lines_per_channel;
 
     for (i = 0; i < FFTGRAPH_WIDTH / 2; i++) {
-      double amp_float = fft_amp2 (this->fft, i, this->wave[c]);
+      double amp_float = this->amp[c][i];
       this->map[line][i] = this->yuy2_colors[d2db (amp_float)];
     }
   }
@@ -341,8 +341,7 @@ static void fftgraph_port_put_buffer (xine_audio_port_t *port_gen,
       for( i = samples_used; i < buf->num_frames && this->data_idx < NUMSAMPLES;
            i++, this->data_idx++, data8 += this->channels ) {
         for( c = 0; c < this->channels; c++){
-          this->wave[c][this->data_idx].re = (double)(data8[c] << 8) - 0x8000;
-          this->wave[c][this->data_idx].im = 0;
+          this->wave[c][this->data_idx] = (data8[c] << 8) - 0x8000;
         }
       }
     } else {
@@ -352,8 +351,7 @@ static void fftgraph_port_put_buffer (xine_audio_port_t *port_gen,
       for( i = samples_used; i < buf->num_frames && this->data_idx < NUMSAMPLES;
            i++, this->data_idx++, data += this->channels ) {
         for( c = 0; c < this->channels; c++){
-          this->wave[c][this->data_idx].re = (double)data[c];
-          this->wave[c][this->data_idx].im = 0;
+          this->wave[c][this->data_idx] = data[c];
         }
       }
     }
@@ -62,7 +62,8 @@ struct post_plugin_fftscope_s {
   double ratio;
 
   int data_idx;
-  complex_t wave[MAXCHANNELS][NUMSAMPLES];
+  float wave[MAXCHANNELS][NUMSAMPLES];
+  float amp[MAXCHANNELS][NUMSAMPLES / 2];
   int amp_max[MAXCHANNELS][NUMSAMPLES / 2];
   uint8_t amp_max_y[MAXCHANNELS][NUMSAMPLES / 2];
   uint8_t amp_max_u[MAXCHANNELS][NUMSAMPLES / 2];
@@ -152,18 +153,17 @@ static void draw_fftscope(post_plugin_fftscope_t *this, vo_frame_t *frame) {
     (0xFF << 8) |
     0x80);
 
-  for (c = 0; c < this->channels; c++){
-    /* perform FFT for channel data */
-    fft_window(this->fft, this->wave[c]);
-    fft_scale(this->wave[c], this->fft->bits);
-    fft_compute(this->fft, this->wave[c]);
+  /* perform FFT for channel data */
+  fft_amp_batch(this->fft, this->channels, this->wave[0], NUMSAMPLES,
+                this->amp[0], NUMSAMPLES / 2);
 
+  for (c = 0; c < this->channels; c++){
     /* plot the FFT points for the channel */
     for (i = 0; i < NUMSAMPLES / 2; i++) {
 
       map_ptr = ((FFT_HEIGHT * (c+1) / this->channels -1 ) * FFT_WIDTH + i * 2) / 2;
       map_ptr_bkp = map_ptr;
-      amp_float = fft_amp2 (this->fft, i, this->wave[c]);
+      amp_float = this->amp[c][i];
       if (amp_float == 0)
         amp_int = 0;
       else
@@ -363,8 +363,7 @@ static void fftscope_port_put_buffer (xine_audio_port_t *port_gen,
       for( i = samples_used; i < buf->num_frames && this->data_idx < NUMSAMPLES;
            i++, this->data_idx++, data8 += this->channels ) {
         for( c = 0; c < this->channels; c++){
-          this->wave[c][this->data_idx].re = (double)(data8[c] << 8) - 0x8000;
-          this->wave[c][this->data_idx].im = 0;
+          this->wave[c][this->data_idx] = (data8[c] << 8) - 0x8000;
         }
       }
     } else {
@@ -374,8 +373,7 @@ static void fftscope_port_put_buffer (xine_audio_port_t *port_gen,
       for( i = samples_used; i < buf->num_frames && this->data_idx < NUMSAMPLES;
            i++, this->data_idx++, data += this->channels ) {
         for( c = 0; c < this->channels; c++){
-          this->wave[c][this->data_idx].re = (double)data[c];
-          this->wave[c][this->data_idx].im = 0;
+          this->wave[c][this->data_idx] = data[c];
         }
       }
     }
@@ -30,6 +30,17 @@
  *  - streams played on master will appear on every slave.
  *    if master is not meant to use video/audio devices it may be started with
  *    'xine -V none -A none'
+ *
+ * fifo callbacks only serialize each buffer once into a shared, refcounted
+ * packet and append it to the queue of every client. A single thread accepts
+ * new clients and writes the queues out with non-blocking gathered sends, so
+ * a slow client never holds up the demuxer. A client that falls too far
+ * behind loses whole buffers, one that makes no progress at all is dropped.
+ *
+ * with media.network.broadcaster_http enabled, the same port also talks
+ * HTTP: a client that sends a GET request right after connecting gets the
+ * elementary streams remuxed into MPEG-TS instead (eg. 'ffprobe
+ * http://master:port/'). Clients that stay silent for a moment are slaves.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -66,6 +77,12 @@
 #endif
 #ifdef WIN32
 #include <ws2tcpip.h>  // socklen_t
+#else
+#include <sys/uio.h>
+#include <poll.h>
+#endif
+#ifdef HAVE_LINUX_ERRQUEUE_H
+#include <linux/errqueue.h>
 #endif
 
 #include <dlfcn.h>
@@ -79,137 +96,873 @@
 #define QLEN 5    /* maximum connection queue length */
 #define _BUFSIZ 512
 
+#define BC_QUEUE_BYTES   (4 << 20) /* per client, newer buffers are dropped beyond that */
+#define BC_QUEUE_PACKETS      1024 /* per client, power of 2 */
+#define BC_STALL_TIMEOUT     10000 /* ms without any progress until a client is dropped */
+#define BC_IOV_MAX              64
+
+#if defined(HAVE_LINUX_ERRQUEUE_H) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#  define BC_ZEROCOPY
+#  define BC_ZEROCOPY_MIN  (16 << 10) /* smaller sends are cheaper to copy */
+#  define BC_ZEROCOPY_HOLD       256 /* packets waiting for the kernel per client */
+#endif
+
+#define BC_PROBE_TIME          250 /* ms to wait for a HTTP request before assuming a slave */
+#define BC_REQUEST_MAX        2048
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+/* unlike select (), not limited to fds below FD_SETSIZE */
+#ifdef WIN32
+#  define bc_poll(fds,n,ms) WSAPoll ((fds), (n), (ms))
+#else
+#  define bc_poll(fds,n,ms) poll ((fds), (n), (ms))
+#endif
+
+/* who a client is, and what a packet is for */
+#define BC_CLIENT_PENDING 0
+#define BC_CLIENT_SLAVE   1
+#define BC_CLIENT_HTTP    2
+
+typedef struct {
+  int          refs;              /* protected by broadcaster lock */
+  uint8_t      kind;              /* BC_CLIENT_* */
+  uint8_t      sync;              /* TS: starts with PAT/PMT, clients may join here */
+  size_t       len;
+  uint8_t      data[1];
+} bc_packet_t;
+
+typedef struct {
+  int          fd;
+  int          kind;
+  int          synced;            /* HTTP: got a sync packet since (re)joining */
+  int          closing;           /* close after the queue has been sent */
+  int64_t      since;
+
+  size_t       req_len;
+  char         req[BC_REQUEST_MAX];
+
+  bc_packet_t *queue[BC_QUEUE_PACKETS];
+  unsigned int head, tail;        /* head == tail: empty */
+  size_t       offset;            /* bytes of queue[head] already sent */
+  size_t       bytes;             /* bytes waiting */
+
+  int64_t      last_progress;
+  unsigned int dropped;
+
+  int          poll_index;        /* manager loop: entry in pfd, or -1 */
+
+#ifdef BC_ZEROCOPY
+  /* packets the kernel may still read from, until it reports completion */
+  int          zerocopy;
+  uint32_t     zc_next;
+  int          zc_num;
+  struct {
+    uint32_t     id;
+    bc_packet_t *pkt;
+  }            zc_hold[BC_ZEROCOPY_HOLD];
+#endif
+} bc_client_t;
+
+/* MPEG-TS output */
+
+#define BC_TS_STREAMS        8
+#define BC_TS_PMT_PID   0x1000
+#define BC_TS_PID_BASE  0x0100
+#define BC_TS_PES_HEADER    14    /* room reserved in front of each unit */
+#define BC_TS_UNIT_MAX  (1 << 20)
+#define BC_TS_PSI_INTERVAL 100    /* ms */
+#define BC_TS_PCR_DELAY  45000    /* 90 kHz, PCR runs this much behind PTS */
+
+typedef struct {
+  uint32_t     buf_type;
+  uint16_t     pid;
+  uint8_t      stream_type;       /* 0: cannot be muxed */
+  uint8_t      stream_id;
+  uint8_t      cc;
+  uint8_t      discontinuity;
+  uint8_t      checked;
+  /* access unit being collected, payload at unit + BC_TS_PES_HEADER */
+  uint8_t     *unit;
+  size_t       unit_len, unit_size;
+  int64_t      unit_pts;
+  int          unit_key;
+} bc_ts_stream_t;
+
+typedef struct {
+  bc_ts_stream_t stream[BC_TS_STREAMS];
+  int          num;
+  int          pcr;               /* index of PCR stream, -1: none */
+  uint8_t      pat_cc, pmt_cc;
+  uint8_t      version;
+  int64_t      last_psi;          /* ms, 0: due */
+  int64_t      last_pcr;          /* -1: none yet */
+} bc_ts_mux_t;
+
 struct broadcaster_s {
   xine_stream_t   *stream;        /* stream to broadcast            */
   int              port;          /* server port                    */
   int              msock;         /* master network socket          */
-  xine_list_t     *connections;   /* active connections             */
+  xine_list_t     *connections;   /* active connections (bc_client_t *) */
 
   pthread_t        manager_thread;
   pthread_mutex_t  lock;
+  int              wake[2];       /* new data or shutdown */
+
+  /* manager loop only */
+  struct pollfd   *pfd;
+  unsigned int     pfd_size;
 
   int              running;
+  int              http;          /* probe new clients for HTTP requests */
+
+  bc_ts_mux_t      ts;
 };
 
 
-/* network functions */
+static int64_t bc_now (void) {
+  struct timeval tv;
+
+  xine_monotonic_clock (&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* packets */
 
-static int sock_check_opened(int socket) {
-  fd_set   readfds, writefds, exceptfds;
-  int      retval;
-  struct   timeval timeout;
+static bc_packet_t *bc_packet_new (int kind, size_t len) {
+  bc_packet_t *pkt = malloc (sizeof (*pkt) + len);
 
-  for(;;) {
-    FD_ZERO(&readfds);
-    FD_ZERO(&writefds);
-    FD_ZERO(&exceptfds);
-    FD_SET(socket, &exceptfds);
+  if (pkt) {
+    pkt->refs = 0;
+    pkt->kind = kind;
+    pkt->sync = 0;
+    pkt->len  = len;
+  }
+  return pkt;
+}
 
-    timeout.tv_sec  = 0;
-    timeout.tv_usec = 0;
+static void bc_packet_unref (bc_packet_t *pkt) {
+  if (--pkt->refs <= 0)
+    free (pkt);
+}
 
-    retval = select(socket + 1, &readfds, &writefds, &exceptfds, &timeout);
+/* clients */
 
-    if(retval == -1 && (errno != EAGAIN && errno != EINTR))
-      return 0;
+static bc_client_t *bc_client_new (int fd) {
+  bc_client_t *c = calloc (1, sizeof (*c));
 
-    if (retval != -1)
-      return 1;
+  if (!c)
+    return NULL;
+  c->fd = fd;
+  c->poll_index = -1;
+  c->last_progress = c->since = bc_now ();
+
+#ifndef WIN32
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+#else
+  {
+    unsigned long non_block = 1;
+    ioctlsocket (fd, FIONBIO, &non_block);
   }
+#endif
 
-  return 0;
+#ifdef BC_ZEROCOPY
+  {
+    int one = 1;
+    c->zerocopy = (setsockopt (fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof (one)) == 0);
+  }
+#endif
+
+  return c;
+}
+
+static void bc_client_push (bc_client_t *c, bc_packet_t *pkt) {
+  pkt->refs++;
+  c->queue[c->tail] = pkt;
+  c->tail = (c->tail + 1) & (BC_QUEUE_PACKETS - 1);
+  c->bytes += pkt->len;
+}
+
+static void bc_client_pop (bc_client_t *c) {
+  bc_packet_t *pkt = c->queue[c->head];
+
+  c->bytes -= pkt->len;
+  c->head = (c->head + 1) & (BC_QUEUE_PACKETS - 1);
+  c->offset = 0;
+  bc_packet_unref (pkt);
+}
+
+#ifdef BC_ZEROCOPY
+/* release packets the kernel has finished sending */
+static void bc_client_zc_complete (bc_client_t *c) {
+  union {
+    char           buf[CMSG_SPACE (sizeof (struct sock_extended_err)) + 64];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg;
+
+  while (c->zc_num > 0) {
+    struct cmsghdr *cm;
+
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_control    = control.buf;
+    msg.msg_controllen = sizeof (control.buf);
+    if (recvmsg (c->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      break;
+
+    for (cm = CMSG_FIRSTHDR (&msg); cm; cm = CMSG_NXTHDR (&msg, cm)) {
+      const struct sock_extended_err *serr = (const struct sock_extended_err *)CMSG_DATA (cm);
+      uint32_t lo, hi;
+      int      i, n;
+
+      if (serr->ee_errno || (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+        continue;
+      lo = serr->ee_info;
+      hi = serr->ee_data;
+      /* the kernel had to copy anyway (eg loopback): not worth the bookkeeping */
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        c->zerocopy = 0;
+
+      for (i = n = 0; i < c->zc_num; i++) {
+        if ((uint32_t)(c->zc_hold[i].id - lo) <= (uint32_t)(hi - lo))
+          bc_packet_unref (c->zc_hold[i].pkt);
+        else
+          c->zc_hold[n++] = c->zc_hold[i];
+      }
+      c->zc_num = n;
+    }
+  }
+}
+#endif
+
+static void bc_client_close (xine_t *xine, bc_client_t *c) {
+  xprintf (xine, XINE_VERBOSITY_DEBUG, "broadcaster: closing socket %d (%u buffers dropped)\n",
+    c->fd, c->dropped);
+#ifdef BC_ZEROCOPY
+  /* the kernel may still send from held packets after a normal close (),
+   * when their memory could already be reused. take what has completed,
+   * and have the rest of the send queue discarded with the connection. */
+  bc_client_zc_complete (c);
+  if (c->zc_num > 0) {
+    struct linger l;
+    l.l_onoff  = 1;
+    l.l_linger = 0;
+    setsockopt (c->fd, SOL_SOCKET, SO_LINGER, &l, sizeof (l));
+  }
+#endif
+  close (c->fd);
+  while (c->head != c->tail)
+    bc_client_pop (c);
+#ifdef BC_ZEROCOPY
+  while (c->zc_num > 0)
+    bc_packet_unref (c->zc_hold[--c->zc_num].pkt);
+#endif
+  free (c);
 }
 
 /*
- * Write to socket.
+ * write as much of the queue as the socket takes without blocking.
+ * returns < 0 when the client is gone.
  */
-static int sock_data_write(xine_t *xine, int socket, const void *buf_gen, int len) {
-  ssize_t  size;
-  int      wlen = 0;
-  const uint8_t *buf = buf_gen;
-
-  if((socket < 0) || (buf == NULL))
-    return -1;
+static int bc_client_flush (bc_client_t *c) {
+
+  while (c->head != c->tail) {
+    size_t       len = 0;
+    ssize_t      sent;
+    unsigned int i;
+#ifndef WIN32
+    struct iovec  iov[BC_IOV_MAX];
+    struct msghdr msg;
+    int           n = 0, flags = MSG_NOSIGNAL;
+
+    for (i = c->head; (i != c->tail) && (n < BC_IOV_MAX); i = (i + 1) & (BC_QUEUE_PACKETS - 1)) {
+      size_t off = (i == c->head) ? c->offset : 0;
+      iov[n].iov_base = c->queue[i]->data + off;
+      iov[n].iov_len  = c->queue[i]->len - off;
+      len += iov[n].iov_len;
+      n++;
+    }
 
-  if(!sock_check_opened(socket))
-    return -1;
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = n;
+#ifdef BC_ZEROCOPY
+    if (c->zerocopy && (len >= BC_ZEROCOPY_MIN) && (c->zc_num + n <= BC_ZEROCOPY_HOLD))
+      flags |= MSG_ZEROCOPY;
+#endif
 
-  while(len) {
-    size = write(socket, buf, len);
+    sent = sendmsg (c->fd, &msg, flags);
+#else
+    i = c->head;
+    len = c->queue[i]->len - c->offset;
+    sent = send (c->fd, (const char *)c->queue[i]->data + c->offset, len, 0);
+#endif
 
-    if(size <= 0) {
-      xprintf(xine, XINE_VERBOSITY_DEBUG, "broadcaster: error writing to socket %d\n",socket);
+    if (sent < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+        return 0;
+#ifdef BC_ZEROCOPY
+      if ((errno == ENOBUFS) && (flags & MSG_ZEROCOPY)) {
+        c->zerocopy = 0;
+        continue;
+      }
+#endif
       return -1;
     }
 
-    len -= size;
-    wlen += size;
-    buf += size;
+#ifdef BC_ZEROCOPY
+    if ((flags & MSG_ZEROCOPY) && sent > 0) {
+      /* hold every packet this send touched until the kernel is done */
+      size_t left = sent, off = c->offset;
+      for (i = c->head; left; i = (i + 1) & (BC_QUEUE_PACKETS - 1)) {
+        size_t part = c->queue[i]->len - off;
+        c->queue[i]->refs++;
+        c->zc_hold[c->zc_num].id  = c->zc_next;
+        c->zc_hold[c->zc_num].pkt = c->queue[i];
+        c->zc_num++;
+        left -= (part < left) ? part : left;
+        off = 0;
+      }
+      c->zc_next++;
+    }
+#endif
+
+    c->last_progress = bc_now ();
+    {
+      size_t left = sent;
+      while (left) {
+        size_t part = c->queue[c->head]->len - c->offset;
+        if (left < part) {
+          c->offset += left;
+          break;
+        }
+        left -= part;
+        bc_client_pop (c);
+      }
+    }
+
+    if ((size_t)sent < len)
+      return 0;
+  }
+
+  return 0;
+}
+
+static void bc_wake (broadcaster_t *this) {
+  if (this->wake[1] >= 0)
+    _x_io_wake_set (this->wake);
+}
+
+/*
+ * this is the most important broadcaster function.
+ * it queues data for every connected client (slaves).
+ */
+static void broadcaster_packet_write(broadcaster_t *this, bc_packet_t *pkt) {
+  xine_list_iterator_t ite = NULL;
+  bc_client_t *c;
+
+  pkt->refs++;
+  while ((c = xine_list_next_value (this->connections, &ite))) {
+    if (c->kind != pkt->kind)
+      continue;
+    if (!c->synced) {
+      if (!pkt->sync)
+        continue;
+      c->synced = 1;
+    }
+    if ((c->bytes + pkt->len > BC_QUEUE_BYTES) ||
+        (((c->tail + 1) & (BC_QUEUE_PACKETS - 1)) == c->head)) {
+      /* laggard: lose this buffer as a whole, keep the stream parseable */
+      if (!c->dropped++)
+        xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+          "broadcaster: socket %d falls behind, dropping buffers\n", c->fd);
+      /* TS resumes at the next PAT/PMT */
+      if (c->kind == BC_CLIENT_HTTP)
+        c->synced = 0;
+      continue;
+    }
+    bc_client_push (c, pkt);
   }
+  bc_packet_unref (pkt);
 
-  return wlen;
+  bc_wake (this);
 }
 
-static int XINE_FORMAT_PRINTF(3, 4)
-sock_string_write(xine_t *xine, int socket, const char *msg, ...) {
-  char     buf[_BUFSIZ];
+static size_t XINE_FORMAT_PRINTF(2, 3)
+bc_line (char *buf, const char *msg, ...) {
   va_list  args;
+  size_t   len;
 
   va_start(args, msg);
   vsnprintf(buf, _BUFSIZ - 1, msg, args);
   va_end(args);
 
   /* Each line sent is '\n' terminated */
-  if((buf[strlen(buf)] == '\0') && (buf[strlen(buf) - 1] != '\n'))
-      strcat(buf, "\n");
+  len = strlen(buf);
+  if (!len || buf[len - 1] != '\n') {
+    buf[len++] = '\n';
+    buf[len] = 0;
+  }
+  return len;
+}
+
+
+/*
+ * MPEG-TS remuxer.
+ * Buffers are collected per stream into access units (up to FRAME_END or
+ * the next pts), each unit becomes one PES. PAT/PMT are repeated every
+ * BC_TS_PSI_INTERVAL and in front of key frames, HTTP clients start there.
+ */
+
+static const struct {
+  uint32_t buf_type;
+  uint8_t  stream_type;
+  uint8_t  stream_id;
+} bc_ts_types[] = {
+  { BUF_VIDEO_MPEG,     0x02, 0xe0 },
+  { BUF_VIDEO_MPEG4,    0x10, 0xe0 },
+  { BUF_VIDEO_H264,     0x1b, 0xe0 },
+  { BUF_VIDEO_HEVC,     0x24, 0xe0 },
+  { BUF_AUDIO_MPEG,     0x04, 0xc0 },
+  { BUF_AUDIO_AAC,      0x0f, 0xc0 },
+  { BUF_AUDIO_AAC_LATM, 0x11, 0xc0 },
+  { BUF_AUDIO_A52,      0x81, 0xbd },
+  { BUF_AUDIO_EAC3,     0x87, 0xbd },
+  { BUF_AUDIO_DTS,      0x82, 0xbd }
+};
+
+static void bc_ts_pcr_select (bc_ts_mux_t *ts) {
+  int i;
+
+  ts->pcr = -1;
+  for (i = 0; i < ts->num; i++) {
+    if (!ts->stream[i].stream_type)
+      continue;
+    if ((ts->stream[i].buf_type & BUF_MAJOR_MASK) == BUF_VIDEO_BASE) {
+      ts->pcr = i;
+      break;
+    }
+    if (ts->pcr < 0)
+      ts->pcr = i;
+  }
+}
+
+static void bc_ts_reset (bc_ts_mux_t *ts) {
+  int i;
+
+  for (i = 0; i < ts->num; i++)
+    _x_freep (&ts->stream[i].unit);
+  memset (ts->stream, 0, sizeof (ts->stream));
+  ts->num      = 0;
+  ts->pcr      = -1;
+  ts->version  = (ts->version + 1) & 31;
+  ts->last_psi = 0;
+  ts->last_pcr = -1;
+}
+
+static bc_ts_stream_t *bc_ts_stream (bc_ts_mux_t *ts, uint32_t type) {
+  bc_ts_stream_t *s;
+  uint8_t         stream_id;
+  unsigned int    i;
+  int             n;
+
+  for (n = 0; n < ts->num; n++) {
+    if (ts->stream[n].buf_type == type)
+      return &ts->stream[n];
+  }
+  if (ts->num >= BC_TS_STREAMS)
+    return NULL;
+
+  for (i = 0; i < sizeof (bc_ts_types) / sizeof (bc_ts_types[0]); i++) {
+    if (bc_ts_types[i].buf_type == (type & (BUF_MAJOR_MASK | BUF_DECODER_MASK)))
+      break;
+  }
+  if (i >= sizeof (bc_ts_types) / sizeof (bc_ts_types[0]))
+    return NULL;
+
+  /* number video and audio PES stream ids separately */
+  stream_id = bc_ts_types[i].stream_id;
+  if (stream_id != 0xbd) {
+    for (n = 0; n < ts->num; n++)
+      if (ts->stream[n].stream_id == stream_id)
+        stream_id++;
+  }
 
-  return sock_data_write(xine, socket, buf, strlen(buf));
+  s = &ts->stream[ts->num];
+  s->buf_type    = type;
+  s->pid         = BC_TS_PID_BASE + ts->num;
+  s->stream_type = bc_ts_types[i].stream_type;
+  s->stream_id   = stream_id;
+  ts->num++;
+
+  ts->version  = (ts->version + 1) & 31;
+  ts->last_psi = 0;
+  bc_ts_pcr_select (ts);
+  return s;
 }
 
 /*
- * this is the most important broadcaster function.
- * it sends data to every connected client (slaves).
+ * the fifos carry what the demuxer found in the container. Formats that need
+ * a bitstream conversion for TS (length prefixed H.264/HEVC, raw AAC) are
+ * left out.
  */
-static void broadcaster_data_write(broadcaster_t *this, const void *buf, int len) {
-  xine_list_iterator_t ite;
-  int ssock;
-
-  ite = NULL;
-  ssock = (intptr_t)xine_list_next_value (this->connections, &ite);
-  while (ite) {
-    /* in case of failure remove from list */
-    if (sock_data_write (this->stream->xine, ssock, buf, len) < 0) {
-      xine_list_iterator_t failed;
-      xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "broadcaster: closing socket %d\n", ssock);
-      close (ssock);
-      failed = ite;
-      ssock = (intptr_t)xine_list_next_value (this->connections, &ite);
-      xine_list_remove (this->connections, failed);
-    } else {
-      ssock = (intptr_t)xine_list_next_value (this->connections, &ite);
+static void bc_ts_check (broadcaster_t *this, bc_ts_stream_t *s) {
+  const uint8_t *p = s->unit + BC_TS_PES_HEADER;
+  int ok = 1;
+
+  s->checked = 1;
+  switch (s->stream_type) {
+    case 0x1b:
+    case 0x24:
+      ok = (s->unit_len >= 4) && !p[0] && !p[1] && ((p[2] == 1) || (!p[2] && (p[3] == 1)));
+      break;
+    case 0x0f:
+      ok = (s->unit_len >= 2) && (p[0] == 0xff) && ((p[1] & 0xf0) == 0xf0);
+      break;
+    case 0x11:
+      ok = (s->unit_len >= 2) && (p[0] == 0x56) && ((p[1] & 0xe0) == 0xe0);
+      break;
+    default: ;
+  }
+  if (!ok) {
+    xprintf (this->stream->xine, XINE_VERBOSITY_LOG,
+      "broadcaster: stream type 0x%08x cannot be sent as MPEG-TS\n", s->buf_type);
+    s->stream_type = 0;
+    this->ts.version  = (this->ts.version + 1) & 31;
+    this->ts.last_psi = 0;
+    bc_ts_pcr_select (&this->ts);
+  }
+}
+
+static void bc_ts_crc (uint8_t *section, size_t len) {
+  /* the result comes bit reversed, first byte lowest */
+  uint32_t crc = xine_crc32_ieee (0xffffffff, section, len);
+
+  section[len]     = crc;
+  section[len + 1] = crc >> 8;
+  section[len + 2] = crc >> 16;
+  section[len + 3] = crc >> 24;
+}
+
+static uint8_t *bc_ts_section (uint8_t *q, unsigned int pid, uint8_t *cc, const uint8_t *section, size_t len) {
+  q[0] = 0x47;
+  q[1] = 0x40 | (pid >> 8);
+  q[2] = pid;
+  q[3] = 0x10 | (*cc & 15);
+  q[4] = 0; /* pointer field */
+  *cc = (*cc + 1) & 15;
+  memcpy (q + 5, section, len);
+  memset (q + 5 + len, 0xff, 183 - len);
+  return q + 188;
+}
+
+static uint8_t *bc_ts_psi (bc_ts_mux_t *ts, uint8_t *q) {
+  uint8_t sec[184];
+  size_t  len;
+  int     i;
+
+  /* PAT: one program */
+  sec[0]  = 0x00;
+  sec[1]  = 0xb0;
+  sec[2]  = 13;
+  sec[3]  = 0x00;
+  sec[4]  = 0x01;
+  sec[5]  = 0xc1 | (ts->version << 1);
+  sec[6]  = 0x00;
+  sec[7]  = 0x00;
+  sec[8]  = 0x00;
+  sec[9]  = 0x01;
+  sec[10] = 0xe0 | (BC_TS_PMT_PID >> 8);
+  sec[11] = BC_TS_PMT_PID & 0xff;
+  bc_ts_crc (sec, 12);
+  q = bc_ts_section (q, 0, &ts->pat_cc, sec, 16);
+
+  /* PMT */
+  len = 12;
+  for (i = 0; i < ts->num; i++) {
+    const bc_ts_stream_t *s = &ts->stream[i];
+    if (!s->stream_type)
+      continue;
+    sec[len]     = s->stream_type;
+    sec[len + 1] = 0xe0 | (s->pid >> 8);
+    sec[len + 2] = s->pid;
+    sec[len + 3] = 0xf0;
+    sec[len + 4] = 0x00;
+    len += 5;
+  }
+  sec[0]  = 0x02;
+  sec[1]  = 0xb0 | ((len + 1) >> 8);
+  sec[2]  = len + 1;
+  sec[3]  = 0x00;
+  sec[4]  = 0x01;
+  sec[5]  = 0xc1 | (ts->version << 1);
+  sec[6]  = 0x00;
+  sec[7]  = 0x00;
+  i = (ts->pcr >= 0) ? ts->stream[ts->pcr].pid : 0x1fff;
+  sec[8]  = 0xe0 | (i >> 8);
+  sec[9]  = i;
+  sec[10] = 0xf0;
+  sec[11] = 0x00;
+  bc_ts_crc (sec, len);
+  return bc_ts_section (q, BC_TS_PMT_PID, &ts->pmt_cc, sec, len + 4);
+}
+
+/* split a PES into transport packets. pcr < 0: none. */
+static uint8_t *bc_ts_packets (uint8_t *q, bc_ts_stream_t *s, const uint8_t *p, size_t len,
+                               int64_t pcr, int af_flags) {
+  int first = 1;
+
+  while (len) {
+    size_t af = 0, n;
+
+    if (first && ((pcr >= 0) || af_flags))
+      af = (pcr >= 0) ? 8 : 2;
+    n = 184 - af;
+    if (len < n)
+      n = len;
+    /* adaptation field, stuffing the last packet */
+    af = 184 - n;
+
+    q[0] = 0x47;
+    q[1] = (first ? 0x40 : 0) | (s->pid >> 8);
+    q[2] = s->pid;
+    q[3] = (af ? 0x30 : 0x10) | (s->cc & 15);
+    s->cc = (s->cc + 1) & 15;
+    if (af) {
+      uint8_t *a = q + 4;
+      a[0] = af - 1;
+      if (af > 1) {
+        size_t k = 2;
+        a[1] = first ? af_flags : 0;
+        if (first && (pcr >= 0)) {
+          a[1] |= 0x10;
+          a[2] = pcr >> 25;
+          a[3] = pcr >> 17;
+          a[4] = pcr >> 9;
+          a[5] = pcr >> 1;
+          a[6] = ((pcr & 1) << 7) | 0x7e;
+          a[7] = 0;
+          k = 8;
+        }
+        memset (a + k, 0xff, af - k);
+      }
     }
+    memcpy (q + 4 + af, p, n);
+    q   += 188;
+    p   += n;
+    len -= n;
+    first = 0;
   }
+  return q;
 }
 
-static void XINE_FORMAT_PRINTF(2, 3)
-broadcaster_string_write(broadcaster_t *this, const char *msg, ...) {
-  char     buf[_BUFSIZ];
-  va_list  args;
+/* turn the collected unit into PES and transport packets, and queue them */
+static void bc_ts_flush (broadcaster_t *this, bc_ts_stream_t *s) {
+  bc_ts_mux_t *ts = &this->ts;
+  bc_packet_t *pkt;
+  uint8_t     *pes, *q;
+  size_t       hlen, plen;
+  int64_t      now, pcr = -1;
+  int          psi, af_flags = 0;
 
-  va_start(args, msg);
-  vsnprintf(buf, _BUFSIZ - 1, msg, args);
-  va_end(args);
+  if (!s->unit_len)
+    return;
+  if (!s->checked)
+    bc_ts_check (this, s);
+  if (!s->stream_type) {
+    s->unit_len = 0;
+    return;
+  }
 
-  /* Each line sent is '\n' terminated */
-  if((buf[strlen(buf)] == '\0') && (buf[strlen(buf) - 1] != '\n'))
-      strcat(buf, "\n");
+  /* PES header, right in front of the payload */
+  hlen = s->unit_pts ? 14 : 9;
+  pes  = s->unit + BC_TS_PES_HEADER - hlen;
+  plen = hlen - 6 + s->unit_len;
+  if (plen > 0xffff)
+    plen = 0; /* unbounded, video only */
+  pes[0] = 0x00;
+  pes[1] = 0x00;
+  pes[2] = 0x01;
+  pes[3] = s->stream_id;
+  pes[4] = plen >> 8;
+  pes[5] = plen;
+  pes[6] = 0x84; /* data aligned */
+  pes[7] = s->unit_pts ? 0x80 : 0x00;
+  pes[8] = hlen - 9;
+  if (s->unit_pts) {
+    int64_t pts = s->unit_pts & 0x1ffffffffLL;
+    pes[9]  = 0x21 | ((pts >> 29) & 0x0e);
+    pes[10] = pts >> 22;
+    pes[11] = (pts >> 14) | 1;
+    pes[12] = pts >> 7;
+    pes[13] = (pts << 1) | 1;
+  }
+
+  if (s->discontinuity) {
+    af_flags |= 0x80;
+    s->discontinuity = 0;
+    ts->last_pcr = -1;
+  }
+  if (s->unit_key)
+    af_flags |= 0x40;
+
+  if ((ts->pcr >= 0) && (s == &ts->stream[ts->pcr]) && s->unit_pts) {
+    pcr = (s->unit_pts - BC_TS_PCR_DELAY) & 0x1ffffffffLL;
+    /* never step back, B frames come with earlier pts */
+    if ((ts->last_pcr >= 0) && (((pcr - ts->last_pcr) & 0x1ffffffffLL) > 0xffffffffLL))
+      pcr = -1;
+    else
+      ts->last_pcr = pcr;
+  }
+
+  now = bc_now ();
+  psi = !ts->last_psi || (now - ts->last_psi >= BC_TS_PSI_INTERVAL) ||
+        (s->unit_key && ((s->buf_type & BUF_MAJOR_MASK) == BUF_VIDEO_BASE));
+
+  pkt = bc_packet_new (BC_CLIENT_HTTP, ((psi ? 2 : 0) + (hlen + s->unit_len + 8) / 184 + 2) * 188);
+  if (pkt) {
+    q = pkt->data;
+    if (psi) {
+      q = bc_ts_psi (ts, q);
+      ts->last_psi = now;
+      pkt->sync = 1;
+    }
+    q = bc_ts_packets (q, s, pes, hlen + s->unit_len, pcr, af_flags);
+    pkt->len = q - pkt->data;
+    broadcaster_packet_write (this, pkt);
+  }
+
+  s->unit_len = 0;
+}
+
+static void bc_ts_buf (broadcaster_t *this, const char *from, buf_element_t *buf) {
+  bc_ts_mux_t    *ts = &this->ts;
+  bc_ts_stream_t *s;
+  int             i;
+
+  switch (buf->type) {
+    case BUF_CONTROL_START:
+      if (!strcmp (from, "video"))
+        bc_ts_reset (ts);
+      return;
+    case BUF_CONTROL_NEWPTS:
+    case BUF_CONTROL_RESET_DECODER:
+      /* after a seek, pending units are stale */
+      for (i = 0; i < ts->num; i++) {
+        if (buf->type == BUF_CONTROL_NEWPTS)
+          bc_ts_flush (this, &ts->stream[i]);
+        ts->stream[i].unit_len      = 0;
+        ts->stream[i].discontinuity = 1;
+      }
+      return;
+    default: ;
+  }
+
+  if ((buf->type & BUF_MAJOR_MASK) != BUF_VIDEO_BASE && (buf->type & BUF_MAJOR_MASK) != BUF_AUDIO_BASE)
+    return;
+  /* previews are sent again later, headers hold decoder config only */
+  if (buf->decoder_flags & (BUF_FLAG_PREVIEW | BUF_FLAG_HEADER | BUF_FLAG_SPECIAL))
+    return;
+  if (buf->size <= 0)
+    return;
+
+  s = bc_ts_stream (ts, buf->type);
+  if (!s || (s->checked && !s->stream_type))
+    return;
+
+  /* a new time stamp starts a new unit */
+  if (s->unit_len &&
+      ((buf->decoder_flags & BUF_FLAG_FRAME_START) || (buf->pts && (buf->pts != s->unit_pts))))
+    bc_ts_flush (this, s);
+
+  if (BC_TS_PES_HEADER + s->unit_len + buf->size > s->unit_size) {
+    size_t   size = (BC_TS_PES_HEADER + s->unit_len + buf->size) * 3 / 2;
+    uint8_t *unit = realloc (s->unit, size);
+    if (!unit)
+      return;
+    s->unit      = unit;
+    s->unit_size = size;
+  }
+  if (!s->unit_len) {
+    s->unit_pts = buf->pts;
+    s->unit_key = 0;
+  }
+  if (buf->decoder_flags & BUF_FLAG_KEYFRAME)
+    s->unit_key = 1;
+  memcpy (s->unit + BC_TS_PES_HEADER + s->unit_len, buf->content, buf->size);
+  s->unit_len += buf->size;
+
+  if ((buf->decoder_flags & BUF_FLAG_FRAME_END) || (s->unit_len >= BC_TS_UNIT_MAX))
+    bc_ts_flush (this, s);
+}
+
+
+/* queue a message for one client only */
+static void bc_client_reply (bc_client_t *c, int kind, const char *msg) {
+  size_t       len = strlen (msg);
+  bc_packet_t *pkt = bc_packet_new (kind, len);
+
+  if (pkt) {
+    memcpy (pkt->data, msg, len);
+    bc_client_push (c, pkt);
+  }
+}
+
+/*
+ * read what a new client sent. Anything but a complete GET/HEAD request
+ * gets an error. Returns < 0 when the client is gone.
+ */
+static int bc_client_request (broadcaster_t *this, bc_client_t *c) {
+  ssize_t n;
+
+  n = recv (c->fd, c->req + c->req_len, sizeof (c->req) - 1 - c->req_len, 0);
+  if (n < 0)
+    return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? 0 : -1;
+  if (n == 0)
+    return -1;
+  c->req_len += n;
+  c->req[c->req_len] = 0;
 
-  broadcaster_data_write(this, buf, strlen(buf));
+  if (!strstr (c->req, "\r\n\r\n") && !strstr (c->req, "\n\n")) {
+    if (c->req_len < sizeof (c->req) - 1)
+      return 0;
+    bc_client_reply (c, BC_CLIENT_PENDING,
+      "HTTP/1.0 400 Bad Request\r\nConnection: close\r\n\r\n");
+  } else if (!strncmp (c->req, "GET ", 4) || !strncmp (c->req, "HEAD ", 5)) {
+    bc_client_reply (c, BC_CLIENT_PENDING,
+      "HTTP/1.0 200 OK\r\n"
+      "Content-Type: video/mp2t\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Connection: close\r\n"
+      "\r\n");
+    if (c->req[0] == 'G') {
+      xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+        "broadcaster: socket %d is a HTTP client\n", c->fd);
+      c->kind = BC_CLIENT_HTTP;
+      return 0;
+    }
+  } else {
+    bc_client_reply (c, BC_CLIENT_PENDING,
+      "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nConnection: close\r\n\r\n");
+  }
+  c->closing = 1;
+  return 0;
+}
+
+static void bc_client_slave (broadcaster_t *this, bc_client_t *c) {
+  /* identification string, helps demuxer probing */
+  bc_client_reply (c, BC_CLIENT_SLAVE, "master xine v1\n");
+  c->kind = BC_CLIENT_SLAVE;
+  c->synced = 1;
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    "broadcaster: socket %d is a slave\n", c->fd);
 }
 
 
 /*
- * this thread takes care of accepting new connections.
+ * this thread accepts new connections and feeds all clients.
  */
 static void *manager_loop (void *this_gen) {
   broadcaster_t *this = (broadcaster_t *) this_gen;
@@ -218,39 +971,135 @@ static void *manager_loop (void *this_gen) {
     struct sockaddr sa;
   } fsin;
   socklen_t alen;          /* from-address length */
-  fd_set rfds;             /* read file descriptor set */
-  fd_set efds;             /* exception descriptor set */
 
   while( this->running ) {
-    FD_ZERO(&rfds);
-    FD_SET(this->msock, &rfds);
-    FD_ZERO(&efds);
-    FD_SET(this->msock, &efds);
-
-    if (select(this->msock+1, &rfds, (fd_set *)0, &efds, (struct timeval *)0) > 0) {
-
-      pthread_mutex_lock( &this->lock );
-
-      if (FD_ISSET(this->msock, &rfds))
-      {
-        int   ssock;
-        alen = sizeof(fsin.in);
-
-        ssock = accept(this->msock, &(fsin.sa), &alen);
-        if (ssock >= 0) {
-          _x_set_socket_close_on_exec(ssock);
-
-          /* identification string, helps demuxer probing */
-          if( sock_string_write(this->stream->xine, ssock,"master xine v1") > 0 ) {
-            xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
-              "broadcaster: new connection socket %d\n", ssock);
-            xine_list_push_back (this->connections, (void *)(intptr_t)ssock);
-          }
+    xine_list_iterator_t ite;
+    bc_client_t *c;
+    struct pollfd *pfd;
+    unsigned int n;
+    int timeout, pending = 0;
+
+    pthread_mutex_lock( &this->lock );
+
+    /* listening socket, wakeup fd and all clients */
+    n = xine_list_size (this->connections) + 2;
+    if (n > this->pfd_size) {
+      pfd = realloc (this->pfd, n * sizeof (*pfd));
+      if (!pfd) {
+        pthread_mutex_unlock( &this->lock );
+        xine_usec_sleep (20000);
+        continue;
+      }
+      this->pfd = pfd;
+      this->pfd_size = n;
+    }
+    pfd = this->pfd;
+    pfd[0].fd     = this->msock;
+    pfd[0].events = POLLIN;
+    /* poll () ignores negative fds */
+    pfd[1].fd     = this->wake[0];
+    pfd[1].events = POLLIN;
+    n = 2;
+
+    ite = NULL;
+    while ((c = xine_list_next_value (this->connections, &ite))) {
+      c->poll_index = -1;
+      if (c->head != c->tail)
+        pfd[n].events = POLLOUT;
+      else if ((c->kind == BC_CLIENT_PENDING) && !c->closing) {
+        pfd[n].events = POLLIN;
+        pending = 1;
+      } else
+        continue;
+      pfd[n].fd = c->fd;
+      c->poll_index = n++;
+    }
+    pthread_mutex_unlock( &this->lock );
+
+    /* without a wakeup fd, look for new data every 20ms */
+    timeout = pending ? 50 : (this->wake[0] >= 0) ? 500 : 20;
+
+    if (bc_poll (pfd, n, timeout) < 0) {
+      if (errno != EINTR)
+        break;
+      continue;
+    }
+
+    if (pfd[1].revents & POLLIN)
+      _x_io_wake_clear (this->wake);
+
+    pthread_mutex_lock( &this->lock );
+
+    if (pfd[0].revents & POLLIN) {
+      int   ssock;
+      alen = sizeof(fsin.in);
+
+      ssock = accept(this->msock, &(fsin.sa), &alen);
+      if (ssock >= 0) {
+        _x_set_socket_close_on_exec(ssock);
+
+        c = bc_client_new (ssock);
+        if (c) {
+          xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+            "broadcaster: new connection socket %d%s\n", ssock,
+#ifdef BC_ZEROCOPY
+            c->zerocopy ? " (zerocopy)" :
+#endif
+            "");
+          if (!this->http)
+            bc_client_slave (this, c);
+          xine_list_push_back (this->connections, c);
+        } else {
+          close (ssock);
         }
       }
+    }
 
-      pthread_mutex_unlock( &this->lock );
+    /* write, and drop clients that are gone or stuck */
+    {
+      int64_t now = bc_now ();
+      ite = NULL;
+      c = xine_list_next_value (this->connections, &ite);
+      while (c) {
+        int fail = 0;
+        if ((c->kind == BC_CLIENT_PENDING) && !c->closing) {
+          if ((c->poll_index >= 0) && this->pfd[c->poll_index].revents)
+            fail = bc_client_request (this, c);
+          else if (!c->req_len && (now - c->since > BC_PROBE_TIME))
+            bc_client_slave (this, c);
+          else if (now - c->since > BC_STALL_TIMEOUT)
+            fail = 1;
+        }
+#ifdef BC_ZEROCOPY
+        bc_client_zc_complete (c);
+#endif
+        if (!fail)
+          fail = bc_client_flush (c);
+        if (!fail && (c->head != c->tail) && (now - c->last_progress > BC_STALL_TIMEOUT)) {
+          xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+            "broadcaster: socket %d stalled\n", c->fd);
+          fail = 1;
+        }
+        if (!fail && c->closing && (c->head == c->tail)) {
+          fail = 1;
+#ifdef BC_ZEROCOPY
+          /* let the kernel finish first, the abortive close would cut the reply */
+          if ((c->zc_num > 0) && (now - c->last_progress <= BC_STALL_TIMEOUT))
+            fail = 0;
+#endif
+        }
+        if (fail) {
+          xine_list_iterator_t failed = ite;
+          bc_client_close (this->stream->xine, c);
+          c = xine_list_next_value (this->connections, &ite);
+          xine_list_remove (this->connections, failed);
+        } else {
+          c = xine_list_next_value (this->connections, &ite);
+        }
+      }
     }
+
+    pthread_mutex_unlock( &this->lock );
   }
 
   return NULL;
@@ -259,35 +1108,84 @@ static void *manager_loop (void *this_gen) {
 
 
 /*
- * receive xine buffers and send them through the broadcaster
+ * serialize a buffer for slaves
  */
-static void send_buf (broadcaster_t *this, const char *from, buf_element_t *buf) {
-  int i;
-
-  /* ignore END buffers since they would stop the slavery */
-  if( buf->type == BUF_CONTROL_END )
-    return;
+static void bc_slave_buf (broadcaster_t *this, const char *from, buf_element_t *buf) {
+  char lines[BUF_NUM_DEC_INFO + 2][_BUFSIZ];
+  struct {
+    const void *data;
+    size_t      len;
+  } part[2 * BUF_NUM_DEC_INFO + 3];
+  int n = 0, l = 0, i;
+  size_t total = 0;
+  bc_packet_t *pkt;
+  uint8_t *p;
 
   /* assume RESET_DECODER is result of a xine_flush_engine */
   if( buf->type == BUF_CONTROL_RESET_DECODER && !strcmp(from,"video") ) {
-    broadcaster_string_write(this, "flush_engine");
+    part[n].data = lines[l];
+    part[n++].len = bc_line (lines[l++], "flush_engine");
   }
 
   /* send decoder information if any */
   for( i = 0; i < BUF_NUM_DEC_INFO; i++ ) {
     if( buf->decoder_info[i] ) {
-      broadcaster_string_write(this, "decoder_info index=%d decoder_info=%u has_data=%d",
+      part[n].data = lines[l];
+      part[n++].len = bc_line (lines[l++], "decoder_info index=%d decoder_info=%u has_data=%d",
                                i, buf->decoder_info[i], (buf->decoder_info_ptr[i]) ? 1 : 0);
-      if( buf->decoder_info_ptr[i] )
-        broadcaster_data_write(this, buf->decoder_info_ptr[i], buf->decoder_info[i]);
+      if( buf->decoder_info_ptr[i] ) {
+        part[n].data = buf->decoder_info_ptr[i];
+        part[n++].len = buf->decoder_info[i];
+      }
     }
   }
 
-  broadcaster_string_write(this, "buffer fifo=%s size=%d type=%u pts=%"PRId64" disc=%"PRId64" flags=%u",
+  part[n].data = lines[l];
+  part[n++].len = bc_line (lines[l++], "buffer fifo=%s size=%d type=%u pts=%"PRId64" disc=%"PRId64" flags=%u",
                            from, buf->size, buf->type, buf->pts, buf->disc_off, buf->decoder_flags );
 
-  if( buf->size )
-    broadcaster_data_write(this, buf->content, buf->size);
+  if( buf->size ) {
+    part[n].data = buf->content;
+    part[n++].len = buf->size;
+  }
+
+  /* one copy for all clients */
+  for (i = 0; i < n; i++)
+    total += part[i].len;
+  pkt = bc_packet_new (BC_CLIENT_SLAVE, total);
+  if (!pkt)
+    return;
+  p = pkt->data;
+  for (i = 0; i < n; i++) {
+    memcpy (p, part[i].data, part[i].len);
+    p += part[i].len;
+  }
+
+  broadcaster_packet_write (this, pkt);
+}
+
+/*
+ * receive xine buffers and send them through the broadcaster
+ */
+static void send_buf (broadcaster_t *this, const char *from, buf_element_t *buf) {
+  xine_list_iterator_t ite = NULL;
+  bc_client_t *c;
+  int kinds = 0;
+
+  /* ignore END buffers since they would stop the slavery */
+  if( buf->type == BUF_CONTROL_END )
+    return;
+
+  while ((c = xine_list_next_value (this->connections, &ite)))
+    kinds |= 1 << c->kind;
+
+  if (kinds & (1 << BC_CLIENT_SLAVE))
+    bc_slave_buf (this, from, buf);
+
+  if (kinds & (1 << BC_CLIENT_HTTP))
+    bc_ts_buf (this, from, buf);
+  else if (this->ts.num)
+    bc_ts_reset (&this->ts);
 }
 
 
@@ -355,8 +1253,21 @@ broadcaster_t *_x_init_broadcaster(xine_stream_t *stream, int port)
   this->stream = stream;
   this->msock = msock;
   this->connections = xine_list_new();
+  this->ts.pcr = -1;
+  this->ts.last_pcr = -1;
+
+  this->http = stream->xine->config->register_bool (stream->xine->config,
+      "media.network.broadcaster_http", 0,
+      _("Broadcaster also serves MPEG-TS over HTTP"),
+      _("Clients that send a HTTP GET request to the broadcaster port receive "
+        "the playing stream remuxed into MPEG transport stream. Others are "
+        "treated as xine slaves, which makes them join a little later."),
+      20, NULL, NULL);
 
   pthread_mutex_init (&this->lock, NULL);
+  /* without it, the writer falls back to polling */
+  if (_x_io_wake_open (this->wake) < 0)
+    this->wake[0] = this->wake[1] = -1;
 
   if (stream->video_fifo)
     stream->video_fifo->register_put_cb(stream->video_fifo, video_put_cb, this);
@@ -380,12 +1291,8 @@ broadcaster_t *_x_init_broadcaster(xine_stream_t *stream, int port)
 
 void _x_close_broadcaster(broadcaster_t *this_gen)
 {
-  if (this_gen->running) {
-    this_gen->running = 0;
-    pthread_cancel(this_gen->manager_thread);
-    pthread_join(this_gen->manager_thread,NULL);
-  }
-  close(this_gen->msock);
+  xine_list_iterator_t ite = NULL;
+  bc_client_t *c;
 
   if (this_gen->stream->video_fifo)
     this_gen->stream->video_fifo->unregister_put_cb(this_gen->stream->video_fifo, video_put_cb);
@@ -393,19 +1300,23 @@ void _x_close_broadcaster(broadcaster_t *this_gen)
   if(this_gen->stream->audio_fifo)
     this_gen->stream->audio_fifo->unregister_put_cb(this_gen->stream->audio_fifo, audio_put_cb);
 
-  xine_list_iterator_t ite = NULL;
-
-  while (1) {
-    int ssock = (intptr_t)xine_list_next_value (this_gen->connections, &ite);
-    if (!ite)
-      break;
-    xprintf (this_gen->stream->xine, XINE_VERBOSITY_DEBUG, "broadcaster: closing socket %d\n", ssock);
-    close (ssock);
+  if (this_gen->running) {
+    this_gen->running = 0;
+    bc_wake (this_gen);
+    pthread_join(this_gen->manager_thread,NULL);
   }
+  close(this_gen->msock);
+
+  while ((c = xine_list_next_value (this_gen->connections, &ite)))
+    bc_client_close (this_gen->stream->xine, c);
   xine_list_delete(this_gen->connections);
+  bc_ts_reset (&this_gen->ts);
 
+  if (this_gen->wake[0] >= 0)
+    _x_io_wake_close (this_gen->wake);
   pthread_mutex_destroy( &this_gen->lock );
 
+  free(this_gen->pfd);
   free(this_gen);
 }
 
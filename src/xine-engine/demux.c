@@ -291,6 +291,192 @@ void _x_demux_control_nop( xine_stream_t *stream, uint32_t flags ) {
   pthread_mutex_unlock(&stream->demux_mutex);
 }
 
+/*
+ * trick play (XINE_PARAM_TRICK_PLAY): instead of streaming, step through
+ * the file by demuxer seeks, and let each step decode just enough to show
+ * the keyframe at the seek target. the step size follows the requested
+ * rate and the wall time the previous step really took, so slow decoding
+ * lowers the keyframe rate, not the playback rate.
+ */
+
+/* min time a keyframe stays on screen, msecs */
+#define TRICK_INTERVAL     200
+/* give up on a step that did not yield a frame within this time, msecs */
+#define TRICK_STEP_TIMEOUT 1000
+
+typedef struct {
+  int             active;
+  int             moved;        /* seek by user while in trick mode */
+  int             pos;          /* nominal position, msecs */
+  int             shown;        /* time of last keyframe shown, or -1 */
+  int             ignore_audio; /* value to restore when leaving */
+  struct timespec last;         /* start of previous step */
+} demux_trick_t;
+
+static void demux_add_msecs (struct timespec *ts, int msecs) {
+  ts->tv_sec  += msecs / 1000;
+  ts->tv_nsec += (msecs % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_nsec -= 1000000000;
+    ts->tv_sec  += 1;
+  }
+}
+
+static int demux_trick_current_time (xine_stream_t *stream) {
+  int msecs;
+
+  pthread_mutex_lock (&stream->current_extra_info_lock);
+  msecs = stream->current_extra_info->input_time;
+  pthread_mutex_unlock (&stream->current_extra_info_lock);
+  return msecs;
+}
+
+static void demux_trick_enter (xine_stream_t *stream, demux_trick_t *trick) {
+
+  trick->active = 1;
+  trick->moved  = 0;
+  trick->pos    = demux_trick_current_time (stream);
+  trick->shown  = -1;
+  xine_gettime (&trick->last);
+
+  /* audio is meaningless here, and would only fill output buffers. */
+  trick->ignore_audio = _x_stream_info_get (stream, XINE_STREAM_INFO_IGNORE_AUDIO);
+  _x_stream_info_set (stream, XINE_STREAM_INFO_IGNORE_AUDIO, 1);
+
+  xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+    "demux: entering trick play at %d ms, rate %d.\n", trick->pos, stream->trick_speed);
+}
+
+static int demux_trick_leave (xine_stream_t *stream, demux_trick_t *trick) {
+
+  int status = DEMUX_OK;
+
+  trick->active = 0;
+  _x_stream_info_set (stream, XINE_STREAM_INFO_IGNORE_AUDIO, trick->ignore_audio);
+
+  /* resume normal playback at the picture the user is looking at. */
+  if (!trick->moved) {
+    int msecs = (trick->shown >= 0) ? trick->shown : trick->pos;
+    status = stream->demux_plugin->seek (stream->demux_plugin, 0, msecs, 1);
+  }
+
+  xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+    "demux: leaving trick play at %d ms.\n", trick->shown >= 0 ? trick->shown : trick->pos);
+  return status;
+}
+
+static int demux_trick_timeout (const struct timespec *ts) {
+  struct timespec now;
+
+  xine_gettime (&now);
+  return (now.tv_sec > ts->tv_sec) || ((now.tv_sec == ts->tv_sec) && (now.tv_nsec >= ts->tv_nsec));
+}
+
+/* waits with demux_lock still held. a seek must not get in between the
+ * steps of a trick play picture, xine_play () just waits for us after
+ * raising its action. with frame set, returns as soon as the first frame
+ * got queued for display. actions are not signalled, so look at least
+ * every msecs for them. */
+static int demux_trick_wait (xine_stream_t *stream, const struct timespec *ts, int msecs, int frame) {
+
+  struct timespec until;
+
+  xine_gettime (&until);
+  demux_add_msecs (&until, msecs);
+  if ((until.tv_sec > ts->tv_sec) || ((until.tv_sec == ts->tv_sec) && (until.tv_nsec > ts->tv_nsec)))
+    until = *ts;
+
+  pthread_mutex_lock (&stream->first_frame_lock);
+  if (!frame || stream->first_frame_flag)
+    pthread_cond_timedwait (&stream->first_frame_reached, &stream->first_frame_lock, &until);
+  pthread_mutex_unlock (&stream->first_frame_lock);
+
+  return !demux_trick_timeout (ts) && !_x_action_pending (stream) && stream->demux_thread_running;
+}
+
+static int demux_trick_step (xine_stream_t *stream, demux_trick_t *trick) {
+
+  struct timespec now, ts;
+  xine_keyframes_entry_t entry;
+  int speed = stream->trick_speed;
+  int status = DEMUX_OK, elapsed, target;
+
+  if (trick->moved) {
+    trick->moved = 0;
+    trick->pos   = demux_trick_current_time (stream);
+    trick->shown = -1;
+  }
+
+  xine_gettime (&now);
+  elapsed = (now.tv_sec - trick->last.tv_sec) * 1000 + (now.tv_nsec - trick->last.tv_nsec) / 1000000;
+  if (elapsed < TRICK_INTERVAL)
+    elapsed = TRICK_INTERVAL;
+  trick->last = now;
+
+  target = trick->pos + (int64_t)speed * elapsed / XINE_FINE_SPEED_NORMAL;
+  if (target < 0)
+    target = 0;
+  trick->pos = target;
+
+  /* snap to a known keyframe, and do not decode the same one twice. */
+  entry.msecs   = target;
+  entry.normpos = 0;
+  if (xine_keyframes_find (stream, &entry, 0) == 0)
+    target = entry.msecs;
+
+  if (target != trick->shown) {
+    pthread_mutex_lock (&stream->first_frame_lock);
+    stream->first_frame_flag = 3;
+    pthread_mutex_unlock (&stream->first_frame_lock);
+
+    status = stream->demux_plugin->seek (stream->demux_plugin, 0, target, 1);
+
+    /* feed the decoder one chunk at a time so it does not run ahead,
+     * and stop as soon as the first picture got queued for display. */
+    ts = now;
+    demux_add_msecs (&ts, TRICK_STEP_TIMEOUT);
+    while (status == DEMUX_OK && stream->first_frame_flag &&
+           stream->demux_thread_running && !stream->emergency_brake) {
+      status = stream->demux_plugin->send_chunk (stream->demux_plugin);
+      while (stream->first_frame_flag && stream->video_fifo->size (stream->video_fifo) &&
+             demux_trick_wait (stream, &ts, 5, 1)) ;
+      if (demux_trick_timeout (&ts) || _x_action_pending (stream))
+        break;
+    }
+
+    /* at stream end, the decoder may still hold back the picture. */
+    if (status != DEMUX_OK && stream->first_frame_flag) {
+      buf_element_t *buf = stream->video_fifo->buffer_pool_alloc (stream->video_fifo);
+      buf->type = BUF_CONTROL_FLUSH_DECODER;
+      stream->video_fifo->put (stream->video_fifo, buf);
+      while (stream->first_frame_flag && demux_trick_wait (stream, &ts, 10, 1)) ;
+    }
+
+    pthread_mutex_lock (&stream->first_frame_lock);
+    if (stream->first_frame_flag) {
+      stream->first_frame_flag = 0;
+      pthread_cond_broadcast (&stream->first_frame_reached);
+      lprintf ("trick play: no frame at %d ms\n", target);
+    } else {
+      trick->shown = target;
+    }
+    pthread_mutex_unlock (&stream->first_frame_lock);
+  }
+
+  /* rewind hit the start: play normally from there. */
+  if ((speed < 0) && (trick->pos == 0))
+    stream->trick_speed = 0;
+
+  /* keep the picture on screen for a while. */
+  if (status == DEMUX_OK) {
+    xine_gettime (&ts);
+    demux_add_msecs (&ts, TRICK_INTERVAL);
+    while (stream->trick_speed && demux_trick_wait (stream, &ts, 20, 0)) ;
+  }
+
+  return status;
+}
+
 static void *demux_loop (void *stream_gen) {
 
   xine_stream_t *stream = (xine_stream_t *)stream_gen;
@@ -302,6 +488,9 @@ static void *demux_loop (void *stream_gen) {
   int iterations = 0;
 
   struct timespec seek_time = {0, 0};
+  demux_trick_t trick;
+
+  trick.active = 0;
 
   lprintf ("loop starting...\n");
 
@@ -321,11 +510,20 @@ static void *demux_loop (void *stream_gen) {
           !stream->emergency_brake) {
 
       iterations++;
-      status = stream->demux_plugin->send_chunk(stream->demux_plugin);
+      if (stream->trick_speed) {
+        if (!trick.active)
+          demux_trick_enter (stream, &trick);
+        status = demux_trick_step (stream, &trick);
+      } else if (trick.active) {
+        status = demux_trick_leave (stream, &trick);
+      } else {
+        status = stream->demux_plugin->send_chunk(stream->demux_plugin);
+      }
 
       /* someone may want to interrupt us */
       if (_x_action_pending(stream)) {
         struct timespec ts = {0, 0};
+        trick.moved = trick.active;
         xine_gettime (&ts);
         ts.tv_nsec += 100000000;
         if (ts.tv_nsec >= 1000000000) {
@@ -420,6 +618,9 @@ static void *demux_loop (void *stream_gen) {
 
   lprintf ("loop finished (status: %d)\n", status);
 
+  if (trick.active)
+    _x_stream_info_set (stream, XINE_STREAM_INFO_IGNORE_AUDIO, trick.ignore_audio);
+
   pthread_mutex_lock (&stream->counter_lock);
   if (stream->audio_thread_created)
     finished_count_audio = stream->finished_count_audio + 1;
@@ -683,6 +884,8 @@ void _x_action_raise (xine_stream_t *stream)
 {
   pthread_mutex_lock(&stream->demux_action_lock);
   stream->demux_action_pending++;
+  /* wake up input plugins waiting in _x_io_select () */
+  _x_io_wake_set (stream->demux_action_fd);
   pthread_mutex_unlock(&stream->demux_action_lock);
 }
 
@@ -691,6 +894,8 @@ void _x_action_lower (xine_stream_t *stream)
 {
   pthread_mutex_lock(&stream->demux_action_lock);
   stream->demux_action_pending--;
+  if (!stream->demux_action_pending)
+    _x_io_wake_clear (stream->demux_action_fd);
   pthread_mutex_unlock(&stream->demux_action_lock);
 }
 
@@ -38,6 +38,10 @@
 
 #define DEFAULT_BUFFER_SIZE 8192
 
+/* Start of stream kept for demuxer probing. Probes seek back to 0 and
+ * read their header again and again, serve them from memory instead. */
+#define PROBE_HEAD_SIZE (32 * 1024)
+
 typedef struct {
   input_plugin_t    input_plugin;      /* inherited structure */
 
@@ -49,6 +53,10 @@ typedef struct {
   int               buf_len;           /* data size */
   int               buf_pos;
 
+  char             *head;
+  int               head_len;
+  off_t             head_pos;          /* < 0: not reading from head */
+
   int               is_clone;
 
   /* Statistics */
@@ -59,6 +67,9 @@ typedef struct {
 
 } cache_input_plugin_t;
 
+static off_t cache_plugin_seek_main(cache_input_plugin_t *this, off_t offset, int origin);
+static off_t cache_plugin_get_current_pos(input_plugin_t *this_gen);
+
 
 /*
  * read data from input plugin and write it into file
@@ -75,6 +86,30 @@ static off_t cache_plugin_read(input_plugin_t *this_gen, void *buf_gen, off_t le
     return len;
   }
 
+  if (this->head_pos >= 0) {
+    off_t head_left = this->head_len - this->head_pos;
+    off_t main_read;
+
+    if (len <= head_left) {
+      xine_fast_memcpy(buf, this->head + this->head_pos, len);
+      this->head_pos += len;
+      return len;
+    }
+
+    /* continue with the main input right behind the head */
+    xine_fast_memcpy(buf, this->head + this->head_pos, head_left);
+    this->head_pos = -1;
+    if (cache_plugin_get_current_pos(this_gen) != this->head_len) {
+      if (cache_plugin_seek_main(this, this->head_len, SEEK_SET) != this->head_len)
+        return head_left ? head_left : -1;
+    }
+    this->read_call--;
+    main_read = cache_plugin_read(this_gen, buf + head_left, len - head_left);
+    if (main_read < 0)
+      return head_left ? head_left : main_read;
+    return head_left + main_read;
+  }
+
   /* optimized for common cases */
   if (len <= (this->buf_len - this->buf_pos)) {
     /* all bytes are in the buffer */
@@ -194,7 +229,7 @@ static buf_element_t *cache_plugin_read_block(input_plugin_t *this_gen, fifo_buf
   int in_buf_len;
 
   in_buf_len = this->buf_len - this->buf_pos;
-  if (in_buf_len > 0) {
+  if ((in_buf_len > 0) || (this->head_pos >= 0)) {
     off_t read_len;
 
     /* hmmm, the demuxer mixes read and read_block */
@@ -214,15 +249,11 @@ static buf_element_t *cache_plugin_read_block(input_plugin_t *this_gen, fifo_buf
   return buf;
 }
 
-static off_t cache_plugin_seek(input_plugin_t *this_gen, off_t offset, int origin) {
-  cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
+static off_t cache_plugin_seek_main(cache_input_plugin_t *this, off_t offset, int origin) {
   off_t cur_pos;
   off_t rel_offset;
   off_t new_buf_pos;
 
-  lprintf("offset: %"PRId64", origin: %d\n", offset, origin);
-  this->seek_call++;
-
   if( !this->buf_len ) {
     cur_pos = this->main_input_plugin->seek(this->main_input_plugin, offset, origin);
     this->main_seek_call++;
@@ -270,6 +301,35 @@ static off_t cache_plugin_seek(input_plugin_t *this_gen, off_t offset, int origi
   return cur_pos;
 }
 
+static off_t cache_plugin_seek(input_plugin_t *this_gen, off_t offset, int origin) {
+  cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
+
+  lprintf("offset: %"PRId64", origin: %d\n", offset, origin);
+  this->seek_call++;
+
+  if (this->head_len) {
+    off_t target = -1;
+
+    if (origin == SEEK_SET)
+      target = offset;
+    else if (origin == SEEK_CUR)
+      target = cache_plugin_get_current_pos(this_gen) + offset;
+
+    if ((target >= 0) && (target < this->head_len)) {
+      this->head_pos = target;
+      return target;
+    }
+    if (this->head_pos >= 0) {
+      /* main input position does not match ours */
+      this->head_pos = -1;
+      if (target >= 0)
+        return cache_plugin_seek_main(this, target, SEEK_SET);
+    }
+  }
+
+  return cache_plugin_seek_main(this, offset, origin);
+}
+
 static off_t cache_plugin_seek_time(input_plugin_t *this_gen, int time_offset, int origin) {
   cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
   off_t cur_pos;
@@ -279,6 +339,7 @@ static off_t cache_plugin_seek_time(input_plugin_t *this_gen, int time_offset, i
 
   cur_pos = this->main_input_plugin->seek_time(this->main_input_plugin, time_offset, origin);
   this->buf_len = this->buf_pos = 0;
+  this->head_pos = -1;
   this->main_seek_call++;
   return cur_pos;
 }
@@ -287,6 +348,9 @@ static off_t cache_plugin_get_current_pos(input_plugin_t *this_gen) {
   cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
   off_t cur_pos;
 
+  if (this->head_pos >= 0)
+    return this->head_pos;
+
   cur_pos = this->main_input_plugin->get_current_pos(this->main_input_plugin);
   if( this->buf_len ) {
     if( cur_pos >= (this->buf_len - this->buf_pos) )
@@ -343,11 +407,50 @@ static void cache_plugin_dispose(input_plugin_t *this_gen) {
   else
     _x_free_input_plugin (this->stream, this->main_input_plugin);
 
+  _x_freep(&this->head);
   _x_freep(&this->buf);
   free(this);
 }
 
 
+/*
+ * fill the probe head once, so that all demuxers probe the same bytes
+ */
+static void cache_plugin_read_head(cache_input_plugin_t *this) {
+  input_plugin_t *main_plugin = this->main_input_plugin;
+  off_t head_len = 0;
+
+  this->head_pos = -1;
+
+  /* block based inputs (dvd, vcd, ...) are left alone */
+  if (!(main_plugin->get_capabilities(main_plugin) & INPUT_CAP_SEEKABLE) ||
+      main_plugin->get_blocksize(main_plugin) ||
+      (main_plugin->get_current_pos(main_plugin) != 0))
+    return;
+
+  this->head = malloc(PROBE_HEAD_SIZE);
+  if (!this->head)
+    return;
+
+  while (head_len < PROBE_HEAD_SIZE) {
+    off_t main_read = main_plugin->read(main_plugin, this->head + head_len, PROBE_HEAD_SIZE - head_len);
+    this->main_read_call++;
+    if (main_read <= 0)
+      break;
+    head_len += main_read;
+  }
+
+  if (head_len <= 0) {
+    _x_freep(&this->head);
+    if (main_plugin->get_current_pos(main_plugin) != 0)
+      main_plugin->seek(main_plugin, 0, SEEK_SET);
+    return;
+  }
+
+  this->head_len = head_len;
+  this->head_pos = 0;
+}
+
 /*
  * create self instance,
  */
@@ -400,6 +503,8 @@ static input_plugin_t *cache_plugin_new (xine_stream_t *stream, input_plugin_t *
     return NULL;
   }
 
+  cache_plugin_read_head(this);
+
   return &this->input_plugin;
 }
 
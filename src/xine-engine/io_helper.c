@@ -42,11 +42,22 @@
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#else
+#include <poll.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <xine/io_helper.h>
+#include "xine_private.h"
 
 /* private constants */
 #define XIO_FILE_READ             0
@@ -55,190 +66,567 @@
 #define XIO_TCP_WRITE             3
 #define XIO_POLLING_INTERVAL  50000  /* usec */
 
+#define XIO_DNS_CACHE_SIZE       16
+#define XIO_DNS_ADDRS             8
+#define XIO_CONNECT_DELAY       250  /* msec, RFC 8305 connection attempt delay */
+
+#ifdef ENABLE_IPV6
+#  define XIO_FAMILY PF_UNSPEC
+#else
+#  define XIO_FAMILY PF_INET
+#endif
+
+#define XIO_REACTOR_THREADS       2
+#define XIO_REACTOR_EVENTS       16
 
-#ifndef ENABLE_IPV6
-static int _x_io_tcp_connect_ipv4(xine_stream_t *stream, const char *host, int port) {
+static int64_t xio_now_ms (void) {
+  struct timeval tv;
 
-  struct hostent *h;
-  int             i;
+  xine_monotonic_clock (&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
 
-  h = gethostbyname(host);
-  if (h == NULL) {
-    _x_message(stream, XINE_MSG_UNKNOWN_HOST, "unable to resolve", host, NULL);
-    return -1;
+
+/*
+ * host name resolution.
+ *
+ * Lookups run on a short-lived helper thread so the stream thread can wait
+ * for them abortably and with the network timeout. Results are kept for
+ * media.network.dns_cache_ttl seconds in a small cache shared by all
+ * xine instances of the process. Address lists are stored in connect
+ * order: families interleaved as recommended by RFC 8305, starting with
+ * the one getaddrinfo () prefers.
+ */
+typedef union {
+  struct sockaddr         sa;
+  struct sockaddr_in      in;
+#ifdef ENABLE_IPV6
+  struct sockaddr_in6     in6;
+#endif
+  struct sockaddr_storage ss;
+} xio_sockaddr_t;
+
+typedef struct {
+  char                    host[256];
+  int64_t                 since;
+  int                     num;
+  socklen_t               len[XIO_DNS_ADDRS];
+  xio_sockaddr_t          addr[XIO_DNS_ADDRS];
+} xio_dns_entry_t;
+
+static pthread_mutex_t xio_dns_lock = PTHREAD_MUTEX_INITIALIZER;
+static xio_dns_entry_t xio_dns_cache[XIO_DNS_CACHE_SIZE];
+
+static int xio_dns_cache_get (const char *host, int ttl, xio_dns_entry_t *e) {
+  int64_t now = xio_now_ms ();
+  int     i, found = 0;
+
+  if (ttl <= 0)
+    return 0;
+
+  pthread_mutex_lock (&xio_dns_lock);
+  for (i = 0; i < XIO_DNS_CACHE_SIZE; i++) {
+    xio_dns_entry_t *c = &xio_dns_cache[i];
+    if (c->num && (now - c->since < (int64_t)ttl * 1000) && !strcasecmp (c->host, host)) {
+      *e = *c;
+      found = 1;
+      break;
+    }
   }
+  pthread_mutex_unlock (&xio_dns_lock);
 
-  for (i = 0; h->h_addr_list[i]; i++) {
+  return found;
+}
 
-    int s = xine_socket_cloexec(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s == -1) {
-      _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "failed to create socket", strerror(errno), NULL);
-      return -1;
+static void xio_dns_cache_put (const xio_dns_entry_t *e) {
+  xio_dns_entry_t *slot = NULL;
+  int              i;
+
+  pthread_mutex_lock (&xio_dns_lock);
+  /* same host, or the oldest entry */
+  for (i = 0; i < XIO_DNS_CACHE_SIZE; i++) {
+    xio_dns_entry_t *c = &xio_dns_cache[i];
+    if (c->num && !strcasecmp (c->host, e->host)) {
+      slot = c;
+      break;
     }
+    if (!slot || (slot->num && (!c->num || c->since < slot->since)))
+      slot = c;
+  }
+  *slot = *e;
+  pthread_mutex_unlock (&xio_dns_lock);
+}
+
+static void xio_dns_fill (xio_dns_entry_t *e, const struct addrinfo *res) {
+  const struct addrinfo *first[XIO_DNS_ADDRS], *other[XIO_DNS_ADDRS], *a;
+  int                    nfirst = 0, nother = 0, i;
+
+  for (a = res; a; a = a->ai_next) {
+    if (a->ai_addrlen > sizeof (e->addr[0]))
+      continue;
+    if (a->ai_family == res->ai_family) {
+      if (nfirst < XIO_DNS_ADDRS)
+        first[nfirst++] = a;
+    } else {
+      if (nother < XIO_DNS_ADDRS)
+        other[nother++] = a;
+    }
+  }
+
+  e->num = 0;
+  for (i = 0; (i < nfirst || i < nother) && (e->num < XIO_DNS_ADDRS); i++) {
+    if (i < nfirst) {
+      memcpy (&e->addr[e->num], first[i]->ai_addr, first[i]->ai_addrlen);
+      e->len[e->num++] = first[i]->ai_addrlen;
+    }
+    if ((i < nother) && (e->num < XIO_DNS_ADDRS)) {
+      memcpy (&e->addr[e->num], other[i]->ai_addr, other[i]->ai_addrlen);
+      e->len[e->num++] = other[i]->ai_addrlen;
+    }
+  }
+}
+
+static int xio_dns_lookup (xio_dns_entry_t *e, int flags) {
+  struct addrinfo hints, *res = NULL;
+  int             error;
+
+  memset (&hints, 0, sizeof (hints));
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_family   = XIO_FAMILY;
+  hints.ai_flags    = flags;
+
+  error = getaddrinfo (e->host, NULL, &hints, &res);
+  if (error)
+    return error;
+
+  xio_dns_fill (e, res);
+  freeaddrinfo (res);
+  if (!e->num)
+    return EAI_NONAME;
+
+  e->since = xio_now_ms ();
+  if (!(flags & AI_NUMERICHOST))
+    xio_dns_cache_put (e);
+  return 0;
+}
 
 #ifndef WIN32
-    if (fcntl (s, F_SETFL, fcntl (s, F_GETFL) | O_NONBLOCK) == -1) {
-      _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", strerror(errno), NULL);
-      _x_io_tcp_close(NULL, s);
-      return -1;
+typedef struct {
+  pthread_mutex_t  lock;
+  int              refs;
+  int              done;
+  int              error;
+  int              wake[2];
+  xio_dns_entry_t  entry;
+} xio_dns_query_t;
+
+static void xio_dns_query_unref (xio_dns_query_t *q) {
+  int refs;
+
+  pthread_mutex_lock (&q->lock);
+  refs = --q->refs;
+  pthread_mutex_unlock (&q->lock);
+
+  if (!refs) {
+    _x_io_wake_close (q->wake);
+    pthread_mutex_destroy (&q->lock);
+    free (q);
+  }
+}
+
+static void *xio_dns_thread (void *data) {
+  xio_dns_query_t *q = data;
+  xio_dns_entry_t  e;
+  int              error;
+
+  e = q->entry;
+  error = xio_dns_lookup (&e, 0);
+
+  pthread_mutex_lock (&q->lock);
+  q->entry = e;
+  q->error = error;
+  q->done  = 1;
+  pthread_mutex_unlock (&q->lock);
+  _x_io_wake_set (q->wake);
+
+  /* the caller may have given up already */
+  xio_dns_query_unref (q);
+  return NULL;
+}
+#endif
+
+/*
+ * resolve host into e.
+ * returns XIO_READY, XIO_ERROR, XIO_ABORTED or XIO_TIMEOUT.
+ */
+static int xio_resolve (xine_stream_t *stream, const char *host, int timeout_msec, xio_dns_entry_t *e) {
+  cfg_entry_t *cfgentry;
+  int          ttl = 60;
+
+  memset (e, 0, sizeof (*e));
+  strlcpy (e->host, host, sizeof (e->host));
+
+  /* literal addresses need no name server */
+  if (!xio_dns_lookup (e, AI_NUMERICHOST))
+    return XIO_READY;
+
+  if (stream) {
+    cfgentry = stream->xine->config->lookup_entry (stream->xine->config, "media.network.dns_cache_ttl");
+    if (cfgentry)
+      ttl = cfgentry->num_value;
+  }
+  if (xio_dns_cache_get (host, ttl, e)) {
+    if (stream)
+      xprintf (stream->xine, XINE_VERBOSITY_DEBUG, "io_helper: using cached addresses of '%s'\n", host);
+    return XIO_READY;
+  }
+
+#ifndef WIN32
+  {
+    xio_dns_query_t *q;
+    pthread_attr_t   attr;
+    pthread_t        thread;
+    int              ret, error;
+
+    q = calloc (1, sizeof (*q));
+    if (!q)
+      return XIO_ERROR;
+    if (_x_io_wake_open (q->wake) < 0) {
+      free (q);
+      return xio_dns_lookup (e, 0) ? XIO_ERROR : XIO_READY;
     }
-#else
-    {
-      unsigned long non_block = 1;
-      int rc;
+    pthread_mutex_init (&q->lock, NULL);
+    q->refs  = 2;
+    q->entry = *e;
+
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create (&thread, &attr, xio_dns_thread, q)) {
+      pthread_attr_destroy (&attr);
+      q->refs = 1;
+      xio_dns_query_unref (q);
+      return xio_dns_lookup (e, 0) ? XIO_ERROR : XIO_READY;
+    }
+    pthread_attr_destroy (&attr);
 
-      rc = ioctlsocket(s, FIONBIO, &non_block);
+    ret = _x_io_select (stream, q->wake[0], XIO_READ_READY, timeout_msec);
 
-      if (rc == SOCKET_ERROR) {
-        _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", strerror(errno), NULL);
-        _x_io_tcp_close(NULL, s);
-        return -1;
-      }
+    pthread_mutex_lock (&q->lock);
+    if (q->done) {
+      *e    = q->entry;
+      error = q->error;
+      ret   = error ? XIO_ERROR : XIO_READY;
+    } else if (ret == XIO_READY) {
+      ret = XIO_ERROR;
     }
+    pthread_mutex_unlock (&q->lock);
+
+    xio_dns_query_unref (q);
+    return ret;
+  }
+#else
+  (void)timeout_msec;
+  return xio_dns_lookup (e, 0) ? XIO_ERROR : XIO_READY;
 #endif
+}
 
-    struct in_addr ia;
-    union {
-      struct sockaddr    sa;
-      struct sockaddr_in in;
-    } saddr;
-    memcpy (&ia, h->h_addr_list[i], 4);
-    saddr.in.sin_family = AF_INET;
-    saddr.in.sin_addr   = ia;
-    saddr.in.sin_port   = htons(port);
+/*
+ * start a non-blocking connect.
+ * returns the socket, or -1 with *err set. *done tells whether
+ * the connection is already up.
+ */
+static int xio_tcp_attempt (xine_stream_t *stream, const xio_sockaddr_t *addr, socklen_t len,
+                            int *done, int *err) {
+  int s;
+
+  *done = 0;
+
+  s = xine_socket_cloexec(addr->sa.sa_family, SOCK_STREAM, IPPROTO_TCP);
+  if (s == -1) {
+    *err = errno;
+    return -1;
+  }
 
 #ifndef WIN32
-    if (connect(s, &saddr.sa, sizeof(saddr.in))==-1 && errno != EINPROGRESS) {
+  if (fcntl (s, F_SETFL, fcntl (s, F_GETFL) | O_NONBLOCK) == -1) {
+    *err = errno;
+    _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", strerror(errno), NULL);
+    _x_io_tcp_close(NULL, s);
+    return -1;
+  }
 #else
-    if (connect(s, &saddr.sa, sizeof(saddr.in))==-1 && WSAGetLastError() != WSAEWOULDBLOCK) {
-      if (stream)
-        xprintf(stream->xine, XINE_VERBOSITY_DEBUG, "io_helper: WSAGetLastError() = %d\n", WSAGetLastError());
-#endif /* WIN32 */
+  {
+    unsigned long non_block = 1;
+    int rc;
 
-      _x_message(stream, XINE_MSG_CONNECTION_REFUSED, strerror(errno), NULL);
+    rc = ioctlsocket(s, FIONBIO, &non_block);
+
+    if (rc == SOCKET_ERROR) {
+      *err = errno;
+      _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", strerror(errno), NULL);
       _x_io_tcp_close(NULL, s);
-      continue;
+      return -1;
     }
+  }
+#endif
 
+  if (connect(s, &addr->sa, len) == 0) {
+    *done = 1;
     return s;
   }
+#ifndef WIN32
+  if (errno != EINPROGRESS) {
+#else
+  if (WSAGetLastError() != WSAEWOULDBLOCK) {
+    if (stream)
+      xprintf(stream->xine, XINE_VERBOSITY_DEBUG, "io_helper: WSAGetLastError() = %d\n", WSAGetLastError());
+#endif /* WIN32 */
+    *err = errno;
+    _x_io_tcp_close(NULL, s);
+    return -1;
+  }
 
-  return -1;
+  return s;
 }
-#endif
 
-int _x_io_tcp_connect(xine_stream_t *stream, const char *host, int port) {
+/*
+ * wait until one of the pending connects (fds[i] >= 0) finishes or fails.
+ * returns its index, -1 on timeout, -2 when aborted, -3 on error.
+ */
+static int xio_connect_wait (xine_stream_t *stream, const int *fds, int n, int timeout_msec) {
+#ifdef WIN32
+  int total_time_usec = 0;
+
+  while (total_time_usec < 1000 * timeout_msec) {
+    fd_set         wset, eset;
+    struct timeval select_timeout;
+    int            i, maxfd = -1, ret;
+
+    FD_ZERO (&wset);
+    FD_ZERO (&eset);
+    for (i = 0; i < n; i++) {
+      if (fds[i] >= 0) {
+        FD_SET (fds[i], &wset);
+        FD_SET (fds[i], &eset);
+        if (fds[i] > maxfd)
+          maxfd = fds[i];
+      }
+    }
+
+    select_timeout.tv_sec  = 0;
+    select_timeout.tv_usec = XIO_POLLING_INTERVAL;
+    ret = select (maxfd + 1, NULL, &wset, &eset, &select_timeout);
+
+    if (ret == -1 && errno != EINTR)
+      return -3;
+    if (ret > 0) {
+      for (i = 0; i < n; i++)
+        if ((fds[i] >= 0) && (FD_ISSET (fds[i], &wset) || FD_ISSET (fds[i], &eset)))
+          return i;
+    }
+    if (stream && _x_action_pending(stream))
+      return -2;
+
+    total_time_usec += XIO_POLLING_INTERVAL;
+  }
+  return -1;
 
-#ifndef ENABLE_IPV6
-    return _x_io_tcp_connect_ipv4(stream, host, port);
 #else
-  int             s;
-  struct addrinfo hints, *res, *tmpaddr;
-  int error;
-  char strport[16];
+  struct pollfd pfd[XIO_DNS_ADDRS + 1];
+  int64_t       deadline;
+  int           i, ret, wake;
+
+  for (i = 0; i < n; i++) {
+    /* poll () ignores negative fds */
+    pfd[i].fd      = fds[i];
+    pfd[i].events  = POLLOUT;
+    pfd[i].revents = 0;
+  }
+  pfd[n].fd      = stream ? stream->demux_action_fd[0] : -1;
+  pfd[n].events  = POLLIN;
+  pfd[n].revents = 0;
+  wake = (pfd[n].fd >= 0);
+
+  deadline = xio_now_ms () + timeout_msec;
+
+  while (1) {
+    int64_t left = deadline - xio_now_ms ();
+    int     wait;
+
+    if (left < 0)
+      left = 0;
+    wait = left;
+    if (!wake && stream && (wait > XIO_POLLING_INTERVAL / 1000))
+      wait = XIO_POLLING_INTERVAL / 1000;
+
+    ret = poll (pfd, n + 1, wait);
+
+    if (ret == -1 && errno != EINTR)
+      return -3;
+    if (ret > 0) {
+      for (i = 0; i < n; i++)
+        if (pfd[i].revents)
+          return i;
+    }
+    if (stream && _x_action_pending(stream))
+      return -2;
 
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_socktype = SOCK_STREAM;
-  hints.ai_family = PF_UNSPEC;
+    if (!left)
+      return -1;
+  }
+#endif
+}
 
-  snprintf(strport, sizeof(strport), "%d", port);
+/*
+ * "happy eyeballs" (RFC 8305): start with the first address, and every
+ * XIO_CONNECT_DELAY msecs (or as soon as an attempt fails) add the next one
+ * while the earlier attempts keep running. The first connection that comes
+ * up wins, all others are dropped.
+ */
+int _x_io_tcp_connect(xine_stream_t *stream, const char *host, int port) {
 
-  if (stream)
-    xprintf(stream->xine, XINE_VERBOSITY_DEBUG, "Resolving host '%s' at port '%s'\n", host, strport);
+  xio_dns_entry_t e;
+  cfg_entry_t    *cfgentry;
+  int             fds[XIO_DNS_ADDRS];
+  int             timeout = 30000, next, pending, i, ret, s = -1, win = 0, err = ECONNREFUSED;
+  int64_t         start, now, deadline, next_start;
 
-  error = getaddrinfo(host, strport, &hints, &res);
+  if (stream) {
+    cfgentry = stream->xine->config->lookup_entry (stream->xine->config, "media.network.timeout");
+    if (cfgentry)
+      timeout = cfgentry->num_value * 1000;
 
-  if (error) {
-    _x_message(stream, XINE_MSG_UNKNOWN_HOST,
-		 "unable to resolve", host, NULL);
-    return -1;
+    xprintf(stream->xine, XINE_VERBOSITY_DEBUG, "Resolving host '%s' at port '%d'\n", host, port);
   }
 
-  tmpaddr = res;
+  start = xio_now_ms ();
 
-  while (tmpaddr) {
+  ret = xio_resolve (stream, host, timeout, &e);
+  if (ret != XIO_READY) {
+    if (ret != XIO_ABORTED)
+      _x_message(stream, XINE_MSG_UNKNOWN_HOST, "unable to resolve", host, NULL);
+    return -1;
+  }
 
-      s = xine_socket_cloexec(tmpaddr->ai_family, SOCK_STREAM, IPPROTO_TCP);
-      if (s == -1) {
-	  _x_message(stream, XINE_MSG_CONNECTION_REFUSED,
-		       "failed to create socket", strerror(errno), NULL);
-	  tmpaddr = tmpaddr->ai_next;
-	  continue;
-      }
+  now = xio_now_ms ();
+  if (stream)
+    _x_stream_info_set (stream, XINE_STREAM_INFO_NET_RESOLVE_TIME, now - start);
+  start = now;
+
+  for (i = 0; i < e.num; i++) {
+    if (e.addr[i].sa.sa_family == AF_INET)
+      e.addr[i].in.sin_port = htons (port);
+#ifdef ENABLE_IPV6
+    else if (e.addr[i].sa.sa_family == AF_INET6)
+      e.addr[i].in6.sin6_port = htons (port);
+#endif
+    fds[i] = -1;
+  }
 
-      /*
-       * Enable the non-blocking features only when there's no other
-       * address, allowing to use other addresses if available.
-       * there will be an error if no address worked at all
-       */
-      if ( ! tmpaddr->ai_next ) {
-#ifndef WIN32
-	if (fcntl (s, F_SETFL, fcntl (s, F_GETFL) | O_NONBLOCK) == -1) {
-	  _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", strerror(errno), NULL);
-          _x_io_tcp_close(NULL, s);
-          freeaddrinfo(res);
-	  return -1;
-	}
-#else
-	unsigned long non_block = 1;
-	int rc;
+  next       = 0;
+  pending    = 0;
+  deadline   = now + timeout;
+  next_start = now;
 
-	rc = ioctlsocket(s, FIONBIO, &non_block);
+  while (1) {
+    int done;
 
-	if (rc == SOCKET_ERROR) {
-	  _x_message(stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", strerror(errno), NULL);
-          _x_io_tcp_close(NULL, s);
-          freeaddrinfo(res);
-	  return -1;
-	}
-#endif
+    now = xio_now_ms ();
+
+    /* add the next address when its turn has come or nothing else is left */
+    if ((next < e.num) && ((now >= next_start) || !pending)) {
+      fds[next] = xio_tcp_attempt (stream, &e.addr[next], e.len[next], &done, &err);
+      if (fds[next] >= 0) {
+        if (done) {
+          s = fds[next];
+          win = next;
+          fds[next] = -1;
+          break;
+        }
+        pending++;
+        next_start = now + XIO_CONNECT_DELAY;
+      } else {
+        next_start = now;
       }
+      next++;
+      continue;
+    }
 
-#ifndef WIN32
-    if (connect(s, tmpaddr->ai_addr,
-		tmpaddr->ai_addrlen)==-1 && errno != EINPROGRESS) {
+    if (!pending)
+      break;
+    if (now >= deadline) {
+      err = ETIMEDOUT;
+      break;
+    }
 
-#else
-    if (connect(s, tmpaddr->ai_addr,
-		tmpaddr->ai_addrlen)==-1 &&
-	WSAGetLastError() != WSAEWOULDBLOCK) {
+    ret = deadline - now;
+    if ((next < e.num) && (next_start - now < ret))
+      ret = next_start - now;
 
-      if (stream)
-        xprintf(stream->xine, XINE_VERBOSITY_DEBUG, "io_helper: WSAGetLastError() = %d\n", WSAGetLastError());
-#endif /* WIN32 */
+    i = xio_connect_wait (stream, fds, e.num, ret);
+    if (i == -2) {
+      err = 0;
+      break;
+    }
+    if (i == -3) {
+      err = errno;
+      break;
+    }
 
-      error = errno;
-      _x_io_tcp_close(NULL, s);
-      tmpaddr = tmpaddr->ai_next;
-      continue;
+    if (i >= 0) {
+      socklen_t len = sizeof (int);
+      int       serr = 0;
+
+      if (getsockopt (fds[i], SOL_SOCKET, SO_ERROR, (void *)&serr, &len) == -1)
+        serr = errno;
+      if (!serr) {
+        s = fds[i];
+        win = i;
+        fds[i] = -1;
+        break;
+      }
+      err = serr;
+      _x_io_tcp_close (NULL, fds[i]);
+      fds[i] = -1;
+      pending--;
+      next_start = now;
     }
+  }
 
-    freeaddrinfo(res);
-    return s;
+  for (i = 0; i < e.num; i++)
+    if (fds[i] >= 0)
+      _x_io_tcp_close (NULL, fds[i]);
+
+  if (s < 0) {
+    if (err)
+      _x_message(stream, XINE_MSG_CONNECTION_REFUSED, strerror(err), NULL);
+    return -1;
   }
 
-  _x_message(stream, XINE_MSG_CONNECTION_REFUSED, strerror(error), NULL);
+  if (stream) {
+    now = xio_now_ms ();
+    _x_stream_info_set (stream, XINE_STREAM_INFO_NET_CONNECT_TIME, now - start);
+    xprintf(stream->xine, XINE_VERBOSITY_DEBUG,
+            "io_helper: connected to %s (address %d of %d) after %d ms\n",
+            host, win + 1, e.num, (int)(now - start));
+  }
 
-  freeaddrinfo(res);
-  return -1;
-#endif
+  return s;
 }
 
 
 int _x_io_select (xine_stream_t *stream, int fd, int state, int timeout_msec) {
 
+#ifdef WIN32
   fd_set fdset;
   fd_set *rset, *wset;
   struct timeval select_timeout;
   int timeout_usec, total_time_usec;
   int ret;
-#ifdef WIN32
   HANDLE h;
   DWORD dwret;
   char msg[256];
-#endif
 
-#ifdef WIN32
   /* handle console file descriptiors differently on Windows */
   switch (fd) {
     case STDIN_FILENO: h = GetStdHandle(STD_INPUT_HANDLE); break;
@@ -246,11 +634,9 @@ int _x_io_select (xine_stream_t *stream, int fd, int state, int timeout_msec) {
     case STDERR_FILENO: h = GetStdHandle(STD_ERROR_HANDLE); break;
     default: h = INVALID_HANDLE_VALUE;
   }
-#endif
   timeout_usec = 1000 * timeout_msec;
   total_time_usec = 0;
 
-#ifdef WIN32
   if (h != INVALID_HANDLE_VALUE) {
     while (total_time_usec < timeout_usec) {
       dwret = WaitForSingleObject(h, timeout_msec);
@@ -283,7 +669,7 @@ int _x_io_select (xine_stream_t *stream, int fd, int state, int timeout_msec) {
     total_time_usec += XIO_POLLING_INTERVAL;
     return XIO_TIMEOUT;
   }
-#endif
+
   while (total_time_usec < timeout_usec) {
 
     FD_ZERO (&fdset);
@@ -314,6 +700,55 @@ int _x_io_select (xine_stream_t *stream, int fd, int state, int timeout_msec) {
     total_time_usec += XIO_POLLING_INTERVAL;
   }
   return XIO_TIMEOUT;
+
+#else
+  struct pollfd pfd[2];
+  int64_t       deadline;
+  int           nfds, ret;
+
+  /* wait for the fd and the stream's action wakeup at once, so an idle
+   * stream sleeps until data arrives or someone wants to stop it.
+   * Without a wakeup fd, check demux_action_pending in short intervals. */
+  pfd[0].fd      = fd;
+  pfd[0].events  = ((state & XIO_READ_READY) ? POLLIN : 0) | ((state & XIO_WRITE_READY) ? POLLOUT : 0);
+  pfd[0].revents = 0;
+  pfd[1].fd      = stream ? stream->demux_action_fd[0] : -1;
+  pfd[1].events  = POLLIN;
+  pfd[1].revents = 0;
+  nfds = (pfd[1].fd >= 0) ? 2 : 1;
+
+  deadline = xio_now_ms () + timeout_msec;
+
+  while (1) {
+    int64_t left = deadline - xio_now_ms ();
+    int     wait;
+
+    if (left < 0)
+      left = 0;
+    wait = left;
+    if ((nfds == 1) && stream && (wait > XIO_POLLING_INTERVAL / 1000))
+      wait = XIO_POLLING_INTERVAL / 1000;
+
+    ret = poll (pfd, nfds, wait);
+
+    if (ret == -1 && errno != EINTR) {
+      /* poll error */
+      return XIO_ERROR;
+    } else if (ret > 0 && pfd[0].revents) {
+      /* fd is ready (or failed, the following i/o call will tell) */
+      return XIO_READY;
+    }
+
+    /* aborts current read if action pending. otherwise xine
+     * cannot be stopped when no more data is available.
+     */
+    if (stream && _x_action_pending(stream))
+      return XIO_ABORTED;
+
+    if (!left)
+      return XIO_TIMEOUT;
+  }
+#endif
 }
 
 
@@ -524,3 +959,436 @@ int _x_io_tcp_close(xine_stream_t *stream, int fd)
 
   return r;
 }
+
+/*
+ * wakeup fd: readable while set.
+ * eventfd where available, a non-blocking pipe otherwise.
+ */
+int _x_io_wake_open (int fds[2]) {
+#if defined(HAVE_SYS_EVENTFD_H)
+  fds[0] = fds[1] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  return (fds[0] < 0) ? -1 : 0;
+#elif !defined(WIN32)
+  if (pipe (fds) < 0) {
+    fds[0] = fds[1] = -1;
+    return -1;
+  }
+  fcntl (fds[0], F_SETFL, O_NONBLOCK);
+  fcntl (fds[1], F_SETFL, O_NONBLOCK);
+  _x_set_file_close_on_exec (fds[0]);
+  _x_set_file_close_on_exec (fds[1]);
+  return 0;
+#else
+  fds[0] = fds[1] = -1;
+  return -1;
+#endif
+}
+
+void _x_io_wake_close (int fds[2]) {
+#ifndef WIN32
+  if (fds[1] >= 0 && fds[1] != fds[0])
+    close (fds[1]);
+  if (fds[0] >= 0)
+    close (fds[0]);
+#endif
+  fds[0] = fds[1] = -1;
+}
+
+void _x_io_wake_set (int fds[2]) {
+#if defined(HAVE_SYS_EVENTFD_H)
+  uint64_t v = 1;
+#else
+  uint8_t  v = 0;
+#endif
+  ssize_t  r;
+
+  if (fds[1] < 0)
+    return;
+  r = write (fds[1], &v, sizeof (v));
+  (void)r;
+}
+
+void _x_io_wake_clear (int fds[2]) {
+#if defined(HAVE_SYS_EVENTFD_H)
+  uint64_t v;
+  ssize_t  r;
+
+  if (fds[0] < 0)
+    return;
+  r = read (fds[0], &v, sizeof (v));
+  (void)r;
+#else
+  uint8_t  buf[64];
+
+  if (fds[0] < 0)
+    return;
+  while (read (fds[0], buf, sizeof (buf)) > 0)
+    ;
+#endif
+}
+
+/*
+ * I/O reactor.
+ *
+ * A few threads per xine instance wait for all registered fds at once
+ * (epoll where available) and run the watch callbacks. A watch is
+ * disarmed while its callback runs, so callbacks of one watch never
+ * run concurrently. Events are matched by watch id, not by pointer:
+ * a watch may be removed while an event for it is underway.
+ */
+
+typedef struct xine_io_reactor_s xine_io_reactor_t;
+
+struct xine_io_watch_s {
+  xine_io_watch_t     *next;
+  xine_io_reactor_t   *reactor;
+  uint32_t             id;
+  int                  fd;
+  int                  state;
+  int64_t              deadline;   /* msecs, 0: none */
+  xine_io_watch_cb_t   cb;
+  void                *data;
+  pthread_t            runner;
+  unsigned int         busy:1;     /* callback running */
+  unsigned int         stopped:1;  /* callback returned XIO_WATCH_STOP */
+  unsigned int         removed:1;  /* removed from within the callback */
+};
+
+struct xine_io_reactor_s {
+  xine_t              *xine;
+  pthread_mutex_t      lock;
+  pthread_cond_t       idle;       /* some callback returned */
+  xine_io_watch_t     *watches;
+  uint32_t             last_id;
+  int                  wake[2];
+#ifdef HAVE_SYS_EPOLL_H
+  int                  epfd;
+#endif
+  int                  quit;
+  int                  num_threads;
+  pthread_t            threads[XIO_REACTOR_THREADS];
+};
+
+static xine_io_watch_t *xio_watch_find (xine_io_reactor_t *r, uint32_t id) {
+  xine_io_watch_t *w;
+
+  for (w = r->watches; w; w = w->next)
+    if (w->id == id)
+      return w;
+  return NULL;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static void xio_watch_arm (xine_io_reactor_t *r, xine_io_watch_t *w, int op) {
+  struct epoll_event ev;
+
+  if (w->fd < 0)
+    return;
+  ev.events   = ((w->state & XIO_READ_READY) ? EPOLLIN : 0) |
+                ((w->state & XIO_WRITE_READY) ? EPOLLOUT : 0) | EPOLLONESHOT;
+  ev.data.u64 = w->id;
+  if (epoll_ctl (r->epfd, op, w->fd, &ev) < 0)
+    xprintf (r->xine, XINE_VERBOSITY_DEBUG, "io_helper: epoll_ctl (%d): %s\n", w->fd, strerror (errno));
+}
+#else
+# define xio_watch_arm(r,w,op) do {} while (0)
+#endif
+
+/* wait for fd events, return ids and states. without lock. */
+static int xio_reactor_wait (xine_io_reactor_t *r, uint32_t *ids, int *states, int timeout) {
+  int i, n = 0;
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event ev[XIO_REACTOR_EVENTS];
+
+  n = epoll_wait (r->epfd, ev, XIO_REACTOR_EVENTS, timeout);
+  if (n < 0)
+    return 0;
+  for (i = 0; i < n; i++) {
+    ids[i]    = ev[i].data.u64;
+    states[i] = ((ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ? XIO_READ_READY : 0) |
+                ((ev[i].events & EPOLLOUT) ? XIO_WRITE_READY : 0);
+  }
+#else
+  struct pollfd    pfd[XIO_REACTOR_EVENTS];
+  uint32_t         pid[XIO_REACTOR_EVENTS];
+  xine_io_watch_t *w;
+  int              num = 0;
+
+  pfd[num].fd     = r->wake[0];
+  pfd[num].events = POLLIN;
+  pid[num++]      = 0;
+  pthread_mutex_lock (&r->lock);
+  for (w = r->watches; w && num < XIO_REACTOR_EVENTS; w = w->next) {
+    if (w->busy || w->stopped || w->fd < 0)
+      continue;
+    pfd[num].fd     = w->fd;
+    pfd[num].events = ((w->state & XIO_READ_READY) ? POLLIN : 0) | ((w->state & XIO_WRITE_READY) ? POLLOUT : 0);
+    pid[num++]      = w->id;
+  }
+  pthread_mutex_unlock (&r->lock);
+
+  if (poll (pfd, num, timeout) <= 0)
+    return 0;
+  for (i = 0; i < num; i++) {
+    if (!pfd[i].revents)
+      continue;
+    ids[n]    = pid[i];
+    states[n] = ((pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) ? XIO_READ_READY : 0) |
+                ((pfd[i].revents & POLLOUT) ? XIO_WRITE_READY : 0);
+    n++;
+  }
+#endif
+  return n;
+}
+
+static void *xio_reactor_loop (void *data) {
+  xine_io_reactor_t *r = (xine_io_reactor_t *)data;
+  xine_io_watch_t   *run[XIO_REACTOR_EVENTS];
+  int                run_state[XIO_REACTOR_EVENTS];
+  uint32_t           ids[XIO_REACTOR_EVENTS];
+  int                states[XIO_REACTOR_EVENTS];
+
+  pthread_mutex_lock (&r->lock);
+
+  while (!r->quit) {
+    xine_io_watch_t *w;
+    int64_t          now = xio_now_ms (), next = 0;
+    int              num_run = 0, i, n;
+
+    /* expired timeouts */
+    for (w = r->watches; w; w = w->next) {
+      if (w->busy || w->stopped || !w->deadline)
+        continue;
+      if (w->deadline <= now) {
+        if (num_run < XIO_REACTOR_EVENTS) {
+          run[num_run]       = w;
+          run_state[num_run] = 0;
+          num_run++;
+        }
+      } else if (!next || w->deadline < next) {
+        next = w->deadline;
+      }
+    }
+
+    if (!num_run) {
+      pthread_mutex_unlock (&r->lock);
+      n = xio_reactor_wait (r, ids, states, next ? (int)(next - now) : -1);
+      pthread_mutex_lock (&r->lock);
+
+      for (i = 0; i < n; i++) {
+        if (!ids[i]) {
+          /* wakeup: re-check timeouts. keep it set when quitting, for the other threads */
+          if (!r->quit)
+            _x_io_wake_clear (r->wake);
+          continue;
+        }
+        w = xio_watch_find (r, ids[i]);
+        if (!w || w->busy || w->stopped)
+          continue;
+        run[num_run]       = w;
+        run_state[num_run] = states[i];
+        num_run++;
+      }
+    }
+
+    for (i = 0; i < num_run; i++)
+      run[i]->busy = 1;
+
+    for (i = 0; i < num_run; i++) {
+      int ret;
+
+      w = run[i];
+      w->runner = pthread_self ();
+      pthread_mutex_unlock (&r->lock);
+      ret = w->cb (w->data, w->fd, run_state[i]);
+      pthread_mutex_lock (&r->lock);
+      w->busy = 0;
+
+      if (w->removed) {
+        free (w);
+        continue;
+      }
+      if (ret == XIO_WATCH_STOP) {
+        w->stopped  = 1;
+        w->deadline = 0;
+      } else {
+        w->deadline = (ret >= 0) ? xio_now_ms () + ret : 0;
+        xio_watch_arm (r, w, EPOLL_CTL_MOD);
+      }
+    }
+    if (num_run)
+      pthread_cond_broadcast (&r->idle);
+  }
+
+  pthread_mutex_unlock (&r->lock);
+  return NULL;
+}
+
+static xine_io_reactor_t *xio_reactor_get (xine_t *xine) {
+  xine_io_reactor_t *r;
+  int                i;
+
+  pthread_mutex_lock (&xine->io_reactor_lock);
+
+  r = xine->io_reactor;
+  if (r)
+    goto out;
+
+  r = calloc (1, sizeof (*r));
+  if (!r)
+    goto out;
+  r->xine = xine;
+#ifdef HAVE_SYS_EPOLL_H
+  r->epfd = -1;
+#endif
+  if (_x_io_wake_open (r->wake) < 0)
+    goto fail;
+#ifdef HAVE_SYS_EPOLL_H
+  r->epfd = epoll_create1 (EPOLL_CLOEXEC);
+  if (r->epfd < 0)
+    goto fail;
+  {
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.u64 = 0;
+    epoll_ctl (r->epfd, EPOLL_CTL_ADD, r->wake[0], &ev);
+  }
+#endif
+  pthread_mutex_init (&r->lock, NULL);
+  pthread_cond_init (&r->idle, NULL);
+
+#ifdef HAVE_SYS_EPOLL_H
+  r->num_threads = XIO_REACTOR_THREADS;
+#else
+  /* poll () would wake all threads for the same events */
+  r->num_threads = 1;
+#endif
+  for (i = 0; i < r->num_threads; i++) {
+    if (pthread_create (&r->threads[i], NULL, xio_reactor_loop, r)) {
+      xprintf (xine, XINE_VERBOSITY_LOG, "io_helper: can't create reactor thread\n");
+      break;
+    }
+  }
+  r->num_threads = i;
+  if (!i) {
+    pthread_cond_destroy (&r->idle);
+    pthread_mutex_destroy (&r->lock);
+    goto fail;
+  }
+
+  xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: started %d reactor threads\n", r->num_threads);
+  xine->io_reactor = r;
+  goto out;
+
+ fail:
+#ifdef HAVE_SYS_EPOLL_H
+  if (r->epfd >= 0)
+    close (r->epfd);
+#endif
+  _x_io_wake_close (r->wake);
+  free (r);
+  r = NULL;
+ out:
+  pthread_mutex_unlock (&xine->io_reactor_lock);
+  return r;
+}
+
+xine_io_watch_t *_x_io_watch_add (xine_t *xine, int fd, int state, int timeout_msec,
+                                  xine_io_watch_cb_t cb, void *data) {
+  xine_io_reactor_t *r = xio_reactor_get (xine);
+  xine_io_watch_t   *w;
+
+  if (!r)
+    return NULL;
+  w = calloc (1, sizeof (*w));
+  if (!w)
+    return NULL;
+
+  w->reactor = r;
+  w->fd      = fd;
+  w->state   = state;
+  w->cb      = cb;
+  w->data    = data;
+
+  pthread_mutex_lock (&r->lock);
+  if (!++r->last_id)
+    ++r->last_id;
+  w->id       = r->last_id;
+  w->deadline = (timeout_msec >= 0) ? xio_now_ms () + timeout_msec : 0;
+  w->next     = r->watches;
+  r->watches  = w;
+  xio_watch_arm (r, w, EPOLL_CTL_ADD);
+  pthread_mutex_unlock (&r->lock);
+
+  /* new timeout, or new fd for poll () */
+  _x_io_wake_set (r->wake);
+
+  return w;
+}
+
+void _x_io_watch_remove (xine_io_watch_t **watch) {
+  xine_io_watch_t   *w = *watch, **p;
+  xine_io_reactor_t *r;
+
+  if (!w)
+    return;
+  *watch = NULL;
+  r = w->reactor;
+
+  pthread_mutex_lock (&r->lock);
+
+  for (p = &r->watches; *p; p = &(*p)->next) {
+    if (*p == w) {
+      *p = w->next;
+      break;
+    }
+  }
+#ifdef HAVE_SYS_EPOLL_H
+  if (w->fd >= 0)
+    epoll_ctl (r->epfd, EPOLL_CTL_DEL, w->fd, NULL);
+#endif
+
+  if (w->busy && pthread_equal (w->runner, pthread_self ())) {
+    /* from within the callback: freed when it returns */
+    w->removed = 1;
+    pthread_mutex_unlock (&r->lock);
+    return;
+  }
+  while (w->busy)
+    pthread_cond_wait (&r->idle, &r->lock);
+
+  pthread_mutex_unlock (&r->lock);
+  free (w);
+}
+
+void _x_io_reactor_dispose (xine_t *xine) {
+  xine_io_reactor_t *r = xine->io_reactor;
+  int                i;
+
+  if (!r)
+    return;
+  xine->io_reactor = NULL;
+
+  pthread_mutex_lock (&r->lock);
+  r->quit = 1;
+  pthread_mutex_unlock (&r->lock);
+  _x_io_wake_set (r->wake);
+
+  for (i = 0; i < r->num_threads; i++)
+    pthread_join (r->threads[i], NULL);
+
+  while (r->watches) {
+    xine_io_watch_t *w = r->watches;
+    xprintf (xine, XINE_VERBOSITY_LOG, "io_helper: BUG: watch for fd %d still registered\n", w->fd);
+    r->watches = w->next;
+    free (w);
+  }
+
+#ifdef HAVE_SYS_EPOLL_H
+  close (r->epfd);
+#endif
+  _x_io_wake_close (r->wake);
+  pthread_cond_destroy (&r->idle);
+  pthread_mutex_destroy (&r->lock);
+  free (r);
+}
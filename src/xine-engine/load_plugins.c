@@ -1864,6 +1864,32 @@ static int probe_mime_type (xine_t *self, plugin_node_t *node, const char *mime_
   return 0;
 }
 
+/* catalog->lock is expected to be locked */
+static demux_plugin_t *probe_demux_open (xine_stream_t *stream, plugin_node_t *node,
+                                         input_plugin_t *input, int method, int *probe_us) {
+  demux_plugin_t *plugin;
+  struct timeval  t1, t2;
+  int             us;
+
+  stream->content_detection_method = method;
+
+  xine_monotonic_clock (&t1, NULL);
+  plugin = ((demux_class_t *)node->plugin_class)->open_plugin (node->plugin_class, stream, input);
+  xine_monotonic_clock (&t2, NULL);
+
+  us = (t2.tv_sec - t1.tv_sec) * 1000000 + (t2.tv_usec - t1.tv_usec);
+  *probe_us += us;
+  xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+           "load_plugins: probing demux '%s' (method %d) took %d us%s\n",
+           node->info->id, method, us, plugin ? ", accepted" : "");
+
+  if (plugin) {
+    inc_node_ref(node);
+    plugin->node = node;
+  }
+  return plugin;
+}
+
 static demux_plugin_t *probe_demux (xine_stream_t *stream, int method1, int method2,
 				    input_plugin_t *input) {
 
@@ -1871,6 +1897,9 @@ static demux_plugin_t *probe_demux (xine_stream_t *stream, int method1, int meth
   int               methods[3];
   plugin_catalog_t *catalog = stream->xine->plugin_catalog;
   demux_plugin_t   *plugin = NULL;
+  const char       *mime_type = NULL;
+  uint8_t          *hinted = NULL;
+  int               probe_us = 0;
 
   methods[0] = method1;
   methods[1] = method2;
@@ -1878,6 +1907,41 @@ static demux_plugin_t *probe_demux (xine_stream_t *stream, int method1, int meth
 
   _x_assert(methods[0] != -1);
 
+  /* MIME type as reported by the input (but not text/plain) */
+  if (stream->input_plugin->get_optional_data &&
+      stream->input_plugin->get_optional_data (stream->input_plugin, NULL, INPUT_OPTIONAL_DATA_DEMUX_MIME_TYPE) != INPUT_OPTIONAL_UNSUPPORTED &&
+      stream->input_plugin->get_optional_data (stream->input_plugin, &mime_type, INPUT_OPTIONAL_DATA_MIME_TYPE) != INPUT_OPTIONAL_UNSUPPORTED &&
+      mime_type && !strcasecmp (mime_type, "text/plain"))
+    mime_type = NULL;
+
+  pthread_mutex_lock (&catalog->lock);
+
+  /* Fast path for detection by content: most of the time, MIME type or
+   * extension already tell the right demuxer. Let those check the content
+   * first, and skip them in the full scan below. */
+  if (methods[0] == METHOD_BY_CONTENT) {
+    int list_id, list_size;
+
+    list_size = xine_sarray_size(catalog->plugin_lists[PLUGIN_DEMUX - 1]);
+    hinted = calloc (list_size, 1);
+    for (list_id = 0; hinted && list_id < list_size; list_id++) {
+      plugin_node_t *node;
+
+      node = xine_sarray_get (catalog->plugin_lists[PLUGIN_DEMUX - 1], list_id);
+      if (!node->plugin_class && !_load_plugin_class(stream->xine, node, NULL))
+        continue;
+      if (!(mime_type && probe_mime_type (stream->xine, node, mime_type)) &&
+          !_x_demux_check_extension(input->get_mrl(input), ((demux_class_t *)node->plugin_class)->extensions))
+        continue;
+
+      hinted[list_id] = 1;
+      if ((plugin = probe_demux_open (stream, node, input, METHOD_BY_CONTENT, &probe_us)))
+        break;
+    }
+  }
+
+  pthread_mutex_unlock (&catalog->lock);
+
   i = 0;
   while (methods[i] != -1 && !plugin) {
     int list_id, list_size;
@@ -1890,39 +1954,26 @@ static demux_plugin_t *probe_demux (xine_stream_t *stream, int method1, int meth
 
       node = xine_sarray_get (catalog->plugin_lists[PLUGIN_DEMUX - 1], list_id);
 
-      xprintf(stream->xine, XINE_VERBOSITY_DEBUG, "load_plugins: probing demux '%s'\n", node->info->id);
+      if (methods[i] == METHOD_BY_CONTENT && hinted && hinted[list_id])
+        continue;
 
       if (node->plugin_class || _load_plugin_class(stream->xine, node, NULL)) {
-        const char *mime_type;
-
-        /* If detecting by MRL, try the MIME type first (but not text/plain)... */
-        stream->content_detection_method = METHOD_EXPLICIT;
-        if (methods[i] == METHOD_BY_MRL &&
-            stream->input_plugin->get_optional_data &&
-            stream->input_plugin->get_optional_data (stream->input_plugin, NULL, INPUT_OPTIONAL_DATA_DEMUX_MIME_TYPE) != INPUT_OPTIONAL_UNSUPPORTED &&
-            stream->input_plugin->get_optional_data (stream->input_plugin, &mime_type, INPUT_OPTIONAL_DATA_MIME_TYPE) != INPUT_OPTIONAL_UNSUPPORTED &&
-            mime_type && strcasecmp (mime_type, "text/plain") &&
+
+        /* If detecting by MRL, try the MIME type first... */
+        if (methods[i] == METHOD_BY_MRL && mime_type &&
             probe_mime_type (stream->xine, node, mime_type) &&
-            (plugin = ((demux_class_t *)node->plugin_class)->open_plugin (node->plugin_class, stream, input)))
-        {
-          inc_node_ref(node);
-          plugin->node = node;
+            (plugin = probe_demux_open (stream, node, input, METHOD_EXPLICIT, &probe_us)))
           break;
-        }
 
         /* ... then try the extension */
-        stream->content_detection_method = methods[i];
-	if ( stream->content_detection_method == METHOD_BY_MRL &&
+	if ( methods[i] == METHOD_BY_MRL &&
 	     ! _x_demux_check_extension(input->get_mrl(input),
 					 ((demux_class_t *)node->plugin_class)->extensions)
 	     )
 	  continue;
 
-        if ((plugin = ((demux_class_t *)node->plugin_class)->open_plugin(node->plugin_class, stream, input))) {
-	  inc_node_ref(node);
-	  plugin->node = node;
-	  break;
-        }
+        if ((plugin = probe_demux_open (stream, node, input, methods[i], &probe_us)))
+          break;
       }
     }
 
@@ -1931,6 +1982,12 @@ static demux_plugin_t *probe_demux (xine_stream_t *stream, int method1, int meth
     i++;
   }
 
+  free (hinted);
+
+  xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+           "load_plugins: demux probing took %d us%s%s\n", probe_us,
+           plugin ? ", using " : "", plugin ? plugin->node->info->id : "");
+
   return plugin;
 }
 
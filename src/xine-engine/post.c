@@ -27,7 +27,13 @@
 #include <xine/post.h>
 
 #include <stdarg.h>
+#include <unistd.h>
 #include <pthread.h>
+#ifdef WIN32
+#  include <windows.h>
+#endif
+
+#include "xine_private.h"
 
 #define HARD_DEBUG
 #ifdef HARD_DEBUG
@@ -53,6 +59,10 @@
 typedef struct {
   vo_frame_t     frame;
   xine_stream_t *stream;
+  /* band ops handed over from the port above, see _x_post_band_draw () */
+  post_band_op_t ops[POST_BAND_OPS_MAX];
+  int            num_ops;
+  int            writable;
 } vf_alias_t;
 
 static void post_frame_lock       (vo_frame_t *vo_img);
@@ -60,6 +70,7 @@ static void post_frame_proc_slice (vo_frame_t *vo_img, uint8_t **src);
 static void post_frame_proc_frame (vo_frame_t *vo_img);
 static void post_frame_field      (vo_frame_t *vo_img, int which_field);
 static int  post_frame_draw       (vo_frame_t *vo_img, xine_stream_t *stream);
+static int  post_frame_draw_plugin(vo_frame_t *vo_img, xine_stream_t *stream);
 static void post_frame_free       (vo_frame_t *vo_img);
 static void post_frame_dispose    (vo_frame_t *vo_img);
 
@@ -101,13 +112,15 @@ static vo_frame_t *post_intercept_video_frame (post_video_port_t *port, vo_frame
   /* make a copy and attach the original */
   xine_fast_memcpy (&new_frame->frame, frame, sizeof (vo_frame_t));
   new_frame->frame.next = frame;
+  new_frame->num_ops  = 0;
+  new_frame->writable = 0;
 
   /* modify the frame with the intercept functions */
   new_frame->frame.port       = &port->new_port;
   new_frame->frame.proc_frame = port->new_frame->proc_frame ? port->new_frame->proc_frame : NULL;
   new_frame->frame.proc_slice = port->new_frame->proc_slice ? port->new_frame->proc_slice : NULL;
   new_frame->frame.field      = port->new_frame->field      ? port->new_frame->field      : post_frame_field;
-  new_frame->frame.draw       = port->new_frame->draw       ? port->new_frame->draw       : post_frame_draw;
+  new_frame->frame.draw       = port->new_frame->draw       ? post_frame_draw_plugin      : post_frame_draw;
   new_frame->frame.lock       = port->new_frame->lock       ? port->new_frame->lock       : post_frame_lock;
   new_frame->frame.free       = port->new_frame->free       ? port->new_frame->free       : post_frame_free;
   new_frame->frame.dispose    = port->new_frame->dispose    ? port->new_frame->dispose    : post_frame_dispose;
@@ -616,6 +629,19 @@ static int post_frame_draw(vo_frame_t *vo_img, xine_stream_t *stream) {
   return skip;
 }
 
+static int post_frame_draw_plugin(vo_frame_t *vo_img, xine_stream_t *stream) {
+  post_video_port_t *port = _x_post_video_frame_to_port(vo_img);
+
+  /* exact seek: frames before the target will not be shown, dont waste
+   * time processing them here. do not forward them either, a plugin may
+   * send its frames elsewhere (eg. a mosaico picture in picture). plugins
+   * that keep earlier frames for later use see them all. */
+  if (stream && (stream != XINE_ANON_STREAM) && !port->need_all_frames &&
+    _x_exact_seek_drop (stream, vo_img->pts))
+    return 0;
+  return port->new_frame->draw (vo_img, stream);
+}
+
 static void post_frame_lock(vo_frame_t *vo_img) {
   post_video_port_t *port = _x_post_video_frame_to_port(vo_img);
 
@@ -1148,3 +1174,304 @@ int _x_post_dispose(post_plugin_t *this) {
 }
 
 
+/* slice parallel processing */
+
+/* one _x_post_slices () call, on the caller's stack */
+typedef struct post_slices_job_s post_slices_job_t;
+struct post_slices_job_s {
+  post_slices_job_t *next;        /* in queue while bands are left to hand out */
+  post_slice_func_t  func;
+  void              *data;
+  int                bands, next_band, pending;
+  int                bounds[POST_SLICES_MAX + 1];
+};
+
+struct xine_post_slices_s {
+  pthread_mutex_t    mutex;
+  pthread_cond_t     wake;        /* workers: new job or quit */
+  pthread_cond_t     done;        /* callers: a job finished */
+  int                quit;
+
+  /* jobs with bands left, oldest first */
+  post_slices_job_t *jobs, **jobs_tail;
+
+  int                num_threads;
+  pthread_t          threads[POST_SLICES_MAX - 1];
+};
+
+/* hand out the next band of job, and unqueue it after its last one.
+ * pool->mutex held. */
+static int post_slices_take (struct xine_post_slices_s *pool, post_slices_job_t *job) {
+  int band = job->next_band++;
+
+  if (job->next_band >= job->bands) {
+    post_slices_job_t **p = &pool->jobs;
+    while (*p != job)
+      p = &(*p)->next;
+    *p = job->next;
+    if (pool->jobs_tail == &job->next)
+      pool->jobs_tail = p;
+    job->next = NULL;
+  }
+  return band;
+}
+
+static int post_slices_cpus (void) {
+#if defined(WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo (&info);
+  return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long n = sysconf (_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? n : 1;
+#else
+  return 1;
+#endif
+}
+
+static void *post_slices_worker (void *data) {
+  struct xine_post_slices_s *pool = data;
+
+  pthread_mutex_lock (&pool->mutex);
+  while (1) {
+    post_slices_job_t *job;
+    int band;
+
+    while (!pool->quit && !pool->jobs)
+      pthread_cond_wait (&pool->wake, &pool->mutex);
+    if (pool->quit)
+      break;
+
+    job  = pool->jobs;
+    band = post_slices_take (pool, job);
+    pthread_mutex_unlock (&pool->mutex);
+    job->func (job->data, band, job->bounds[band], job->bounds[band + 1]);
+    pthread_mutex_lock (&pool->mutex);
+
+    if (--job->pending == 0)
+      pthread_cond_broadcast (&pool->done);
+  }
+  pthread_mutex_unlock (&pool->mutex);
+
+  return NULL;
+}
+
+static struct xine_post_slices_s *post_slices_get (xine_t *xine) {
+  struct xine_post_slices_s *pool;
+
+  pthread_mutex_lock (&xine->post_slices_lock);
+
+  pool = xine->post_slices;
+  if (!pool) {
+    int n = xine->config->register_num (xine->config,
+      "engine.performance.post_threads", 0,
+      _("Threads for video post processing"),
+      _("Video post plugins that support it split each frame into bands "
+        "and filter them in parallel. 0 uses one thread per CPU core, 1 "
+        "filters on the decoder thread only."),
+      20, NULL, NULL);
+    if (n <= 0)
+      n = post_slices_cpus ();
+    if (n > POST_SLICES_MAX)
+      n = POST_SLICES_MAX;
+
+    pool = calloc (1, sizeof (*pool));
+    if (pool) {
+      pthread_mutex_init (&pool->mutex, NULL);
+      pthread_cond_init (&pool->wake, NULL);
+      pthread_cond_init (&pool->done, NULL);
+      pool->jobs_tail = &pool->jobs;
+      /* the caller does one band itself */
+      while (pool->num_threads < n - 1) {
+        if (pthread_create (&pool->threads[pool->num_threads], NULL, post_slices_worker, pool))
+          break;
+        pool->num_threads++;
+      }
+      xprintf (xine, XINE_VERBOSITY_DEBUG, "post: %d slice worker threads.\n", pool->num_threads);
+      xine->post_slices = pool;
+    }
+  }
+
+  pthread_mutex_unlock (&xine->post_slices_lock);
+  return pool;
+}
+
+void _x_post_slices (post_plugin_t *post, int n, int align, post_slice_func_t func, void *data) {
+  struct xine_post_slices_s *pool;
+  post_slices_job_t job;
+  int bands, size, i;
+
+  if (n <= 0)
+    return;
+  if (align < 1)
+    align = 1;
+
+  pool = post_slices_get (post->xine);
+  bands = pool ? pool->num_threads + 1 : 1;
+  /* small bands are not worth the hand over */
+  size = (align < 16) ? 16 : align;
+  if (bands > n / size)
+    bands = n / size;
+  if (bands <= 1) {
+    func (data, 0, 0, n);
+    return;
+  }
+
+  size = (n + bands - 1) / bands;
+  size = (size + align - 1) / align * align;
+  job.bounds[0] = 0;
+  for (i = 1; i <= bands; i++)
+    job.bounds[i] = (i * size < n) ? i * size : n;
+  /* rounding may have left the last bands empty */
+  while (job.bounds[bands - 1] >= n)
+    bands--;
+
+  job.next      = NULL;
+  job.func      = func;
+  job.data      = data;
+  job.bands     = bands;
+  job.next_band = 0;
+  job.pending   = bands;
+
+  /* jobs of other streams may be queued, and run side by side.
+   * the caller works on its own job meanwhile. */
+  pthread_mutex_lock (&pool->mutex);
+  *pool->jobs_tail = &job;
+  pool->jobs_tail  = &job.next;
+  pthread_cond_broadcast (&pool->wake);
+
+  while (job.next_band < job.bands) {
+    int band = post_slices_take (pool, &job);
+    pthread_mutex_unlock (&pool->mutex);
+    func (data, band, job.bounds[band], job.bounds[band + 1]);
+    pthread_mutex_lock (&pool->mutex);
+    job.pending--;
+  }
+  while (job.pending > 0)
+    pthread_cond_wait (&pool->done, &pool->mutex);
+
+  pthread_mutex_unlock (&pool->mutex);
+}
+
+void _x_post_slices_dispose (xine_t *xine) {
+  struct xine_post_slices_s *pool = xine->post_slices;
+  int i;
+
+  if (!pool)
+    return;
+  xine->post_slices = NULL;
+
+  pthread_mutex_lock (&pool->mutex);
+  pool->quit = 1;
+  pthread_cond_broadcast (&pool->wake);
+  pthread_mutex_unlock (&pool->mutex);
+  for (i = 0; i < pool->num_threads; i++)
+    pthread_join (pool->threads[i], NULL);
+
+  pthread_cond_destroy (&pool->done);
+  pthread_cond_destroy (&pool->wake);
+  pthread_mutex_destroy (&pool->mutex);
+  free (pool);
+}
+
+
+/* fused band filters */
+
+/* rows per tile: all planes of a tile should stay in L1/L2 while the ops run */
+#define POST_BAND_TILE 32
+
+typedef struct {
+  vo_frame_t     *src, *dst;
+  post_band_op_t *ops;
+  int             num_ops;
+} post_band_job_t;
+
+static vf_alias_t *post_video_alias (vo_frame_t *frame) {
+  if ((frame->draw == post_frame_draw_plugin) || (frame->draw == post_frame_draw))
+    return (vf_alias_t *)frame;
+  return NULL;
+}
+
+static void post_band_slice (void *data, int band, int start, int end) {
+  post_band_job_t *job = (post_band_job_t *)data;
+  int y0, i;
+
+  (void)band;
+
+  for (y0 = start; y0 < end; y0 += POST_BAND_TILE) {
+    int y1 = (end - y0 > POST_BAND_TILE) ? y0 + POST_BAND_TILE : end;
+    job->ops[0].func (job->ops[0].data, job->src, job->dst, y0, y1);
+    for (i = 1; i < job->num_ops; i++)
+      job->ops[i].func (job->ops[i].data, job->dst, job->dst, y0, y1);
+  }
+}
+
+int _x_post_band_draw (vo_frame_t *frame, xine_stream_t *stream) {
+  post_video_port_t *port = _x_post_video_frame_to_port (frame);
+  vf_alias_t        *alias = post_video_alias (frame);
+  vf_alias_t        *next;
+  post_band_op_t     ops[POST_BAND_OPS_MAX];
+  post_band_job_t    job;
+  vo_frame_t        *out;
+  int                num_ops = 0, writable = 0, skip;
+
+  /* ops of the ports above */
+  if (alias) {
+    num_ops  = alias->num_ops;
+    writable = alias->writable;
+    memcpy (ops, alias->ops, num_ops * sizeof (ops[0]));
+    alias->num_ops  = 0;
+    alias->writable = 0;
+  }
+
+  if (!frame->bad_frame && (frame->format == XINE_IMGFMT_YV12) &&
+    (num_ops < POST_BAND_OPS_MAX) && port->band_op && port->band_op (port, frame, &ops[num_ops]))
+    num_ops++;
+
+  if (!num_ops || frame->bad_frame || (frame->format != XINE_IMGFMT_YV12))
+    return post_frame_draw (frame, stream);
+
+  /* the next port is a band filter as well: let it do our work, too */
+  next = post_video_alias (frame->next);
+  if (next && (next->frame.draw == post_frame_draw_plugin) && (num_ops < POST_BAND_OPS_MAX) &&
+    _x_post_video_frame_to_port (&next->frame)->band_op) {
+    memcpy (next->ops, ops, num_ops * sizeof (ops[0]));
+    next->num_ops  = num_ops;
+    next->writable = writable;
+    return post_frame_draw (frame, stream);
+  }
+
+  job.ops     = ops;
+  job.num_ops = num_ops;
+
+  if (writable) {
+    job.src = frame;
+    job.dst = frame;
+    _x_post_slices (port->post, frame->height, 2, post_band_slice, &job);
+    if (next)
+      next->writable = 1;
+    return post_frame_draw (frame, stream);
+  }
+
+  out = port->original_port->get_frame (port->original_port,
+    frame->width, frame->height, frame->ratio, XINE_IMGFMT_YV12, frame->flags | VO_BOTH_FIELDS);
+  _x_post_frame_copy_down (frame, out);
+
+  job.src = frame;
+  job.dst = out;
+  _x_post_slices (port->post, frame->height, 2, post_band_slice, &job);
+
+  _x_post_frame_writable (out);
+  skip = out->draw (out, stream);
+  _x_post_frame_copy_up (frame, out);
+  out->free (out);
+
+  return skip;
+}
+
+void _x_post_frame_writable (vo_frame_t *frame) {
+  vf_alias_t *alias = post_video_alias (frame);
+
+  if (alias)
+    alias->writable = 1;
+}
@@ -152,6 +152,18 @@ static void *video_decoder_loop (void *stream_gen) {
     _x_extra_info_merge( stream->video_decoder_extra_info, buf->extra_info );
     stream->video_decoder_extra_info->seek_count = stream->video_seek_count;
 
+    /* exact seek: the first video pts after seek tells how stream time maps to pts. */
+    if (buf->pts && stream->exact_seek_state && ((buf->type & BUF_MAJOR_MASK) == BUF_VIDEO_BASE)) {
+      pthread_mutex_lock (&stream->first_frame_lock);
+      if (stream->exact_seek_state == 1) {
+        stream->exact_seek_pts = buf->pts + (int64_t)(stream->exact_seek_time - buf->extra_info->input_time) * 90;
+        stream->exact_seek_last_pts = buf->pts;
+        stream->exact_seek_state = 2;
+        lprintf ("exact seek to pts %" PRId64 "\n", stream->exact_seek_pts);
+      }
+      pthread_mutex_unlock (&stream->first_frame_lock);
+    }
+
     lprintf ("got buffer 0x%08x\n", buf->type);
 
     switch (buf->type & 0xffff0000) {
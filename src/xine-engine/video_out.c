@@ -61,6 +61,10 @@
 #define FIRST_FRAME_POLL_DELAY   3000
 #define FIRST_FRAME_MAX_POLL       10    /* poll n times at most */
 
+/* exact seek: show frames anyway after dropping that many, in case
+ * decoder or demuxer timestamps do not match. */
+#define EXACT_SEEK_MAX_DROP       600
+
 /* experimental optimization: try to allocate frames from free queue
  * in the same format as requested (avoid unnecessary free/alloc in
  * vo driver). up to 25% less cpu load using deinterlace with film mode.
@@ -1331,10 +1335,53 @@ static vo_frame_t *vo_get_frame (xine_video_port_t *this_gen,
   return img;
 }
 
+/* exact seek: frames before the target are decoded for reference only.
+ * return 1 when this one shall be dropped, the decision is final. */
+int _x_exact_seek_drop (xine_stream_t *stream, int64_t pts) {
+  int reached = 0, dropped = 0;
+
+  /* unlocked hint, cheap for the common case. play () sets the state
+   * before the demuxer sends anything, and the decoder moves it to 2
+   * before it decodes the frames in question. */
+  if (!stream->exact_seek_state)
+    return 0;
+
+  pthread_mutex_lock (&stream->first_frame_lock);
+  if (stream->exact_seek_state == 2) {
+    /* a frame without pts is somewhere after the last one with pts */
+    if (pts)
+      stream->exact_seek_last_pts = pts;
+    if ((stream->exact_seek_last_pts < stream->exact_seek_pts) &&
+      (stream->exact_seek_dropped < EXACT_SEEK_MAX_DROP)) {
+      stream->exact_seek_dropped++;
+      pthread_mutex_unlock (&stream->first_frame_lock);
+      return 1;
+    }
+    stream->exact_seek_state = 0;
+    dropped = stream->exact_seek_dropped;
+    reached = 1;
+  }
+  pthread_mutex_unlock (&stream->first_frame_lock);
+
+  if (reached) {
+    struct timespec now;
+    int msecs;
+    xine_gettime (&now);
+    msecs = (now.tv_sec - stream->exact_seek_start.tv_sec) * 1000
+          + (now.tv_nsec - stream->exact_seek_start.tv_nsec) / 1000000;
+    _x_stream_info_set (stream, XINE_STREAM_INFO_SEEK_DROPPED_FRAMES, dropped);
+    _x_stream_info_set (stream, XINE_STREAM_INFO_SEEK_TIME, msecs);
+    xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+      "video_out: exact seek to %d ms reached after %d ms, %d frames dropped.\n",
+      stream->exact_seek_time, msecs, dropped);
+  }
+  return 0;
+}
+
 static int vo_frame_draw (vo_frame_t *img, xine_stream_t *stream) {
 
   vos_t         *this = (vos_t *) img->port;
-  int            frames_to_skip, first_frame_flag = 0;
+  int            frames_to_skip, first_frame_flag = 0, trick_play = 0;
 
   img->stream = NULL;
 
@@ -1347,7 +1394,11 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *stream) {
   /* handle anonymous streams like NULL for easy checking */
   if (stream == XINE_ANON_STREAM) stream = NULL;
 
+  if (stream && _x_exact_seek_drop (stream, img->pts))
+    return 0;
+
   if (stream) {
+    trick_play = stream->trick_speed;
     first_frame_flag = stream->first_frame_flag;
     if (first_frame_flag >= 2) {
       /* Frame reordering and/or multithreaded deoders feature an initial delay.
@@ -1636,6 +1687,11 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *stream) {
     this->num_frames_skipped   = 0;
   }
 
+  /* in trick play, only the keyframe is wanted. let decoders skip
+   * non reference frames that they may see before the next seek. */
+  if (trick_play && !frames_to_skip)
+    frames_to_skip = 1;
+
   return frames_to_skip;
 }
 
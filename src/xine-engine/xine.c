@@ -695,6 +695,7 @@ static void stop_internal (xine_stream_t *stream) {
     _x_demux_stop_thread( stream );
     lprintf ("demux stopped\n");
   }
+  stream->trick_speed = 0;
   lprintf ("done\n");
 }
 
@@ -921,6 +922,9 @@ xine_stream_t *xine_stream_new (xine_t *this, xine_audio_port_t *ao, xine_video_
   stream->s.audio_decoder_plugin   = NULL;
   stream->s.early_finish_event     = 0;
   stream->s.delay_finish_event     = 0;
+  stream->s.trick_speed            = 0;
+  stream->s.exact_seek             = 0;
+  stream->s.exact_seek_state       = 0;
   stream->s.gapless_switch         = 0;
   stream->s.keep_ao_driver_open    = 0;
   stream->s.video_channel          = 0;
@@ -993,6 +997,7 @@ xine_stream_t *xine_stream_new (xine_t *this, xine_audio_port_t *ao, xine_video_
   pthread_mutex_init (&stream->s.meta_mutex, NULL);
   pthread_mutex_init (&stream->s.demux_lock, NULL);
   pthread_mutex_init (&stream->s.demux_action_lock, NULL);
+  _x_io_wake_open (stream->s.demux_action_fd);
   pthread_mutex_init (&stream->s.demux_mutex, NULL);
   pthread_cond_init  (&stream->s.demux_resume, NULL);
   pthread_mutex_init (&stream->s.event_queues_lock, NULL);
@@ -1066,6 +1071,7 @@ xine_stream_t *xine_stream_new (xine_t *this, xine_audio_port_t *ao, xine_video_
   pthread_cond_destroy  (&stream->s.demux_resume);
   pthread_mutex_destroy (&stream->s.demux_mutex);
   pthread_mutex_destroy (&stream->s.demux_action_lock);
+  _x_io_wake_close      (stream->s.demux_action_fd);
   pthread_mutex_destroy (&stream->s.demux_lock);
   pthread_mutex_destroy (&stream->s.meta_mutex);
   pthread_mutex_destroy (&stream->s.info_mutex);
@@ -1757,6 +1763,16 @@ static int play_internal (xine_stream_t *stream, int start_pos, int start_time)
   /* before resuming the demuxer, set first_frame_flag */
   pthread_mutex_lock (&stream->first_frame_lock);
   stream->first_frame_flag = first_frame_flag;
+
+  /* exact seek: video decoder will find the target pts, see video_out.c */
+  if (stream->exact_seek && start_time && !start_pos) {
+    stream->exact_seek_time    = start_time;
+    stream->exact_seek_dropped = 0;
+    xine_gettime (&stream->exact_seek_start);
+    stream->exact_seek_state   = 1;
+  } else {
+    stream->exact_seek_state   = 0;
+  }
   pthread_mutex_unlock (&stream->first_frame_lock);
 
   /* before resuming the demuxer, reset current position information */
@@ -1871,6 +1887,7 @@ static void xine_dispose_internal (xine_stream_t *stream) {
   pthread_cond_destroy  (&stream->demux_resume);
   pthread_mutex_destroy (&stream->demux_mutex);
   pthread_mutex_destroy (&stream->demux_action_lock);
+  _x_io_wake_close      (stream->demux_action_fd);
   pthread_mutex_destroy (&stream->demux_lock);
   pthread_mutex_destroy (&stream->meta_mutex);
   pthread_mutex_destroy (&stream->info_mutex);
@@ -1974,6 +1991,12 @@ void xine_exit (xine_t *this) {
 
   xprintf (this, XINE_VERBOSITY_DEBUG, "xine_exit: bye!\n");
 
+  _x_io_reactor_dispose (this);
+  pthread_mutex_destroy (&this->io_reactor_lock);
+
+  _x_post_slices_dispose (this);
+  pthread_mutex_destroy (&this->post_slices_lock);
+
   _x_dispose_plugins (this);
 
   if(this->clock)
@@ -2019,6 +2042,8 @@ xine_t *xine_new (void) {
   this->streams        = NULL;
   this->clock          = NULL;
   this->port_ticket    = NULL;
+  this->io_reactor     = NULL;
+  this->post_slices    = NULL;
 #endif
 
 #ifdef ENABLE_NLS
@@ -2045,6 +2070,9 @@ xine_t *xine_new (void) {
   memset(this->log_buffers, 0, sizeof(this->log_buffers));
   pthread_mutex_init (&this->log_lock, NULL);
 
+  pthread_mutex_init (&this->io_reactor_lock, NULL);
+  pthread_mutex_init (&this->post_slices_lock, NULL);
+
   this->live_pause = 0;
   pthread_mutex_init (&this->pause_mutex, NULL);
 
@@ -2240,6 +2268,16 @@ void xine_init (xine_t *this) {
 	"connection is lost."),
       0, NULL, this);
 
+  /*
+   * how long host name lookups are reused
+   */
+  this->config->register_num(this->config,
+      "media.network.dns_cache_ttl", 60,
+      _("Time to keep resolved host names (in seconds)"),
+      _("Network streams reuse the addresses of a host name for this long "
+	"instead of asking the name server again. 0 disables the cache."),
+      20, NULL, this);
+
   /*
    * keep track of all opened streams
    */
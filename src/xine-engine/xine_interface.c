@@ -535,6 +535,20 @@ void xine_set_param (xine_stream_t *stream, int param, int value) {
     stream->delay_finish_event = value;
     break;
 
+  case XINE_PARAM_TRICK_PLAY:
+    if (value && (!stream->demux_plugin ||
+      !(stream->demux_plugin->get_capabilities (stream->demux_plugin) & DEMUX_CAP_TRICKPLAY))) {
+      xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+        "xine_interface: trick play not supported by this stream\n");
+      break;
+    }
+    stream->trick_speed = value;
+    break;
+
+  case XINE_PARAM_EXACT_SEEK:
+    stream->exact_seek = !!value;
+    break;
+
   case XINE_PARAM_GAPLESS_SWITCH:
     stream->gapless_switch = !!value;
     if( stream->gapless_switch && !stream->early_finish_event ) {
@@ -706,6 +720,14 @@ int xine_get_param (xine_stream_t *stream, int param) {
     ret = stream->gapless_switch;
     break;
 
+  case XINE_PARAM_TRICK_PLAY:
+    ret = stream->trick_speed;
+    break;
+
+  case XINE_PARAM_EXACT_SEEK:
+    ret = stream->exact_seek;
+    break;
+
   default:
     xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
 	     "xine_interface: unknown or deprecated stream param %d requested\n", param);
@@ -764,6 +786,21 @@ uint32_t xine_get_stream_info (xine_stream_t *stream, int info) {
   case XINE_STREAM_INFO_DVD_CHAPTER_COUNT:
   case XINE_STREAM_INFO_DVD_ANGLE_NUMBER:
   case XINE_STREAM_INFO_DVD_ANGLE_COUNT:
+  case XINE_STREAM_INFO_SEEK_DROPPED_FRAMES:
+  case XINE_STREAM_INFO_SEEK_TIME:
+  case XINE_STREAM_INFO_NET_LOST_PACKETS:
+  case XINE_STREAM_INFO_NET_REORDERED_PACKETS:
+  case XINE_STREAM_INFO_NET_LATE_PACKETS:
+  case XINE_STREAM_INFO_NET_VARIANT:
+  case XINE_STREAM_INFO_NET_THROUGHPUT:
+  case XINE_STREAM_INFO_NET_VARIANT_SWITCHES:
+  case XINE_STREAM_INFO_NET_BUFFER_LENGTH:
+  case XINE_STREAM_INFO_NET_RESOLVE_TIME:
+  case XINE_STREAM_INFO_NET_CONNECT_TIME:
+  case XINE_STREAM_INFO_NET_TLS_HANDSHAKES:
+  case XINE_STREAM_INFO_NET_TLS_RESUMED:
+  case XINE_STREAM_INFO_NET_REBUFFERS:
+  case XINE_STREAM_INFO_NET_REBUFFER_TIME:
     return _x_stream_info_get_public(stream, info);
 
   case XINE_STREAM_INFO_MAX_AUDIO_CHANNEL:
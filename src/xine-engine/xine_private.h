@@ -127,6 +127,29 @@ int _x_set_file_close_on_exec(int fd) INTERNAL;
 
 int _x_set_socket_close_on_exec(int s) INTERNAL;
 
+///@{
+/**
+ * @defgroup
+ * @brief  wakeup fd (readable while set) and shared network i/o threads
+ */
+int  _x_io_wake_open  (int fds[2]) INTERNAL;
+void _x_io_wake_close (int fds[2]) INTERNAL;
+void _x_io_wake_set   (int fds[2]) INTERNAL;
+void _x_io_wake_clear (int fds[2]) INTERNAL;
+
+void _x_io_reactor_dispose (xine_t *xine) INTERNAL;
+///@}
+
+/**
+ * @brief Exact seek: shall this frame be dropped? Counts the drop, the answer is final.
+ */
+int _x_exact_seek_drop (xine_stream_t *stream, int64_t pts) INTERNAL;
+
+/**
+ * @brief Stop the worker threads of _x_post_slices ().
+ */
+void _x_post_slices_dispose (xine_t *xine) INTERNAL;
+
 
 #if defined(HAVE_PTHREAD_RWLOCK)
 #  define xine_rwlock_t                pthread_rwlock_t
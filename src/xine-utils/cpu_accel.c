@@ -94,7 +94,7 @@ static uint32_t arch_accel (void)
            "=S" (ebx),                  \
            "=c" (ecx),                  \
            "=d" (edx)                   \
-         : "a" (op)                     \
+         : "a" (op), "c" (0)            \
          : "cc")
 #elif !defined(__PIC__)
 #define cpuid(op,eax,ebx,ecx,edx)       \
@@ -103,7 +103,7 @@ static uint32_t arch_accel (void)
            "=b" (ebx),                  \
            "=c" (ecx),                  \
            "=d" (edx)                   \
-         : "a" (op)                     \
+         : "a" (op), "c" (0)            \
          : "cc")
 #else   /* PIC version : save ebx */
 #define cpuid(op,eax,ebx,ecx,edx)       \
@@ -115,7 +115,7 @@ static uint32_t arch_accel (void)
            "=S" (ebx),                  \
            "=c" (ecx),                  \
            "=d" (edx)                   \
-         : "a" (op)                     \
+         : "a" (op), "c" (0)            \
          : "cc")
 #endif
 
@@ -196,6 +196,14 @@ static uint32_t arch_accel (void)
       __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c" (0));
       if ((eax & 0x6) == 0x6) {
 	caps |= MM_ACCEL_X86_AVX;
+
+	/* AVX2 is in the extended features leaf */
+	cpuid (0x00000000, eax, ebx, ecx, edx);
+	if (eax >= 7) {
+	  cpuid (0x00000007, eax, ebx, ecx, edx);
+	  if (ebx & 0x00000020)
+	    caps |= MM_ACCEL_X86_AVX2;
+	}
       }
 
     }
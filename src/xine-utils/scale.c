@@ -0,0 +1,609 @@
+/*
+ * Copyright (C) 2000-2018 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * Separable image scaler for 8 bit planes.
+ *
+ * Filtering runs horizontally first, into a small ring of 16 bit rows
+ * with SCALER_MID_BITS fraction bits, then vertically from that ring.
+ * Both filter banks are computed once per geometry: for every output
+ * sample, the first input sample and a fixed number of integer
+ * coefficients adding up to 1 << SCALER_COEF_BITS. Taps beyond the
+ * image borders are folded onto the edge samples, so the kernels never
+ * read outside of the source plane.
+ * The SIMD kernels are bit exact with the C ones.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <xine/xineutils.h>
+
+#define SCALER_COEF_BITS 14
+#define SCALER_MID_BITS   6
+#define SCALER_MAX_TAPS  64
+
+#define SCALER_H_SHIFT   (SCALER_COEF_BITS - SCALER_MID_BITS)
+#define SCALER_V_SHIFT   (SCALER_COEF_BITS + SCALER_MID_BITS)
+
+#define SCALER_ACCEL_C    0
+#define SCALER_ACCEL_SSE2 1
+#define SCALER_ACCEL_AVX2 2
+
+/* scratch buffers for that many callers of xine_scaler_rows () at a time.
+ * more parallel callers get a temporary one. */
+#define SCALER_SCRATCH 16
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7)))
+#  define SCRATCH_CLAIM(p)    (__atomic_exchange_n ((p), 1, __ATOMIC_ACQUIRE) == 0)
+#  define SCRATCH_RELEASE(p)  __atomic_store_n ((p), 0, __ATOMIC_RELEASE)
+#else
+#  define SCRATCH_CLAIM(p)    (__sync_lock_test_and_set ((p), 1) == 0)
+#  define SCRATCH_RELEASE(p)  __sync_lock_release (p)
+#endif
+
+typedef struct {
+  int      size;    /* output samples */
+  int      taps;    /* input samples per output sample */
+  int32_t *offs;    /* first input sample */
+  int16_t *coefs;   /* size * taps */
+  int16_t *simd;    /* horizontal coefs in the order of the SIMD kernel, or NULL */
+} scaler_bank_t;
+
+typedef struct {
+  int      busy;
+  uint8_t *mem;     /* allocated by the first user of the slot */
+} scaler_scratch_t;
+
+struct xine_scaler_s {
+  int              accel;
+  scaler_bank_t    h, v;
+  size_t           scratch_size;
+  scaler_scratch_t scratch[SCALER_SCRATCH];
+};
+
+
+static double scaler_sinc (double x) {
+  x *= M_PI;
+  return (x == 0.0) ? 1.0 : sin (x) / x;
+}
+
+static double scaler_kernel (int method, double x) {
+  x = fabs (x);
+  switch (method) {
+    case XINE_SCALER_BICUBIC:
+      /* Keys, a = -0.5 */
+      if (x < 1.0)
+        return (1.5 * x - 2.5) * x * x + 1.0;
+      if (x < 2.0)
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+      return 0.0;
+    case XINE_SCALER_LANCZOS:
+      return (x < 3.0) ? scaler_sinc (x) * scaler_sinc (x / 3.0) : 0.0;
+    default:
+      return (x < 1.0) ? 1.0 - x : 0.0;
+  }
+}
+
+static int scaler_bank_init (scaler_bank_t *b, int method, int src, int dst, int align) {
+  double  radius = (method == XINE_SCALER_LANCZOS) ? 3.0 : (method == XINE_SCALER_BICUBIC) ? 2.0 : 1.0;
+  double  scale  = (double)src / dst;
+  double  fscale = (scale > 1.0) ? scale : 1.0;
+  double  w[SCALER_MAX_TAPS];
+  int     n, i;
+
+  /* when downscaling, the kernel is stretched to the input sample distance */
+  if (radius * fscale * 2.0 > SCALER_MAX_TAPS - align)
+    fscale = (SCALER_MAX_TAPS - align) / (radius * 2.0);
+  n = (int)ceil (radius * fscale * 2.0);
+
+  b->size = dst;
+  b->taps = (n + align - 1) / align * align;
+  if (b->taps > src)
+    b->taps = src;
+  b->offs  = malloc (dst * sizeof (*b->offs));
+  b->coefs = calloc (dst * b->taps, sizeof (*b->coefs));
+  b->simd  = NULL;
+  if (!b->offs || !b->coefs)
+    return 0;
+
+  for (i = 0; i < dst; i++) {
+    double   center = (i + 0.5) * scale - 0.5;
+    int      left = (int)floor (center - radius * fscale) + 1;
+    int      off = left, k, big = 0, sum;
+    double   total = 0.0;
+    int16_t *c = b->coefs + i * b->taps;
+
+    if (off > src - b->taps)
+      off = src - b->taps;
+    if (off < 0)
+      off = 0;
+    b->offs[i] = off;
+
+    for (k = 0; k < b->taps; k++)
+      w[k] = 0.0;
+    for (k = 0; k < n; k++) {
+      int    j = left + k;
+      double v = scaler_kernel (method, (j - center) / fscale);
+      if (j < 0)
+        j = 0;
+      else if (j > src - 1)
+        j = src - 1;
+      w[j - off] += v;
+      total += v;
+    }
+
+    /* quantize, and give the rounding error to the largest tap */
+    sum = 0;
+    for (k = 0; k < b->taps; k++) {
+      c[k] = (int16_t)lrint (w[k] / total * (1 << SCALER_COEF_BITS));
+      sum += c[k];
+      if (c[k] > c[big])
+        big = k;
+    }
+    c[big] += (1 << SCALER_COEF_BITS) - sum;
+  }
+
+  return 1;
+}
+
+static void scaler_bank_free (scaler_bank_t *b) {
+  _x_freep (&b->offs);
+  _x_freep (&b->coefs);
+  xine_freep_aligned (&b->simd);
+}
+
+
+/*
+ * C kernels
+ */
+
+static void scaler_h_c (const scaler_bank_t *b, const uint8_t *src, int step, int16_t *dst, int x) {
+  for (; x < b->size; x++) {
+    const uint8_t *s = src + b->offs[x] * step;
+    const int16_t *c = b->coefs + x * b->taps;
+    int sum = 1 << (SCALER_H_SHIFT - 1), t;
+
+    for (t = 0; t < b->taps; t++)
+      sum += s[t * step] * c[t];
+    /* cannot leave the int16_t range: filters overshoot by less than 2 */
+    dst[x] = sum >> SCALER_H_SHIFT;
+  }
+}
+
+static void scaler_v_c (int16_t *const *rows, const int16_t *c, int taps,
+                        uint8_t *dst, int step, int x, int width) {
+  for (; x < width; x++) {
+    int sum = 1 << (SCALER_V_SHIFT - 1), t;
+
+    for (t = 0; t < taps; t++)
+      sum += rows[t][x] * c[t];
+    sum >>= SCALER_V_SHIFT;
+    dst[x * step] = (sum < 0) ? 0 : (sum > 255) ? 255 : sum;
+  }
+}
+
+
+#if defined(ARCH_X86_64)
+
+/* pairs of vertical coefs for pmaddwd */
+static uint32_t scaler_v_pair (int16_t *const *rows, const int16_t *c, int taps, int t,
+                               const int16_t **a, const int16_t **b) {
+  *a = rows[t];
+  if (t + 1 < taps) {
+    *b = rows[t + 1];
+    return (uint16_t)c[t] | ((uint32_t)(uint16_t)c[t + 1] << 16);
+  }
+  *b = rows[t];
+  return (uint16_t)c[t];
+}
+
+/* simd coef order: per block of 4 outputs and group of 4 taps, the 4 taps of
+ * output 0, 1, 2 and 3 */
+static void scaler_h_sse2_order (scaler_bank_t *b) {
+  int groups = b->taps >> 2, x, g;
+
+  for (x = 0; x < (b->size & ~3); x++) {
+    for (g = 0; g < groups; g++)
+      memcpy (b->simd + ((x >> 2) * groups + g) * 16 + (x & 3) * 4,
+              b->coefs + x * b->taps + g * 4, 4 * sizeof (int16_t));
+  }
+}
+
+static int scaler_h_sse2 (const scaler_bank_t *b, const uint8_t *src, int16_t *dst) {
+  const int16_t *c = b->simd;
+  int x;
+
+  for (x = 0; x + 4 <= b->size; x += 4) {
+    const uint8_t *s0 = src + b->offs[x], *s1 = src + b->offs[x + 1];
+    const uint8_t *s2 = src + b->offs[x + 2], *s3 = src + b->offs[x + 3];
+    long n = b->taps >> 2;
+
+    __asm__ __volatile__ (
+      "pxor      %%xmm7, %%xmm7         \n\t"
+      "movd      %7, %%xmm6             \n\t"
+      "pshufd    $0, %%xmm6, %%xmm6     \n\t"
+      "1:                               \n\t"
+      "movd      (%0), %%xmm0           \n\t"
+      "movd      (%1), %%xmm1           \n\t"
+      "movd      (%2), %%xmm2           \n\t"
+      "movd      (%3), %%xmm3           \n\t"
+      "punpckldq %%xmm1, %%xmm0         \n\t"
+      "punpckldq %%xmm3, %%xmm2         \n\t"
+      "punpcklbw %%xmm7, %%xmm0         \n\t"
+      "punpcklbw %%xmm7, %%xmm2         \n\t"
+      "movdqu    (%4), %%xmm4           \n\t"
+      "movdqu    16(%4), %%xmm5         \n\t"
+      "pmaddwd   %%xmm4, %%xmm0         \n\t"
+      "pmaddwd   %%xmm5, %%xmm2         \n\t"
+      /* sum up the 2 halves of each output */
+      "movdqa    %%xmm0, %%xmm1         \n\t"
+      "shufps    $0x88, %%xmm2, %%xmm0  \n\t"
+      "shufps    $0xdd, %%xmm2, %%xmm1  \n\t"
+      "paddd     %%xmm0, %%xmm6         \n\t"
+      "paddd     %%xmm1, %%xmm6         \n\t"
+      "add       $4, %0                 \n\t"
+      "add       $4, %1                 \n\t"
+      "add       $4, %2                 \n\t"
+      "add       $4, %3                 \n\t"
+      "add       $32, %4                \n\t"
+      "dec       %5                     \n\t"
+      "jnz       1b                     \n\t"
+      "psrad     %8, %%xmm6             \n\t"
+      "packssdw  %%xmm6, %%xmm6         \n\t"
+      "movq      %%xmm6, (%6)           \n\t"
+      : "+r" (s0), "+r" (s1), "+r" (s2), "+r" (s3), "+r" (c), "+r" (n)
+      : "r" (dst + x), "r" (1 << (SCALER_H_SHIFT - 1)), "i" (SCALER_H_SHIFT)
+      : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+  }
+  return x;
+}
+
+static void scaler_v_sse2 (int16_t *const *rows, const int16_t *c, int taps,
+                           int32_t *acc, uint8_t *dst, int width) {
+  int n = (width + 7) & ~7, t, x;
+
+  for (x = 0; x < n; x++)
+    acc[x] = 1 << (SCALER_V_SHIFT - 1);
+
+  for (t = 0; t < taps; t += 2) {
+    const int16_t *a, *b;
+    uint32_t cc = scaler_v_pair (rows, c, taps, t, &a, &b);
+
+    for (x = 0; x < n; x += 8) {
+      __asm__ __volatile__ (
+        "movd      %3, %%xmm6             \n\t"
+        "pshufd    $0, %%xmm6, %%xmm6     \n\t"
+        "movdqu    (%0), %%xmm0           \n\t"
+        "movdqu    (%1), %%xmm1           \n\t"
+        "movdqa    %%xmm0, %%xmm2         \n\t"
+        "punpcklwd %%xmm1, %%xmm0         \n\t"
+        "punpckhwd %%xmm1, %%xmm2         \n\t"
+        "pmaddwd   %%xmm6, %%xmm0         \n\t"
+        "pmaddwd   %%xmm6, %%xmm2         \n\t"
+        "movdqu    (%2), %%xmm3           \n\t"
+        "movdqu    16(%2), %%xmm4         \n\t"
+        "paddd     %%xmm3, %%xmm0         \n\t"
+        "paddd     %%xmm4, %%xmm2         \n\t"
+        "movdqu    %%xmm0, (%2)           \n\t"
+        "movdqu    %%xmm2, 16(%2)         \n\t"
+        : : "r" (a + x), "r" (b + x), "r" (acc + x), "r" (cc)
+        : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm6");
+    }
+  }
+
+  for (x = 0; x + 8 <= width; x += 8) {
+    __asm__ __volatile__ (
+      "movdqu    (%0), %%xmm0           \n\t"
+      "movdqu    16(%0), %%xmm1         \n\t"
+      "psrad     %2, %%xmm0             \n\t"
+      "psrad     %2, %%xmm1             \n\t"
+      "packssdw  %%xmm1, %%xmm0         \n\t"
+      "packuswb  %%xmm0, %%xmm0         \n\t"
+      "movq      %%xmm0, (%1)           \n\t"
+      : : "r" (acc + x), "r" (dst + x), "i" (SCALER_V_SHIFT)
+      : "memory", "xmm0", "xmm1");
+  }
+  scaler_v_c (rows, c, taps, dst, 1, x, width);
+}
+
+#if defined(HAVE_AVX2)
+/* simd coef order: per block of 8 outputs and group of 4 taps, the 4 taps of
+ * output 0, 1, 4, 5, 2, 3, 6 and 7, matching the lanes of the unpacked gather */
+static void scaler_h_avx2_order (scaler_bank_t *b) {
+  static const uint8_t slot[8] = { 0, 1, 4, 5, 2, 3, 6, 7 };
+  int groups = b->taps >> 2, x, g;
+
+  for (x = 0; x < (b->size & ~7); x++) {
+    for (g = 0; g < groups; g++)
+      memcpy (b->simd + ((x >> 3) * groups + g) * 32 + slot[x & 7] * 4,
+              b->coefs + x * b->taps + g * 4, 4 * sizeof (int16_t));
+  }
+}
+
+static int scaler_h_avx2 (const scaler_bank_t *b, const uint8_t *src, int16_t *dst) {
+  const int16_t *c = b->simd;
+  int x;
+
+  for (x = 0; x + 8 <= b->size; x += 8) {
+    long n = b->taps >> 2;
+
+    __asm__ __volatile__ (
+      "vmovdqu    (%3), %%ymm5                      \n\t"
+      "vpxor      %%ymm6, %%ymm6, %%ymm6            \n\t"
+      "vpxor      %%ymm7, %%ymm7, %%ymm7            \n\t"
+      "movl       $4, %%eax                         \n\t"
+      "vmovd      %%eax, %%xmm3                     \n\t"
+      "vpbroadcastd %%xmm3, %%ymm3                  \n\t"
+      "1:                                           \n\t"
+      "vpcmpeqd   %%ymm4, %%ymm4, %%ymm4            \n\t"
+      "vpgatherdd %%ymm4, (%2,%%ymm5,1), %%ymm0     \n\t"
+      "vpaddd     %%ymm3, %%ymm5, %%ymm5            \n\t"
+      "vpunpckhbw %%ymm7, %%ymm0, %%ymm1            \n\t"
+      "vpunpcklbw %%ymm7, %%ymm0, %%ymm0            \n\t"
+      "vpmaddwd   (%0), %%ymm0, %%ymm0              \n\t"
+      "vpmaddwd   32(%0), %%ymm1, %%ymm1            \n\t"
+      /* sum up the 2 halves of each output */
+      "vshufps    $0x88, %%ymm1, %%ymm0, %%ymm2     \n\t"
+      "vshufps    $0xdd, %%ymm1, %%ymm0, %%ymm0     \n\t"
+      "vpaddd     %%ymm2, %%ymm6, %%ymm6            \n\t"
+      "vpaddd     %%ymm0, %%ymm6, %%ymm6            \n\t"
+      "add        $64, %0                           \n\t"
+      "dec        %1                                \n\t"
+      "jnz        1b                                \n\t"
+      "vmovd      %5, %%xmm3                        \n\t"
+      "vpbroadcastd %%xmm3, %%ymm3                  \n\t"
+      "vpaddd     %%ymm3, %%ymm6, %%ymm6            \n\t"
+      "vpsrad     %6, %%ymm6, %%ymm6                \n\t"
+      "vpackssdw  %%ymm6, %%ymm6, %%ymm6            \n\t"
+      "vpermq     $0x08, %%ymm6, %%ymm6             \n\t"
+      "vmovdqu    %%xmm6, (%4)                      \n\t"
+      : "+r" (c), "+r" (n)
+      : "r" (src), "r" (b->offs + x), "r" (dst + x), "r" (1 << (SCALER_H_SHIFT - 1)), "i" (SCALER_H_SHIFT)
+      : "memory", "eax", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+  }
+  __asm__ __volatile__ ("vzeroupper");
+  return x;
+}
+
+static void scaler_v_avx2 (int16_t *const *rows, const int16_t *c, int taps,
+                           int32_t *acc, uint8_t *dst, int width) {
+  int n = (width + 15) & ~15, t, x;
+
+  for (x = 0; x < n; x++)
+    acc[x] = 1 << (SCALER_V_SHIFT - 1);
+
+  /* acc holds outputs 0-3, 8-11, 4-7, 12-15 of each block */
+  for (t = 0; t < taps; t += 2) {
+    const int16_t *a, *b;
+    uint32_t cc = scaler_v_pair (rows, c, taps, t, &a, &b);
+
+    for (x = 0; x < n; x += 16) {
+      __asm__ __volatile__ (
+        "vmovd      %3, %%xmm6                 \n\t"
+        "vpbroadcastd %%xmm6, %%ymm6           \n\t"
+        "vmovdqu    (%0), %%ymm0               \n\t"
+        "vmovdqu    (%1), %%ymm1               \n\t"
+        "vpunpckhwd %%ymm1, %%ymm0, %%ymm2     \n\t"
+        "vpunpcklwd %%ymm1, %%ymm0, %%ymm0     \n\t"
+        "vpmaddwd   %%ymm6, %%ymm0, %%ymm0     \n\t"
+        "vpmaddwd   %%ymm6, %%ymm2, %%ymm2     \n\t"
+        "vpaddd     (%2), %%ymm0, %%ymm0       \n\t"
+        "vpaddd     32(%2), %%ymm2, %%ymm2     \n\t"
+        "vmovdqu    %%ymm0, (%2)               \n\t"
+        "vmovdqu    %%ymm2, 32(%2)             \n\t"
+        : : "r" (a + x), "r" (b + x), "r" (acc + x), "r" (cc)
+        : "memory", "xmm0", "xmm1", "xmm2", "xmm6");
+    }
+  }
+
+  for (x = 0; x + 16 <= width; x += 16) {
+    __asm__ __volatile__ (
+      "vmovdqu    (%0), %%ymm0               \n\t"
+      "vmovdqu    32(%0), %%ymm1             \n\t"
+      "vpsrad     %2, %%ymm0, %%ymm0         \n\t"
+      "vpsrad     %2, %%ymm1, %%ymm1         \n\t"
+      "vpackssdw  %%ymm1, %%ymm0, %%ymm0     \n\t"
+      "vpackuswb  %%ymm0, %%ymm0, %%ymm0     \n\t"
+      "vpermq     $0x08, %%ymm0, %%ymm0      \n\t"
+      "vmovdqu    %%xmm0, (%1)               \n\t"
+      : : "r" (acc + x), "r" (dst + x), "i" (SCALER_V_SHIFT)
+      : "memory", "xmm0", "xmm1");
+  }
+  __asm__ __volatile__ ("vzeroupper");
+  scaler_v_c (rows, c, taps, dst, 1, x, width);
+}
+#endif /* HAVE_AVX2 */
+
+#endif /* ARCH_X86_64 */
+
+
+xine_scaler_t *xine_scaler_new (int method, int src_width, int src_height, int dst_width, int dst_height) {
+  xine_scaler_t *s;
+
+  if ((src_width < 1) || (src_height < 1) || (dst_width < 1) || (dst_height < 1))
+    return NULL;
+
+  s = calloc (1, sizeof (*s));
+  if (!s)
+    return NULL;
+
+  /* horizontal taps come in groups of 4, vertical ones in pairs */
+  if (!scaler_bank_init (&s->h, method, src_width, dst_width, 4) ||
+      !scaler_bank_init (&s->v, method, src_height, dst_height, 2)) {
+    xine_scaler_delete (s);
+    return NULL;
+  }
+
+  /* ring of horizontally scaled rows, accumulator and output line,
+   * all rounded up to whole SIMD blocks */
+  {
+    size_t pw = (s->h.size + 15) & ~15;
+    s->scratch_size = s->v.taps * pw * sizeof (int16_t) + pw * sizeof (int32_t) + pw;
+  }
+
+#if defined(ARCH_X86_64)
+  {
+    uint32_t accel = xine_mm_accel ();
+
+    if (accel & MM_ACCEL_X86_SSE2)
+      s->accel = SCALER_ACCEL_SSE2;
+#  if defined(HAVE_AVX2)
+    if (accel & MM_ACCEL_X86_AVX2)
+      s->accel = SCALER_ACCEL_AVX2;
+#  endif
+
+    /* a tiny source may have left an odd number of taps */
+    if ((s->accel != SCALER_ACCEL_C) && !(s->h.taps & 3)) {
+      s->h.simd = xine_mallocz_aligned (s->h.size * s->h.taps * sizeof (int16_t));
+      if (s->h.simd) {
+#  if defined(HAVE_AVX2)
+        if (s->accel == SCALER_ACCEL_AVX2)
+          scaler_h_avx2_order (&s->h);
+        else
+#  endif
+          scaler_h_sse2_order (&s->h);
+      }
+    }
+  }
+#endif
+
+  return s;
+}
+
+void xine_scaler_delete (xine_scaler_t *s) {
+  int i;
+
+  if (!s)
+    return;
+  for (i = 0; i < SCALER_SCRATCH; i++)
+    xine_freep_aligned (&s->scratch[i].mem);
+  scaler_bank_free (&s->h);
+  scaler_bank_free (&s->v);
+  free (s);
+}
+
+static void scaler_h (const xine_scaler_t *s, const uint8_t *src, int step, int16_t *dst) {
+  int x = 0;
+
+#if defined(ARCH_X86_64)
+  if (s->h.simd && (step == 1)) {
+#  if defined(HAVE_AVX2)
+    if (s->accel == SCALER_ACCEL_AVX2)
+      x = scaler_h_avx2 (&s->h, src, dst);
+    else
+#  endif
+      x = scaler_h_sse2 (&s->h, src, dst);
+  }
+#endif
+  scaler_h_c (&s->h, src, step, dst, x);
+}
+
+static void scaler_v (const xine_scaler_t *s, int16_t *const *rows, const int16_t *c,
+                      int32_t *acc, uint8_t *dst, int step, uint8_t *line) {
+  int width = s->h.size, x;
+
+#if defined(ARCH_X86_64)
+  if (s->accel != SCALER_ACCEL_C) {
+    uint8_t *out = (step == 1) ? dst : line;
+
+#  if defined(HAVE_AVX2)
+    if (s->accel == SCALER_ACCEL_AVX2)
+      scaler_v_avx2 (rows, c, s->v.taps, acc, out, width);
+    else
+#  endif
+      scaler_v_sse2 (rows, c, s->v.taps, acc, out, width);
+    if (step != 1) {
+      for (x = 0; x < width; x++)
+        dst[x * step] = line[x];
+    }
+    return;
+  }
+#else
+  (void)acc;
+  (void)line;
+  (void)x;
+#endif
+  scaler_v_c (rows, c, s->v.taps, dst, step, 0, width);
+}
+
+void xine_scaler_rows (xine_scaler_t *s, const uint8_t *src, int src_pitch, int src_step,
+                       uint8_t *dst, int dst_pitch, int dst_step, int y0, int y1) {
+  /* room for whole SIMD blocks */
+  int      pw = (s->h.size + 15) & ~15;
+  int      taps = s->v.taps, have, y, k;
+  int16_t *ring, *rows[SCALER_MAX_TAPS];
+  int32_t *acc;
+  uint8_t *mem, *line;
+  scaler_scratch_t *slot = NULL;
+
+  if (y1 > s->v.size)
+    y1 = s->v.size;
+  if (y0 >= y1)
+    return;
+
+  /* scratch needs no clearing. ring rows are written before use, and the
+   * SIMD padding behind h.size only feeds results that are never stored. */
+  for (k = 0; k < SCALER_SCRATCH; k++) {
+    if (SCRATCH_CLAIM (&s->scratch[k].busy)) {
+      slot = &s->scratch[k];
+      break;
+    }
+  }
+  if (slot) {
+    if (!slot->mem)
+      slot->mem = xine_malloc_aligned (s->scratch_size);
+    mem = slot->mem;
+  } else {
+    mem = xine_malloc_aligned (s->scratch_size);
+  }
+  if (!mem) {
+    if (slot)
+      SCRATCH_RELEASE (&slot->busy);
+    return;
+  }
+  ring = (int16_t *)mem;
+  acc  = (int32_t *)(ring + taps * pw);
+  line = (uint8_t *)(acc + pw);
+
+  /* input rows of the ring, from first to have - 1, in slot row % taps.
+   * first rows only grow with y, so a row is dropped after its last use. */
+  have = s->v.offs[y0];
+  for (y = y0; y < y1; y++) {
+    int first = s->v.offs[y];
+
+    if (have < first)
+      have = first;
+    for (; have < first + taps; have++)
+      scaler_h (s, src + have * src_pitch, src_step, ring + (have % taps) * pw);
+
+    for (k = 0; k < taps; k++)
+      rows[k] = ring + ((first + k) % taps) * pw;
+    scaler_v (s, rows, s->v.coefs + y * taps, acc, dst + y * dst_pitch, dst_step, line);
+  }
+
+  if (slot)
+    SCRATCH_RELEASE (&slot->busy);
+  else
+    xine_free_aligned (mem);
+}